@@ -0,0 +1,138 @@
+//===- AnalysisCaches.cpp - SCEV and LVI queries on huge functions --------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Compile-time benchmarks for ScalarEvolution and LazyValueInfo on generated
+// functions with thousands of loops, the shape of machine-generated code whose
+// analysis caches grow without bound. The first argument is the number of
+// loops, the second one the cache limit, where zero is unlimited.
+//
+//===----------------------------------------------------------------------===//
+
+#include "benchmark/benchmark.h"
+#include "llvm/Analysis/AssumptionCache.h"
+#include "llvm/Analysis/LazyValueInfo.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+extern cl::opt<unsigned> SCEVMaxCachedValues;
+extern cl::opt<unsigned> SCEVMaxCachedBackedgeTakenCounts;
+extern cl::opt<unsigned> LVIMaxCachedBlocks;
+
+// Each loop has a diamond in its body and an accumulator. The accumulators do
+// not feed each other, whose SCEVs would grow with the number of loops.
+static std::unique_ptr<Module> makeModule(LLVMContext &Ctx,
+                                          unsigned NumLoops) {
+  std::string IR;
+  raw_string_ostream OS(IR);
+  OS << "define i64 @f(i64 %n, ptr %p) {\n"
+     << "entry:\n"
+     << "  br label %h0\n";
+  for (unsigned I = 0; I != NumLoops; ++I) {
+    std::string Exit = I + 1 == NumLoops ? "exit" : "h" + std::to_string(I + 1);
+    std::string Pred = I ? "%l" + std::to_string(I - 1) : "%entry";
+    OS << "h" << I << ":\n"
+       << "  %iv" << I << " = phi i64 [ 0, " << Pred << " ], [ %iv" << I
+       << ".next, %l" << I << " ]\n"
+       << "  %s" << I << " = phi i64 [ %n, " << Pred
+       << " ], [ %s" << I << ".next, %l" << I << " ]\n"
+       << "  %c" << I << " = icmp ult i64 %iv" << I << ", " << (I % 64 + 1)
+       << "\n"
+       << "  br i1 %c" << I << ", label %t" << I << ", label %e" << I << "\n"
+       << "t" << I << ":\n"
+       << "  %x" << I << " = add nuw i64 %iv" << I << ", " << I << "\n"
+       << "  br label %l" << I << "\n"
+       << "e" << I << ":\n"
+       << "  %y" << I << " = load i64, ptr %p\n"
+       << "  br label %l" << I << "\n"
+       << "l" << I << ":\n"
+       << "  %m" << I << " = phi i64 [ %x" << I << ", %t" << I << " ], [ %y"
+       << I << ", %e" << I << " ]\n"
+       << "  store i64 %m" << I << ", ptr %p\n"
+       << "  %s" << I << ".next = add i64 %s" << I << ", " << (I + 1) << "\n"
+       << "  %iv" << I << ".next = add nuw i64 %iv" << I << ", 1\n"
+       << "  %b" << I << " = icmp ult i64 %iv" << I << ".next, %n\n"
+       << "  br i1 %b" << I << ", label %h" << I << ", label %" << Exit
+       << "\n";
+  }
+  OS << "exit:\n"
+     << "  ret i64 %s" << (NumLoops - 1) << ".next\n"
+     << "}\n";
+
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(IR, Err, Ctx);
+  if (!M)
+    report_fatal_error("failed to parse the module");
+  return M;
+}
+
+static void BM_ScalarEvolution(benchmark::State &State) {
+  LLVMContext Ctx;
+  std::unique_ptr<Module> M = makeModule(Ctx, State.range(0));
+  Function &F = *M->getFunction("f");
+  TargetLibraryInfoImpl TLII;
+  TargetLibraryInfo TLI(TLII);
+  AssumptionCache AC(F);
+  DominatorTree DT(F);
+  LoopInfo LI(DT);
+  unsigned OldMaxValues = SCEVMaxCachedValues;
+  unsigned OldMaxCounts = SCEVMaxCachedBackedgeTakenCounts;
+  SCEVMaxCachedValues = State.range(1);
+  SCEVMaxCachedBackedgeTakenCounts = State.range(1) / 4;
+
+  for (auto _ : State) {
+    ScalarEvolution SE(F, TLI, AC, DT, LI);
+    for (Loop *L : LI)
+      benchmark::DoNotOptimize(SE.getBackedgeTakenCount(L));
+    for (Instruction &I : instructions(F))
+      if (SE.isSCEVable(I.getType()))
+        benchmark::DoNotOptimize(SE.getSCEVAtScope(&I, nullptr));
+  }
+
+  SCEVMaxCachedValues = OldMaxValues;
+  SCEVMaxCachedBackedgeTakenCounts = OldMaxCounts;
+}
+// Proving that the loops are entered walks the dominators of their preheaders,
+// which makes the queries quadratic in the number of loops.
+BENCHMARK(BM_ScalarEvolution)
+    ->ArgsProduct({{100, 400}, {0, 256}})
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_LazyValueInfo(benchmark::State &State) {
+  LLVMContext Ctx;
+  std::unique_ptr<Module> M = makeModule(Ctx, State.range(0));
+  Function &F = *M->getFunction("f");
+  AssumptionCache AC(F);
+  unsigned OldMaxBlocks = LVIMaxCachedBlocks;
+  LVIMaxCachedBlocks = State.range(1);
+
+  for (auto _ : State) {
+    LazyValueInfo LVI(&AC, &M->getDataLayout());
+    for (Instruction &I : instructions(F))
+      if (auto *Cmp = dyn_cast<ICmpInst>(&I))
+        benchmark::DoNotOptimize(
+            LVI.getConstantRange(Cmp->getOperand(0), Cmp, false));
+  }
+
+  LVIMaxCachedBlocks = OldMaxBlocks;
+}
+BENCHMARK(BM_LazyValueInfo)
+    ->ArgsProduct({{1000, 10000}, {0, 4000}})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
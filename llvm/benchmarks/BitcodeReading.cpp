@@ -0,0 +1,174 @@
+//===- BitcodeReading.cpp - Bitstream records and function bodies ---------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// BM_ReadRecords walks every block and record of a bitcode file the way
+// llvm-bcanalyzer does, which is mostly VBR decoding. BM_MaterializeFunctions
+// lazily loads the same file and materializes all of its functions with
+// Module::materializeFunctions; its argument is the number of threads, zero
+// selects Module::materializeAll.
+//
+//===----------------------------------------------------------------------===//
+
+#include "benchmark/benchmark.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Bitstream/BitstreamReader.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+// Each function has a few blocks of arithmetic on large constants, which are
+// written as unabbreviated records with wide VBR operands.
+static SmallVector<char, 0> makeBitcode(unsigned NumFunctions) {
+  std::string IR;
+  raw_string_ostream OS(IR);
+  OS << "@g = global i64 0\n";
+  for (unsigned I = 0; I != NumFunctions; ++I) {
+    OS << "define i64 @f" << I << "(i64 %x, ptr %p) {\n"
+       << "entry:\n"
+       << "  %a = add i64 %x, " << (1000000007ull * (I + 1)) << "\n"
+       << "  %b = mul i64 %a, " << (998244353ull * (I + 3)) << "\n"
+       << "  %l = load i64, ptr %p\n"
+       << "  %c = icmp ult i64 %b, %l\n"
+       << "  br i1 %c, label %t, label %e\n"
+       << "t:\n"
+       << "  %d = xor i64 %b, " << (0x123456789abull + I) << "\n"
+       << "  store i64 %d, ptr @g\n"
+       << "  br label %e\n"
+       << "e:\n"
+       << "  %r = phi i64 [ %d, %t ], [ %a, %entry ]\n"
+       << "  ret i64 %r\n"
+       << "}\n";
+  }
+
+  LLVMContext Ctx;
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(IR, Err, Ctx);
+  if (!M)
+    report_fatal_error("failed to parse the module");
+  SmallVector<char, 0> Buffer;
+  raw_svector_ostream BOS(Buffer);
+  WriteBitcodeToFile(*M, BOS);
+  return Buffer;
+}
+
+static Error readBlock(BitstreamCursor &Cursor, BitstreamBlockInfo &BlockInfo,
+                       SmallVectorImpl<uint64_t> &Record, size_t &NumRecords) {
+  while (true) {
+    Expected<BitstreamEntry> Entry = Cursor.advance();
+    if (!Entry)
+      return Entry.takeError();
+    switch (Entry->Kind) {
+    case BitstreamEntry::Error:
+      return createStringError(inconvertibleErrorCode(), "malformed block");
+    case BitstreamEntry::EndBlock:
+      return Error::success();
+    case BitstreamEntry::SubBlock:
+      if (Entry->ID == bitc::BLOCKINFO_BLOCK_ID) {
+        Expected<std::optional<BitstreamBlockInfo>> NewBlockInfo =
+            Cursor.ReadBlockInfoBlock();
+        if (!NewBlockInfo)
+          return NewBlockInfo.takeError();
+        BlockInfo = std::move(**NewBlockInfo);
+        break;
+      }
+      if (Error Err = Cursor.EnterSubBlock(Entry->ID))
+        return Err;
+      if (Error Err = readBlock(Cursor, BlockInfo, Record, NumRecords))
+        return Err;
+      break;
+    case BitstreamEntry::Record:
+      Record.clear();
+      if (Expected<unsigned> Code = Cursor.readRecord(Entry->ID, Record); !Code)
+        return Code.takeError();
+      ++NumRecords;
+      break;
+    }
+  }
+}
+
+static void BM_ReadRecords(benchmark::State &State) {
+  SmallVector<char, 0> Buffer = makeBitcode(State.range(0));
+  ArrayRef<uint8_t> Bytes(reinterpret_cast<const uint8_t *>(Buffer.data()),
+                          Buffer.size());
+  SmallVector<uint64_t, 64> Record;
+  for (auto _ : State) {
+    BitstreamBlockInfo BlockInfo;
+    BitstreamCursor Cursor(Bytes);
+    Cursor.setBlockInfo(&BlockInfo);
+    size_t NumRecords = 0;
+    // Skip the magic number, then read the top-level blocks.
+    if (Error Err = Cursor.JumpToBit(32)) {
+      State.SkipWithError(toString(std::move(Err)).c_str());
+      return;
+    }
+    while (!Cursor.AtEndOfStream()) {
+      Expected<BitstreamEntry> Entry = Cursor.advance();
+      Error Err = Entry.takeError();
+      if (!Err && Entry->Kind != BitstreamEntry::SubBlock)
+        break;
+      if (!Err)
+        Err = Cursor.EnterSubBlock(Entry->ID);
+      if (!Err)
+        Err = readBlock(Cursor, BlockInfo, Record, NumRecords);
+      if (Err) {
+        State.SkipWithError(toString(std::move(Err)).c_str());
+        return;
+      }
+    }
+    benchmark::DoNotOptimize(NumRecords);
+  }
+  State.SetBytesProcessed(State.iterations() * Buffer.size());
+}
+BENCHMARK(BM_ReadRecords)->Arg(1000)->Arg(20000)->Unit(benchmark::kMicrosecond);
+
+static void BM_MaterializeFunctions(benchmark::State &State) {
+  const unsigned Threads = State.range(0);
+  SmallVector<char, 0> Buffer = makeBitcode(State.range(1));
+  MemoryBufferRef Ref(StringRef(Buffer.data(), Buffer.size()), "bench");
+
+  for (auto _ : State) {
+    State.PauseTiming();
+    auto Ctx = std::make_unique<LLVMContext>();
+    Expected<std::unique_ptr<Module>> M = getLazyBitcodeModule(Ref, *Ctx);
+    if (!M) {
+      State.SkipWithError(toString(M.takeError()).c_str());
+      return;
+    }
+    std::vector<Function *> Fns;
+    for (Function &F : **M)
+      Fns.push_back(&F);
+    State.ResumeTiming();
+
+    Error Err = Threads ? (*M)->materializeFunctions(
+                              Fns, hardware_concurrency(Threads))
+                        : (*M)->materializeAll();
+    if (Err) {
+      State.SkipWithError(toString(std::move(Err)).c_str());
+      return;
+    }
+
+    // Destroying the module is not part of the measurement.
+    State.PauseTiming();
+    M->reset();
+    Ctx.reset();
+    State.ResumeTiming();
+  }
+  State.SetBytesProcessed(State.iterations() * Buffer.size());
+}
+BENCHMARK(BM_MaterializeFunctions)
+    ->ArgsProduct({{0, 1, 2, 4}, {1000, 20000}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
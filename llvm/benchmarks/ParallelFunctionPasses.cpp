@@ -0,0 +1,105 @@
+//===- ParallelFunctionPasses.cpp - Threaded function pipelines -----------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Compares a function pass pipeline run by the module to function adaptor with
+// the same pipeline run by the parallel one on 1 to 8 threads, on a module
+// with many small functions. The argument of BM_FunctionPipeline is the number
+// of threads, zero selects the sequential adaptor.
+//
+//===----------------------------------------------------------------------===//
+
+#include "benchmark/benchmark.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+static const char *FunctionPipeline =
+    "instcombine,simplifycfg,gvn,instcombine,simplifycfg";
+
+// Each function has a loop with redundant arithmetic for the pipeline to
+// clean up.
+static std::string makeModule(unsigned NumFunctions) {
+  std::string IR;
+  raw_string_ostream OS(IR);
+  OS << "@g = global i32 0\n";
+  for (unsigned I = 0; I != NumFunctions; ++I) {
+    OS << "define i32 @f" << I << "(i32 %n, ptr %p) {\n"
+       << "entry:\n"
+       << "  br label %loop\n"
+       << "loop:\n"
+       << "  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]\n"
+       << "  %acc = phi i32 [ " << I << ", %entry ], [ %acc.next, %loop ]\n"
+       << "  %a = add i32 %i, 0\n"
+       << "  %b = mul i32 %a, 1\n"
+       << "  %x = load i32, ptr %p\n"
+       << "  %y = load i32, ptr %p\n"
+       << "  %s = add i32 %x, %y\n"
+       << "  %t = add i32 %s, %b\n"
+       << "  %acc.next = add i32 %acc, %t\n"
+       << "  %i.next = add i32 %i, 1\n"
+       << "  %c = icmp slt i32 %i.next, %n\n"
+       << "  br i1 %c, label %loop, label %exit\n"
+       << "exit:\n"
+       << "  store i32 %acc.next, ptr @g\n"
+       << "  ret i32 %acc.next\n"
+       << "}\n";
+  }
+  return IR;
+}
+
+static void BM_FunctionPipeline(benchmark::State &State) {
+  const unsigned Threads = State.range(0);
+  const unsigned NumFunctions = State.range(1);
+  std::string IR = makeModule(NumFunctions);
+  std::string Pipeline =
+      Threads ? "parallel-function<" + std::to_string(Threads) + ">(" +
+                    FunctionPipeline + ")"
+              : std::string("function(") + FunctionPipeline + ")";
+
+  for (auto _ : State) {
+    State.PauseTiming();
+    LLVMContext Ctx;
+    SMDiagnostic Err;
+    std::unique_ptr<Module> M = parseAssemblyString(IR, Err, Ctx);
+    if (!M) {
+      State.SkipWithError("failed to parse the module");
+      return;
+    }
+
+    LoopAnalysisManager LAM;
+    FunctionAnalysisManager FAM;
+    CGSCCAnalysisManager CGAM;
+    ModuleAnalysisManager MAM;
+    PassBuilder PB;
+    PB.registerModuleAnalyses(MAM);
+    PB.registerCGSCCAnalyses(CGAM);
+    PB.registerFunctionAnalyses(FAM);
+    PB.registerLoopAnalyses(LAM);
+    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+    ModulePassManager MPM;
+    if (Error E = PB.parsePassPipeline(MPM, Pipeline)) {
+      State.SkipWithError(toString(std::move(E)).c_str());
+      return;
+    }
+    State.ResumeTiming();
+
+    MPM.run(*M, MAM);
+  }
+  State.SetItemsProcessed(State.iterations() * NumFunctions);
+}
+BENCHMARK(BM_FunctionPipeline)
+    ->ArgsProduct({{0, 1, 2, 4, 8}, {1000, 100000}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
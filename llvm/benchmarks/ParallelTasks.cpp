@@ -0,0 +1,89 @@
+//===- ParallelTasks.cpp - Task throughput of llvm::parallel --------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Measures how many tasks the default executor of llvm::parallel runs per
+// second. The executor is created once per process, so the number of worker
+// threads is selected with --parallel-threads=N (1 to 128). The benchmarks
+// themselves are additionally run with several threads submitting tasks
+// concurrently.
+//
+//===----------------------------------------------------------------------===//
+
+#include "benchmark/benchmark.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Parallel.h"
+#include "llvm/Support/Threading.h"
+#include <atomic>
+#include <cstring>
+
+using namespace llvm;
+
+// Spawns empty tasks into a task group.
+static void BM_TaskGroupSpawn(benchmark::State &State) {
+  const int64_t NumTasks = State.range(0);
+  for (auto _ : State) {
+    parallel::TaskGroup TG;
+    for (int64_t I = 0; I < NumTasks; ++I)
+      TG.spawn([] {});
+  }
+  State.SetItemsProcessed(State.iterations() * NumTasks);
+}
+BENCHMARK(BM_TaskGroupSpawn)->Arg(1024)->Arg(16384)->ThreadRange(1, 128);
+
+// Mixes sequential and parallel tasks, like the output phase of lld.
+static void BM_TaskGroupSequential(benchmark::State &State) {
+  const int64_t NumTasks = State.range(0);
+  std::atomic<int64_t> Counter{0};
+  for (auto _ : State) {
+    parallel::TaskGroup TG;
+    for (int64_t I = 0; I < NumTasks; ++I) {
+      TG.spawn([&] { ++Counter; }, /*Sequential=*/I % 8 == 0);
+    }
+  }
+  benchmark::DoNotOptimize(Counter.load());
+  State.SetItemsProcessed(State.iterations() * NumTasks);
+}
+BENCHMARK(BM_TaskGroupSequential)->Arg(16384);
+
+// Runs parallelFor over items with a small amount of work each.
+static void BM_ParallelFor(benchmark::State &State) {
+  const size_t NumItems = State.range(0);
+  for (auto _ : State) {
+    parallelFor(0, NumItems, [&](size_t I) {
+      uint64_t X = I;
+      for (int J = 0; J < 16; ++J)
+        X = X * 6364136223846793005ULL + 1442695040888963407ULL;
+      benchmark::DoNotOptimize(X);
+    });
+  }
+  State.SetItemsProcessed(State.iterations() * NumItems);
+}
+BENCHMARK(BM_ParallelFor)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+int main(int argc, char **argv) {
+  // Remove --parallel-threads=N before the benchmark library sees it.
+  int NewArgc = 1;
+  for (int I = 1; I < argc; ++I) {
+    StringRef Arg(argv[I]);
+    unsigned Threads;
+    if (Arg.consume_front("--parallel-threads=") &&
+        !Arg.getAsInteger(10, Threads)) {
+      parallel::strategy = hardware_concurrency(Threads);
+      continue;
+    }
+    argv[NewArgc++] = argv[I];
+  }
+  argc = NewArgc;
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,72 @@
+//===- SourceMgr.cpp - Line and column lookups in SourceMgr ---------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Measures the line and column lookups done for diagnostics, on a buffer shaped
+// like a large TableGen or MLIR input. The first lookup in a buffer builds its
+// line index, so that is measured separately from later lookups.
+//
+//===----------------------------------------------------------------------===//
+
+#include "benchmark/benchmark.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include <random>
+#include <string>
+
+using namespace llvm;
+
+static std::string makeSource(size_t Size) {
+  static const char *const Lines[] = {
+      "def ADD32rr : BinOpRR<0x01, \"add\", Xi32, X86add_flag>;",
+      "  %0 = arith.addi %arg0, %arg1 : i32",
+      "",
+      "  let Predicates = [HasAVX512] in {",
+      "    // Comment describing the following definitions.",
+      "}"};
+  std::mt19937 Rng(1);
+  std::string Text;
+  Text.reserve(Size + 128);
+  while (Text.size() < Size) {
+    Text += Lines[Rng() % std::size(Lines)];
+    Text += '\n';
+  }
+  return Text;
+}
+
+// The first lookup in a buffer, which indexes its lines.
+static void BM_SourceMgrFirstLookup(benchmark::State &State) {
+  std::string Text = makeSource(State.range(0));
+  for (auto _ : State) {
+    SourceMgr SM;
+    SM.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(Text, "input", false),
+                          SMLoc());
+    benchmark::DoNotOptimize(SM.getLineAndColumn(
+        SMLoc::getFromPointer(Text.data() + Text.size() / 2)));
+  }
+  State.SetBytesProcessed(State.iterations() * Text.size());
+}
+BENCHMARK(BM_SourceMgrFirstLookup)->Arg(64 << 10)->Arg(16 << 20);
+
+// Lookups at random locations once the buffer is indexed.
+static void BM_SourceMgrLookup(benchmark::State &State) {
+  std::string Text = makeSource(16 << 20);
+  SourceMgr SM;
+  SM.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(Text, "input", false),
+                        SMLoc());
+  // Add more buffers, as with the include files of a TableGen input.
+  for (int I = 0; I < State.range(0); ++I)
+    SM.AddNewSourceBuffer(MemoryBuffer::getMemBufferCopy("include", "inc"),
+                          SMLoc());
+  std::mt19937 Rng(2);
+  for (auto _ : State)
+    benchmark::DoNotOptimize(SM.getLineAndColumn(
+        SMLoc::getFromPointer(Text.data() + Rng() % Text.size())));
+}
+BENCHMARK(BM_SourceMgrLookup)->Arg(0)->Arg(100);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,112 @@
+//===- StringMap.cpp - Insert and lookup throughput of StringMap ----------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Measures StringMap with keys shaped like the symbol names found in object
+// files and IR modules. The lookup benchmarks take the percentage of keys that
+// are present in the map, since misses have to probe until an empty bucket.
+//
+//===----------------------------------------------------------------------===//
+
+#include "benchmark/benchmark.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/Twine.h"
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+static std::vector<std::string> makeSymbolNames(size_t Count, unsigned Seed) {
+  static const char *const Prefixes[] = {"_ZN4llvm", "_ZNK5clang", ".L.str.",
+                                         "__cxx_global_var_init.", "llvm."};
+  std::mt19937 Rng(Seed);
+  std::vector<std::string> Names;
+  Names.reserve(Count);
+  for (size_t I = 0; I < Count; ++I)
+    Names.push_back((Twine(Prefixes[Rng() % std::size(Prefixes)]) +
+                     Twine(Rng() % 100000) + "_" + Twine(I))
+                        .str());
+  return Names;
+}
+
+// Inserts N distinct keys into an empty map, including all the rehashing.
+static void BM_StringMapInsert(benchmark::State &State) {
+  std::vector<std::string> Names = makeSymbolNames(State.range(0), 1);
+  for (auto _ : State) {
+    StringMap<unsigned> Map;
+    for (const std::string &Name : Names)
+      Map.try_emplace(Name, 0);
+    benchmark::DoNotOptimize(Map.size());
+  }
+  State.SetItemsProcessed(State.iterations() * Names.size());
+}
+BENCHMARK(BM_StringMapInsert)->Range(64, 1 << 18);
+
+// Looks up keys of which the given percentage is present in the map.
+static void BM_StringMapLookup(benchmark::State &State) {
+  const size_t NumKeys = State.range(0);
+  const unsigned HitPercent = State.range(1);
+  std::vector<std::string> Present = makeSymbolNames(NumKeys, 1);
+  std::vector<std::string> Absent = makeSymbolNames(NumKeys, 2);
+  StringMap<unsigned> Map;
+  for (const std::string &Name : Present)
+    Map.try_emplace(Name, 0);
+
+  std::mt19937 Rng(3);
+  std::vector<StringRef> Queries;
+  Queries.reserve(NumKeys);
+  for (size_t I = 0; I < NumKeys; ++I)
+    Queries.push_back(Rng() % 100 < HitPercent ? Present[Rng() % NumKeys]
+                                               : Absent[Rng() % NumKeys]);
+
+  for (auto _ : State)
+    for (StringRef Query : Queries)
+      benchmark::DoNotOptimize(Map.find(Query));
+  State.SetItemsProcessed(State.iterations() * Queries.size());
+}
+BENCHMARK(BM_StringMapLookup)
+    ->ArgsProduct({{1 << 10, 1 << 14, 1 << 18}, {0, 50, 100}});
+
+// Interns a stream of names where most are repeats, like a symbol table.
+static void BM_StringMapIntern(benchmark::State &State) {
+  std::vector<std::string> Names = makeSymbolNames(State.range(0), 1);
+  std::mt19937 Rng(4);
+  std::vector<StringRef> Stream;
+  Stream.reserve(Names.size() * 4);
+  for (size_t I = 0; I < Names.size() * 4; ++I)
+    Stream.push_back(Names[Rng() % Names.size()]);
+
+  for (auto _ : State) {
+    StringMap<unsigned> Map;
+    for (StringRef Name : Stream)
+      ++Map[Name];
+    benchmark::DoNotOptimize(Map.size());
+  }
+  State.SetItemsProcessed(State.iterations() * Stream.size());
+}
+BENCHMARK(BM_StringMapIntern)->Range(64, 1 << 16);
+
+// Erases and reinserts keys, so that lookups have to skip tombstones.
+static void BM_StringMapChurn(benchmark::State &State) {
+  std::vector<std::string> Names = makeSymbolNames(State.range(0), 1);
+  StringMap<unsigned> Map;
+  for (const std::string &Name : Names)
+    Map.try_emplace(Name, 0);
+
+  size_t Next = 0;
+  for (auto _ : State) {
+    const std::string &Name = Names[Next];
+    Map.erase(Name);
+    Map.try_emplace(Name, 0);
+    Next = (Next + 7919) % Names.size();
+  }
+  State.SetItemsProcessed(State.iterations() * 2);
+}
+BENCHMARK(BM_StringMapChurn)->Range(64, 1 << 16);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,103 @@
+//===- SwissDenseMap.cpp - DenseMap and SwissDenseMap under erase churn ---===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Compares DenseMap with SwissDenseMap on pointer keyed maps. The churn
+// benchmark keeps a fixed number of live entries while erasing and inserting
+// keys, which is how side tables of instructions and registers behave, and
+// then looks up keys that are not in the map. DenseMap accumulates tombstones
+// there until it rehashes.
+//
+//===----------------------------------------------------------------------===//
+
+#include "benchmark/benchmark.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SwissDenseMap.h"
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+struct Node {
+  int64_t Payload[4];
+};
+
+// Pointers to distinct heap objects, in a random order.
+std::vector<Node *> makeKeys(size_t Count,
+                             std::vector<std::unique_ptr<Node>> &Storage) {
+  std::vector<Node *> Keys;
+  for (size_t I = 0; I < Count; ++I) {
+    Storage.push_back(std::make_unique<Node>());
+    Keys.push_back(Storage.back().get());
+  }
+  std::shuffle(Keys.begin(), Keys.end(), std::mt19937(1));
+  return Keys;
+}
+} // end anonymous namespace
+
+template <typename MapT> static void BM_Insert(benchmark::State &State) {
+  std::vector<std::unique_ptr<Node>> Storage;
+  std::vector<Node *> Keys = makeKeys(State.range(0), Storage);
+  for (auto _ : State) {
+    MapT Map;
+    for (Node *Key : Keys)
+      Map[Key] = 0;
+    benchmark::DoNotOptimize(Map.size());
+  }
+  State.SetItemsProcessed(State.iterations() * Keys.size());
+}
+BENCHMARK_TEMPLATE(BM_Insert, DenseMap<Node *, unsigned>)->Range(64, 1 << 18);
+BENCHMARK_TEMPLATE(BM_Insert, SwissDenseMap<Node *, unsigned>)
+    ->Range(64, 1 << 18);
+
+template <typename MapT> static void BM_LookupHit(benchmark::State &State) {
+  std::vector<std::unique_ptr<Node>> Storage;
+  std::vector<Node *> Keys = makeKeys(State.range(0), Storage);
+  MapT Map;
+  for (Node *Key : Keys)
+    Map[Key] = 0;
+  for (auto _ : State)
+    for (Node *Key : Keys)
+      benchmark::DoNotOptimize(Map.find(Key));
+  State.SetItemsProcessed(State.iterations() * Keys.size());
+}
+BENCHMARK_TEMPLATE(BM_LookupHit, DenseMap<Node *, unsigned>)
+    ->Range(64, 1 << 18);
+BENCHMARK_TEMPLATE(BM_LookupHit, SwissDenseMap<Node *, unsigned>)
+    ->Range(64, 1 << 18);
+
+// Keeps range(0) live entries while replacing them one at a time, and looks
+// up a key that is not in the map after every replacement.
+template <typename MapT> static void BM_EraseChurn(benchmark::State &State) {
+  const size_t NumLive = State.range(0);
+  std::vector<std::unique_ptr<Node>> Storage;
+  std::vector<Node *> Keys = makeKeys(NumLive * 8, Storage);
+  std::vector<std::unique_ptr<Node>> MissStorage;
+  std::vector<Node *> Misses = makeKeys(1024, MissStorage);
+
+  MapT Map;
+  for (size_t I = 0; I < NumLive; ++I)
+    Map[Keys[I]] = 0;
+
+  size_t Next = NumLive;
+  for (auto _ : State) {
+    Map.erase(Keys[(Next - NumLive) % Keys.size()]);
+    Map[Keys[Next % Keys.size()]] = 0;
+    benchmark::DoNotOptimize(Map.find(Misses[Next % Misses.size()]));
+    ++Next;
+  }
+  State.SetItemsProcessed(State.iterations() * 3);
+}
+BENCHMARK_TEMPLATE(BM_EraseChurn, DenseMap<Node *, unsigned>)
+    ->Range(64, 1 << 16);
+BENCHMARK_TEMPLATE(BM_EraseChurn, SwissDenseMap<Node *, unsigned>)
+    ->Range(64, 1 << 16);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,157 @@
+//===- TextualIR.cpp - Parsing and printing .ll files ---------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Throughput of the textual IR reader and writer, which is what llvm-as and
+// llvm-dis spend their time in. BM_ParseAssembly parses a generated module,
+// BM_PrintModule prints it to /dev/null the way llvm-dis writes its output
+// file and BM_PrintModuleToString to an unbuffered string stream.
+// BM_PrintFunctions prints each function on its own with a shared
+// ModuleSlotTracker, as pass instrumentation does. The argument is the number
+// of functions in the module.
+//
+//===----------------------------------------------------------------------===//
+
+#include "benchmark/benchmark.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/ModuleSlotTracker.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+// Each function is a loop over an array with a switch, a call and unnamed
+// values, and is a comdat member like the inline functions of C++ code.
+static std::string makeIR(unsigned NumFunctions) {
+  std::string IR;
+  raw_string_ostream OS(IR);
+  OS << "target datalayout = \"e-m:e-i64:64-f80:128-n8:16:32:64-S128\"\n"
+     << "%struct.S = type { i32, double, [4 x i8] }\n"
+     << "declare double @llvm.fmuladd.f64(double, double, double)\n";
+  for (unsigned I = 0; I != NumFunctions; ++I) {
+    OS << "$f" << I << " = comdat any\n"
+       << "@g" << I << " = linkonce_odr global i64 " << I * 7919
+       << ", comdat($f" << I << "), align 8\n"
+       << "define linkonce_odr double @f" << I
+       << "(ptr nocapture readonly %p, i64 %n) #0 comdat {\n"
+       << "entry:\n"
+       << "  %cmp = icmp sgt i64 %n, 0\n"
+       << "  br i1 %cmp, label %loop, label %exit, !prof !0\n"
+       << "loop:\n"
+       << "  %i = phi i64 [ 0, %entry ], [ %i.next, %latch ]\n"
+       << "  %acc = phi double [ 0.0, %entry ], [ %acc.next, %latch ]\n"
+       << "  %f = getelementptr inbounds %struct.S, ptr %p, i64 %i, i32 1\n"
+       << "  %0 = load double, ptr %f, align 8\n"
+       << "  %1 = trunc i64 %i to i32\n"
+       << "  switch i32 %1, label %latch [\n"
+       << "    i32 " << I << ", label %case\n"
+       << "    i32 " << -int(I) - 1 << ", label %case\n"
+       << "  ]\n"
+       << "case:\n"
+       << "  %2 = load i64, ptr @g" << I << ", align 8\n"
+       << "  %3 = sitofp i64 %2 to double\n"
+       << "  store double %3, ptr %f, align 8\n"
+       << "  br label %latch\n"
+       << "latch:\n"
+       << "  %x = phi double [ %0, %loop ], [ %3, %case ]\n"
+       << "  %acc.next = call fast double @llvm.fmuladd.f64(double %x, "
+          "double 1.500000e+00, double %acc)\n"
+       << "  %i.next = add nuw nsw i64 %i, 1\n"
+       << "  %done = icmp eq i64 %i.next, %n\n"
+       << "  br i1 %done, label %exit, label %loop\n"
+       << "exit:\n"
+       << "  %r = phi double [ 0.0, %entry ], [ %acc.next, %latch ]\n"
+       << "  ret double %r\n"
+       << "}\n";
+  }
+  OS << "attributes #0 = { nounwind uwtable \"frame-pointer\"=\"none\" }\n"
+     << "!0 = !{!\"branch_weights\", i32 1, i32 2000}\n";
+  return IR;
+}
+
+static std::unique_ptr<Module> parseIR(StringRef IR, LLVMContext &Ctx) {
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(IR, Err, Ctx);
+  if (!M)
+    report_fatal_error("failed to parse the module");
+  return M;
+}
+
+static void BM_ParseAssembly(benchmark::State &State) {
+  std::string IR = makeIR(State.range(0));
+  for (auto _ : State) {
+    LLVMContext Ctx;
+    benchmark::DoNotOptimize(parseIR(IR, Ctx));
+  }
+  State.SetBytesProcessed(State.iterations() * IR.size());
+}
+BENCHMARK(BM_ParseAssembly)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_PrintModule(benchmark::State &State) {
+  std::string IR = makeIR(State.range(0));
+  LLVMContext Ctx;
+  std::unique_ptr<Module> M = parseIR(IR, Ctx);
+  std::error_code EC;
+  raw_fd_ostream OS("/dev/null", EC, sys::fs::OF_TextWithCRLF);
+  if (EC) {
+    State.SkipWithError(EC.message().c_str());
+    return;
+  }
+  for (auto _ : State) {
+    M->print(OS, nullptr);
+    OS.flush();
+  }
+  State.SetBytesProcessed(State.iterations() * IR.size());
+}
+BENCHMARK(BM_PrintModule)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_PrintModuleToString(benchmark::State &State) {
+  std::string IR = makeIR(State.range(0));
+  LLVMContext Ctx;
+  std::unique_ptr<Module> M = parseIR(IR, Ctx);
+  for (auto _ : State) {
+    std::string Out;
+    raw_string_ostream OS(Out);
+    M->print(OS, nullptr);
+    benchmark::DoNotOptimize(Out);
+  }
+  State.SetBytesProcessed(State.iterations() * IR.size());
+}
+BENCHMARK(BM_PrintModuleToString)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_PrintFunctions(benchmark::State &State) {
+  std::string IR = makeIR(State.range(0));
+  LLVMContext Ctx;
+  std::unique_ptr<Module> M = parseIR(IR, Ctx);
+  for (auto _ : State) {
+    ModuleSlotTracker MST(M.get());
+    std::string Out;
+    raw_string_ostream OS(Out);
+    for (const Function &F : *M)
+      static_cast<const Value &>(F).print(OS, MST);
+    benchmark::DoNotOptimize(Out);
+  }
+  State.SetBytesProcessed(State.iterations() * IR.size());
+}
+BENCHMARK(BM_PrintFunctions)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,156 @@
+//===- UseLists.cpp - Memory and time spent on uses -----------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// The cost of Uses on a large module whose functions share globals and
+// call each other, like a module linked for full LTO. BM_ParseAssembly parses
+// the module and reports the heap memory it takes as ModuleMiB.
+// BM_Users visits the users of every value, BM_OperandNo asks every use for
+// its operand number, BM_RAUW replaces every global with another one and
+// back, and BM_Verify runs the verifier. The argument is the number of
+// functions in the module.
+//
+//===----------------------------------------------------------------------===//
+
+#include "benchmark/benchmark.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+static const unsigned NumGlobals = 64;
+
+// Each function is a loop whose blocks load and store globals, do some
+// arithmetic and call another function, merging their results in phis.
+static std::string makeIR(unsigned NumFunctions) {
+  std::string IR;
+  raw_string_ostream OS(IR);
+  OS << "target datalayout = \"e-m:e-i64:64-f80:128-n8:16:32:64-S128\"\n";
+  for (unsigned G = 0; G != NumGlobals; ++G)
+    OS << "@g" << G << " = global i64 " << G << ", align 8\n";
+  for (unsigned I = 0; I != NumFunctions; ++I) {
+    OS << "define i64 @f" << I << "(ptr %p, i64 %n) {\n"
+       << "entry:\n"
+       << "  br label %b0\n";
+    for (unsigned B = 0; B != 8; ++B) {
+      std::string Pred = B ? "%b" + std::to_string(B - 1) : "%entry";
+      std::string Prev = B ? "%s" + std::to_string(B - 1) : "%n";
+      unsigned G = (I * 7 + B) % NumGlobals;
+      OS << "b" << B << ":\n"
+         << "  %x" << B << " = phi i64 [ " << Prev << ", " << Pred
+         << " ], [ %s" << B << ", %b" << B << " ]\n"
+         << "  %l" << B << " = load i64, ptr @g" << G << ", align 8\n"
+         << "  %a" << B << " = add i64 %x" << B << ", %l" << B << "\n"
+         << "  %m" << B << " = mul i64 %a" << B << ", " << (B + 3) << "\n"
+         << "  %q" << B << " = getelementptr inbounds i64, ptr %p, i64 %m"
+         << B << "\n"
+         << "  %c" << B << " = call i64 @f" << (I + B + 1) % NumFunctions
+         << "(ptr %q" << B << ", i64 %a" << B << ")\n"
+         << "  %s" << B << " = xor i64 %c" << B << ", %m" << B << "\n"
+         << "  store i64 %s" << B << ", ptr @g" << (G + 1) % NumGlobals
+         << ", align 8\n"
+         << "  %d" << B << " = icmp ult i64 %s" << B << ", %n\n"
+         << "  br i1 %d" << B << ", label %b" << B << ", label %"
+         << (B == 7 ? "exit" : "b" + std::to_string(B + 1)) << "\n";
+    }
+    OS << "exit:\n"
+       << "  ret i64 %s7\n"
+       << "}\n";
+  }
+  return IR;
+}
+
+static std::unique_ptr<Module> parseIR(StringRef IR, LLVMContext &Ctx) {
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(IR, Err, Ctx);
+  if (!M)
+    report_fatal_error("failed to parse the module");
+  return M;
+}
+
+static void BM_ParseAssembly(benchmark::State &State) {
+  std::string IR = makeIR(State.range(0));
+  size_t ModuleBytes = 0;
+  for (auto _ : State) {
+    LLVMContext Ctx;
+    size_t Before = sys::Process::GetMallocUsage();
+    std::unique_ptr<Module> M = parseIR(IR, Ctx);
+    ModuleBytes = sys::Process::GetMallocUsage() - Before;
+    benchmark::DoNotOptimize(M);
+  }
+  State.counters["ModuleMiB"] = double(ModuleBytes) / (1 << 20);
+}
+BENCHMARK(BM_ParseAssembly)
+    ->Arg(10000)
+    ->Arg(50000)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_Users(benchmark::State &State) {
+  LLVMContext Ctx;
+  std::unique_ptr<Module> M = parseIR(makeIR(State.range(0)), Ctx);
+  for (auto _ : State) {
+    unsigned NumUsers = 0;
+    for (GlobalValue &GV : M->global_values())
+      for (User *U : GV.users())
+        NumUsers += isa<Instruction>(U);
+    for (Function &F : *M)
+      for (BasicBlock &BB : F)
+        for (Instruction &I : BB)
+          for (User *U : I.users())
+            NumUsers += isa<Instruction>(U);
+    benchmark::DoNotOptimize(NumUsers);
+  }
+}
+BENCHMARK(BM_Users)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+static void BM_OperandNo(benchmark::State &State) {
+  LLVMContext Ctx;
+  std::unique_ptr<Module> M = parseIR(makeIR(State.range(0)), Ctx);
+  for (auto _ : State) {
+    unsigned Sum = 0;
+    for (Function &F : *M)
+      for (BasicBlock &BB : F)
+        for (Instruction &I : BB)
+          for (Use &U : I.uses())
+            Sum += U.getOperandNo();
+    benchmark::DoNotOptimize(Sum);
+  }
+}
+BENCHMARK(BM_OperandNo)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+static void BM_RAUW(benchmark::State &State) {
+  LLVMContext Ctx;
+  std::unique_ptr<Module> M = parseIR(makeIR(State.range(0)), Ctx);
+  SmallVector<GlobalVariable *, 0> Globals;
+  for (GlobalVariable &GV : M->globals())
+    Globals.push_back(&GV);
+  Type *Int64Ty = Type::getInt64Ty(Ctx);
+  auto *Other = new GlobalVariable(*M, Int64Ty, /*isConstant=*/false,
+                                   GlobalValue::ExternalLinkage, nullptr, "h");
+  for (auto _ : State) {
+    for (GlobalVariable *GV : Globals) {
+      GV->replaceAllUsesWith(Other);
+      Other->replaceAllUsesWith(GV);
+    }
+  }
+}
+BENCHMARK(BM_RAUW)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+static void BM_Verify(benchmark::State &State) {
+  LLVMContext Ctx;
+  std::unique_ptr<Module> M = parseIR(makeIR(State.range(0)), Ctx);
+  for (auto _ : State)
+    benchmark::DoNotOptimize(verifyModule(*M));
+}
+BENCHMARK(BM_Verify)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,78 @@
+//===- YAMLParser.cpp - Parsing throughput of yaml::Stream ----------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Measures parsing a stream of many small documents, shaped like the
+// optimization records written by -fsave-optimization-record, and visiting
+// all of their scalars.
+//
+//===----------------------------------------------------------------------===//
+
+#include "benchmark/benchmark.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Support/Casting.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/YAMLParser.h"
+#include <string>
+
+using namespace llvm;
+
+static std::string makeRemarks(unsigned Count) {
+  std::string Text;
+  for (unsigned I = 0; I < Count; ++I)
+    Text += (Twine("--- !Missed\n"
+                   "Pass:            inline\n"
+                   "Name:            NoDefinition\n"
+                   "DebugLoc:        { File: 'file.c', Line: ") +
+             Twine(I % 1000) +
+             ", Column: 12 }\n"
+             "Function:        func" +
+             Twine(I) +
+             "\n"
+             "Args:\n"
+             "  - Callee:          callee\n"
+             "  - String:          ' will not be inlined into '\n"
+             "  - Caller:          func" +
+             Twine(I) +
+             "\n"
+             "    DebugLoc:        { File: 'file.c', Line: 3, Column: 0 }\n"
+             "  - String:          ' because its definition is unavailable'\n"
+             "...\n")
+                .str();
+  return Text;
+}
+
+static unsigned visit(yaml::Node *N, SmallVectorImpl<char> &Storage) {
+  if (auto *S = dyn_cast_or_null<yaml::ScalarNode>(N))
+    return S->getValue(Storage).size();
+  unsigned Size = 0;
+  if (auto *M = dyn_cast_or_null<yaml::MappingNode>(N))
+    for (yaml::KeyValueNode &KV : *M)
+      Size += visit(KV.getKey(), Storage) + visit(KV.getValue(), Storage);
+  if (auto *S = dyn_cast_or_null<yaml::SequenceNode>(N))
+    for (yaml::Node &E : *S)
+      Size += visit(&E, Storage);
+  return Size;
+}
+
+static void BM_YAMLParseRemarks(benchmark::State &State) {
+  std::string Text = makeRemarks(State.range(0));
+  SmallString<64> Storage;
+  for (auto _ : State) {
+    SourceMgr SM;
+    yaml::Stream Stream(Text, SM);
+    unsigned Size = 0;
+    for (yaml::Document &Doc : Stream)
+      Size += visit(Doc.getRoot(), Storage);
+    benchmark::DoNotOptimize(Size);
+  }
+  State.SetBytesProcessed(State.iterations() * Text.size());
+}
+BENCHMARK(BM_YAMLParseRemarks)->Arg(10000);
+
+BENCHMARK_MAIN();
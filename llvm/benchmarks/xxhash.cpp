@@ -0,0 +1,60 @@
+//===- xxhash.cpp - Throughput of xxHash64 and XXH3 -----------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Measures hashing throughput for inputs from 16 bytes to 64MB. Small inputs
+// stay in cache and measure latency of the short-input paths, the largest
+// ones are bound by memory bandwidth.
+//
+//===----------------------------------------------------------------------===//
+
+#include "benchmark/benchmark.h"
+#include "llvm/Support/xxhash.h"
+#include <vector>
+
+using namespace llvm;
+
+static std::vector<uint8_t> makeInput(size_t Size) {
+  std::vector<uint8_t> Data(Size);
+  uint64_t X = 1;
+  for (uint8_t &C : Data) {
+    X ^= X << 13;
+    X ^= X >> 7;
+    X ^= X << 17;
+    C = uint8_t(X);
+  }
+  return Data;
+}
+
+template <typename HashFn>
+static void runHash(benchmark::State &State, HashFn Hash) {
+  std::vector<uint8_t> Data = makeInput(State.range(0));
+  for (auto _ : State)
+    benchmark::DoNotOptimize(Hash(ArrayRef<uint8_t>(Data)));
+  State.SetBytesProcessed(int64_t(State.iterations()) * State.range(0));
+}
+
+static void BM_xxHash64(benchmark::State &State) {
+  runHash(State, [](ArrayRef<uint8_t> Data) { return xxHash64(Data); });
+}
+
+static void BM_xxh3_64bits(benchmark::State &State) {
+  runHash(State, [](ArrayRef<uint8_t> Data) { return xxh3_64bits(Data); });
+}
+
+static void BM_xxh3_128bits(benchmark::State &State) {
+  runHash(State, [](ArrayRef<uint8_t> Data) {
+    XXH128_hash_t Hash = xxh3_128bits(Data);
+    return Hash.low64 ^ Hash.high64;
+  });
+}
+
+BENCHMARK(BM_xxHash64)->RangeMultiplier(8)->Range(16, 64 << 20);
+BENCHMARK(BM_xxh3_64bits)->RangeMultiplier(8)->Range(16, 64 << 20);
+BENCHMARK(BM_xxh3_128bits)->RangeMultiplier(8)->Range(16, 64 << 20);
+
+BENCHMARK_MAIN();
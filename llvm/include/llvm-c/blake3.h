@@ -65,6 +65,20 @@ void llvm_blake3_hasher_init_derive_key_raw(llvm_blake3_hasher *self,
                                             size_t context_len);
 void llvm_blake3_hasher_update(llvm_blake3_hasher *self, const void *input,
                                size_t input_len);
+
+// Calls fn(arg, i) for each i in [0, count), possibly concurrently, and
+// returns once all of the calls have finished.
+typedef void (*llvm_blake3_for_each_fn)(void *context, size_t count,
+                                        void (*fn)(void *arg, size_t index),
+                                        void *arg);
+
+// Like llvm_blake3_hasher_update(), but splits large inputs into subtrees that
+// are compressed with for_each. The result is the same as for
+// llvm_blake3_hasher_update().
+void llvm_blake3_hasher_update_parallel(llvm_blake3_hasher *self,
+                                        const void *input, size_t input_len,
+                                        llvm_blake3_for_each_fn for_each,
+                                        void *context);
 void llvm_blake3_hasher_finalize(const llvm_blake3_hasher *self, uint8_t *out,
                                  size_t out_len);
 void llvm_blake3_hasher_finalize_seek(const llvm_blake3_hasher *self,
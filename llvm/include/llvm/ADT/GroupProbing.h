@@ -0,0 +1,173 @@
+//===- llvm/ADT/GroupProbing.h - Hash table control bytes -------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file defines the helpers shared by the hash tables that keep one
+/// control byte per bucket, StringMap and SwissDenseMap. A control byte is
+/// either CtrlEmpty, CtrlDeleted, or the top seven bits of the hash of the
+/// key stored in the bucket. Lookups compare a group of control bytes with
+/// the hash bits at once, using SSE2 or NEON when available, and only look at
+/// the buckets that match.
+///
+/// The control bytes of the first Width buckets are mirrored after the last
+/// bucket, so that a group can be loaded starting at any bucket.
+///
+/// ProbeGroup::match works on any Width bytes, so it is also used to find a
+/// character in text, e.g. the line endings of a SourceMgr buffer.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ADT_GROUPPROBING_H
+#define LLVM_ADT_GROUPPROBING_H
+
+#include "llvm/ADT/bit.h"
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace llvm {
+namespace detail {
+
+/// Control byte values. A full bucket stores seven bits of its hash, so the
+/// high bit of the control byte is set only for available buckets.
+enum : uint8_t { CtrlEmpty = 0x80, CtrlDeleted = 0xFE };
+
+inline bool isCtrlFull(uint8_t Ctrl) { return !(Ctrl & 0x80); }
+
+/// A group of Width control bytes starting at an arbitrary bucket. The match
+/// functions return a mask with (1 << MaskShift) bits per bucket, the lowest
+/// of which corresponds to the first bucket of the group.
+class ProbeGroup {
+public:
+  static constexpr unsigned Width = 16;
+
+#if defined(__SSE2__)
+private:
+  __m128i Ctrl;
+
+  static uint64_t toMask(__m128i Cmp) { return _mm_movemask_epi8(Cmp); }
+
+public:
+  static constexpr unsigned MaskShift = 0;
+
+  explicit ProbeGroup(const uint8_t *P)
+      : Ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i *>(P))) {}
+
+  uint64_t match(uint8_t H2) const {
+    return toMask(_mm_cmpeq_epi8(Ctrl, _mm_set1_epi8(static_cast<char>(H2))));
+  }
+  uint64_t matchAvailable() const { return toMask(Ctrl); }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+private:
+  uint8x16_t Ctrl;
+
+  // NEON has no movemask; narrow each byte to a nibble and keep one bit of it.
+  static uint64_t toMask(uint8x16_t Cmp) {
+    uint8x8_t Nibbles = vshrn_n_u16(vreinterpretq_u16_u8(Cmp), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(Nibbles), 0) &
+           0x8888888888888888ULL;
+  }
+
+public:
+  static constexpr unsigned MaskShift = 2;
+
+  explicit ProbeGroup(const uint8_t *P) : Ctrl(vld1q_u8(P)) {}
+
+  uint64_t match(uint8_t H2) const {
+    return toMask(vceqq_u8(Ctrl, vdupq_n_u8(H2)));
+  }
+  uint64_t matchAvailable() const {
+    return toMask(vcltzq_s8(vreinterpretq_s8_u8(Ctrl)));
+  }
+#else
+private:
+  const uint8_t *Ctrl;
+
+public:
+  static constexpr unsigned MaskShift = 0;
+
+  explicit ProbeGroup(const uint8_t *P) : Ctrl(P) {}
+
+  uint64_t match(uint8_t H2) const {
+    uint64_t Mask = 0;
+    for (unsigned I = 0; I != Width; ++I)
+      if (Ctrl[I] == H2)
+        Mask |= uint64_t(1) << I;
+    return Mask;
+  }
+  uint64_t matchAvailable() const {
+    uint64_t Mask = 0;
+    for (unsigned I = 0; I != Width; ++I)
+      if (!isCtrlFull(Ctrl[I]))
+        Mask |= uint64_t(1) << I;
+    return Mask;
+  }
+#endif
+
+  uint64_t matchEmpty() const { return match(CtrlEmpty); }
+
+  /// Returns the index within the group of the first bucket in \p Mask.
+  static unsigned lowestIndex(uint64_t Mask) {
+    return llvm::countr_zero(Mask) >> MaskShift;
+  }
+
+  /// Returns the number of buckets at the start of the group that are not in
+  /// \p Mask.
+  static unsigned leadingBuckets(uint64_t Mask) {
+    return lowestIndex(Mask);
+  }
+
+  /// Returns the number of buckets at the end of the group that are not in
+  /// \p Mask.
+  static unsigned trailingBuckets(uint64_t Mask) {
+    return (llvm::countl_zero(Mask) - (64 - (Width << MaskShift))) >>
+           MaskShift;
+  }
+};
+
+/// Triangular probing over groups. For a power of two number of buckets this
+/// visits every group start once before repeating.
+class GroupProbeSeq {
+  unsigned Mask;
+  unsigned Offset;
+  unsigned Stride = 0;
+
+public:
+  GroupProbeSeq(uint32_t Hash, unsigned NumBuckets)
+      : Mask(NumBuckets - 1), Offset(Hash & Mask) {}
+
+  /// The first bucket of the current group.
+  unsigned offset() const { return Offset; }
+
+  /// The bucket at index \p I within the current group.
+  unsigned bucket(unsigned I) const { return (Offset + I) & Mask; }
+
+  void next() {
+    Stride += ProbeGroup::Width;
+    Offset = (Offset + Stride) & Mask;
+  }
+};
+
+/// Sets the control byte of \p Bucket, and its mirror if there is one. Tables
+/// smaller than a group are mirrored more than once.
+inline void setCtrl(uint8_t *Ctrl, unsigned NumBuckets, unsigned Bucket,
+                    uint8_t Value) {
+  Ctrl[Bucket] = Value;
+  for (unsigned I = Bucket + NumBuckets; I < NumBuckets + ProbeGroup::Width;
+       I += NumBuckets)
+    Ctrl[I] = Value;
+}
+
+} // end namespace detail
+} // end namespace llvm
+
+#endif // LLVM_ADT_GROUPPROBING_H
@@ -19,6 +19,10 @@
 ///
 /// Later, in the code: ++NumInstsKilled;
 ///
+/// Updates are counted per thread and only combined when a statistic is read.
+/// Statistics declared with STATISTIC ignore updates while statistics are
+/// disabled, so that they are cheap enough for hot code.
+///
 /// NOTE: Statistics *must* be declared as global variables.
 ///
 //===----------------------------------------------------------------------===//
@@ -47,69 +51,121 @@ class raw_ostream;
 class raw_fd_ostream;
 class StringRef;
 
+namespace detail {
+/// Set while statistics are enabled, see AreStatisticsEnabled(). Statistics
+/// declared with STATISTIC ignore updates while it is clear.
+extern std::atomic<bool> StatisticsEnabled;
+
+/// The counters of one thread for all tracking statistics, indexed by the id
+/// of a statistic. Only the owning thread updates its counters, so that hot
+/// statistics do not bounce cache lines between threads. The counters are
+/// combined when a statistic is read, and added to the statistic when the
+/// thread exits.
+struct StatisticShard {
+  static constexpr unsigned BlockBits = 8;
+  static constexpr unsigned BlockSize = 1u << BlockBits;
+  static constexpr unsigned NumBlocks = 64;
+  /// Statistics with larger ids update the shared value instead.
+  static constexpr unsigned MaxStatistics = NumBlocks * BlockSize;
+
+  std::atomic<std::atomic<uint64_t> *> Blocks[NumBlocks] = {};
+};
+
+/// Returns the counter of the current thread for the statistic with id \p Id,
+/// or null if the statistic has to be updated through its shared value.
+std::atomic<uint64_t> *getStatisticCounterSlow(unsigned Id);
+
+#ifdef _WIN32
+// Direct access to thread_local variables from a different DLL isn't
+// possible with Windows Native TLS.
+std::atomic<uint64_t> *getStatisticCounter(unsigned Id);
+#else
+// Don't access this directly, use getStatisticCounter.
+extern LLVM_THREAD_LOCAL StatisticShard *CurrentStatisticShard;
+
+inline std::atomic<uint64_t> *getStatisticCounter(unsigned Id) {
+  if (LLVM_LIKELY(CurrentStatisticShard && Id &&
+                  Id < StatisticShard::MaxStatistics))
+    if (std::atomic<uint64_t> *Block =
+            CurrentStatisticShard->Blocks[Id >> StatisticShard::BlockBits]
+                .load(std::memory_order_relaxed))
+      return &Block[Id & (StatisticShard::BlockSize - 1)];
+  return getStatisticCounterSlow(Id);
+}
+#endif
+} // end namespace detail
+
+/// A statistic that counts with per-thread counters. The postfix operators do
+/// not return the previous value, which would require combining the counters
+/// of all threads.
 class TrackingStatistic {
 public:
   const char *const DebugType;
   const char *const Name;
   const char *const Desc;
 
+  /// The part of the value that is not in the counters of the threads. It
+  /// holds the whole value of statistics that are only updated by updateMax.
   std::atomic<uint64_t> Value;
   std::atomic<bool> Initialized;
+  /// The index of the counters of this statistic in the shards, or 0 before
+  /// the statistic is first updated.
+  std::atomic<unsigned> Id;
+  /// Whether updates are counted while statistics are disabled.
+  const bool AlwaysEnabled;
 
   constexpr TrackingStatistic(const char *DebugType, const char *Name,
-                              const char *Desc)
+                              const char *Desc, bool AlwaysEnabled = false)
       : DebugType(DebugType), Name(Name), Desc(Desc), Value(0),
-        Initialized(false) {}
+        Initialized(false), Id(0), AlwaysEnabled(AlwaysEnabled) {}
 
   const char *getDebugType() const { return DebugType; }
   const char *getName() const { return Name; }
   const char *getDesc() const { return Desc; }
 
-  uint64_t getValue() const { return Value.load(std::memory_order_relaxed); }
+  uint64_t getValue() const;
+
+  /// Sets the shared value so that the value of the statistic is \p Val.
+  void setValue(uint64_t Val);
 
   // Allow use of this class as the value itself.
   operator uint64_t() const { return getValue(); }
 
   const TrackingStatistic &operator=(uint64_t Val) {
-    Value.store(Val, std::memory_order_relaxed);
-    return init();
+    if (isEnabled())
+      init().setValue(Val);
+    return *this;
   }
 
   const TrackingStatistic &operator++() {
-    Value.fetch_add(1, std::memory_order_relaxed);
-    return init();
+    add(1);
+    return *this;
   }
 
-  uint64_t operator++(int) {
-    init();
-    return Value.fetch_add(1, std::memory_order_relaxed);
-  }
+  void operator++(int) { add(1); }
 
   const TrackingStatistic &operator--() {
-    Value.fetch_sub(1, std::memory_order_relaxed);
-    return init();
+    add(-uint64_t(1));
+    return *this;
   }
 
-  uint64_t operator--(int) {
-    init();
-    return Value.fetch_sub(1, std::memory_order_relaxed);
-  }
+  void operator--(int) { add(-uint64_t(1)); }
 
   const TrackingStatistic &operator+=(uint64_t V) {
-    if (V == 0)
-      return *this;
-    Value.fetch_add(V, std::memory_order_relaxed);
-    return init();
+    if (V != 0)
+      add(V);
+    return *this;
   }
 
   const TrackingStatistic &operator-=(uint64_t V) {
-    if (V == 0)
-      return *this;
-    Value.fetch_sub(V, std::memory_order_relaxed);
-    return init();
+    if (V != 0)
+      add(-V);
+    return *this;
   }
 
   void updateMax(uint64_t V) {
+    if (!isEnabled())
+      return;
     uint64_t PrevMax = Value.load(std::memory_order_relaxed);
     // Keep trying to update max until we succeed or another thread produces
     // a bigger max than us.
@@ -120,6 +176,23 @@ public:
   }
 
 protected:
+  bool isEnabled() const {
+    return AlwaysEnabled ||
+           detail::StatisticsEnabled.load(std::memory_order_relaxed);
+  }
+
+  void add(uint64_t V) {
+    if (!isEnabled())
+      return;
+    init();
+    if (std::atomic<uint64_t> *Counter =
+            detail::getStatisticCounter(Id.load(std::memory_order_relaxed)))
+      Counter->store(Counter->load(std::memory_order_relaxed) + V,
+                     std::memory_order_relaxed);
+    else
+      Value.fetch_add(V, std::memory_order_relaxed);
+  }
+
   TrackingStatistic &init() {
     if (!Initialized.load(std::memory_order_acquire))
       RegisterStatistic();
@@ -143,11 +216,11 @@ public:
 
   const NoopStatistic &operator++() { return *this; }
 
-  uint64_t operator++(int) { return 0; }
+  void operator++(int) {}
 
   const NoopStatistic &operator--() { return *this; }
 
-  uint64_t operator--(int) { return 0; }
+  void operator--(int) {}
 
   const NoopStatistic &operator+=(const uint64_t &V) { return *this; }
 
@@ -170,7 +243,7 @@ using Statistic = NoopStatistic;
 // ALWAYS_ENABLED_STATISTIC - A macro to define a statistic like STATISTIC but
 // it is enabled even if LLVM_ENABLE_STATS is off.
 #define ALWAYS_ENABLED_STATISTIC(VARNAME, DESC)                                \
-  static llvm::TrackingStatistic VARNAME = {DEBUG_TYPE, #VARNAME, DESC}
+  static llvm::TrackingStatistic VARNAME = {DEBUG_TYPE, #VARNAME, DESC, true}
 
 /// Enable the collection and printing of statistics.
 void EnableStatistics(bool DoPrintOnExit = true);
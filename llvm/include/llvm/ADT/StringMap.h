@@ -33,7 +33,9 @@ class StringMapImpl {
 protected:
   // Array of NumBuckets pointers to entries, null pointers are holes.
   // TheTable[NumBuckets] contains a sentinel value for easy iteration. Followed
-  // by an array of the actual hash values as unsigned integers.
+  // by an array of the actual hash values as unsigned integers, and by one
+  // control byte per bucket that holds the top bits of the hash. The control
+  // bytes let lookups match a whole group of buckets at once.
   StringMapEntryBase **TheTable = nullptr;
   unsigned NumBuckets = 0;
   unsigned NumItems = 0;
@@ -87,6 +89,13 @@ protected:
   /// setup the map as empty.
   void init(unsigned Size);
 
+  /// Copy the hash values and control bytes of \p RHS, which must have the
+  /// same number of buckets as this map.
+  void copyMetadata(const StringMapImpl &RHS);
+
+  /// Mark all buckets as empty after the entries have been cleared.
+  void clearMetadata();
+
 public:
   static constexpr uintptr_t TombstoneIntVal =
       static_cast<uintptr_t>(-1)
@@ -159,8 +168,7 @@ public:
     // Allocate TheTable of the same size as RHS's TheTable, and set the
     // sentinel appropriately (and NumBuckets).
     init(RHS.NumBuckets);
-    unsigned *HashTable = (unsigned *)(TheTable + NumBuckets + 1),
-             *RHSHashTable = (unsigned *)(RHS.TheTable + NumBuckets + 1);
+    copyMetadata(RHS);
 
     NumItems = RHS.NumItems;
     NumTombstones = RHS.NumTombstones;
@@ -174,7 +182,6 @@ public:
       TheTable[I] = MapEntryTy::create(
           static_cast<MapEntryTy *>(Bucket)->getKey(), getAllocator(),
           static_cast<MapEntryTy *>(Bucket)->getValue());
-      HashTable[I] = RHSHashTable[I];
     }
 
     // Note that here we've copied everything from the RHS into this object,
@@ -402,6 +409,7 @@ public:
       }
       Bucket = nullptr;
     }
+    clearMetadata();
 
     NumItems = 0;
     NumTombstones = 0;
@@ -0,0 +1,751 @@
+//===- llvm/ADT/SwissDenseMap.h - Group probed hash table -------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file defines the SwissDenseMap class, a drop-in replacement for
+/// DenseMap for maps with many erasures.
+///
+/// DenseMap marks buckets with the empty and tombstone keys of the KeyInfoT,
+/// so erased buckets stay tombstones until the map is rehashed and lookups
+/// get slower as they accumulate. SwissDenseMap keeps one control byte per
+/// bucket instead (see GroupProbing.h) and probes a group of buckets at once.
+/// An erased bucket is marked empty again whenever no probe sequence can have
+/// passed over it, which is the common case unless the map is nearly full.
+///
+/// The interface matches DenseMap. The empty and tombstone keys of the
+/// KeyInfoT are not used, only getHashValue and isEqual are. Like with
+/// DenseMap, inserting into the map invalidates iterators and pointers to the
+/// elements, erasing an element only invalidates iterators to that element.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ADT_SWISSDENSEMAP_H
+#define LLVM_ADT_SWISSDENSEMAP_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseMapInfo.h"
+#include "llvm/ADT/EpochTracker.h"
+#include "llvm/ADT/GroupProbing.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemAlloc.h"
+#include "llvm/Support/type_traits.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace llvm {
+
+template <typename Bucket, bool IsConst = false> class SwissDenseMapIterator;
+
+template <typename KeyT, typename ValueT,
+          typename KeyInfoT = DenseMapInfo<KeyT>,
+          typename BucketT = llvm::detail::DenseMapPair<KeyT, ValueT>>
+class SwissDenseMap : public DebugEpochBase {
+  template <typename T>
+  using const_arg_type_t = typename const_pointer_or_const_ref<T>::type;
+
+  using Group = detail::ProbeGroup;
+
+  BucketT *Buckets = nullptr;
+  uint8_t *Ctrl = nullptr;
+  unsigned NumEntries = 0;
+  unsigned NumBuckets = 0;
+  // Number of empty buckets that can still be filled before the map has to be
+  // rehashed. Deleted buckets do not count, reusing them is always fine.
+  unsigned GrowthLeft = 0;
+
+public:
+  using size_type = unsigned;
+  using key_type = KeyT;
+  using mapped_type = ValueT;
+  using value_type = BucketT;
+
+  using iterator = SwissDenseMapIterator<BucketT>;
+  using const_iterator = SwissDenseMapIterator<BucketT, true>;
+
+  explicit SwissDenseMap(unsigned InitialReserve = 0) {
+    init(InitialReserve);
+  }
+
+  SwissDenseMap(const SwissDenseMap &Other) : DebugEpochBase() {
+    copyFrom(Other);
+  }
+
+  SwissDenseMap(SwissDenseMap &&Other) : DebugEpochBase() { swap(Other); }
+
+  template <typename InputIt>
+  SwissDenseMap(const InputIt &I, const InputIt &E) {
+    init(std::distance(I, E));
+    this->insert(I, E);
+  }
+
+  SwissDenseMap(std::initializer_list<value_type> Vals) {
+    init(Vals.size());
+    this->insert(Vals.begin(), Vals.end());
+  }
+
+  ~SwissDenseMap() {
+    destroyAll();
+    deallocateBuckets();
+  }
+
+  void swap(SwissDenseMap &RHS) {
+    this->incrementEpoch();
+    RHS.incrementEpoch();
+    std::swap(Buckets, RHS.Buckets);
+    std::swap(Ctrl, RHS.Ctrl);
+    std::swap(NumEntries, RHS.NumEntries);
+    std::swap(NumBuckets, RHS.NumBuckets);
+    std::swap(GrowthLeft, RHS.GrowthLeft);
+  }
+
+  SwissDenseMap &operator=(const SwissDenseMap &Other) {
+    if (&Other != this)
+      copyFrom(Other);
+    return *this;
+  }
+
+  SwissDenseMap &operator=(SwissDenseMap &&Other) {
+    destroyAll();
+    deallocateBuckets();
+    init(0);
+    swap(Other);
+    return *this;
+  }
+
+  inline iterator begin() {
+    if (empty())
+      return end();
+    return iterator(Buckets, Ctrl, Buckets + NumBuckets, *this);
+  }
+  inline iterator end() {
+    return iterator(Buckets + NumBuckets, nullptr, Buckets + NumBuckets, *this,
+                    true);
+  }
+  inline const_iterator begin() const {
+    if (empty())
+      return end();
+    return const_iterator(Buckets, Ctrl, Buckets + NumBuckets, *this);
+  }
+  inline const_iterator end() const {
+    return const_iterator(Buckets + NumBuckets, nullptr, Buckets + NumBuckets,
+                          *this, true);
+  }
+
+  [[nodiscard]] bool empty() const { return NumEntries == 0; }
+  unsigned size() const { return NumEntries; }
+
+  /// Grow the map so that it can accommodate \p Size entries without growing
+  /// again.
+  void reserve(size_type Size) {
+    unsigned NewNumBuckets = getMinBucketToReserveForEntries(Size);
+    incrementEpoch();
+    if (NewNumBuckets > NumBuckets)
+      rehash(NewNumBuckets);
+  }
+
+  void clear() {
+    incrementEpoch();
+    if (NumEntries == 0 && GrowthLeft == getMaxLoad(NumBuckets))
+      return;
+
+    // If the capacity of the array is huge, and the # elements used is small,
+    // shrink the array.
+    if (NumEntries * 4 < NumBuckets && NumBuckets > 64) {
+      shrink_and_clear();
+      return;
+    }
+
+    destroyAll();
+    if (NumBuckets)
+      std::memset(Ctrl, detail::CtrlEmpty, NumBuckets + Group::Width);
+    NumEntries = 0;
+    GrowthLeft = getMaxLoad(NumBuckets);
+  }
+
+  void shrink_and_clear() {
+    unsigned OldNumEntries = NumEntries;
+    destroyAll();
+
+    // Reduce the number of buckets.
+    unsigned NewNumBuckets = 0;
+    if (OldNumEntries)
+      NewNumBuckets = std::max(64, 1 << (Log2_32_Ceil(OldNumEntries) + 1));
+    if (NewNumBuckets == NumBuckets) {
+      std::memset(Ctrl, detail::CtrlEmpty, NumBuckets + Group::Width);
+      NumEntries = 0;
+      GrowthLeft = getMaxLoad(NumBuckets);
+      return;
+    }
+
+    deallocateBuckets();
+    allocateBuckets(NewNumBuckets);
+  }
+
+  /// Return true if the specified key is in the map, false otherwise.
+  bool contains(const_arg_type_t<KeyT> Val) const {
+    return findBucket(Val) != nullptr;
+  }
+
+  /// Return 1 if the specified key is in the map, 0 otherwise.
+  size_type count(const_arg_type_t<KeyT> Val) const {
+    return contains(Val) ? 1 : 0;
+  }
+
+  iterator find(const_arg_type_t<KeyT> Val) { return find_as(Val); }
+  const_iterator find(const_arg_type_t<KeyT> Val) const {
+    return find_as(Val);
+  }
+
+  /// Alternate version of find() which allows a different, and possibly
+  /// less expensive, key type.
+  /// The DenseMapInfo is responsible for supplying methods
+  /// getHashValue(LookupKeyT) and isEqual(LookupKeyT, KeyT) for each key
+  /// type used.
+  template <class LookupKeyT> iterator find_as(const LookupKeyT &Val) {
+    if (BucketT *Bucket = findBucket(Val))
+      return makeIterator(Bucket);
+    return end();
+  }
+  template <class LookupKeyT>
+  const_iterator find_as(const LookupKeyT &Val) const {
+    if (const BucketT *Bucket = findBucket(Val))
+      return makeConstIterator(Bucket);
+    return end();
+  }
+
+  /// lookup - Return the entry for the specified key, or a default
+  /// constructed value if no such entry exists.
+  ValueT lookup(const_arg_type_t<KeyT> Val) const {
+    if (const BucketT *Bucket = findBucket(Val))
+      return Bucket->getSecond();
+    return ValueT();
+  }
+
+  /// at - Return the entry for the specified key, or abort if no such
+  /// entry exists.
+  const ValueT &at(const_arg_type_t<KeyT> Val) const {
+    auto Iter = this->find(std::move(Val));
+    assert(Iter != this->end() &&
+           "SwissDenseMap::at failed due to a missing key");
+    return Iter->second;
+  }
+
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // If the key is already in the map, it returns false and doesn't update the
+  // value.
+  std::pair<iterator, bool> insert(const std::pair<KeyT, ValueT> &KV) {
+    return try_emplace(KV.first, KV.second);
+  }
+
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // If the key is already in the map, it returns false and doesn't update the
+  // value.
+  std::pair<iterator, bool> insert(std::pair<KeyT, ValueT> &&KV) {
+    return try_emplace(std::move(KV.first), std::move(KV.second));
+  }
+
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // The value is constructed in-place if the key is not in the map, otherwise
+  // it is not moved.
+  template <typename... Ts>
+  std::pair<iterator, bool> try_emplace(KeyT &&Key, Ts &&... Args) {
+    auto [Bucket, Inserted] = findOrPrepareInsert(Key);
+    if (Inserted)
+      constructBucket(Bucket, std::move(Key), std::forward<Ts>(Args)...);
+    return std::make_pair(makeIterator(Bucket), Inserted);
+  }
+
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // The value is constructed in-place if the key is not in the map, otherwise
+  // it is not moved.
+  template <typename... Ts>
+  std::pair<iterator, bool> try_emplace(const KeyT &Key, Ts &&... Args) {
+    auto [Bucket, Inserted] = findOrPrepareInsert(Key);
+    if (Inserted)
+      constructBucket(Bucket, Key, std::forward<Ts>(Args)...);
+    return std::make_pair(makeIterator(Bucket), Inserted);
+  }
+
+  /// Alternate version of insert() which allows a different, and possibly
+  /// less expensive, key type.
+  /// The DenseMapInfo is responsible for supplying methods
+  /// getHashValue(LookupKeyT) and isEqual(LookupKeyT, KeyT) for each key
+  /// type used.
+  template <typename LookupKeyT>
+  std::pair<iterator, bool> insert_as(std::pair<KeyT, ValueT> &&KV,
+                                      const LookupKeyT &Val) {
+    auto [Bucket, Inserted] = findOrPrepareInsert(Val);
+    if (Inserted)
+      constructBucket(Bucket, std::move(KV.first), std::move(KV.second));
+    return std::make_pair(makeIterator(Bucket), Inserted);
+  }
+
+  /// insert - Range insertion of pairs.
+  template<typename InputIt>
+  void insert(InputIt I, InputIt E) {
+    for (; I != E; ++I)
+      insert(*I);
+  }
+
+  /// Returns the value associated to the key in the map if it exists. If it
+  /// does not exist, emplace a default value for the key and returns a
+  /// reference to the newly created value.
+  ValueT &getOrInsertDefault(KeyT &&Key) {
+    return try_emplace(Key).first->second;
+  }
+
+  /// Returns the value associated to the key in the map if it exists. If it
+  /// does not exist, emplace a default value for the key and returns a
+  /// reference to the newly created value.
+  ValueT &getOrInsertDefault(const KeyT &Key) {
+    return try_emplace(Key).first->second;
+  }
+
+  bool erase(const KeyT &Val) {
+    BucketT *Bucket = findBucket(Val);
+    if (!Bucket)
+      return false; // not in map.
+
+    eraseBucket(Bucket);
+    return true;
+  }
+  void erase(iterator I) {
+    BucketT *Bucket = &*I;
+    eraseBucket(Bucket);
+  }
+
+  value_type &FindAndConstruct(const KeyT &Key) {
+    auto [Bucket, Inserted] = findOrPrepareInsert(Key);
+    if (Inserted)
+      constructBucket(Bucket, Key);
+    return *Bucket;
+  }
+
+  ValueT &operator[](const KeyT &Key) {
+    return FindAndConstruct(Key).second;
+  }
+
+  value_type &FindAndConstruct(KeyT &&Key) {
+    auto [Bucket, Inserted] = findOrPrepareInsert(Key);
+    if (Inserted)
+      constructBucket(Bucket, std::move(Key));
+    return *Bucket;
+  }
+
+  ValueT &operator[](KeyT &&Key) {
+    return FindAndConstruct(std::move(Key)).second;
+  }
+
+  /// isPointerIntoBucketsArray - Return true if the specified pointer points
+  /// somewhere into the SwissDenseMap's array of buckets (i.e. either to a
+  /// key or value in the SwissDenseMap).
+  bool isPointerIntoBucketsArray(const void *Ptr) const {
+    return Ptr >= Buckets && Ptr < Buckets + NumBuckets;
+  }
+
+  /// getPointerIntoBucketsArray() - Return an opaque pointer into the buckets
+  /// array.  In conjunction with the previous method, this can be used to
+  /// determine whether an insertion caused the SwissDenseMap to reallocate.
+  const void *getPointerIntoBucketsArray() const { return Buckets; }
+
+  void grow(unsigned AtLeast) {
+    incrementEpoch();
+    rehash(std::max<unsigned>(Group::Width, NextPowerOf2(AtLeast - 1)));
+  }
+
+  /// Return the approximate size (in bytes) of the actual map.
+  /// This is just the raw memory used by SwissDenseMap.
+  /// If entries are pointers to objects, the size of the referenced objects
+  /// are not included.
+  size_t getMemorySize() const { return getAllocationSize(NumBuckets); }
+
+private:
+  static unsigned getHashValue(const KeyT &Val) {
+    return KeyInfoT::getHashValue(Val);
+  }
+
+  template <typename LookupKeyT>
+  static unsigned getHashValue(const LookupKeyT &Val) {
+    return KeyInfoT::getHashValue(Val);
+  }
+
+  /// The bucket index comes from the low bits of the hash value, like in
+  /// DenseMap, whose DenseMapInfo specializations are tuned for that. The
+  /// seven bits stored in the control byte have to be independent of the
+  /// index, so take them from the high bits of a multiplicative hash.
+  static uint32_t getH1(unsigned Hash) { return Hash; }
+  static uint8_t getH2(unsigned Hash) {
+    return (static_cast<uint64_t>(Hash) * 0x9e3779b97f4a7c15ULL) >> 57;
+  }
+
+  /// Number of buckets that can be filled before the map is rehashed.
+  static unsigned getMaxLoad(unsigned NumBuckets) {
+    return NumBuckets - NumBuckets / 8;
+  }
+
+  static unsigned getMinBucketToReserveForEntries(unsigned NumEntries) {
+    // Ensure that "NumEntries <= getMaxLoad(NumBuckets)".
+    if (NumEntries == 0)
+      return 0;
+    return std::max<unsigned>(Group::Width,
+                              PowerOf2Ceil(NumEntries * 8 / 7 + 1));
+  }
+
+  static size_t getAllocationSize(unsigned NumBuckets) {
+    if (NumBuckets == 0)
+      return 0;
+    return sizeof(BucketT) * NumBuckets + NumBuckets + Group::Width;
+  }
+
+  void init(unsigned InitNumEntries) {
+    allocateBuckets(getMinBucketToReserveForEntries(InitNumEntries));
+  }
+
+  /// Allocate \p Num buckets and mark them all as empty.
+  void allocateBuckets(unsigned Num) {
+    NumBuckets = Num;
+    NumEntries = 0;
+    GrowthLeft = getMaxLoad(Num);
+    if (Num == 0) {
+      Buckets = nullptr;
+      Ctrl = nullptr;
+      return;
+    }
+
+    Buckets = static_cast<BucketT *>(
+        allocate_buffer(getAllocationSize(Num), alignof(BucketT)));
+    Ctrl = reinterpret_cast<uint8_t *>(Buckets + Num);
+    std::memset(Ctrl, detail::CtrlEmpty, Num + Group::Width);
+  }
+
+  void deallocateBuckets() {
+    if (NumBuckets)
+      deallocate_buffer(Buckets, getAllocationSize(NumBuckets),
+                        alignof(BucketT));
+  }
+
+  void destroyAll() {
+    if (!std::is_trivially_destructible<KeyT>::value ||
+        !std::is_trivially_destructible<ValueT>::value)
+      for (unsigned I = 0; I != NumBuckets; ++I)
+        if (detail::isCtrlFull(Ctrl[I]))
+          destroyBucket(Buckets + I);
+  }
+
+  static void destroyBucket(BucketT *Bucket) {
+    Bucket->getSecond().~ValueT();
+    Bucket->getFirst().~KeyT();
+  }
+
+  template <typename KeyArg, typename... ValueArgs>
+  static void constructBucket(BucketT *Bucket, KeyArg &&Key,
+                              ValueArgs &&... Values) {
+    ::new (&Bucket->getFirst()) KeyT(std::forward<KeyArg>(Key));
+    ::new (&Bucket->getSecond()) ValueT(std::forward<ValueArgs>(Values)...);
+  }
+
+  void copyFrom(const SwissDenseMap &Other) {
+    destroyAll();
+    deallocateBuckets();
+    allocateBuckets(Other.NumBuckets);
+    if (NumBuckets == 0)
+      return;
+
+    std::memcpy(Ctrl, Other.Ctrl, NumBuckets + Group::Width);
+    NumEntries = Other.NumEntries;
+    GrowthLeft = Other.GrowthLeft;
+    if constexpr (std::is_trivially_copyable<KeyT>::value &&
+                  std::is_trivially_copyable<ValueT>::value) {
+      std::memcpy(reinterpret_cast<void *>(Buckets), Other.Buckets,
+                  NumBuckets * sizeof(BucketT));
+    } else {
+      for (unsigned I = 0; I != NumBuckets; ++I)
+        if (detail::isCtrlFull(Ctrl[I]))
+          constructBucket(Buckets + I, Other.Buckets[I].getFirst(),
+                          Other.Buckets[I].getSecond());
+    }
+  }
+
+  /// Move all entries into a new array of \p NewNumBuckets buckets, which
+  /// drops the deleted buckets.
+  void rehash(unsigned NewNumBuckets) {
+    assert(getMaxLoad(NewNumBuckets) >= NumEntries &&
+           "Too few buckets for the entries of the map");
+    BucketT *OldBuckets = Buckets;
+    uint8_t *OldCtrl = Ctrl;
+    unsigned OldNumBuckets = NumBuckets;
+    unsigned OldNumEntries = NumEntries;
+
+    allocateBuckets(NewNumBuckets);
+    for (unsigned I = 0; I != OldNumBuckets; ++I) {
+      if (!detail::isCtrlFull(OldCtrl[I]))
+        continue;
+      BucketT *Old = OldBuckets + I;
+      unsigned Hash = getHashValue(Old->getFirst());
+      unsigned Index = claimAvailableBucket(Hash);
+      constructBucket(Buckets + Index, std::move(Old->getFirst()),
+                      std::move(Old->getSecond()));
+      destroyBucket(Old);
+    }
+    assert(NumEntries == OldNumEntries && "Lost entries during rehash");
+    (void)OldNumEntries;
+
+    if (OldNumBuckets)
+      deallocate_buffer(OldBuckets, getAllocationSize(OldNumBuckets),
+                        alignof(BucketT));
+  }
+
+  /// Return the index of the first available bucket on the probe sequence of
+  /// \p Hash.
+  unsigned findAvailableBucket(unsigned Hash) const {
+    detail::GroupProbeSeq Seq(getH1(Hash), NumBuckets);
+    while (true) {
+      if (uint64_t Mask = Group(Ctrl + Seq.offset()).matchAvailable())
+        return Seq.bucket(Group::lowestIndex(Mask));
+      Seq.next();
+    }
+  }
+
+  /// Mark the first available bucket on the probe sequence of \p Hash as
+  /// full and return its index. The caller constructs the entry.
+  unsigned claimAvailableBucket(unsigned Hash) {
+    unsigned Index = findAvailableBucket(Hash);
+    if (Ctrl[Index] == detail::CtrlEmpty) {
+      // Make room for another entry, unless a deleted bucket can be reused.
+      if (LLVM_UNLIKELY(GrowthLeft == 0)) {
+        // Dropping the deleted buckets is enough if that leaves room for
+        // NumBuckets * 3 / 32 insertions, which keeps the amortized cost of
+        // rehashing constant. Otherwise grow.
+        if (NumEntries * 32 <= NumBuckets * 25)
+          rehash(NumBuckets);
+        else
+          rehash(NumBuckets * 2);
+        Index = findAvailableBucket(Hash);
+      }
+      --GrowthLeft;
+    }
+    detail::setCtrl(Ctrl, NumBuckets, Index, getH2(Hash));
+    ++NumEntries;
+    return Index;
+  }
+
+  template <typename LookupKeyT>
+  const BucketT *findBucketImpl(const LookupKeyT &Val, unsigned Hash) const {
+    detail::GroupProbeSeq Seq(getH1(Hash), NumBuckets);
+    uint8_t H2 = getH2(Hash);
+    while (true) {
+      Group G(Ctrl + Seq.offset());
+      for (uint64_t Mask = G.match(H2); Mask; Mask &= Mask - 1) {
+        const BucketT *Bucket = Buckets + Seq.bucket(Group::lowestIndex(Mask));
+        if (LLVM_LIKELY(KeyInfoT::isEqual(Val, Bucket->getFirst())))
+          return Bucket;
+      }
+      // An empty bucket ends the probe sequence.
+      if (LLVM_LIKELY(G.matchEmpty()))
+        return nullptr;
+      Seq.next();
+    }
+  }
+
+  template <typename LookupKeyT>
+  const BucketT *findBucket(const LookupKeyT &Val) const {
+    if (NumBuckets == 0)
+      return nullptr;
+    return findBucketImpl(Val, getHashValue(Val));
+  }
+
+  template <typename LookupKeyT> BucketT *findBucket(const LookupKeyT &Val) {
+    return const_cast<BucketT *>(
+        static_cast<const SwissDenseMap *>(this)->findBucket(Val));
+  }
+
+  /// Look up \p Val and return its bucket and false if it is in the map.
+  /// Otherwise claim a bucket for it, and return that bucket and true. The
+  /// caller has to construct the entry in the bucket.
+  template <typename LookupKeyT>
+  std::pair<BucketT *, bool> findOrPrepareInsert(const LookupKeyT &Val) {
+    unsigned Hash = getHashValue(Val);
+    if (NumBuckets != 0)
+      if (const BucketT *Bucket = findBucketImpl(Val, Hash))
+        return std::make_pair(const_cast<BucketT *>(Bucket), false);
+
+    incrementEpoch();
+    if (NumBuckets == 0)
+      allocateBuckets(Group::Width);
+    // Claiming the bucket may rehash, so compute its address afterwards.
+    unsigned Index = claimAvailableBucket(Hash);
+    return std::make_pair(Buckets + Index, true);
+  }
+
+  void eraseBucket(BucketT *Bucket) {
+    destroyBucket(Bucket);
+    unsigned Index = Bucket - Buckets;
+    --NumEntries;
+
+    // A probe for some other key only passes over this bucket if the group it
+    // loaded had no empty bucket. If every run of Width buckets containing
+    // this one also contains an empty bucket, no probe sequence can depend on
+    // this bucket being full, and it can be marked as empty again instead of
+    // leaving a tombstone.
+    uint64_t EmptyBefore =
+        Group(Ctrl + ((Index - Group::Width) & (NumBuckets - 1))).matchEmpty();
+    uint64_t EmptyAfter = Group(Ctrl + Index).matchEmpty();
+    if (EmptyBefore && EmptyAfter &&
+        Group::trailingBuckets(EmptyBefore) +
+                Group::leadingBuckets(EmptyAfter) <
+            Group::Width) {
+      detail::setCtrl(Ctrl, NumBuckets, Index, detail::CtrlEmpty);
+      ++GrowthLeft;
+      return;
+    }
+    detail::setCtrl(Ctrl, NumBuckets, Index, detail::CtrlDeleted);
+  }
+
+  iterator makeIterator(BucketT *Bucket) {
+    return iterator(Bucket, Ctrl + (Bucket - Buckets), Buckets + NumBuckets,
+                    *this, true);
+  }
+
+  const_iterator makeConstIterator(const BucketT *Bucket) const {
+    return const_iterator(Bucket, Ctrl + (Bucket - Buckets),
+                          Buckets + NumBuckets, *this, true);
+  }
+};
+
+/// Equality comparison for SwissDenseMap.
+///
+/// Iterates over elements of LHS confirming that each (key, value) pair in LHS
+/// is also in RHS, and that no additional pairs are in RHS.
+/// Equivalent to N calls to RHS.find and N value comparisons. Amortized
+/// complexity is linear, worst case is O(N^2) (if every hash collides).
+template <typename KeyT, typename ValueT, typename KeyInfoT, typename BucketT>
+bool operator==(const SwissDenseMap<KeyT, ValueT, KeyInfoT, BucketT> &LHS,
+                const SwissDenseMap<KeyT, ValueT, KeyInfoT, BucketT> &RHS) {
+  if (LHS.size() != RHS.size())
+    return false;
+
+  for (auto &KV : LHS) {
+    auto I = RHS.find(KV.first);
+    if (I == RHS.end() || I->second != KV.second)
+      return false;
+  }
+
+  return true;
+}
+
+/// Inequality comparison for SwissDenseMap.
+///
+/// Equivalent to !(LHS == RHS). See operator== for performance notes.
+template <typename KeyT, typename ValueT, typename KeyInfoT, typename BucketT>
+bool operator!=(const SwissDenseMap<KeyT, ValueT, KeyInfoT, BucketT> &LHS,
+                const SwissDenseMap<KeyT, ValueT, KeyInfoT, BucketT> &RHS) {
+  return !(LHS == RHS);
+}
+
+template <typename Bucket, bool IsConst>
+class SwissDenseMapIterator : DebugEpochBase::HandleBase {
+  friend class SwissDenseMapIterator<Bucket, true>;
+  friend class SwissDenseMapIterator<Bucket, false>;
+
+public:
+  using difference_type = ptrdiff_t;
+  using value_type = std::conditional_t<IsConst, const Bucket, Bucket>;
+  using pointer = value_type *;
+  using reference = value_type &;
+  using iterator_category = std::forward_iterator_tag;
+
+private:
+  pointer Ptr = nullptr;
+  pointer End = nullptr;
+  // The control byte of the bucket Ptr points to.
+  const uint8_t *Ctrl = nullptr;
+
+public:
+  SwissDenseMapIterator() = default;
+
+  SwissDenseMapIterator(pointer Pos, const uint8_t *Ctrl, pointer E,
+                        const DebugEpochBase &Epoch, bool NoAdvance = false)
+      : DebugEpochBase::HandleBase(&Epoch), Ptr(Pos), End(E), Ctrl(Ctrl) {
+    assert(isHandleInSync() && "invalid construction!");
+
+    if (NoAdvance) return;
+    AdvancePastEmptyBuckets();
+  }
+
+  // Converting ctor from non-const iterators to const iterators. SFINAE'd out
+  // for const iterator destinations so it doesn't end up as a user defined copy
+  // constructor.
+  template <bool IsConstSrc,
+            typename = std::enable_if_t<!IsConstSrc && IsConst>>
+  SwissDenseMapIterator(const SwissDenseMapIterator<Bucket, IsConstSrc> &I)
+      : DebugEpochBase::HandleBase(I), Ptr(I.Ptr), End(I.End), Ctrl(I.Ctrl) {}
+
+  reference operator*() const {
+    assert(isHandleInSync() && "invalid iterator access!");
+    assert(Ptr != End && "dereferencing end() iterator");
+    return *Ptr;
+  }
+  pointer operator->() const {
+    assert(isHandleInSync() && "invalid iterator access!");
+    assert(Ptr != End && "dereferencing end() iterator");
+    return Ptr;
+  }
+
+  friend bool operator==(const SwissDenseMapIterator &LHS,
+                         const SwissDenseMapIterator &RHS) {
+    assert((!LHS.Ptr || LHS.isHandleInSync()) && "handle not in sync!");
+    assert((!RHS.Ptr || RHS.isHandleInSync()) && "handle not in sync!");
+    assert(LHS.getEpochAddress() == RHS.getEpochAddress() &&
+           "comparing incomparable iterators!");
+    return LHS.Ptr == RHS.Ptr;
+  }
+
+  friend bool operator!=(const SwissDenseMapIterator &LHS,
+                         const SwissDenseMapIterator &RHS) {
+    return !(LHS == RHS);
+  }
+
+  inline SwissDenseMapIterator &operator++() { // Preincrement
+    assert(isHandleInSync() && "invalid iterator access!");
+    assert(Ptr != End && "incrementing end() iterator");
+    ++Ptr;
+    ++Ctrl;
+    AdvancePastEmptyBuckets();
+    return *this;
+  }
+  SwissDenseMapIterator operator++(int) { // Postincrement
+    assert(isHandleInSync() && "invalid iterator access!");
+    SwissDenseMapIterator tmp = *this; ++*this; return tmp;
+  }
+
+private:
+  void AdvancePastEmptyBuckets() {
+    assert(Ptr <= End);
+    while (Ptr != End && !detail::isCtrlFull(*Ctrl)) {
+      ++Ptr;
+      ++Ctrl;
+    }
+  }
+};
+
+template <typename KeyT, typename ValueT, typename KeyInfoT>
+inline size_t
+capacity_in_bytes(const SwissDenseMap<KeyT, ValueT, KeyInfoT> &X) {
+  return X.getMemorySize();
+}
+
+} // end namespace llvm
+
+#endif // LLVM_ADT_SWISSDENSEMAP_H
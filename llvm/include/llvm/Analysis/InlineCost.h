@@ -14,9 +14,12 @@
 #define LLVM_ANALYSIS_INLINECOST_H
 
 #include "llvm/ADT/APInt.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Analysis/InlineModelFeatureMaps.h"
 #include "llvm/IR/PassManager.h"
+#include "llvm/Support/InstructionCost.h"
 #include <cassert>
 #include <climits>
 #include <optional>
@@ -28,9 +31,11 @@ class BlockFrequencyInfo;
 class CallBase;
 class DataLayout;
 class Function;
+class Instruction;
 class ProfileSummaryInfo;
 class TargetTransformInfo;
 class TargetLibraryInfo;
+class Value;
 
 namespace InlineConstants {
 // Various thresholds used by inline cost analysis.
@@ -263,6 +268,48 @@ InlineParams getInlineParams(unsigned OptLevel, unsigned SizeOptLevel);
 int getCallsiteCost(const TargetTransformInfo &TTI, const CallBase &Call,
                     const DataLayout &DL);
 
+/// The parts of the inline cost analysis that only depend on the body of a
+/// function. They are computed on first use and shared by the analyses of all
+/// the call sites of the function, and of the call sites in it.
+class InlineCostCalleeInfo {
+public:
+  InlineCostCalleeInfo(Function &F, AssumptionCache &AC,
+                       const TargetTransformInfo &TTI)
+      : F(F), AC(AC), TTI(TTI) {}
+
+  /// Return the values only used by assumptions, which are free.
+  const SmallPtrSetImpl<const Value *> &getEphemeralValues();
+
+  /// Return true if the function is a user of itself in a call, which is how
+  /// the analysis of the calls in it decides that it is recursive.
+  bool isSelfRecursive();
+
+  /// Return the size and latency cost of \p I as computed by \p CalleeTTI.
+  /// It is only memoized if \p CalleeTTI is the one of the function.
+  InstructionCost getInstructionCost(const Instruction &I,
+                                     const TargetTransformInfo &CalleeTTI);
+
+private:
+  Function &F;
+  AssumptionCache &AC;
+  const TargetTransformInfo &TTI;
+  std::optional<SmallPtrSet<const Value *, 32>> EphValues;
+  std::optional<bool> IsSelfRecursive;
+  DenseMap<const Instruction *, InstructionCost> InstructionCosts;
+};
+
+/// Analysis providing the InlineCostCalleeInfo of a function. The inliners
+/// invalidate it on every function they inline into.
+class InlineCostCalleeAnalysis
+    : public AnalysisInfoMixin<InlineCostCalleeAnalysis> {
+  friend AnalysisInfoMixin<InlineCostCalleeAnalysis>;
+  static AnalysisKey Key;
+
+public:
+  using Result = InlineCostCalleeInfo;
+  Result run(Function &F, FunctionAnalysisManager &FAM);
+};
+
 /// Get an InlineCost object representing the cost of inlining this
 /// callsite.
 ///
@@ -273,29 +320,30 @@ int getCallsiteCost(const TargetTransformInfo &TTI, const CallBase &Call,
 /// sufficiently low to warrant inlining.
 ///
 /// Also note that calling this function *dynamically* computes the cost of
-/// inlining the callsite. It is an expensive, heavyweight call.
-InlineCost
-getInlineCost(CallBase &Call, const InlineParams &Params,
-              TargetTransformInfo &CalleeTTI,
-              function_ref<AssumptionCache &(Function &)> GetAssumptionCache,
-              function_ref<const TargetLibraryInfo &(Function &)> GetTLI,
-              function_ref<BlockFrequencyInfo &(Function &)> GetBFI = nullptr,
-              ProfileSummaryInfo *PSI = nullptr,
-              OptimizationRemarkEmitter *ORE = nullptr);
+/// inlining the callsite. It is an expensive, heavyweight call. The parts of it
+/// that only depend on the functions involved are reused from
+/// \p GetCalleeInfo, if it is provided.
+InlineCost getInlineCost(
+    CallBase &Call, const InlineParams &Params, TargetTransformInfo &CalleeTTI,
+    function_ref<AssumptionCache &(Function &)> GetAssumptionCache,
+    function_ref<const TargetLibraryInfo &(Function &)> GetTLI,
+    function_ref<BlockFrequencyInfo &(Function &)> GetBFI = nullptr,
+    ProfileSummaryInfo *PSI = nullptr, OptimizationRemarkEmitter *ORE = nullptr,
+    function_ref<InlineCostCalleeInfo &(Function &)> GetCalleeInfo = nullptr);
 
 /// Get an InlineCost with the callee explicitly specified.
 /// This allows you to calculate the cost of inlining a function via a
 /// pointer. This behaves exactly as the version with no explicit callee
 /// parameter in all other respects.
 //
-InlineCost
-getInlineCost(CallBase &Call, Function *Callee, const InlineParams &Params,
-              TargetTransformInfo &CalleeTTI,
-              function_ref<AssumptionCache &(Function &)> GetAssumptionCache,
-              function_ref<const TargetLibraryInfo &(Function &)> GetTLI,
-              function_ref<BlockFrequencyInfo &(Function &)> GetBFI = nullptr,
-              ProfileSummaryInfo *PSI = nullptr,
-              OptimizationRemarkEmitter *ORE = nullptr);
+InlineCost getInlineCost(
+    CallBase &Call, Function *Callee, const InlineParams &Params,
+    TargetTransformInfo &CalleeTTI,
+    function_ref<AssumptionCache &(Function &)> GetAssumptionCache,
+    function_ref<const TargetLibraryInfo &(Function &)> GetTLI,
+    function_ref<BlockFrequencyInfo &(Function &)> GetBFI = nullptr,
+    ProfileSummaryInfo *PSI = nullptr, OptimizationRemarkEmitter *ORE = nullptr,
+    function_ref<InlineCostCalleeInfo &(Function &)> GetCalleeInfo = nullptr);
 
 /// Returns InlineResult::success() if the call site should be always inlined
 /// because of user directives, and the inlining is viable. Returns
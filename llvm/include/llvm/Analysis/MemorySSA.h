@@ -499,11 +499,14 @@ public:
   using const_block_iterator = BasicBlock *const *;
 
   block_iterator block_begin() {
-    return reinterpret_cast<block_iterator>(op_begin() + ReservedSpace);
+    // The blocks follow the Uses and the pointer back to this MemoryPhi.
+    return reinterpret_cast<block_iterator>(
+        reinterpret_cast<Use::UserRef *>(op_begin() + ReservedSpace) + 1);
   }
 
   const_block_iterator block_begin() const {
-    return reinterpret_cast<const_block_iterator>(op_begin() + ReservedSpace);
+    return reinterpret_cast<const_block_iterator>(
+        reinterpret_cast<const Use::UserRef *>(op_begin() + ReservedSpace) + 1);
   }
 
   block_iterator block_end() { return block_begin() + getNumOperands(); }
@@ -1357,6 +1357,10 @@ private:
 
   public:
     SCEVCallbackVH(Value *V, ScalarEvolution *SE = nullptr);
+
+    /// The value of CacheClock when the entry of ValueExprMap for this value
+    /// was last used.
+    uint64_t LastUse = 0;
   };
 
   friend class SCEVCallbackVH;
@@ -1407,6 +1411,18 @@ private:
   /// This is a cache of the values we have analyzed so far.
   ValueExprMapType ValueExprMap;
 
+  /// Counts the uses of ValueExprMap and the backedge-taken count caches, to
+  /// find their least recently used entries.
+  uint64_t CacheClock = 0;
+
+  /// The number of queries running that may call getSCEV or compute a
+  /// backedge-taken count themselves: creating SCEVs, backedge-taken counts,
+  /// values at scope, ranges, implied conditions, loop guards and overflow
+  /// checks. The caches are only trimmed when it is zero, i.e. at the start
+  /// of a query from outside of ScalarEvolution, as trimming forgets results
+  /// and placeholders that the running queries still depend on.
+  unsigned QueryDepth = 0;
+
   /// This is a cache for expressions that got folded to a different existing
   /// SCEV.
   DenseMap<FoldID, const SCEV *> FoldCache;
@@ -1489,6 +1505,9 @@ private:
     /// True iff the backedge is taken either exactly Max or zero times.
     bool MaxOrZero = false;
 
+    /// The value of CacheClock when this was last used.
+    uint64_t LastUse = 0;
+
     bool isComplete() const { return IsComplete; }
     const SCEV *getConstantMax() const { return ConstantMax; }
 
@@ -2039,6 +2058,14 @@ private:
   /// Forget predicated/non-predicated backedge taken counts for the given loop.
   void forgetBackedgeTakenCounts(const Loop *L, bool Predicated);
 
+  /// If ValueExprMap is over its size limit, evict its least recently used
+  /// values and forget everything memoized about their SCEVs.
+  void trimValueExprMap();
+
+  /// If the predicated or non-predicated backedge-taken counts are over their
+  /// size limit, forget the least recently used ones.
+  void trimBackedgeTakenCounts(bool Predicated);
+
   /// Drop memoized information for all \p SCEVs.
   void forgetMemoizedResults(ArrayRef<const SCEV *> SCEVs);
 
@@ -0,0 +1,56 @@
+//===- CacheEviction.h - Least recently used eviction -----------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// The bounded caches of ScalarEvolution and LazyValueInfo record when each of
+// their entries was last used, and evict the least recently used ones once
+// they grow over their limit.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ANALYSIS_UTILS_CACHEEVICTION_H
+#define LLVM_ANALYSIS_UTILS_CACHEEVICTION_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+
+namespace llvm {
+
+/// Returns the keys of the least recently used entries of \p Cache if it has
+/// more than \p Limit entries, or nothing if it doesn't or \p Limit is 0.
+/// Evicting them leaves three quarters of the limit, so that the search is
+/// amortized over many insertions. \p GetEntry maps an entry of the cache to
+/// a pair of the time it was last used and its key.
+template <typename CacheT, typename EntryFn>
+auto findEntriesToEvict(const CacheT &Cache, unsigned Limit,
+                        EntryFn GetEntry) {
+  using EntryT = std::invoke_result_t<EntryFn &, decltype(*Cache.begin())>;
+  static_assert(std::is_same_v<typename EntryT::first_type, uint64_t>,
+                "Entries must be pairs of the time of last use and a key");
+  SmallVector<typename EntryT::second_type, 0> Keys;
+  if (!Limit || Cache.size() <= Limit)
+    return Keys;
+
+  SmallVector<EntryT, 0> Entries;
+  Entries.reserve(Cache.size());
+  for (const auto &Entry : Cache)
+    Entries.push_back(GetEntry(Entry));
+  size_t NumEvicted = Entries.size() - (Limit - Limit / 4);
+  std::nth_element(Entries.begin(), Entries.begin() + NumEvicted,
+                   Entries.end());
+  Keys.reserve(NumEvicted);
+  for (const auto &[LastUse, Key] : ArrayRef(Entries).take_front(NumEvicted))
+    Keys.push_back(Key);
+  return Keys;
+}
+
+} // end namespace llvm
+
+#endif // LLVM_ANALYSIS_UTILS_CACHEEVICTION_H
@@ -292,6 +292,57 @@ public:
     }
   }
 
+  /// Reads \p NumElts VBRs with chunks of \p NumBits bits into \p Vals, like
+  /// calling ReadVBR64 that many times. Values that lie entirely within the
+  /// current word are decoded straight from it, without refilling the word or
+  /// checking for the end of the stream.
+  Error ReadVBR64Array(const unsigned NumBits, unsigned NumElts,
+                       SmallVectorImpl<uint64_t> &Vals) {
+    assert(NumBits <= 32 && NumBits >= 1 && "Invalid NumBits value");
+    static const unsigned Mask = sizeof(word_t) > 4 ? 0x3f : 0x1f;
+    const word_t ChunkMask = ~word_t(0) >> (sizeof(word_t) * 8 - NumBits);
+    const word_t ContinueBit = word_t(1) << (NumBits - 1);
+
+    while (NumElts) {
+      word_t Word = CurWord;
+      unsigned Bits = BitsInCurWord;
+      while (NumElts && Bits >= NumBits) {
+        word_t Piece = Word & ChunkMask;
+        word_t NextWord = Word >> (NumBits & Mask);
+        unsigned NextBits = Bits - NumBits;
+        uint64_t Result = Piece & (ContinueBit - 1);
+        unsigned NextBit = 0;
+        while (Piece & ContinueBit) {
+          NextBit += NumBits - 1;
+          if (NextBits < NumBits || NextBit >= 64)
+            break;
+          Piece = NextWord & ChunkMask;
+          NextWord >>= (NumBits & Mask);
+          NextBits -= NumBits;
+          Result |= uint64_t(Piece & (ContinueBit - 1)) << NextBit;
+        }
+        // Leave values that continue into the next word to ReadVBR64.
+        if (Piece & ContinueBit)
+          break;
+        Vals.push_back(Result);
+        Word = NextWord;
+        Bits = NextBits;
+        --NumElts;
+      }
+      CurWord = Word;
+      BitsInCurWord = Bits;
+      if (!NumElts)
+        break;
+
+      Expected<uint64_t> MaybeVal = ReadVBR64(NumBits);
+      if (!MaybeVal)
+        return MaybeVal.takeError();
+      Vals.push_back(MaybeVal.get());
+      --NumElts;
+    }
+    return Error::success();
+  }
+
   void SkipToFourByteBoundary() {
     // If word_t is 64-bits and if we've read less than 32 bits, just dump
     // the bits we have up to the next 32-bit boundary.
@@ -2202,6 +2202,16 @@ public:
     return OptLevel >= CodeGenOptLevel::Aggressive ? 4 : 2;
   }
 
+  /// Returns the target-specific default value for the branch probability
+  /// threshold, in percent, that block placement uses to decide whether a
+  /// successor of \p MBB should become its fall-through when profile data is
+  /// available. Targets with a high penalty for taken branches can lower it
+  /// to bias the layout towards falling through on the hot path. This value
+  /// will be used if the profile-likely-prob argument is not provided.
+  virtual unsigned getProfileLikelyProb(const MachineBasicBlock &MBB) const {
+    return 51;
+  }
+
   /// Returns the callee operand from the given \p MI.
   virtual const MachineOperand &getCalleeOperand(const MachineInstr &MI) const {
     return MI.getOperand(0);
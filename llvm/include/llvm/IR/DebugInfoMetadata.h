@@ -3367,7 +3367,9 @@ public:
   DINodeArray getAnnotations() const {
     return cast_or_null<MDTuple>(getRawAnnotations());
   }
-  Metadata *getRawAnnotations() const { return getOperand(4); }
+  Metadata *getRawAnnotations() const {
+    return getNumOperands() > 4 ? getOperandAs<Metadata>(4) : nullptr;
+  }
 
   bool isArtificial() const { return getFlags() & FlagArtificial; }
   bool isObjectPointer() const { return getFlags() & FlagObjectPointer; }
@@ -17,13 +17,16 @@
 #ifndef LLVM_IR_GVMATERIALIZER_H
 #define LLVM_IR_GVMATERIALIZER_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include <vector>
 
 namespace llvm {
 
 class Error;
+class Function;
 class GlobalValue;
 class StructType;
+class ThreadPoolStrategy;
 
 class GVMaterializer {
 protected:
@@ -36,6 +39,12 @@ public:
   ///
   virtual Error materialize(GlobalValue *GV) = 0;
 
+  /// Make sure the given functions are fully read, doing what can be done on
+  /// other threads on the threads of \p S. By default they are read one at a
+  /// time.
+  virtual Error materializeFunctions(ArrayRef<Function *> Fns,
+                                     ThreadPoolStrategy S);
+
   /// Make sure the entire Module has been completely read.
   ///
   virtual Error materializeModule() = 0;
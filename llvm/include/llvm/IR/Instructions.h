@@ -3050,7 +3050,9 @@ public:
   using const_block_iterator = BasicBlock * const *;
 
   const_block_iterator block_begin() const {
-    return reinterpret_cast<const_block_iterator>(op_begin() + ReservedSpace);
+    // The blocks follow the Uses and the pointer back to this PHI.
+    return reinterpret_cast<const_block_iterator>(
+        reinterpret_cast<const Use::UserRef *>(op_begin() + ReservedSpace) + 1);
   }
 
   const_block_iterator block_end() const {
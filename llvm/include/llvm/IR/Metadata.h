@@ -1076,12 +1076,16 @@ class MDNode : public Metadata {
   /// immediately before the header, overlapping with the operands.
   /// Explicity set alignment because bitfields by default have an
   /// alignment of 1 on z/OS.
+  /// The bit-fields are all unsigned so that they pack into one word next to
+  /// NumUnresolved, which keeps the header at 8 bytes.
   struct alignas(alignof(size_t)) Header {
-    bool IsResizable : 1;
-    bool IsLarge : 1;
-    size_t SmallSize : 4;
-    size_t SmallNumOps : 4;
-    size_t : sizeof(size_t) * CHAR_BIT - 10;
+    unsigned IsResizable : 1;
+    unsigned IsLarge : 1;
+    unsigned SmallSize : 4;
+    unsigned SmallNumOps : 4;
+    /// Whether the node was allocated from the BumpPtrAllocator of its
+    /// context, which frees it along with everything else.
+    unsigned IsContextAllocated : 1;
 
     unsigned NumUnresolved = 0;
     using LargeStorageVector = SmallVector<MDOperand, 0>;
@@ -1183,6 +1187,12 @@ protected:
   ~MDNode() = default;
 
   void *operator new(size_t Size, size_t NumOps, StorageType Storage);
+  /// Allocate uniqued nodes from the BumpPtrAllocator of \p Context, and other
+  /// nodes like the overload above. This avoids the overhead of malloc for
+  /// kinds of nodes that are small, numerous and rarely deleted before their
+  /// context.
+  void *operator new(size_t Size, size_t NumOps, StorageType Storage,
+                     LLVMContext &Context);
   void operator delete(void *Mem);
 
   /// Required by std, but never called.
@@ -1195,6 +1205,11 @@ protected:
     llvm_unreachable("Constructor throws?");
   }
 
+  /// Required by std, but never called.
+  void operator delete(void *, size_t, StorageType, LLVMContext &) {
+    llvm_unreachable("Constructor throws?");
+  }
+
   void dropAllReferences();
 
   MDOperand *mutable_begin() { return getHeader().operands().begin(); }
@@ -49,6 +49,7 @@ class MemoryBuffer;
 class ModuleSummaryIndex;
 class RandomNumberGenerator;
 class StructType;
+class ThreadPoolStrategy;
 class VersionTuple;
 
 /// A Module instance is used to store all the information related to an
@@ -568,6 +569,11 @@ public:
   /// Make sure the GlobalValue is fully read.
   llvm::Error materialize(GlobalValue *GV);
 
+  /// Make sure the functions \p Fns are fully read. The bitcode reader decodes
+  /// their bodies on the threads of \p S before it builds them one at a time.
+  llvm::Error materializeFunctions(ArrayRef<Function *> Fns,
+                                   ThreadPoolStrategy S);
+
   /// Make sure all GlobalValues in this Module are fully read and clear the
   /// Materializer.
   llvm::Error materializeAll();
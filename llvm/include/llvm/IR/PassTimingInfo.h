@@ -40,7 +40,9 @@ Timer *getPassTimer(Pass *);
 /// It provides the pass-instrumentation callbacks that measure the pass
 /// execution time. They collect timing info into individual timers as
 /// passes are being run. At the end of its life-time it prints the resulting
-/// timing report.
+/// timing report. With -track-perf-counters, the report and its JSON output
+/// also attribute hardware performance counters and the growth of the peak
+/// resident set size to each pass and analysis.
 class TimePassesHandler {
   /// Value of this type is capable of uniquely identifying pass invocations.
   /// It is a pair of string Pass-Identifier (which for now is common
@@ -25,8 +25,10 @@
 #define LLVM_IR_USE_H
 
 #include "llvm-c/Types.h"
+#include "llvm/ADT/PointerIntPair.h"
 #include "llvm/Support/CBindingWrapping.h"
 #include "llvm/Support/Compiler.h"
+#include <cstring>
 
 namespace llvm {
 
@@ -48,6 +50,21 @@ public:
   /// that also works with less standard-compliant compilers
   void swap(Use &RHS);
 
+  /// Pointer traits for UserRef, which always use the lowest bit whatever the
+  /// alignment of User is on the target.
+  struct UserRefPointerTraits {
+    static inline void *getAsVoidPointer(User *P) { return P; }
+    static inline User *getFromVoidPointer(void *P) {
+      return static_cast<User *>(P);
+    }
+    static constexpr int NumLowBitsAvailable = 1;
+  };
+
+  /// The word following an array of hung-off Uses, which points back to their
+  /// User with the lowest bit set. The first word of a User whose Uses are
+  /// co-allocated with it never has that bit set.
+  using UserRef = PointerIntPair<User *, 1, unsigned, UserRefPointerTraits>;
+
 private:
   /// Destructor - Only for zap()
   ~Use() {
@@ -55,8 +72,13 @@ private:
       removeFromList();
   }
 
+  /// The waymarks kept in the low bits of Prev. Read from the end of an array
+  /// of Uses, the digits between two stop tags spell the distance to its end
+  /// in binary, and a full stop marks its last Use.
+  enum PrevPtrTag { zeroDigitTag, oneDigitTag, stopTag, fullStopTag };
+
   /// Constructor
-  Use(User *Parent) : Parent(Parent) {}
+  Use(PrevPtrTag Tag) { Prev.setInt(Tag); }
 
 public:
   friend class Value;
@@ -69,7 +91,13 @@ public:
   ///
   /// For an instruction operand, for example, this will return the
   /// instruction.
-  User *getUser() const { return Parent; };
+  User *getUser() const {
+    // The last Use of an array, e.g. the only operand of a unary instruction,
+    // is directly followed by its User or a UserRef.
+    if (LLVM_LIKELY(Prev.getInt() == fullStopTag))
+      return getUserAt(this + 1);
+    return getUserAt(getImpliedUser());
+  }
 
   inline void set(Value *Val);
 
@@ -84,29 +112,52 @@ public:
   /// Return the operand # of this use in its User.
   unsigned getOperandNo() const;
 
+  /// Initializes the waymarks of the Uses in [Start, Stop), which do not
+  /// refer to any value yet, and returns Start.
+  static Use *initTags(Use *Start, Use *Stop);
+
   /// Destroys Use operands when the number of operands of
   /// a User changes.
   static void zap(Use *Start, const Use *Stop, bool del = false);
 
 private:
+  /// Returns the end of the array of Uses this one is in, following the
+  /// waymarks.
+  const Use *getImpliedUser() const LLVM_READONLY;
+
+  /// Returns the User at \p End, the end of an array of Uses. It is either
+  /// the User the Uses were co-allocated with, whose first word never has the
+  /// lowest bit set, or a UserRef to the User of hung-off Uses.
+  static User *getUserAt(const Use *End) {
+    void *Word;
+    std::memcpy(&Word, End, sizeof(Word));
+    UserRef Ref = UserRef::getFromOpaqueValue(Word);
+    return Ref.getInt() ? Ref.getPointer()
+                        : reinterpret_cast<User *>(const_cast<Use *>(End));
+  }
 
   Value *Val = nullptr;
   Use *Next = nullptr;
-  Use **Prev = nullptr;
-  User *Parent = nullptr;
+  /// The Next field of the previous Use on the list, or the head of the list.
+  /// Its low bits are the waymark of this Use, which stays with the position
+  /// of the Use in its array rather than with its value.
+  PointerIntPair<Use **, 2, PrevPtrTag> Prev;
+
+  void setPrev(Use **NewPrev) { Prev.setPointer(NewPrev); }
 
   void addToList(Use **List) {
     Next = *List;
     if (Next)
-      Next->Prev = &Next;
-    Prev = List;
-    *Prev = this;
+      Next->setPrev(&Next);
+    setPrev(List);
+    *List = this;
   }
 
   void removeFromList() {
-    *Prev = Next;
+    Use **StrippedPrev = Prev.getPointer();
+    *StrippedPrev = Next;
     if (Next)
-      Next->Prev = Prev;
+      Next->setPrev(StrippedPrev);
   }
 };
 
@@ -72,6 +72,10 @@ using ValueName = StringMapEntry<Value *>;
 /// objects that watch it and listen to RAUW and Destroy events.  See
 /// llvm/IR/ValueHandle.h for details.
 class Value {
+  // The type comes first: the Uses co-allocated in front of a User find it by
+  // its first word, which must not have the lowest bit set. See Use.h.
+  Type *VTy;
+
   const unsigned char SubclassID;   // Subclass identifier (for isa/dyn_cast)
   unsigned char HasValueHandle : 1; // Has a ValueHandle pointing to this?
 
@@ -115,7 +119,6 @@ protected:
   unsigned HasDescriptor : 1;
 
 private:
-  Type *VTy;
   Use *UseList;
 
   friend class ValueAsMetadata; // Allow access to IsUsedByMD.
@@ -957,7 +960,7 @@ template <class Compare> void Value::sortUseList(Compare Cmp) {
 
   // Fix the Prev pointers.
   for (Use *I = UseList, **Prev = &UseList; I; I = I->Next) {
-    I->Prev = Prev;
+    I->setPrev(Prev);
     Prev = &I->Next;
   }
 }
@@ -711,6 +711,9 @@ private:
                                ArrayRef<PipelineElement> Pipeline);
   Error parseModulePassPipeline(ModulePassManager &MPM,
                                 ArrayRef<PipelineElement> Pipeline);
+  Error parseParallelFunctionPass(ModulePassManager &MPM,
+                                  ArrayRef<PipelineElement> Pipeline,
+                                  unsigned Threads);
 
   // Adds passes to do pre-inlining and related cleanup passes before
   // profile instrumentation/matching (to enable better context sensitivity),
@@ -52,6 +52,14 @@ public:
     llvm_blake3_hasher_update(&Hasher, Str.data(), Str.size());
   }
 
+  /// Inputs shorter than this are not worth hashing on multiple threads.
+  static constexpr size_t MinParallelSize = 1024 * 1024;
+
+  /// Digest more data, using the threads of llvm::parallel to hash the
+  /// independent subtrees of large inputs. The result is the same as for
+  /// update().
+  void updateParallel(ArrayRef<uint8_t> Data);
+
   /// Finalize the hasher and put the result in \p Result.
   /// This doesn't modify the hasher itself, and it's possible to finalize again
   /// after adding more input.
@@ -89,6 +97,15 @@ public:
     return Hasher.final<NumBytes>();
   }
 
+  /// Returns a BLAKE3 hash for the given data, hashing large inputs on
+  /// multiple threads.
+  template <size_t NumBytes = LLVM_BLAKE3_OUT_LEN>
+  static BLAKE3Result<NumBytes> hashParallel(ArrayRef<uint8_t> Data) {
+    BLAKE3 Hasher;
+    Hasher.updateParallel(Data);
+    return Hasher.final<NumBytes>();
+  }
+
 private:
   llvm_blake3_hasher Hasher;
 };
@@ -1272,6 +1272,14 @@ public:
     priv ///< May modify via data, but changes are lost on destruction.
   };
 
+  /// The expected access pattern of a mapping, see advise().
+  enum class AccessPattern {
+    Normal,     ///< No particular pattern.
+    Sequential, ///< Read from start to end, read ahead aggressively.
+    Random,     ///< Scattered accesses, readahead is wasted.
+    WillNeed    ///< The whole mapping is needed soon, start reading it now.
+  };
+
 private:
   /// Platform-specific mapping state.
   size_t Size = 0;
@@ -1297,6 +1305,7 @@ private:
 
   void unmapImpl();
   void dontNeedImpl();
+  void adviseImpl(AccessPattern Pattern);
 
   std::error_code init(sys::fs::file_t FD, uint64_t Offset, mapmode Mode);
 
@@ -1328,6 +1337,10 @@ public:
   }
   void dontNeed() { dontNeedImpl(); }
 
+  /// Tell the OS how the mapping is going to be accessed, so that it can tune
+  /// readahead. This is only a hint and is a no-op where it isn't supported.
+  void advise(AccessPattern Pattern) { adviseImpl(Pattern); }
+
   size_t size() const;
   char *data() const;
 
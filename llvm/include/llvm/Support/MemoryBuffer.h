@@ -82,6 +82,17 @@ public:
   /// function should not be called on a writable buffer.
   virtual void dontNeedIfMmap() {}
 
+  /// The expected access pattern of a buffer, see adviseIfMmap(). This mirrors
+  /// sys::fs::mapped_file_region::AccessPattern to avoid a dependency.
+  enum class AccessPattern { Normal, Sequential, Random, WillNeed };
+
+  /// For MemoryBuffer_MMap, tell the kernel how the buffer is going to be
+  /// accessed. Sequential makes it read ahead more aggressively, WillNeed
+  /// starts reading the whole file in the background, which is useful right
+  /// after opening an input that is going to be parsed completely. This calls
+  /// madvise on *NIX systems and is a no-op for other kinds of buffers.
+  virtual void adviseIfMmap(AccessPattern Pattern) {}
+
   /// Open the specified file as a MemoryBuffer, returning a new MemoryBuffer
   /// if successful, otherwise returning null.
   ///
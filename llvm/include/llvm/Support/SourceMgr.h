@@ -90,6 +90,10 @@ private:
   DiagHandlerTy DiagHandler = nullptr;
   void *DiagContext = nullptr;
 
+  /// The buffer found by the last call to FindBufferContainingLoc, or 0 if an
+  /// earlier buffer overlaps it.
+  mutable unsigned LastBufferID = 0;
+
   bool isValidBufferID(unsigned i) const { return i && i <= Buffers.size(); }
 
 public:
@@ -163,6 +167,7 @@ public:
     std::move(SrcMgr.Buffers.begin(), SrcMgr.Buffers.end(),
               std::back_inserter(Buffers));
     SrcMgr.Buffers.clear();
+    SrcMgr.LastBufferID = 0;
     Buffers[OldNumBuffers].IncludeLoc = MainBufferIncludeLoc;
   }
 
@@ -192,13 +197,15 @@ public:
   unsigned FindBufferContainingLoc(SMLoc Loc) const;
 
   /// Find the line number for the specified location in the specified file.
-  /// This is not a fast method.
+  /// The first lookup in a buffer indexes its lines, later ones are a binary
+  /// search.
   unsigned FindLineNumber(SMLoc Loc, unsigned BufferID = 0) const {
     return getLineAndColumn(Loc, BufferID).first;
   }
 
   /// Find the line and column number for the specified location in the
-  /// specified file. This is not a fast method.
+  /// specified file. The first lookup in a buffer indexes its lines, later
+  /// ones are a binary search.
   std::pair<unsigned, unsigned> getLineAndColumn(SMLoc Loc,
                                                  unsigned BufferID = 0) const;
 
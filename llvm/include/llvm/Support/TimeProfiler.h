@@ -55,6 +55,13 @@
 // Each new thread should begin with a timeTraceProfilerInitialize, and
 // finish with a timeTraceProfilerFinishThread call.
 //
+// Long running processes can bound the memory used by the profiler with a
+// per-thread ring buffer of completed sections, see TimeTraceProfilerOptions.
+// Only the most recent sections are written then, the totals still cover all
+// of them. Traces can also be written in a compact binary form, which
+// timeTraceProfilerConvertToJSON turns into the JSON that
+// timeTraceProfilerWrite would have produced.
+//
 // Timestamps come from std::chrono::stable_clock. Note that threads need
 // not see the same time from that clock, and the resolution may not be
 // the best available.
@@ -88,11 +95,28 @@ TimeTraceProfiler *getTimeTraceProfilerInstance();
 
 struct TimeTraceProfilerEntry;
 
+/// Options for the time trace profiler.
+struct TimeTraceProfilerOptions {
+  /// Minimum time in microseconds of a section to be recorded as an event.
+  /// Shorter sections only contribute to the totals.
+  unsigned Granularity = 0;
+
+  /// If nonzero, each thread keeps only the last RingBufferSize events, and
+  /// older ones are counted as dropped.
+  size_t RingBufferSize = 0;
+
+  /// Record only every SamplingPeriod-th section that passes the granularity
+  /// check as an event. The totals include all sections.
+  unsigned SamplingPeriod = 1;
+};
+
 /// Initialize the time trace profiler.
 /// This sets up the global \p TimeTraceProfilerInstance
 /// variable to be the profiler instance.
 void timeTraceProfilerInitialize(unsigned TimeTraceGranularity,
                                  StringRef ProcName);
+void timeTraceProfilerInitialize(const TimeTraceProfilerOptions &Options,
+                                 StringRef ProcName);
 
 /// Cleanup the time trace profiler, if it was initialized.
 void timeTraceProfilerCleanup();
@@ -110,6 +134,14 @@ inline bool timeTraceProfilerEnabled() {
 /// https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU/preview
 void timeTraceProfilerWrite(raw_pwrite_stream &OS);
 
+/// Write profiling data to output stream in a compact binary format, which
+/// can be turned into JSON by timeTraceProfilerConvertToJSON.
+void timeTraceProfilerWriteBinary(raw_pwrite_stream &OS);
+
+/// Convert profiling data written by timeTraceProfilerWriteBinary to the JSON
+/// format written by timeTraceProfilerWrite.
+Error timeTraceProfilerConvertToJSON(StringRef Binary, raw_pwrite_stream &OS);
+
 /// Write profiling data to a file.
 /// The function will write to \p PreferredFileName if provided, if not
 /// then will write to \p FallbackFileName appending .time-trace.
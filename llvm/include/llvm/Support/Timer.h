@@ -27,7 +27,22 @@ class TimeRecord {
   double UserTime = 0.0;             ///< User time elapsed.
   double SystemTime = 0.0;           ///< System time elapsed.
   ssize_t MemUsed = 0;               ///< Memory allocated (in bytes).
+  ssize_t PeakMemUsed = 0;           ///< Peak resident set size (in bytes).
   uint64_t InstructionsExecuted = 0; ///< Number of instructions executed
+  uint64_t Cycles = 0;               ///< Number of CPU cycles.
+  uint64_t CacheMisses = 0;          ///< Number of cache misses.
+  uint64_t BranchMisses = 0;         ///< Number of mispredicted branches.
+  uint64_t CountersEnabled = 0;      ///< Nanoseconds the counters were on.
+  uint64_t CountersRunning = 0;      ///< Nanoseconds they were counting.
+  /// False if the hardware counters could not be read. Their values are then
+  /// zero.
+  bool CountersValid = true;
+
+  void invalidateCounters() {
+    InstructionsExecuted = Cycles = CacheMisses = BranchMisses = 0;
+    CountersValid = false;
+  }
+
 public:
   TimeRecord() = default;
 
@@ -42,7 +57,25 @@ public:
   double getSystemTime() const { return SystemTime; }
   double getWallTime() const { return WallTime; }
   ssize_t getMemUsed() const { return MemUsed; }
-  uint64_t getInstructionsExecuted() const { return InstructionsExecuted; }
+  ssize_t getPeakMemUsed() const { return PeakMemUsed; }
+  uint64_t getInstructionsExecuted() const {
+    return hasValidCounters() ? InstructionsExecuted : 0;
+  }
+  uint64_t getCycles() const { return hasValidCounters() ? Cycles : 0; }
+  uint64_t getCacheMisses() const {
+    return hasValidCounters() ? CacheMisses : 0;
+  }
+  uint64_t getBranchMisses() const {
+    return hasValidCounters() ? BranchMisses : 0;
+  }
+
+  /// Whether the hardware counters were read and counted for the whole
+  /// duration. The kernel multiplexes them with other events when there are
+  /// more than the processor can count at once, and then they only count for
+  /// part of the time. Otherwise the counters read as zero.
+  bool hasValidCounters() const {
+    return CountersValid && CountersRunning == CountersEnabled;
+  }
 
   bool operator<(const TimeRecord &T) const {
     // Sort by Wall Time elapsed, as it is the only thing really accurate
@@ -54,14 +87,30 @@ public:
     UserTime += RHS.UserTime;
     SystemTime += RHS.SystemTime;
     MemUsed += RHS.MemUsed;
+    PeakMemUsed += RHS.PeakMemUsed;
     InstructionsExecuted += RHS.InstructionsExecuted;
+    Cycles += RHS.Cycles;
+    CacheMisses += RHS.CacheMisses;
+    BranchMisses += RHS.BranchMisses;
+    CountersEnabled += RHS.CountersEnabled;
+    CountersRunning += RHS.CountersRunning;
+    if (!CountersValid || !RHS.CountersValid)
+      invalidateCounters();
   }
   void operator-=(const TimeRecord &RHS) {
     WallTime -= RHS.WallTime;
     UserTime -= RHS.UserTime;
     SystemTime -= RHS.SystemTime;
     MemUsed -= RHS.MemUsed;
+    PeakMemUsed -= RHS.PeakMemUsed;
     InstructionsExecuted -= RHS.InstructionsExecuted;
+    Cycles -= RHS.Cycles;
+    CacheMisses -= RHS.CacheMisses;
+    BranchMisses -= RHS.BranchMisses;
+    CountersEnabled -= RHS.CountersEnabled;
+    CountersRunning -= RHS.CountersRunning;
+    if (!CountersValid || !RHS.CountersValid)
+      invalidateCounters();
   }
 
   /// Print the current time record to \p OS, with a breakdown showing
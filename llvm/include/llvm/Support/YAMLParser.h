@@ -571,6 +571,20 @@ private:
   /// Maps tag prefixes to their expansion.
   std::map<StringRef, StringRef> TagMap;
 
+  /// Whether a %TAG directive has changed TagMap from the default mappings.
+  bool HasTagDirectives = false;
+
+  void setDefaultTagMap();
+
+  /// Parse the directives and the document start marker, if any.
+  void parseDocumentStart();
+
+  /// Reuse this document for the next document of the stream, once this one
+  /// has been skipped. This keeps the memory of the node allocator, so that
+  /// streams of many small documents do not allocate memory for every
+  /// document.
+  void startNextDocument();
+
   Token &peekNext();
   Token getNext();
   void setError(const Twine &Message, Token &Location) const;
@@ -607,12 +621,10 @@ public:
 
   document_iterator operator++() {
     assert(Doc && "incrementing iterator past the end.");
-    if (!(*Doc)->skip()) {
+    if (!(*Doc)->skip())
       Doc->reset(nullptr);
-    } else {
-      Stream &S = (*Doc)->stream;
-      Doc->reset(new Document(S));
-    }
+    else
+      (*Doc)->startNextDocument();
     return *this;
   }
 
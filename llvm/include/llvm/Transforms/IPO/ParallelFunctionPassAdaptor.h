@@ -0,0 +1,129 @@
+//===- ParallelFunctionPassAdaptor.h - Threaded function passes -*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file defines a module pass that runs a function pass pipeline over the
+/// functions of a module on several threads.
+///
+/// An LLVMContext may only be used by one thread at a time, and function
+/// passes touch state that is shared by the whole context, e.g. the use lists
+/// of constants. So each thread loads its own copy of the module from bitcode
+/// into a private context, optimizes a contiguous range of the functions, and
+/// writes the new bodies back as bitcode. The bodies are then moved into the
+/// original module in function order, together with the global values the
+/// passes created, and their distinct metadata is mapped back to the nodes of
+/// the original module, so that e.g. the compile unit is not duplicated.
+///
+/// Every function is optimized against the original module, rather than
+/// against a module in which the functions before it have already been
+/// optimized, so the output does not depend on the number of threads. This
+/// relies on the passes keeping to the contract of a function pass: they may
+/// not look at the bodies of other functions, and the only changes they may
+/// make outside of their function are adding global values, raising the
+/// alignment of global objects and adding attributes to them. The latter two
+/// are merged back into the original module, whichever thread made them.
+///
+/// Each thread has analysis managers of its own, which start out empty. The
+/// module analyses the caller has cached, e.g. GlobalsAA, are not available
+/// to the function passes, so the results of the passes can be less precise
+/// than those of the same pipeline in a ModuleToFunctionPassAdaptor. Only the
+/// profile summary is computed again if the caller had it.
+///
+/// Optionally, optimized functions are kept in an on-disk cache, so that a
+/// rebuild only optimizes the functions that changed. A function is then moved
+/// into a module of its own before it is optimized, which holds declarations
+/// of the global values it refers to, the values of the constants among them,
+/// and the module flags, and nothing else. The cache key is the hash of that
+/// module's bitcode, of the pipeline and of its configuration, so it covers
+/// all the IR the passes can see, including the attributes of callees. The
+/// output of a pass may depend on much less than that, but StructuralHash and
+/// the like leave out details that passes do look at, so they can't serve as
+/// the key. An entry also holds the alignment and attributes the passes gave
+/// the global values the function refers to, and a hit merges them back into
+/// the module like a fresh run does.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_IPO_PARALLELFUNCTIONPASSADAPTOR_H
+#define LLVM_TRANSFORMS_IPO_PARALLELFUNCTIONPASSADAPTOR_H
+
+#include "llvm/Analysis/CGSCCPassManager.h"
+#include "llvm/Analysis/LoopAnalysisManager.h"
+#include "llvm/IR/PassManager.h"
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace llvm {
+
+class Module;
+
+/// The function pipeline and analysis managers used by one thread of a
+/// ParallelModuleToFunctionPassAdaptor. Clients that need more state per
+/// thread, like a TargetMachine for TargetIRAnalysis, can derive from this.
+struct ParallelFunctionPipeline {
+  virtual ~ParallelFunctionPipeline();
+
+  LoopAnalysisManager LAM;
+  FunctionAnalysisManager FAM;
+  CGSCCAnalysisManager CGAM;
+  ModuleAnalysisManager MAM;
+  FunctionPassManager FPM;
+
+  /// Describes what, besides the IR and the passes, may change the output of
+  /// the pipeline, e.g. the target and its options, the tuning options and
+  /// the profile. It is part of the key of cached functions, so it must cover
+  /// all of that.
+  std::string Configuration;
+
+  /// Drops all cached analysis results.
+  void clear();
+};
+
+/// Runs a function pass pipeline over the functions of a module on several
+/// threads, see the file comment.
+///
+/// Functions with blocks whose address is taken can't be moved between
+/// modules, since the users of the blockaddress would have to be rewritten.
+/// They are optimized in place on the calling thread once the others are done,
+/// and are never cached.
+class ParallelModuleToFunctionPassAdaptor
+    : public PassInfoMixin<ParallelModuleToFunctionPassAdaptor> {
+public:
+  /// Builds the pipeline of one thread. It is called on the calling thread
+  /// before the workers start, and has to register the analyses and proxies
+  /// the passes need, e.g. with PassBuilder. Pipelines must not share state
+  /// that is not thread-safe, in particular not a TargetMachine.
+  using PipelineBuilderT =
+      std::function<std::unique_ptr<ParallelFunctionPipeline>()>;
+
+  /// Runs the pipelines built by \p BuildPipeline on \p Threads threads, or on
+  /// all hardware threads if it is zero. Optimized functions are cached in
+  /// \p CacheDir, or in the directory given by -parallel-function-cache-dir
+  /// if it is empty. There is no cache if neither is set.
+  explicit ParallelModuleToFunctionPassAdaptor(PipelineBuilderT BuildPipeline,
+                                               unsigned Threads = 0,
+                                               std::string CacheDir = "")
+      : BuildPipeline(std::move(BuildPipeline)), Threads(Threads),
+        CacheDir(std::move(CacheDir)) {}
+
+  PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM);
+  void printPipeline(raw_ostream &OS,
+                     function_ref<StringRef(StringRef)> MapClassName2PassName);
+
+  static bool isRequired() { return true; }
+
+private:
+  PipelineBuilderT BuildPipeline;
+  unsigned Threads;
+  std::string CacheDir;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_TRANSFORMS_IPO_PARALLELFUNCTIONPASSADAPTOR_H
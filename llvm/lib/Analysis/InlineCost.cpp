@@ -52,6 +52,8 @@ using namespace llvm;
 #define DEBUG_TYPE "inline-cost"
 
 STATISTIC(NumCallsAnalyzed, "Number of call sites analyzed");
+STATISTIC(NumInstructionCostsReused,
+          "Number of instruction costs reused from earlier call sites");
 
 static cl::opt<int>
     DefaultThreshold("inlinedefault-threshold", cl::Hidden, cl::init(225),
@@ -249,6 +251,13 @@ protected:
   /// Getter for BlockFrequencyInfo
   function_ref<BlockFrequencyInfo &(Function &)> GetBFI;
 
+  /// Getter for the parts of the analysis shared by the call sites of a
+  /// function, if they are cached.
+  function_ref<InlineCostCalleeInfo &(Function &)> GetCalleeInfo;
+
+  /// The shared parts of the analysis of the callee, if they are cached.
+  InlineCostCalleeInfo *CalleeInfo = nullptr;
+
   /// Profile summary information.
   ProfileSummaryInfo *PSI;
 
@@ -448,9 +457,13 @@ protected:
   /// Return true if size growth is allowed when inlining the callee at \p Call.
   bool allowSizeGrowth(CallBase &Call);
 
+  /// Return true if the size and latency cost of \p I is free. It does not
+  /// depend on the call site, so it is reused from CalleeInfo if possible.
+  bool isFree(const Instruction &I);
+
   // Custom analysis routines.
   InlineResult analyzeBlock(BasicBlock *BB,
-                            SmallPtrSetImpl<const Value *> &EphValues);
+                            const SmallPtrSetImpl<const Value *> &EphValues);
 
   // Disable several entry points to the visitor so we don't accidentally use
   // them by declaring but not defining them here.
@@ -492,14 +505,16 @@ protected:
   bool visitUnreachableInst(UnreachableInst &I);
 
 public:
-  CallAnalyzer(Function &Callee, CallBase &Call, const TargetTransformInfo &TTI,
-               function_ref<AssumptionCache &(Function &)> GetAssumptionCache,
-               function_ref<BlockFrequencyInfo &(Function &)> GetBFI = nullptr,
-               ProfileSummaryInfo *PSI = nullptr,
-               OptimizationRemarkEmitter *ORE = nullptr)
+  CallAnalyzer(
+      Function &Callee, CallBase &Call, const TargetTransformInfo &TTI,
+      function_ref<AssumptionCache &(Function &)> GetAssumptionCache,
+      function_ref<BlockFrequencyInfo &(Function &)> GetBFI = nullptr,
+      ProfileSummaryInfo *PSI = nullptr,
+      OptimizationRemarkEmitter *ORE = nullptr,
+      function_ref<InlineCostCalleeInfo &(Function &)> GetCalleeInfo = nullptr)
       : TTI(TTI), GetAssumptionCache(GetAssumptionCache), GetBFI(GetBFI),
-        PSI(PSI), F(Callee), DL(F.getParent()->getDataLayout()), ORE(ORE),
-        CandidateCall(Call) {}
+        GetCalleeInfo(GetCalleeInfo), PSI(PSI), F(Callee),
+        DL(F.getParent()->getDataLayout()), ORE(ORE), CandidateCall(Call) {}
 
   InlineResult analyze();
 
@@ -687,7 +702,8 @@ class InlineCostCallAnalyzer final : public CallAnalyzer {
       /// FIXME: if InlineCostCallAnalyzer is derived from, this may need
       /// to instantiate the derived class.
       InlineCostCallAnalyzer CA(*F, Call, IndirectCallParams, TTI,
-                                GetAssumptionCache, GetBFI, PSI, ORE, false);
+                                GetAssumptionCache, GetBFI, PSI, ORE, false,
+                                /*IgnoreThreshold=*/false, GetCalleeInfo);
       if (CA.analyze().isSuccess()) {
         // We were able to inline the indirect call! Subtract the cost from the
         // threshold to get the bonus we want to apply, but don't go below zero.
@@ -1102,8 +1118,10 @@ public:
       function_ref<BlockFrequencyInfo &(Function &)> GetBFI = nullptr,
       ProfileSummaryInfo *PSI = nullptr,
       OptimizationRemarkEmitter *ORE = nullptr, bool BoostIndirect = true,
-      bool IgnoreThreshold = false)
-      : CallAnalyzer(Callee, Call, TTI, GetAssumptionCache, GetBFI, PSI, ORE),
+      bool IgnoreThreshold = false,
+      function_ref<InlineCostCalleeInfo &(Function &)> GetCalleeInfo = nullptr)
+      : CallAnalyzer(Callee, Call, TTI, GetAssumptionCache, GetBFI, PSI, ORE,
+                     GetCalleeInfo),
         ComputeFullInlineCost(OptComputeFullInlineCost ||
                               Params.ComputeFullInlineCost || ORE ||
                               isCostBenefitAnalysisEnabled()),
@@ -1446,11 +1464,16 @@ bool CallAnalyzer::accumulateGEPOffset(GEPOperator &GEP, APInt &Offset) {
 bool CallAnalyzer::isGEPFree(GetElementPtrInst &GEP) {
   SmallVector<Value *, 4> Operands;
   Operands.push_back(GEP.getOperand(0));
+  bool IsSimplified = false;
   for (const Use &Op : GEP.indices())
-    if (Constant *SimpleOp = SimplifiedValues.lookup(Op))
+    if (Constant *SimpleOp = SimplifiedValues.lookup(Op)) {
       Operands.push_back(SimpleOp);
-    else
+      IsSimplified = true;
+    } else {
       Operands.push_back(Op);
+    }
+  if (!IsSimplified)
+    return isFree(GEP);
   return TTI.getInstructionCost(&GEP, Operands,
                                 TargetTransformInfo::TCK_SizeAndLatency) ==
          TargetTransformInfo::TCC_Free;
@@ -1743,8 +1766,7 @@ bool CallAnalyzer::visitPtrToInt(PtrToIntInst &I) {
   if (auto *SROAArg = getSROAArgForValueOrNull(I.getOperand(0)))
     SROAArgValues[&I] = SROAArg;
 
-  return TTI.getInstructionCost(&I, TargetTransformInfo::TCK_SizeAndLatency) ==
-         TargetTransformInfo::TCC_Free;
+  return isFree(I);
 }
 
 bool CallAnalyzer::visitIntToPtr(IntToPtrInst &I) {
@@ -1766,8 +1788,7 @@ bool CallAnalyzer::visitIntToPtr(IntToPtrInst &I) {
   if (auto *SROAArg = getSROAArgForValueOrNull(Op))
     SROAArgValues[&I] = SROAArg;
 
-  return TTI.getInstructionCost(&I, TargetTransformInfo::TCK_SizeAndLatency) ==
-         TargetTransformInfo::TCC_Free;
+  return isFree(I);
 }
 
 bool CallAnalyzer::visitCastInst(CastInst &I) {
@@ -1796,8 +1817,7 @@ bool CallAnalyzer::visitCastInst(CastInst &I) {
     break;
   }
 
-  return TTI.getInstructionCost(&I, TargetTransformInfo::TCK_SizeAndLatency) ==
-         TargetTransformInfo::TCC_Free;
+  return isFree(I);
 }
 
 bool CallAnalyzer::paramHasAttr(Argument *A, Attribute::AttrKind Attr) {
@@ -1851,6 +1871,14 @@ bool CallAnalyzer::allowSizeGrowth(CallBase &Call) {
   return true;
 }
 
+bool CallAnalyzer::isFree(const Instruction &I) {
+  InstructionCost Cost =
+      CalleeInfo
+          ? CalleeInfo->getInstructionCost(I, TTI)
+          : TTI.getInstructionCost(&I, TargetTransformInfo::TCK_SizeAndLatency);
+  return Cost == TargetTransformInfo::TCC_Free;
+}
+
 bool InlineCostCallAnalyzer::isColdCallSite(CallBase &Call,
                                             BlockFrequencyInfo *CallerBFI) {
   // If global profile summary is available, then callsite's coldness is
@@ -2511,8 +2539,7 @@ bool CallAnalyzer::visitUnreachableInst(UnreachableInst &I) {
 bool CallAnalyzer::visitInstruction(Instruction &I) {
   // Some instructions are free. All of the free intrinsics can also be
   // handled by SROA, etc.
-  if (TTI.getInstructionCost(&I, TargetTransformInfo::TCK_SizeAndLatency) ==
-      TargetTransformInfo::TCC_Free)
+  if (isFree(I))
     return true;
 
   // We found something we don't understand or can't handle. Mark any SROA-able
@@ -2532,7 +2559,7 @@ bool CallAnalyzer::visitInstruction(Instruction &I) {
 /// viable, and true if inlining remains viable.
 InlineResult
 CallAnalyzer::analyzeBlock(BasicBlock *BB,
-                           SmallPtrSetImpl<const Value *> &EphValues) {
+                           const SmallPtrSetImpl<const Value *> &EphValues) {
   for (Instruction &I : *BB) {
     // FIXME: Currently, the number of instructions in a function regardless of
     // our ability to simplify them during inline to constants or dead code,
@@ -2714,11 +2741,16 @@ InlineResult CallAnalyzer::analyze() {
 
   Function *Caller = CandidateCall.getFunction();
   // Check if the caller function is recursive itself.
-  for (User *U : Caller->users()) {
-    CallBase *Call = dyn_cast<CallBase>(U);
-    if (Call && Call->getFunction() == Caller) {
-      IsCallerRecursive = true;
-      break;
+  if (GetCalleeInfo) {
+    IsCallerRecursive = GetCalleeInfo(*Caller).isSelfRecursive();
+    CalleeInfo = &GetCalleeInfo(F);
+  } else {
+    for (User *U : Caller->users()) {
+      CallBase *Call = dyn_cast<CallBase>(U);
+      if (Call && Call->getFunction() == Caller) {
+        IsCallerRecursive = true;
+        break;
+      }
     }
   }
 
@@ -2747,11 +2779,14 @@ InlineResult CallAnalyzer::analyze() {
   NumConstantOffsetPtrArgs = ConstantOffsetPtrs.size();
   NumAllocaArgs = SROAArgValues.size();
 
-  // FIXME: If a caller has multiple calls to a callee, we end up recomputing
-  // the ephemeral values multiple times (and they're completely determined by
-  // the callee, so this is purely duplicate work).
-  SmallPtrSet<const Value *, 32> EphValues;
-  CodeMetrics::collectEphemeralValues(&F, &GetAssumptionCache(F), EphValues);
+  // The ephemeral values are completely determined by the callee, so they are
+  // only collected once if the callee info is cached.
+  SmallPtrSet<const Value *, 32> LocalEphValues;
+  if (!CalleeInfo)
+    CodeMetrics::collectEphemeralValues(&F, &GetAssumptionCache(F),
+                                        LocalEphValues);
+  const SmallPtrSetImpl<const Value *> &EphValues =
+      CalleeInfo ? CalleeInfo->getEphemeralValues() : LocalEphValues;
 
   // The worklist of live basic blocks in the callee *after* inlining. We avoid
   // adding basic blocks of the callee which can be proven to be dead for this
@@ -2933,9 +2968,11 @@ InlineCost llvm::getInlineCost(
     function_ref<AssumptionCache &(Function &)> GetAssumptionCache,
     function_ref<const TargetLibraryInfo &(Function &)> GetTLI,
     function_ref<BlockFrequencyInfo &(Function &)> GetBFI,
-    ProfileSummaryInfo *PSI, OptimizationRemarkEmitter *ORE) {
+    ProfileSummaryInfo *PSI, OptimizationRemarkEmitter *ORE,
+    function_ref<InlineCostCalleeInfo &(Function &)> GetCalleeInfo) {
   return getInlineCost(Call, Call.getCalledFunction(), Params, CalleeTTI,
-                       GetAssumptionCache, GetTLI, GetBFI, PSI, ORE);
+                       GetAssumptionCache, GetTLI, GetBFI, PSI, ORE,
+                       GetCalleeInfo);
 }
 
 std::optional<int> llvm::getInliningCostEstimate(
@@ -3053,7 +3090,8 @@ InlineCost llvm::getInlineCost(
     function_ref<AssumptionCache &(Function &)> GetAssumptionCache,
     function_ref<const TargetLibraryInfo &(Function &)> GetTLI,
     function_ref<BlockFrequencyInfo &(Function &)> GetBFI,
-    ProfileSummaryInfo *PSI, OptimizationRemarkEmitter *ORE) {
+    ProfileSummaryInfo *PSI, OptimizationRemarkEmitter *ORE,
+    function_ref<InlineCostCalleeInfo &(Function &)> GetCalleeInfo) {
 
   auto UserDecision =
       llvm::getAttributeBasedInliningDecision(Call, Callee, CalleeTTI, GetTLI);
@@ -3069,7 +3107,9 @@ InlineCost llvm::getInlineCost(
                           << ")\n");
 
   InlineCostCallAnalyzer CA(*Callee, Call, Params, CalleeTTI,
-                            GetAssumptionCache, GetBFI, PSI, ORE);
+                            GetAssumptionCache, GetBFI, PSI, ORE,
+                            /*BoostIndirect=*/true, /*IgnoreThreshold=*/false,
+                            GetCalleeInfo);
   InlineResult ShouldInline = CA.analyze();
 
   LLVM_DEBUG(CA.dump());
@@ -3095,6 +3135,49 @@ InlineCost llvm::getInlineCost(
              : InlineCost::getNever(ShouldInline.getFailureReason());
 }
 
+const SmallPtrSetImpl<const Value *> &
+InlineCostCalleeInfo::getEphemeralValues() {
+  if (!EphValues) {
+    EphValues.emplace();
+    CodeMetrics::collectEphemeralValues(&F, &AC, *EphValues);
+  }
+  return *EphValues;
+}
+
+bool InlineCostCalleeInfo::isSelfRecursive() {
+  if (!IsSelfRecursive)
+    IsSelfRecursive = any_of(F.users(), [&](User *U) {
+      auto *Call = dyn_cast<CallBase>(U);
+      return Call && Call->getFunction() == &F;
+    });
+  return *IsSelfRecursive;
+}
+
+InstructionCost
+InlineCostCalleeInfo::getInstructionCost(const Instruction &I,
+                                         const TargetTransformInfo &CalleeTTI) {
+  // The targets of indirect calls are analyzed with the TTI of the callee
+  // that calls them.
+  if (&CalleeTTI != &TTI)
+    return CalleeTTI.getInstructionCost(
+        &I, TargetTransformInfo::TCK_SizeAndLatency);
+  auto [It, Inserted] = InstructionCosts.try_emplace(&I);
+  if (Inserted)
+    It->second =
+        TTI.getInstructionCost(&I, TargetTransformInfo::TCK_SizeAndLatency);
+  else
+    ++NumInstructionCostsReused;
+  return It->second;
+}
+
+AnalysisKey InlineCostCalleeAnalysis::Key;
+
+InlineCostCalleeInfo
+InlineCostCalleeAnalysis::run(Function &F, FunctionAnalysisManager &FAM) {
+  return InlineCostCalleeInfo(F, FAM.getResult<AssumptionAnalysis>(F),
+                              FAM.getResult<TargetIRAnalysis>(F));
+}
+
 InlineResult llvm::isInlineViable(Function &F) {
   bool ReturnsTwice = F.hasFnAttribute(Attribute::ReturnsTwice);
   for (BasicBlock &BB : F) {
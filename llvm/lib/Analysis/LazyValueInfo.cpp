@@ -14,10 +14,12 @@
 #include "llvm/Analysis/LazyValueInfo.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AssumptionCache.h"
 #include "llvm/Analysis/ConstantFolding.h"
 #include "llvm/Analysis/InstructionSimplify.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Analysis/Utils/CacheEviction.h"
 #include "llvm/Analysis/ValueLattice.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/AssemblyAnnotationWriter.h"
@@ -34,6 +36,7 @@
 #include "llvm/IR/PatternMatch.h"
 #include "llvm/IR/ValueHandle.h"
 #include "llvm/InitializePasses.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/KnownBits.h"
@@ -44,10 +47,22 @@ using namespace PatternMatch;
 
 #define DEBUG_TYPE "lazy-value-info"
 
+STATISTIC(NumBlockCacheHits, "Number of values found in the block cache");
+STATISTIC(NumBlockCacheEvictions, "Number of blocks evicted from the cache");
+STATISTIC(MaxBlockCacheSize, "Largest number of blocks in the cache");
+
 // This is the number of worklist items we will process to try to discover an
 // answer for a given value.
 static const unsigned MaxProcessedPerValue = 500;
 
+cl::opt<unsigned> LVIMaxCachedBlocks(
+    "lvi-max-cached-blocks", cl::Hidden, cl::init(10000),
+    cl::desc("Maximum number of blocks with cached values in a function, "
+             "beyond which the least recently used ones are evicted "
+             "(0 = unlimited). Enabled by default: in functions over the "
+             "limit, recomputed values can be less precise than the evicted "
+             "ones"));
+
 char LazyValueInfoWrapperPass::ID = 0;
 LazyValueInfoWrapperPass::LazyValueInfoWrapperPass() : FunctionPass(ID) {
   initializeLazyValueInfoWrapperPassPass(*PassRegistry::getPassRegistry());
@@ -166,6 +181,8 @@ namespace {
       // std::nullopt indicates that the nonnull pointers for this basic block
       // block have not been computed yet.
       std::optional<NonNullPointerSet> NonNullPointers;
+      // The value of Clock when the entry was last used.
+      uint64_t LastUse = 0;
     };
 
     /// Cached information per basic block.
@@ -173,20 +190,26 @@ namespace {
         BlockCache;
     /// Set of value handles used to erase values from the cache on deletion.
     DenseSet<LVIValueHandle, DenseMapInfo<Value *>> ValueHandles;
+    /// Counts the uses of the block entries, to find the least recently used.
+    mutable uint64_t Clock = 0;
 
     const BlockCacheEntry *getBlockEntry(BasicBlock *BB) const {
       auto It = BlockCache.find_as(BB);
       if (It == BlockCache.end())
         return nullptr;
+      It->second->LastUse = ++Clock;
       return It->second.get();
     }
 
     BlockCacheEntry *getOrCreateBlockEntry(BasicBlock *BB) {
       auto It = BlockCache.find_as(BB);
-      if (It == BlockCache.end())
+      if (It == BlockCache.end()) {
         It = BlockCache.insert({ BB, std::make_unique<BlockCacheEntry>() })
                        .first;
+        MaxBlockCacheSize.updateMax(BlockCache.size());
+      }
 
+      It->second->LastUse = ++Clock;
       return It->second.get();
     }
 
@@ -217,13 +240,16 @@ namespace {
       if (!Entry)
         return std::nullopt;
 
-      if (Entry->OverDefined.count(V))
+      if (Entry->OverDefined.count(V)) {
+        ++NumBlockCacheHits;
         return ValueLatticeElement::getOverdefined();
+      }
 
       auto LatticeIt = Entry->LatticeElements.find_as(V);
       if (LatticeIt == Entry->LatticeElements.end())
         return std::nullopt;
 
+      ++NumBlockCacheHits;
       return LatticeIt->second;
     }
 
@@ -253,6 +279,11 @@ namespace {
     /// that a block has been deleted.
     void eraseBlock(BasicBlock *BB);
 
+    /// Evict the least recently used blocks if there are more than
+    /// LVIMaxCachedBlocks of them. Their values are recomputed when queried
+    /// again, so this must not happen while the solver is running.
+    void trim();
+
     /// Updates the cache to remove any influence an overdefined value in
     /// OldSucc might have (unless also overdefined in NewSucc).  This just
     /// flushes elements from the cache and does not add any.
@@ -283,6 +314,17 @@ void LazyValueInfoCache::eraseBlock(BasicBlock *BB) {
   BlockCache.erase(BB);
 }
 
+void LazyValueInfoCache::trim() {
+  SmallVector<BasicBlock *, 0> ToErase = findEntriesToEvict(
+      BlockCache, LVIMaxCachedBlocks, [](const auto &Entry) {
+        return std::pair<uint64_t, BasicBlock *>(Entry.second->LastUse,
+                                                 Entry.first);
+      });
+  for (BasicBlock *BB : ToErase)
+    eraseBlock(BB);
+  NumBlockCacheEvictions += ToErase.size();
+}
+
 void LazyValueInfoCache::threadEdgeImpl(BasicBlock *OldSucc,
                                         BasicBlock *NewSucc) {
   // When an edge in the graph has been threaded, values that we could not
@@ -1523,6 +1565,7 @@ ValueLatticeElement LazyValueInfoImpl::getValueInBlock(Value *V, BasicBlock *BB,
                     << BB->getName() << "'\n");
 
   assert(BlockValueStack.empty() && BlockValueSet.empty());
+  TheCache.trim();
   std::optional<ValueLatticeElement> OptResult = getBlockValue(V, BB, CxtI);
   if (!OptResult) {
     solve();
@@ -1558,6 +1601,7 @@ getValueOnEdge(Value *V, BasicBlock *FromBB, BasicBlock *ToBB,
                     << FromBB->getName() << "' to '" << ToBB->getName()
                     << "'\n");
 
+  TheCache.trim();
   std::optional<ValueLatticeElement> Result =
       getEdgeValue(V, FromBB, ToBB, CxtI);
   while (!Result) {
@@ -80,6 +80,7 @@
 #include "llvm/Analysis/MemoryBuiltins.h"
 #include "llvm/Analysis/ScalarEvolutionExpressions.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Analysis/Utils/CacheEviction.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/Config/llvm-config.h"
 #include "llvm/IR/Argument.h"
@@ -142,6 +143,16 @@ STATISTIC(NumExitCountsNotComputed,
           "Number of loop exits without predictable exit counts");
 STATISTIC(NumBruteForceTripCountsComputed,
           "Number of loops with trip counts computed by force");
+STATISTIC(NumValueExprMapHits, "Number of values found in the SCEV cache");
+STATISTIC(NumValueExprMapEvictions,
+          "Number of values evicted from the SCEV cache");
+STATISTIC(MaxValueExprMapSize, "Largest number of values in the SCEV cache");
+STATISTIC(NumBackedgeTakenCountHits,
+          "Number of backedge-taken counts found in the cache");
+STATISTIC(NumBackedgeTakenCountEvictions,
+          "Number of backedge-taken counts evicted from the cache");
+STATISTIC(MaxBackedgeTakenCountsSize,
+          "Largest number of backedge-taken counts in the cache");
 
 #ifdef EXPENSIVE_CHECKS
 bool llvm::VerifySCEV = true;
@@ -244,6 +255,22 @@ static cl::opt<bool>
                             cl::desc("Handle <= and >= in finite loops"),
                             cl::init(true));
 
+cl::opt<unsigned> SCEVMaxCachedValues(
+    "scalar-evolution-max-cached-values", cl::Hidden, cl::init(100000),
+    cl::desc("Maximum number of values with cached SCEVs in a function, "
+             "beyond which the least recently used ones are evicted "
+             "(0 = unlimited). Enabled by default: in functions over the "
+             "limit, recomputed SCEVs can differ from the evicted ones, "
+             "e.g. in their inferred no-wrap flags"));
+
+cl::opt<unsigned> SCEVMaxCachedBackedgeTakenCounts(
+    "scalar-evolution-max-cached-backedge-taken-counts", cl::Hidden,
+    cl::init(10000),
+    cl::desc("Maximum number of loops with cached backedge-taken counts in a "
+             "function, beyond which the least recently used ones are "
+             "evicted (0 = unlimited). Enabled by default: in functions over "
+             "the limit, recomputed counts can differ from the evicted ones"));
+
 static cl::opt<bool> UseContextForNoWrapFlagInference(
     "scalar-evolution-use-context-for-no-wrap-flag-strenghening", cl::Hidden,
     cl::desc("Infer nuw/nsw flags using context where suitable"),
@@ -2300,6 +2327,7 @@ CollectAddOperandsWithScales(DenseMap<const SCEV *, APInt> &M,
 bool ScalarEvolution::willNotOverflow(Instruction::BinaryOps BinOp, bool Signed,
                                       const SCEV *LHS, const SCEV *RHS,
                                       const Instruction *CtxI) {
+  SaveAndRestore Depth(QueryDepth, QueryDepth + 1);
   const SCEV *(ScalarEvolution::*Operation)(const SCEV *, const SCEV *,
                                             SCEV::NoWrapFlags, unsigned);
   switch (BinOp) {
@@ -4556,8 +4584,10 @@ void ScalarEvolution::insertValueToMap(Value *V, const SCEV *S) {
   // inferred nowrap flags.
   auto It = ValueExprMap.find_as(V);
   if (It == ValueExprMap.end()) {
-    ValueExprMap.insert({SCEVCallbackVH(V, this), S});
+    It = ValueExprMap.insert({SCEVCallbackVH(V, this), S}).first;
+    It->first.LastUse = ++CacheClock;
     ExprValueMap[S].insert(V);
+    MaxValueExprMapSize.updateMax(ValueExprMap.size());
   }
 }
 
@@ -4568,6 +4598,8 @@ const SCEV *ScalarEvolution::getSCEV(Value *V) {
 
   if (const SCEV *S = getExistingSCEV(V))
     return S;
+  if (!QueryDepth)
+    trimValueExprMap();
   return createSCEVIter(V);
 }
 
@@ -4579,11 +4611,29 @@ const SCEV *ScalarEvolution::getExistingSCEV(Value *V) {
     const SCEV *S = I->second;
     assert(checkValidity(S) &&
            "existing SCEV has not been properly invalidated");
+    I->first.LastUse = ++CacheClock;
+    ++NumValueExprMapHits;
     return S;
   }
   return nullptr;
 }
 
+void ScalarEvolution::trimValueExprMap() {
+  // A later forgetValue would not find the evicted values, so everything
+  // derived from their SCEVs is forgotten now. This also evicts the other
+  // values with the same SCEVs, and the users of the SCEVs.
+  SmallVector<const SCEV *, 0> ToForget = findEntriesToEvict(
+      ValueExprMap, SCEVMaxCachedValues, [](const auto &Entry) {
+        return std::make_pair(Entry.first.LastUse, Entry.second);
+      });
+  if (ToForget.empty())
+    return;
+
+  size_t OldSize = ValueExprMap.size();
+  forgetMemoizedResults(ToForget);
+  NumValueExprMapEvictions += OldSize - ValueExprMap.size();
+}
+
 /// Return a SCEV corresponding to -V = -1*V
 const SCEV *ScalarEvolution::getNegativeSCEV(const SCEV *V,
                                              SCEV::NoWrapFlags Flags) {
@@ -6609,6 +6659,7 @@ ScalarEvolution::getRangeRefIter(const SCEV *S,
 /// with a "cleaner" unsigned (resp. signed) representation.
 const ConstantRange &ScalarEvolution::getRangeRef(
     const SCEV *S, ScalarEvolution::RangeSignHint SignHint, unsigned Depth) {
+  SaveAndRestore QueryScope(QueryDepth, QueryDepth + 1);
   DenseMap<const SCEV *, ConstantRange> &Cache =
       SignHint == ScalarEvolution::HINT_RANGE_UNSIGNED ? UnsignedRanges
                                                        : SignedRanges;
@@ -7426,6 +7477,8 @@ bool ScalarEvolution::loopIsFiniteByAssumption(const Loop *L) {
 }
 
 const SCEV *ScalarEvolution::createSCEVIter(Value *V) {
+  SaveAndRestore Depth(QueryDepth, QueryDepth + 1);
+
   // Worklist item with a Value and a bool indicating whether all operands have
   // been visited already.
   using PointerTy = PointerIntPair<Value *, 1, bool>;
@@ -8317,13 +8370,22 @@ ScalarEvolution::getPredicatedBackedgeTakenInfo(const Loop *L) {
   if (BTI.hasFullInfo())
     return BTI;
 
-  auto Pair = PredicatedBackedgeTakenCounts.insert({L, BackedgeTakenInfo()});
-
-  if (!Pair.second)
-    return Pair.first->second;
+  auto It = PredicatedBackedgeTakenCounts.find(L);
+  if (It != PredicatedBackedgeTakenCounts.end()) {
+    ++NumBackedgeTakenCountHits;
+    It->second.LastUse = ++CacheClock;
+    return It->second;
+  }
+  if (!QueryDepth)
+    trimBackedgeTakenCounts(/*Predicated=*/true);
+  PredicatedBackedgeTakenCounts.insert({L, BackedgeTakenInfo()});
 
-  BackedgeTakenInfo Result =
-      computeBackedgeTakenCount(L, /*AllowPredicates=*/true);
+  BackedgeTakenInfo Result;
+  {
+    SaveAndRestore Depth(QueryDepth, QueryDepth + 1);
+    Result = computeBackedgeTakenCount(L, /*AllowPredicates=*/true);
+  }
+  Result.LastUse = ++CacheClock;
 
   return PredicatedBackedgeTakenCounts.find(L)->second = std::move(Result);
 }
@@ -8335,15 +8397,26 @@ ScalarEvolution::getBackedgeTakenInfo(const Loop *L) {
   // update the value. The temporary CouldNotCompute value tells SCEV
   // code elsewhere that it shouldn't attempt to request a new
   // backedge-taken count, which could result in infinite recursion.
-  std::pair<DenseMap<const Loop *, BackedgeTakenInfo>::iterator, bool> Pair =
-      BackedgeTakenCounts.insert({L, BackedgeTakenInfo()});
-  if (!Pair.second)
-    return Pair.first->second;
+  auto It = BackedgeTakenCounts.find(L);
+  if (It != BackedgeTakenCounts.end()) {
+    ++NumBackedgeTakenCountHits;
+    It->second.LastUse = ++CacheClock;
+    return It->second;
+  }
+  if (!QueryDepth)
+    trimBackedgeTakenCounts(/*Predicated=*/false);
+  BackedgeTakenCounts.insert({L, BackedgeTakenInfo()});
+  MaxBackedgeTakenCountsSize.updateMax(BackedgeTakenCounts.size());
 
   // computeBackedgeTakenCount may allocate memory for its result. Inserting it
   // into the BackedgeTakenCounts map transfers ownership. Otherwise, the result
   // must be cleared in this scope.
-  BackedgeTakenInfo Result = computeBackedgeTakenCount(L);
+  BackedgeTakenInfo Result;
+  {
+    SaveAndRestore Depth(QueryDepth, QueryDepth + 1);
+    Result = computeBackedgeTakenCount(L);
+  }
+  Result.LastUse = ++CacheClock;
 
   // Now that we know more about the trip count for this loop, forget any
   // existing SCEV values for PHI nodes in this loop since they are only
@@ -8647,8 +8720,11 @@ ScalarEvolution::BackedgeTakenInfo::getConstantMax(ScalarEvolution *SE) const {
 const SCEV *
 ScalarEvolution::BackedgeTakenInfo::getSymbolicMax(const Loop *L,
                                                    ScalarEvolution *SE) {
-  if (!SymbolicMax)
+  if (!SymbolicMax) {
+    // Keep this from being evicted while it is being computed.
+    SaveAndRestore Depth(SE->QueryDepth, SE->QueryDepth + 1);
     SymbolicMax = SE->computeSymbolicMaxBackedgeTakenCount(L);
+  }
   return SymbolicMax;
 }
 
@@ -9722,6 +9798,8 @@ const SCEV *ScalarEvolution::computeExitCountExhaustively(const Loop *L,
 }
 
 const SCEV *ScalarEvolution::getSCEVAtScope(const SCEV *V, const Loop *L) {
+  // Keep the placeholder below from being forgotten while it is computed.
+  SaveAndRestore Depth(QueryDepth, QueryDepth + 1);
   SmallVector<std::pair<const Loop *, const SCEV *>, 2> &Values =
       ValuesAtScopes[V];
   // Check to see if we've folded this expression at this loop before.
@@ -11567,6 +11645,7 @@ bool ScalarEvolution::isImpliedCond(ICmpInst::Predicate Pred, const SCEV *LHS,
                                     const SCEV *RHS,
                                     const Value *FoundCondValue, bool Inverse,
                                     const Instruction *CtxI) {
+  SaveAndRestore Depth(QueryDepth, QueryDepth + 1);
   // False conditions implies anything. Do not bother analyzing it further.
   if (FoundCondValue ==
       ConstantInt::getBool(FoundCondValue->getContext(), Inverse))
@@ -12221,6 +12300,7 @@ bool ScalarEvolution::isImpliedCondOperands(ICmpInst::Predicate Pred,
                                             const SCEV *FoundLHS,
                                             const SCEV *FoundRHS,
                                             const Instruction *CtxI) {
+  SaveAndRestore Depth(QueryDepth, QueryDepth + 1);
   if (isImpliedCondOperandsViaRanges(Pred, LHS, RHS, Pred, FoundLHS, FoundRHS))
     return true;
 
@@ -13423,7 +13503,7 @@ ScalarEvolution::ScalarEvolution(Function &F, TargetLibraryInfo &TLI,
 ScalarEvolution::ScalarEvolution(ScalarEvolution &&Arg)
     : F(Arg.F), HasGuards(Arg.HasGuards), TLI(Arg.TLI), AC(Arg.AC), DT(Arg.DT),
       LI(Arg.LI), CouldNotCompute(std::move(Arg.CouldNotCompute)),
-      ValueExprMap(std::move(Arg.ValueExprMap)),
+      ValueExprMap(std::move(Arg.ValueExprMap)), CacheClock(Arg.CacheClock),
       PendingLoopPredicates(std::move(Arg.PendingLoopPredicates)),
       PendingPhiRanges(std::move(Arg.PendingPhiRanges)),
       PendingMerges(std::move(Arg.PendingMerges)),
@@ -13907,6 +13987,18 @@ void ScalarEvolution::forgetBackedgeTakenCounts(const Loop *L,
   }
 }
 
+void ScalarEvolution::trimBackedgeTakenCounts(bool Predicated) {
+  auto &BECounts =
+      Predicated ? PredicatedBackedgeTakenCounts : BackedgeTakenCounts;
+  SmallVector<const Loop *, 0> ToForget = findEntriesToEvict(
+      BECounts, SCEVMaxCachedBackedgeTakenCounts, [](const auto &Entry) {
+        return std::make_pair(Entry.second.LastUse, Entry.first);
+      });
+  for (const Loop *L : ToForget)
+    forgetBackedgeTakenCounts(L, Predicated);
+  NumBackedgeTakenCountEvictions += ToForget.size();
+}
+
 void ScalarEvolution::forgetMemoizedResults(ArrayRef<const SCEV *> SCEVs) {
   SmallPtrSet<const SCEV *, 8> ToForget(SCEVs.begin(), SCEVs.end());
   SmallVector<const SCEV *, 8> Worklist(ToForget.begin(), ToForget.end());
@@ -15037,6 +15129,7 @@ public:
 };
 
 const SCEV *ScalarEvolution::applyLoopGuards(const SCEV *Expr, const Loop *L) {
+  SaveAndRestore Depth(QueryDepth, QueryDepth + 1);
   SmallVector<const SCEV *> ExprsToRewrite;
   auto CollectCondition = [&](ICmpInst::Predicate Predicate, const SCEV *LHS,
                               const SCEV *RHS,
@@ -12,13 +12,16 @@
 
 #include "llvm/AsmParser/LLLexer.h"
 #include "llvm/ADT/APInt.h"
+#include "llvm/ADT/APSInt.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/SourceMgr.h"
+#include <array>
 #include <cassert>
 #include <cctype>
 #include <cstdio>
@@ -137,10 +140,60 @@ static void UnEscapeLexed(std::string &Str) {
   Str.resize(BOut-Buffer);
 }
 
+namespace {
+/// The classes of the characters names are made of. The lexer looks them up in
+/// a table instead of calling into the C library for every character.
+enum CharClass : uint8_t {
+  CC_Digit = 1 << 0,     // [0-9]
+  CC_Letter = 1 << 1,    // [a-zA-Z_]
+  CC_NamePunct = 1 << 2, // [-$.]
+  CC_Backslash = 1 << 3, // [\\]
+};
+} // end anonymous namespace
+
+static constexpr std::array<uint8_t, 256> CharClasses = [] {
+  std::array<uint8_t, 256> Classes{};
+  for (unsigned C = '0'; C <= '9'; ++C)
+    Classes[C] = CC_Digit;
+  for (unsigned C = 'a'; C <= 'z'; ++C)
+    Classes[C] = Classes[C - 'a' + 'A'] = CC_Letter;
+  Classes['_'] = CC_Letter;
+  Classes['-'] = Classes['$'] = Classes['.'] = CC_NamePunct;
+  Classes['\\'] = CC_Backslash;
+  return Classes;
+}();
+
+static bool isCharClass(char C, unsigned Classes) {
+  return CharClasses[static_cast<unsigned char>(C)] & Classes;
+}
+
 /// isLabelChar - Return true for [-a-zA-Z$._0-9].
 static bool isLabelChar(char C) {
-  return isalnum(static_cast<unsigned char>(C)) || C == '-' || C == '$' ||
-         C == '.' || C == '_';
+  return isCharClass(C, CC_Digit | CC_Letter | CC_NamePunct);
+}
+
+/// Return the APSInt for the decimal integer Str, which is what APSInt(Str)
+/// returns, without going through APInt's string parsing when it fits in 64
+/// bits.
+static APSInt parseDecimalAPSInt(StringRef Str) {
+  bool IsNegative = Str.front() == '-';
+  StringRef Digits = Str.drop_front(IsNegative);
+  // Up to 18 digits always fit in an int64_t.
+  if (Digits.size() > 18)
+    return APSInt(Str);
+
+  uint64_t Val = 0;
+  for (char C : Digits)
+    Val = Val * 10 + (C - '0');
+  if (!IsNegative) {
+    unsigned ActiveBits = std::max(1, llvm::bit_width(Val));
+    return APSInt(APInt(ActiveBits, Val), /*isUnsigned=*/true);
+  }
+  uint64_t SVal = uint64_t(-int64_t(Val));
+  unsigned NumSignBits = int64_t(SVal) < 0 ? llvm::countl_one(SVal)
+                                           : llvm::countl_zero(SVal);
+  unsigned MinBits = std::max(1u, 65 - NumSignBits);
+  return APSInt(APInt(MinBits, SVal, /*isSigned=*/true), /*isUnsigned=*/false);
 }
 
 /// isLabelTail - Return true if this pointer points to a valid end of a label.
@@ -244,9 +297,12 @@ lltok::Kind LLLexer::LexToken() {
 }
 
 void LLLexer::SkipLineComment() {
-  while (true) {
-    if (CurPtr[0] == '\n' || CurPtr[0] == '\r' || getNextChar() == EOF)
+  // Only a nul at the end of the buffer ends the comment, others are skipped
+  // like getNextChar does.
+  while (CurPtr[0] != '\n' && CurPtr[0] != '\r') {
+    if (CurPtr[0] == 0 && CurPtr == CurBuf.end())
       return;
+    ++CurPtr;
   }
 }
 
@@ -316,13 +372,9 @@ lltok::Kind LLLexer::ReadString(lltok::Kind kind) {
 /// ReadVarName - Read the rest of a token containing a variable name.
 bool LLLexer::ReadVarName() {
   const char *NameStart = CurPtr;
-  if (isalpha(static_cast<unsigned char>(CurPtr[0])) ||
-      CurPtr[0] == '-' || CurPtr[0] == '$' ||
-      CurPtr[0] == '.' || CurPtr[0] == '_') {
+  if (isCharClass(CurPtr[0], CC_Letter | CC_NamePunct)) {
     ++CurPtr;
-    while (isalnum(static_cast<unsigned char>(CurPtr[0])) ||
-           CurPtr[0] == '-' || CurPtr[0] == '$' ||
-           CurPtr[0] == '.' || CurPtr[0] == '_')
+    while (isLabelChar(CurPtr[0]))
       ++CurPtr;
 
     StrVal.assign(NameStart, CurPtr);
@@ -413,13 +465,10 @@ lltok::Kind LLLexer::LexQuote() {
 ///    !
 lltok::Kind LLLexer::LexExclaim() {
   // Lex a metadata name as a MetadataVar.
-  if (isalpha(static_cast<unsigned char>(CurPtr[0])) ||
-      CurPtr[0] == '-' || CurPtr[0] == '$' ||
-      CurPtr[0] == '.' || CurPtr[0] == '_' || CurPtr[0] == '\\') {
+  if (isCharClass(CurPtr[0], CC_Letter | CC_NamePunct | CC_Backslash)) {
     ++CurPtr;
-    while (isalnum(static_cast<unsigned char>(CurPtr[0])) ||
-           CurPtr[0] == '-' || CurPtr[0] == '$' ||
-           CurPtr[0] == '.' || CurPtr[0] == '_' || CurPtr[0] == '\\')
+    while (isCharClass(CurPtr[0],
+                       CC_Digit | CC_Letter | CC_NamePunct | CC_Backslash))
       ++CurPtr;
 
     StrVal.assign(TokStart+1, CurPtr);   // Skip !
@@ -446,58 +495,22 @@ lltok::Kind LLLexer::LexHash() {
   return lltok::hash;
 }
 
-/// Lex a label, integer type, keyword, or hexadecimal integer constant.
-///    Label           [-a-zA-Z$._0-9]+:
-///    IntegerType     i[0-9]+
-///    Keyword         sdiv, float, ...
-///    HexIntConstant  [us]0x[0-9A-Fa-f]+
-lltok::Kind LLLexer::LexIdentifier() {
-  const char *StartChar = CurPtr;
-  const char *IntEnd = CurPtr[-1] == 'i' ? nullptr : StartChar;
-  const char *KeywordEnd = nullptr;
-
-  for (; isLabelChar(*CurPtr); ++CurPtr) {
-    // If we decide this is an integer, remember the end of the sequence.
-    if (!IntEnd && !isdigit(static_cast<unsigned char>(*CurPtr)))
-      IntEnd = CurPtr;
-    if (!KeywordEnd && !isalnum(static_cast<unsigned char>(*CurPtr)) &&
-        *CurPtr != '_')
-      KeywordEnd = CurPtr;
-  }
-
-  // If we stopped due to a colon, unless we were directed to ignore it,
-  // this really is a label.
-  if (!IgnoreColonInIdentifiers && *CurPtr == ':') {
-    StrVal.assign(StartChar-1, CurPtr++);
-    return lltok::LabelStr;
-  }
-
-  // Otherwise, this wasn't a label.  If this was valid as an integer type,
-  // return it.
-  if (!IntEnd) IntEnd = CurPtr;
-  if (IntEnd != StartChar) {
-    CurPtr = IntEnd;
-    uint64_t NumBits = atoull(StartChar, CurPtr);
-    if (NumBits < IntegerType::MIN_INT_BITS ||
-        NumBits > IntegerType::MAX_INT_BITS) {
-      Error("bitwidth for integer type out of range!");
-      return lltok::Error;
-    }
-    TyVal = IntegerType::get(Context, NumBits);
-    return lltok::Type;
-  }
-
-  // Otherwise, this was a letter sequence.  See which keyword this is.
-  if (!KeywordEnd) KeywordEnd = CurPtr;
-  CurPtr = KeywordEnd;
-  --StartChar;
-  StringRef Keyword(StartChar, CurPtr - StartChar);
-
-#define KEYWORD(STR)                                                           \
-  do {                                                                         \
-    if (Keyword == #STR)                                                       \
-      return lltok::kw_##STR;                                                  \
-  } while (false)
+namespace {
+/// What a fixed keyword lexes to. Val is the TypeID of type keywords and the
+/// opcode of instruction keywords, zero otherwise.
+struct KeywordInfo {
+  lltok::Kind Kind;
+  unsigned Val = 0;
+};
+} // end anonymous namespace
+
+/// Build the table of fixed keywords. LexIdentifier used to compare an
+/// identifier against each of them in turn; a hash lookup is a lot cheaper
+/// for the instruction and type keywords at the end of the list. Where a
+/// keyword is listed twice, the first entry wins.
+static StringMap<KeywordInfo> makeKeywordTable() {
+  StringMap<KeywordInfo> Keywords;
+#define KEYWORD(STR) Keywords.try_emplace(#STR, KeywordInfo{lltok::kw_##STR})
 
   KEYWORD(true);    KEYWORD(false);
   KEYWORD(declare); KEYWORD(define);
@@ -817,39 +830,29 @@ lltok::Kind LLLexer::LexIdentifier() {
 #undef KEYWORD
 
   // Keywords for types.
-#define TYPEKEYWORD(STR, LLVMTY)                                               \
-  do {                                                                         \
-    if (Keyword == STR) {                                                      \
-      TyVal = LLVMTY;                                                          \
-      return lltok::Type;                                                      \
-    }                                                                          \
-  } while (false)
-
-  TYPEKEYWORD("void",      Type::getVoidTy(Context));
-  TYPEKEYWORD("half",      Type::getHalfTy(Context));
-  TYPEKEYWORD("bfloat",    Type::getBFloatTy(Context));
-  TYPEKEYWORD("float",     Type::getFloatTy(Context));
-  TYPEKEYWORD("double",    Type::getDoubleTy(Context));
-  TYPEKEYWORD("x86_fp80",  Type::getX86_FP80Ty(Context));
-  TYPEKEYWORD("fp128",     Type::getFP128Ty(Context));
-  TYPEKEYWORD("ppc_fp128", Type::getPPC_FP128Ty(Context));
-  TYPEKEYWORD("label",     Type::getLabelTy(Context));
-  TYPEKEYWORD("metadata",  Type::getMetadataTy(Context));
-  TYPEKEYWORD("x86_mmx",   Type::getX86_MMXTy(Context));
-  TYPEKEYWORD("x86_amx",   Type::getX86_AMXTy(Context));
-  TYPEKEYWORD("token",     Type::getTokenTy(Context));
-  TYPEKEYWORD("ptr",       PointerType::getUnqual(Context));
+#define TYPEKEYWORD(STR, ID)                                                   \
+  Keywords.try_emplace(STR, KeywordInfo{lltok::Type, Type::ID})
+
+  TYPEKEYWORD("void",      VoidTyID);
+  TYPEKEYWORD("half",      HalfTyID);
+  TYPEKEYWORD("bfloat",    BFloatTyID);
+  TYPEKEYWORD("float",     FloatTyID);
+  TYPEKEYWORD("double",    DoubleTyID);
+  TYPEKEYWORD("x86_fp80",  X86_FP80TyID);
+  TYPEKEYWORD("fp128",     FP128TyID);
+  TYPEKEYWORD("ppc_fp128", PPC_FP128TyID);
+  TYPEKEYWORD("label",     LabelTyID);
+  TYPEKEYWORD("metadata",  MetadataTyID);
+  TYPEKEYWORD("x86_mmx",   X86_MMXTyID);
+  TYPEKEYWORD("x86_amx",   X86_AMXTyID);
+  TYPEKEYWORD("token",     TokenTyID);
+  TYPEKEYWORD("ptr",       PointerTyID);
 
 #undef TYPEKEYWORD
 
   // Keywords for instructions.
 #define INSTKEYWORD(STR, Enum)                                                 \
-  do {                                                                         \
-    if (Keyword == #STR) {                                                     \
-      UIntVal = Instruction::Enum;                                             \
-      return lltok::kw_##STR;                                                  \
-    }                                                                          \
-  } while (false)
+  Keywords.try_emplace(#STR, KeywordInfo{lltok::kw_##STR, Instruction::Enum})
 
   INSTKEYWORD(fneg,  FNeg);
 
@@ -912,6 +915,100 @@ lltok::Kind LLLexer::LexIdentifier() {
 
 #undef INSTKEYWORD
 
+  // Keywords for debug record types.
+#define DBGRECORDTYPEKEYWORD(STR)                                              \
+  Keywords.try_emplace("dbg_" #STR, KeywordInfo{lltok::DbgRecordType})
+
+  DBGRECORDTYPEKEYWORD(value);
+  DBGRECORDTYPEKEYWORD(declare);
+  DBGRECORDTYPEKEYWORD(assign);
+  DBGRECORDTYPEKEYWORD(label);
+#undef DBGRECORDTYPEKEYWORD
+
+  for (StringRef Kind :
+       {"NoDebug", "FullDebug", "LineTablesOnly", "DebugDirectivesOnly"})
+    Keywords.try_emplace(Kind, KeywordInfo{lltok::EmissionKind});
+  for (StringRef Kind : {"GNU", "Apple", "None", "Default"})
+    Keywords.try_emplace(Kind, KeywordInfo{lltok::NameTableKind});
+  return Keywords;
+}
+
+static const StringMap<KeywordInfo> &getKeywordTable() {
+  static const StringMap<KeywordInfo> Keywords = makeKeywordTable();
+  return Keywords;
+}
+
+/// Lex a label, integer type, keyword, or hexadecimal integer constant.
+///    Label           [-a-zA-Z$._0-9]+:
+///    IntegerType     i[0-9]+
+///    Keyword         sdiv, float, ...
+///    HexIntConstant  [us]0x[0-9A-Fa-f]+
+lltok::Kind LLLexer::LexIdentifier() {
+  const char *StartChar = CurPtr;
+  const char *IntEnd = CurPtr[-1] == 'i' ? nullptr : StartChar;
+  const char *KeywordEnd = nullptr;
+
+  for (; isLabelChar(*CurPtr); ++CurPtr) {
+    // If we decide this is an integer, remember the end of the sequence.
+    if (!IntEnd && !isCharClass(*CurPtr, CC_Digit))
+      IntEnd = CurPtr;
+    if (!KeywordEnd && !isCharClass(*CurPtr, CC_Digit | CC_Letter))
+      KeywordEnd = CurPtr;
+  }
+
+  // If we stopped due to a colon, unless we were directed to ignore it,
+  // this really is a label.
+  if (!IgnoreColonInIdentifiers && *CurPtr == ':') {
+    StrVal.assign(StartChar-1, CurPtr++);
+    return lltok::LabelStr;
+  }
+
+  // Otherwise, this wasn't a label.  If this was valid as an integer type,
+  // return it.
+  if (!IntEnd) IntEnd = CurPtr;
+  if (IntEnd != StartChar) {
+    CurPtr = IntEnd;
+    uint64_t NumBits = atoull(StartChar, CurPtr);
+    if (NumBits < IntegerType::MIN_INT_BITS ||
+        NumBits > IntegerType::MAX_INT_BITS) {
+      Error("bitwidth for integer type out of range!");
+      return lltok::Error;
+    }
+    TyVal = IntegerType::get(Context, NumBits);
+    return lltok::Type;
+  }
+
+  // Otherwise, this was a letter sequence.  See which keyword this is.
+  if (!KeywordEnd) KeywordEnd = CurPtr;
+  CurPtr = KeywordEnd;
+  --StartChar;
+  StringRef Keyword(StartChar, CurPtr - StartChar);
+
+  const StringMap<KeywordInfo> &Keywords = getKeywordTable();
+  auto KI = Keywords.find(Keyword);
+  if (KI != Keywords.end()) {
+    const KeywordInfo &Info = KI->second;
+    switch (Info.Kind) {
+    case lltok::Type:
+      TyVal = Info.Val == Type::PointerTyID
+                  ? PointerType::getUnqual(Context)
+                  : Type::getPrimitiveType(Context, Type::TypeID(Info.Val));
+      break;
+    case lltok::DbgRecordType:
+      StrVal.assign(Keyword.begin() + 4, Keyword.end()); // Drop "dbg_".
+      break;
+    case lltok::EmissionKind:
+    case lltok::NameTableKind:
+      StrVal.assign(Keyword.begin(), Keyword.end());
+      break;
+    default:
+      if (Info.Val)
+        UIntVal = Info.Val;
+      break;
+    }
+    return Info.Kind;
+  }
+
 #define DWKEYWORD(TYPE, TOKEN)                                                 \
   do {                                                                         \
     if (Keyword.starts_with("DW_" #TYPE "_")) {                                \
@@ -930,21 +1027,6 @@ lltok::Kind LLLexer::LexIdentifier() {
 
 #undef DWKEYWORD
 
-// Keywords for debug record types.
-#define DBGRECORDTYPEKEYWORD(STR)                                              \
-  do {                                                                         \
-    if (Keyword == "dbg_" #STR) {                                              \
-      StrVal = #STR;                                                           \
-      return lltok::DbgRecordType;                                             \
-    }                                                                          \
-  } while (false)
-
-  DBGRECORDTYPEKEYWORD(value);
-  DBGRECORDTYPEKEYWORD(declare);
-  DBGRECORDTYPEKEYWORD(assign);
-  DBGRECORDTYPEKEYWORD(label);
-#undef DBGRECORDTYPEKEYWORD
-
   if (Keyword.starts_with("DIFlag")) {
     StrVal.assign(Keyword.begin(), Keyword.end());
     return lltok::DIFlag;
@@ -960,18 +1042,6 @@ lltok::Kind LLLexer::LexIdentifier() {
     return lltok::ChecksumKind;
   }
 
-  if (Keyword == "NoDebug" || Keyword == "FullDebug" ||
-      Keyword == "LineTablesOnly" || Keyword == "DebugDirectivesOnly") {
-    StrVal.assign(Keyword.begin(), Keyword.end());
-    return lltok::EmissionKind;
-  }
-
-  if (Keyword == "GNU" || Keyword == "Apple" || Keyword == "None" ||
-      Keyword == "Default") {
-    StrVal.assign(Keyword.begin(), Keyword.end());
-    return lltok::NameTableKind;
-  }
-
   // Check for [us]0x[0-9A-Fa-f]+ which are Hexadecimal constant generated by
   // the CFE to avoid forcing it to deal with 64-bit numbers.
   if ((TokStart[0] == 'u' || TokStart[0] == 's') &&
@@ -1124,7 +1194,7 @@ lltok::Kind LLLexer::LexDigitOrNegative() {
   if (CurPtr[0] != '.') {
     if (TokStart[0] == '0' && TokStart[1] == 'x')
       return Lex0x();
-    APSIntVal = APSInt(StringRef(TokStart, CurPtr - TokStart));
+    APSIntVal = parseDecimalAPSInt(StringRef(TokStart, CurPtr - TokStart));
     return lltok::APSInt;
   }
 
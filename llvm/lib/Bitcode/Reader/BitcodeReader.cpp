@@ -71,6 +71,8 @@
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/ModRef.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/TargetParser/Triple.h"
 #include <algorithm>
@@ -579,6 +581,81 @@ public:
   }
 };
 
+/// The entries of a function block, decoded ahead of parseFunctionBody so that
+/// this can be done on other threads. parseFunctionBody then reads them from
+/// here instead of from the stream. Sub-blocks are not decoded, only their
+/// position is kept, and they are read from the stream as usual.
+class StagedFunctionBlock {
+  struct Entry {
+    /// The position right after the ID of a sub-block.
+    uint64_t BitNo;
+    /// The block ID of a sub-block, or the code of a record.
+    unsigned ID;
+    /// The end of the operands of a record in Ops.
+    unsigned OpsEnd;
+    bool IsSubBlock;
+  };
+  SmallVector<Entry, 0> Entries;
+  SmallVector<uint64_t, 0> Ops;
+  unsigned NextEntry = 0;
+
+public:
+  /// Decodes the function block at \p BitNo, the position right after its
+  /// block ID, with \p Cursor.
+  Error decode(BitstreamCursor &Cursor, uint64_t BitNo) {
+    if (Error Err = Cursor.JumpToBit(BitNo))
+      return Err;
+    if (Error Err = Cursor.EnterSubBlock(bitc::FUNCTION_BLOCK_ID))
+      return Err;
+    while (true) {
+      Expected<BitstreamEntry> MaybeEntry = Cursor.advance();
+      if (!MaybeEntry)
+        return MaybeEntry.takeError();
+      BitstreamEntry Entry = MaybeEntry.get();
+      switch (Entry.Kind) {
+      case BitstreamEntry::Error:
+        return error("Malformed block");
+      case BitstreamEntry::EndBlock:
+        return Error::success();
+      case BitstreamEntry::SubBlock:
+        Entries.push_back({Cursor.GetCurrentBitNo(), Entry.ID,
+                           unsigned(Ops.size()), true});
+        if (Error Err = Cursor.SkipBlock())
+          return Err;
+        break;
+      case BitstreamEntry::Record:
+        Expected<unsigned> MaybeCode = Cursor.readRecord(Entry.ID, Ops);
+        if (!MaybeCode)
+          return MaybeCode.takeError();
+        Entries.push_back({0, MaybeCode.get(), unsigned(Ops.size()), false});
+        break;
+      }
+    }
+  }
+
+  /// Like BitstreamCursor::advance. For a sub-block, \p Stream is moved to
+  /// where advance would have left it.
+  Expected<BitstreamEntry> advance(BitstreamCursor &Stream) {
+    if (NextEntry == Entries.size())
+      return BitstreamEntry::getEndBlock();
+    const Entry &E = Entries[NextEntry++];
+    if (!E.IsSubBlock)
+      return BitstreamEntry::getRecord(0);
+    if (Error Err = Stream.JumpToBit(E.BitNo))
+      return std::move(Err);
+    return BitstreamEntry::getSubBlock(E.ID);
+  }
+
+  /// Like BitstreamCursor::readRecord for the record advance returned.
+  unsigned readRecord(SmallVectorImpl<uint64_t> &Vals) {
+    assert(NextEntry && !Entries[NextEntry - 1].IsSubBlock && "Not a record");
+    unsigned OpsBegin = NextEntry > 1 ? Entries[NextEntry - 2].OpsEnd : 0;
+    const Entry &E = Entries[NextEntry - 1];
+    Vals.append(Ops.begin() + OpsBegin, Ops.begin() + E.OpsEnd);
+    return E.ID;
+  }
+};
+
 class BitcodeReader : public BitcodeReaderBase, public GVMaterializer {
   LLVMContext &Context;
   Module *TheModule = nullptr;
@@ -655,6 +732,9 @@ class BitcodeReader : public BitcodeReaderBase, public GVMaterializer {
   /// where to find deferred function body in the stream.
   DenseMap<Function*, uint64_t> DeferredFunctionInfo;
 
+  /// Function bodies materializeFunctions has decoded already.
+  DenseMap<Function *, StagedFunctionBlock> StagedFunctionBlocks;
+
   /// When Metadata block is initially scanned when parsing the module, we may
   /// choose to defer parsing of the metadata. This vector contains info about
   /// which Metadata blocks are deferred.
@@ -705,6 +785,8 @@ public:
   Error materializeForwardReferencedFunctions();
 
   Error materialize(GlobalValue *GV) override;
+  Error materializeFunctions(ArrayRef<Function *> Fns,
+                             ThreadPoolStrategy S) override;
   Error materializeModule() override;
   std::vector<StructType *> getIdentifiedStructTypes() const override;
 
@@ -4742,8 +4824,16 @@ Error BitcodeReader::propagateAttributeTypes(CallBase *CB,
 
 /// Lazily parse the specified function body block.
 Error BitcodeReader::parseFunctionBody(Function *F) {
-  if (Error Err = Stream.EnterSubBlock(bitc::FUNCTION_BLOCK_ID))
+  // Read the entries of the block from the stream, unless they have been
+  // decoded already.
+  std::optional<StagedFunctionBlock> Staged;
+  auto StagedIt = StagedFunctionBlocks.find(F);
+  if (StagedIt != StagedFunctionBlocks.end()) {
+    Staged = std::move(StagedIt->second);
+    StagedFunctionBlocks.erase(StagedIt);
+  } else if (Error Err = Stream.EnterSubBlock(bitc::FUNCTION_BLOCK_ID)) {
     return Err;
+  }
 
   // Unexpected unresolved metadata when parsing function.
   if (MDLoader->hasFwdRefs())
@@ -4789,7 +4879,8 @@ Error BitcodeReader::parseFunctionBody(Function *F) {
   SmallVector<uint64_t, 64> Record;
 
   while (true) {
-    Expected<llvm::BitstreamEntry> MaybeEntry = Stream.advance();
+    Expected<llvm::BitstreamEntry> MaybeEntry =
+        Staged ? Staged->advance(Stream) : Stream.advance();
     if (!MaybeEntry)
       return MaybeEntry.takeError();
     llvm::BitstreamEntry Entry = MaybeEntry.get();
@@ -4841,7 +4932,9 @@ Error BitcodeReader::parseFunctionBody(Function *F) {
     Record.clear();
     Instruction *I = nullptr;
     unsigned ResTypeID = InvalidTypeID;
-    Expected<unsigned> MaybeBitCode = Stream.readRecord(Entry.ID, Record);
+    Expected<unsigned> MaybeBitCode = Staged
+                                          ? Staged->readRecord(Record)
+                                          : Stream.readRecord(Entry.ID, Record);
     if (!MaybeBitCode)
       return MaybeBitCode.takeError();
     switch (unsigned BitCode = MaybeBitCode.get()) {
@@ -6937,6 +7030,85 @@ Error BitcodeReader::materialize(GlobalValue *GV) {
   return materializeForwardReferencedFunctions();
 }
 
+Error BitcodeReader::materializeFunctions(ArrayRef<Function *> Fns,
+                                          ThreadPoolStrategy S) {
+  // Find the bodies in the stream first, which materialize would do as it
+  // goes.
+  SmallVector<std::pair<Function *, uint64_t>, 0> Bodies;
+  for (Function *F : Fns) {
+    if (!F->isMaterializable())
+      continue;
+    auto DFII = DeferredFunctionInfo.find(F);
+    assert(DFII != DeferredFunctionInfo.end() &&
+           "Deferred function not found!");
+    if (DFII->second == 0)
+      if (Error Err = findFunctionInStream(F, DFII))
+        return Err;
+    Bodies.emplace_back(F, DFII->second);
+  }
+  if (Error Err = materializeMetadata())
+    return Err;
+
+  unsigned Threads = S.compute_thread_count();
+  if (Threads <= 1 || Bodies.size() <= 1) {
+    for (auto [F, BitNo] : Bodies)
+      if (Error Err = materialize(F))
+        return Err;
+    return Error::success();
+  }
+
+  // Only one thread can build IR, so the others decode function blocks into
+  // StagedFunctionBlocks ahead of it. They work on chunks of functions, and
+  // stay a bounded number of chunks ahead to bound the memory used.
+  const size_t ChunkSize = 16;
+  const size_t NumChunks = divideCeil(Bodies.size(), ChunkSize);
+  const size_t MaxChunksAhead = 4 * Threads;
+  std::vector<std::optional<StagedFunctionBlock>> Staged(Bodies.size());
+  std::vector<std::shared_future<void>> Chunks(NumChunks);
+  DefaultThreadPool Pool(S);
+  ArrayRef<uint8_t> Bytes = Stream.getBitcodeBytes();
+  auto DecodeChunk = [&](size_t Chunk) {
+    Chunks[Chunk] = Pool.async([&, Chunk] {
+      BitstreamCursor Cursor(Bytes);
+      Cursor.setBlockInfo(&BlockInfo);
+      size_t End = std::min(Bodies.size(), (Chunk + 1) * ChunkSize);
+      for (size_t I = Chunk * ChunkSize; I != End; ++I) {
+        // Functions that fail to decode are left to parseFunctionBody, which
+        // reports the error.
+        StagedFunctionBlock Block;
+        if (Error Err = Block.decode(Cursor, Bodies[I].second))
+          consumeError(std::move(Err));
+        else
+          Staged[I] = std::move(Block);
+      }
+    });
+  };
+  for (size_t Chunk = 0; Chunk != std::min(NumChunks, MaxChunksAhead); ++Chunk)
+    DecodeChunk(Chunk);
+
+  for (size_t Chunk = 0; Chunk != NumChunks; ++Chunk) {
+    Chunks[Chunk].wait();
+    if (Chunk + MaxChunksAhead < NumChunks)
+      DecodeChunk(Chunk + MaxChunksAhead);
+    size_t End = std::min(Bodies.size(), (Chunk + 1) * ChunkSize);
+    for (size_t I = Chunk * ChunkSize; I != End; ++I) {
+      Function *F = Bodies[I].first;
+      if (Staged[I])
+        StagedFunctionBlocks.try_emplace(F, std::move(*Staged[I]));
+      Staged[I].reset();
+      Error Err = materialize(F);
+      // F may have been materialized already through a blockaddress.
+      StagedFunctionBlocks.erase(F);
+      if (Err) {
+        Pool.wait();
+        StagedFunctionBlocks.clear();
+        return Err;
+      }
+    }
+  }
+  return Error::success();
+}
+
 Error BitcodeReader::materializeModule() {
   if (Error Err = materializeMetadata())
     return Err;
@@ -229,11 +229,8 @@ Expected<unsigned> BitstreamCursor::readRecord(unsigned AbbrevID,
       return error("Size is not plausible");
     Vals.reserve(Vals.size() + NumElts);
 
-    for (unsigned i = 0; i != NumElts; ++i)
-      if (Expected<uint64_t> MaybeVal = ReadVBR64(6))
-        Vals.push_back(MaybeVal.get());
-      else
-        return MaybeVal.takeError();
+    if (Error Err = ReadVBR64Array(6, NumElts, Vals))
+      return std::move(Err);
     return Code;
   }
 
@@ -307,12 +304,9 @@ Expected<unsigned> BitstreamCursor::readRecord(unsigned AbbrevID,
             return MaybeVal.takeError();
         break;
       case BitCodeAbbrevOp::VBR:
-        for (; NumElts; --NumElts)
-          if (Expected<uint64_t> MaybeVal =
-                  ReadVBR64((unsigned)EltEnc.getEncodingData()))
-            Vals.push_back(MaybeVal.get());
-          else
-            return MaybeVal.takeError();
+        if (Error Err = ReadVBR64Array((unsigned)EltEnc.getEncodingData(),
+                                       NumElts, Vals))
+          return std::move(Err);
         break;
       case BitCodeAbbrevOp::Char6:
         for (; NumElts; --NumElts)
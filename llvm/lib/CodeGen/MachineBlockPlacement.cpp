@@ -1375,10 +1375,16 @@ void MachineBlockPlacement::precomputeTriangleChains() {
 
 // When profile is not present, return the StaticLikelyProb.
 // When profile is available, we need to handle the triangle-shape CFG.
-static BranchProbability getLayoutSuccessorProbThreshold(
-      const MachineBasicBlock *BB) {
+// Unless overridden on the command line, the profile threshold is provided by
+// the target.
+static BranchProbability
+getLayoutSuccessorProbThreshold(const MachineBasicBlock *BB,
+                                const TargetInstrInfo *TII) {
   if (!BB->getParent()->getFunction().hasProfileData())
     return BranchProbability(StaticLikelyProb, 100);
+  unsigned LikelyProb = ProfileLikelyProb.getNumOccurrences()
+                            ? ProfileLikelyProb
+                            : TII->getProfileLikelyProb(*BB);
   if (BB->succ_size() == 2) {
     const MachineBasicBlock *Succ1 = *BB->succ_begin();
     const MachineBasicBlock *Succ2 = *(BB->succ_begin() + 1);
@@ -1393,10 +1399,10 @@ static BranchProbability getLayoutSuccessorProbThreshold(
        *   T = (2/3)*(ProfileLikelyProb/50)
        *     = (2*ProfileLikelyProb)/150)
        */
-      return BranchProbability(2 * ProfileLikelyProb, 150);
+      return BranchProbability(2 * LikelyProb, 150);
     }
   }
-  return BranchProbability(ProfileLikelyProb, 100);
+  return BranchProbability(LikelyProb, 100);
 }
 
 /// Checks to see if the layout candidate block \p Succ has a better layout
@@ -1530,7 +1536,7 @@ bool MachineBlockPlacement::hasBetterLayoutPredecessor(
   // This is exactly what is checked below.
   // Note there are other shapes that apply (Pred may not be a single block,
   // but they all fit this general pattern.)
-  BranchProbability HotProb = getLayoutSuccessorProbThreshold(BB);
+  BranchProbability HotProb = getLayoutSuccessorProbThreshold(BB, TII);
 
   // Make sure that a hot successor doesn't have a globally more
   // important predecessor.
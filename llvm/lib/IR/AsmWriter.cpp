@@ -1048,9 +1048,11 @@ void SlotTracker::processFunction() {
   ST_DEBUG("begin processFunction!\n");
   fNext = 0;
 
-  // Process function metadata if it wasn't hit at the module-level.
+  // Process function metadata if it wasn't hit at the module-level. The
+  // metadata of the instructions is numbered in the walk below, so that a
+  // function is only walked once.
   if (!ShouldInitializeAllMetadata)
-    processFunctionMetadata(*TheFunction);
+    processGlobalObjectMetadata(*TheFunction);
 
   // Add all the function arguments with no names.
   for(Function::const_arg_iterator AI = TheFunction->arg_begin(),
@@ -1066,6 +1068,12 @@ void SlotTracker::processFunction() {
       CreateFunctionSlot(&BB);
 
     for (auto &I : BB) {
+      if (!ShouldInitializeAllMetadata) {
+        for (const DbgRecord &DR : I.getDbgRecordRange())
+          processDbgRecordMetadata(DR);
+        processInstructionMetadata(I);
+      }
+
       if (!I.getType()->isVoidTy() && !I.hasName())
         CreateFunctionSlot(&I);
 
@@ -2669,7 +2677,6 @@ class AssemblyWriter {
   SlotTracker &Machine;
   TypePrinting TypePrinter;
   AssemblyAnnotationWriter *AnnotationWriter = nullptr;
-  SetVector<const Comdat *> Comdats;
   bool IsForDebug;
   bool ShouldPreserveUseListOrder;
   UseListOrderMap UseListOrders;
@@ -2776,13 +2783,7 @@ AssemblyWriter::AssemblyWriter(formatted_raw_ostream &o, SlotTracker &Mac,
                                bool IsForDebug, bool ShouldPreserveUseListOrder)
     : Out(o), TheModule(M), Machine(Mac), TypePrinter(M), AnnotationWriter(AAW),
       IsForDebug(IsForDebug),
-      ShouldPreserveUseListOrder(ShouldPreserveUseListOrder) {
-  if (!TheModule)
-    return;
-  for (const GlobalObject &GO : TheModule->global_objects())
-    if (const Comdat *C = GO.getComdat())
-      Comdats.insert(C);
-}
+      ShouldPreserveUseListOrder(ShouldPreserveUseListOrder) {}
 
 AssemblyWriter::AssemblyWriter(formatted_raw_ostream &o, SlotTracker &Mac,
                                const ModuleSummaryIndex *Index, bool IsForDebug)
@@ -2947,7 +2948,12 @@ void AssemblyWriter::printModule(const Module *M) {
 
   printTypeIdentities();
 
-  // Output all comdats.
+  // Output all comdats. They are only collected here, so that printing a
+  // single value does not walk all global objects of its module.
+  SetVector<const Comdat *> Comdats;
+  for (const GlobalObject &GO : M->global_objects())
+    if (const Comdat *C = GO.getComdat())
+      Comdats.insert(C);
   if (!Comdats.empty())
     Out << '\n';
   for (const Comdat *C : Comdats) {
@@ -4848,9 +4854,25 @@ void Module::print(raw_ostream &ROS, AssemblyAnnotationWriter *AAW,
                    bool ShouldPreserveUseListOrder, bool IsForDebug) const {
   SlotTracker SlotTable(this);
   formatted_raw_ostream OS(ROS);
+
+  // A module is printed in a great many small writes. Batch them in a bigger
+  // buffer than ROS may have, then hand its own setting back to ROS, which
+  // inherits the buffer size of OS when it is destroyed.
+  const size_t PrintBufferSize = 64 * 1024;
+  size_t OldBufferSize = OS.GetBufferSize();
+  if (OldBufferSize < PrintBufferSize)
+    OS.SetBufferSize(PrintBufferSize);
+
   AssemblyWriter W(OS, SlotTable, this, AAW, IsForDebug,
                    ShouldPreserveUseListOrder);
   W.printModule(this);
+
+  if (OldBufferSize >= PrintBufferSize)
+    return;
+  if (OldBufferSize)
+    OS.SetBufferSize(OldBufferSize);
+  else
+    OS.SetUnbuffered();
 }
 
 void NamedMDNode::print(raw_ostream &ROS, bool IsForDebug) const {
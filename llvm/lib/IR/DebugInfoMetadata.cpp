@@ -99,7 +99,7 @@ DILocation *DILocation::getImpl(LLVMContext &Context, unsigned Line,
   Ops.push_back(Scope);
   if (InlinedAt)
     Ops.push_back(InlinedAt);
-  return storeImpl(new (Ops.size(), Storage) DILocation(
+  return storeImpl(new (Ops.size(), Storage, Context) DILocation(
                        Context, Storage, Line, Column, Ops, ImplicitCode),
                    Storage, Context.pImpl->DILocations);
 }
@@ -1314,8 +1314,13 @@ DILocalVariable::getImpl(LLVMContext &Context, Metadata *Scope, MDString *Name,
   assert(isCanonical(Name) && "Expected canonical MDString");
   DEFINE_GETIMPL_LOOKUP(DILocalVariable, (Scope, Name, File, Line, Type, Arg,
                                           Flags, AlignInBits, Annotations));
-  Metadata *Ops[] = {Scope, Name, File, Type, Annotations};
-  DEFINE_GETIMPL_STORE(DILocalVariable, (Line, Arg, Flags, AlignInBits), Ops);
+  SmallVector<Metadata *, 5> Ops = {Scope, Name, File, Type, Annotations};
+  // Most variables have no annotations, so leave out the operand for them.
+  if (!Annotations)
+    Ops.pop_back();
+  return storeImpl(new (Ops.size(), Storage, Context) DILocalVariable(
+                       Context, Storage, Line, Arg, Flags, AlignInBits, Ops),
+                   Storage, Context.pImpl->DILocalVariables);
 }
 
 DIVariable::DIVariable(LLVMContext &C, unsigned ID, StorageType Storage,
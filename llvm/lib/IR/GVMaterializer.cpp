@@ -12,6 +12,17 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/IR/GVMaterializer.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/Threading.h"
 using namespace llvm;
 
 GVMaterializer::~GVMaterializer() = default;
+
+Error GVMaterializer::materializeFunctions(ArrayRef<Function *> Fns,
+                                           ThreadPoolStrategy S) {
+  for (Function *F : Fns)
+    if (Error Err = materialize(F))
+      return Err;
+  return Error::success();
+}
@@ -634,11 +634,27 @@ void *MDNode::operator new(size_t Size, size_t NumOps, StorageType Storage) {
   return reinterpret_cast<void *>(H + 1);
 }
 
+void *MDNode::operator new(size_t Size, size_t NumOps, StorageType Storage,
+                           LLVMContext &Context) {
+  if (Storage != Uniqued)
+    return operator new(Size, NumOps, Storage);
+
+  size_t AllocSize =
+      alignTo(Header::getAllocSize(Storage, NumOps), alignof(uint64_t));
+  char *Mem = static_cast<char *>(
+      Context.pImpl->Alloc.Allocate(AllocSize + Size, alignof(uint64_t)));
+  Header *H = new (Mem + AllocSize - sizeof(Header)) Header(NumOps, Storage);
+  H->IsContextAllocated = true;
+  return reinterpret_cast<void *>(H + 1);
+}
+
 void MDNode::operator delete(void *N) {
   Header *H = reinterpret_cast<Header *>(N) - 1;
   void *Mem = H->getAllocation();
+  bool IsContextAllocated = H->IsContextAllocated;
   H->~Header();
-  ::operator delete(Mem);
+  if (!IsContextAllocated)
+    ::operator delete(Mem);
 }
 
 MDNode::MDNode(LLVMContext &Context, unsigned ID, StorageType Storage,
@@ -672,6 +688,7 @@ TempMDNode MDNode::clone() const {
 MDNode::Header::Header(size_t NumOps, StorageType Storage) {
   IsLarge = isLarge(NumOps);
   IsResizable = isResizable(Storage);
+  IsContextAllocated = false;
   SmallSize = getSmallSize(NumOps, IsResizable, IsLarge);
   if (IsLarge) {
     SmallNumOps = 0;
@@ -43,6 +43,7 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/RandomNumberGenerator.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/VersionTuple.h"
 #include <algorithm>
 #include <cassert>
@@ -452,6 +453,13 @@ Error Module::materialize(GlobalValue *GV) {
   return Materializer->materialize(GV);
 }
 
+Error Module::materializeFunctions(ArrayRef<Function *> Fns,
+                                   ThreadPoolStrategy S) {
+  if (!Materializer)
+    return Error::success();
+  return Materializer->materializeFunctions(Fns, S);
+}
+
 Error Module::materializeAll() {
   if (!Materializer)
     return Error::success();
@@ -11,27 +11,99 @@
 
 namespace llvm {
 
+// Each Use is a Value, a Next and a tagged Prev pointer; its User is found from
+// where it is in memory.
+static_assert(sizeof(Use) == 3 * sizeof(void *), "Use has grown");
+
 void Use::swap(Use &RHS) {
   if (Val == RHS.Val)
     return;
 
+  // The waymarks stay where they are, only the list links move.
   std::swap(Val, RHS.Val);
   std::swap(Next, RHS.Next);
-  std::swap(Prev, RHS.Prev);
+  Use **LHSPrev = Prev.getPointer();
+  setPrev(RHS.Prev.getPointer());
+  RHS.setPrev(LHSPrev);
 
-  *Prev = this;
+  *Prev.getPointer() = this;
   if (Next)
-    Next->Prev = &Next;
+    Next->setPrev(&Next);
 
-  *RHS.Prev = &RHS;
+  *RHS.Prev.getPointer() = &RHS;
   if (RHS.Next)
-    RHS.Next->Prev = &RHS.Next;
+    RHS.Next->setPrev(&RHS.Next);
 }
 
 unsigned Use::getOperandNo() const {
   return this - getUser()->op_begin();
 }
 
+const Use *Use::getImpliedUser() const {
+  const Use *Current = this;
+
+  while (true) {
+    unsigned Tag = (Current++)->Prev.getInt();
+    switch (Tag) {
+    case zeroDigitTag:
+    case oneDigitTag:
+      continue;
+
+    case stopTag: {
+      ++Current;
+      ptrdiff_t Offset = 1;
+      while (true) {
+        unsigned Tag = Current->Prev.getInt();
+        switch (Tag) {
+        case zeroDigitTag:
+        case oneDigitTag:
+          ++Current;
+          Offset = (Offset << 1) + Tag;
+          continue;
+        default:
+          return Current + Offset;
+        }
+      }
+    }
+
+    case fullStopTag:
+      return Current;
+    }
+  }
+}
+
+Use *Use::initTags(Use *const Start, Use *Stop) {
+  // The last 20 Uses of an array get fixed waymarks, the ones before them
+  // spell out their distance to the end, each number followed by a stop.
+  ptrdiff_t Done = 0;
+  while (Done < 20) {
+    if (Start == Stop--)
+      return Start;
+    static const PrevPtrTag Tags[20] = {
+        fullStopTag,  oneDigitTag,  stopTag,      oneDigitTag, oneDigitTag,
+        stopTag,      zeroDigitTag, oneDigitTag,  oneDigitTag, stopTag,
+        zeroDigitTag, oneDigitTag,  zeroDigitTag, oneDigitTag, stopTag,
+        oneDigitTag,  oneDigitTag,  oneDigitTag,  oneDigitTag, stopTag};
+    new (Stop) Use(Tags[Done++]);
+  }
+
+  ptrdiff_t Count = Done;
+  while (Start != Stop) {
+    --Stop;
+    if (!Count) {
+      new (Stop) Use(stopTag);
+      ++Done;
+      Count = Done;
+    } else {
+      new (Stop) Use(PrevPtrTag(Count & 1));
+      Count >>= 1;
+      ++Done;
+    }
+  }
+
+  return Start;
+}
+
 void Use::zap(Use *Start, const Use *Stop, bool del) {
   while (Start != Stop)
     (--Stop)->~Use();
@@ -53,15 +53,15 @@ void User::allocHungoffUses(unsigned N, bool IsPhi) {
   static_assert(alignof(Use) >= alignof(BasicBlock *),
                 "Alignment is insufficient for 'hung-off-uses' pieces");
 
-  // Allocate the array of Uses
-  size_t size = N * sizeof(Use);
+  // Allocate the array of Uses, followed by a pointer back to this User that
+  // their waymarks lead to.
+  size_t size = N * sizeof(Use) + sizeof(Use::UserRef);
   if (IsPhi)
     size += N * sizeof(BasicBlock *);
   Use *Begin = static_cast<Use*>(::operator new(size));
   Use *End = Begin + N;
-  setOperandList(Begin);
-  for (; Begin != End; Begin++)
-    new (Begin) Use(this);
+  new (End) Use::UserRef(this, 1);
+  setOperandList(Use::initTags(Begin, End));
 }
 
 void User::growHungoffUses(unsigned NewNumUses, bool IsPhi) {
@@ -82,8 +82,10 @@ void User::growHungoffUses(unsigned NewNumUses, bool IsPhi) {
 
   // If this is a Phi, then we need to copy the BB pointers too.
   if (IsPhi) {
-    auto *OldPtr = reinterpret_cast<char *>(OldOps + OldNumUses);
-    auto *NewPtr = reinterpret_cast<char *>(NewOps + NewNumUses);
+    auto *OldPtr = reinterpret_cast<char *>(OldOps + OldNumUses) +
+                   sizeof(Use::UserRef);
+    auto *NewPtr = reinterpret_cast<char *>(NewOps + NewNumUses) +
+                   sizeof(Use::UserRef);
     std::copy(OldPtr, OldPtr + (OldNumUses * sizeof(BasicBlock *)), NewPtr);
   }
   Use::zap(OldOps, OldOps + OldNumUses, true);
@@ -139,8 +141,7 @@ void *User::allocateFixedOperandUser(size_t Size, unsigned Us,
   Obj->NumUserOperands = Us;
   Obj->HasHungOffUses = false;
   Obj->HasDescriptor = DescBytes != 0;
-  for (; Start != End; Start++)
-    new (Start) Use(Obj);
+  Use::initTags(Start, End);
 
   if (DescBytes != 0) {
     auto *DescInfo = reinterpret_cast<DescriptorInfo *>(Storage + DescBytes);
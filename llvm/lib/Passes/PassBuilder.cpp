@@ -15,6 +15,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Passes/PassBuilder.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Analysis/AliasAnalysisEvaluator.h"
 #include "llvm/Analysis/AliasSetTracker.h"
@@ -111,12 +112,14 @@
 #include "llvm/IR/SafepointIRVerifier.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/IRPrinter/IRPrintingPasses.h"
+#include "llvm/MC/TargetRegistry.h"
 #include "llvm/Passes/OptimizationLevel.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/Regex.h"
+#include "llvm/Support/VirtualFileSystem.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Transforms/AggressiveInstCombine/AggressiveInstCombine.h"
 #include "llvm/Transforms/CFGuard.h"
@@ -154,6 +157,7 @@
 #include "llvm/Transforms/IPO/MergeFunctions.h"
 #include "llvm/Transforms/IPO/ModuleInliner.h"
 #include "llvm/Transforms/IPO/OpenMPOpt.h"
+#include "llvm/Transforms/IPO/ParallelFunctionPassAdaptor.h"
 #include "llvm/Transforms/IPO/PartialInlining.h"
 #include "llvm/Transforms/IPO/SCCP.h"
 #include "llvm/Transforms/IPO/SampleProfile.h"
@@ -531,6 +535,21 @@ parseFunctionPipelineName(StringRef Name) {
   return Params;
 }
 
+/// Parses "parallel-function" and "parallel-function<N>", returning the number
+/// of threads, or zero to use all hardware threads.
+static std::optional<unsigned>
+parseParallelFunctionPipelineName(StringRef Name) {
+  if (!Name.consume_front("parallel-function"))
+    return std::nullopt;
+  if (Name.empty())
+    return 0;
+  unsigned Threads;
+  if (!Name.consume_front("<") || !Name.consume_back(">") ||
+      Name.getAsInteger(0, Threads))
+    return std::nullopt;
+  return Threads;
+}
+
 static std::optional<int> parseDevirtPassName(StringRef Name) {
   if (!Name.consume_front("devirt<") || !Name.consume_back(">"))
     return std::nullopt;
@@ -1190,6 +1209,8 @@ static bool isModulePassName(StringRef Name, CallbacksT &Callbacks) {
   // Explicitly handle custom-parsed pass names.
   if (parseRepeatPassName(Name))
     return true;
+  if (parseParallelFunctionPipelineName(Name))
+    return true;
 
 #define MODULE_PASS(NAME, CREATE_PASS)                                         \
   if (Name == NAME)                                                            \
@@ -1430,6 +1451,8 @@ Error PassBuilder::parseModulePass(ModulePassManager &MPM,
           createModuleToFunctionPassAdaptor(std::move(FPM), Params->first));
       return Error::success();
     }
+    if (auto Threads = parseParallelFunctionPipelineName(Name))
+      return parseParallelFunctionPass(MPM, InnerPipeline, *Threads);
     if (auto Count = parseRepeatPassName(Name)) {
       ModulePassManager NestedMPM;
       if (auto Err = parseModulePassPipeline(NestedMPM, InnerPipeline))
@@ -2003,6 +2026,178 @@ Error PassBuilder::parseModulePassPipeline(ModulePassManager &MPM,
   return Error::success();
 }
 
+static void printPipelineText(raw_ostream &OS,
+                              ArrayRef<PassBuilder::PipelineElement> Pipeline) {
+  ListSeparator LS(",");
+  for (const auto &E : Pipeline) {
+    OS << LS << E.Name;
+    if (E.InnerPipeline.empty())
+      continue;
+    OS << '(';
+    printPipelineText(OS, E.InnerPipeline);
+    OS << ')';
+  }
+}
+
+namespace {
+/// The pipeline of one thread of a parallel-function adaptor. Each thread has
+/// its own PassBuilder, which the registered analyses refer to, and its own
+/// copy of the TargetMachine.
+struct PassBuilderParallelFunctionPipeline : ParallelFunctionPipeline {
+  std::unique_ptr<TargetMachine> TM;
+  PassBuilder PB;
+
+  PassBuilderParallelFunctionPipeline(std::unique_ptr<TargetMachine> TM,
+                                      const PipelineTuningOptions &PTO,
+                                      const std::optional<PGOOptions> &PGOOpt)
+      : TM(std::move(TM)), PB(this->TM.get(), PTO, PGOOpt) {
+    PB.registerModuleAnalyses(MAM);
+    PB.registerCGSCCAnalyses(CGAM);
+    PB.registerFunctionAnalyses(FAM);
+    PB.registerLoopAnalyses(LAM);
+    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+  }
+};
+} // end anonymous namespace
+
+/// Writes the target options to \p OS, everything but the buffers and streams
+/// they refer to. TargetTransformInfo and the target's IR passes may look at
+/// any of them.
+static void printTargetOptions(raw_ostream &OS, const TargetOptions &O) {
+  auto Add = [&](auto Value) { OS << Value << '\0'; };
+  auto AddMode = [&](DenormalMode M) {
+    Add(int(M.Output));
+    Add(int(M.Input));
+  };
+  Add(O.BinutilsVersion.first);
+  Add(O.BinutilsVersion.second);
+  for (unsigned Flag : std::initializer_list<unsigned>{
+           O.UnsafeFPMath, O.NoInfsFPMath, O.NoNaNsFPMath, O.NoTrappingFPMath,
+           O.NoSignedZerosFPMath, O.ApproxFuncFPMath,
+           O.EnableAIXExtendedAltivecABI,
+           O.HonorSignDependentRoundingFPMathOption, O.NoZerosInBSS,
+           O.GuaranteedTailCallOpt, O.StackSymbolOrdering, O.EnableFastISel,
+           O.EnableGlobalISel, O.UseInitArray, O.DisableIntegratedAS,
+           O.FunctionSections, O.DataSections, O.IgnoreXCOFFVisibility,
+           O.XCOFFTracebackTable, O.UniqueSectionNames,
+           O.UniqueBasicBlockSectionNames, O.TrapUnreachable,
+           O.NoTrapAfterNoreturn, O.TLSSize, O.EmulatedTLS, O.EnableTLSDESC,
+           O.EnableIPRA, O.EmitStackSizeSection, O.EnableMachineOutliner,
+           O.EnableMachineFunctionSplitter, O.SupportsDefaultOutlining,
+           O.EmitAddrsig, O.BBAddrMap, O.EmitCallSiteInfo,
+           O.SupportsDebugEntryValues, O.ValueTrackingVariableLocations,
+           O.ForceDwarfFrameSection, O.XRayFunctionIndex, O.DebugStrictDwarf,
+           O.Hotpatch, O.PPCGenScalarMASSEntries, O.JMCInstrument,
+           O.EnableCFIFixup, O.MisExpect, O.XCOFFReadOnlyPointers,
+           O.LoopAlignment})
+    Add(Flag);
+  for (int Enum :
+       {int(O.GlobalISelAbort), int(O.BBSections), int(O.FloatABIType),
+        int(O.AllowFPOpFusion), int(O.ThreadModel), int(O.EABIVersion),
+        int(O.DebuggerTuning), int(O.ExceptionModel)})
+    Add(Enum);
+  AddMode(O.getRawFPDenormalMode());
+  AddMode(O.getRawFP32DenormalMode());
+  Add(O.MCOptions.ABIName);
+  Add(O.MCOptions.X86RelaxRelocations);
+  Add(O.MCOptions.DwarfVersion);
+  Add(O.MCOptions.Dwarf64);
+  Add(int(O.MCOptions.EmitDwarfUnwind));
+}
+
+/// Writes the tuning options to \p OS.
+static void printTuningOptions(raw_ostream &OS,
+                               const PipelineTuningOptions &PTO) {
+  for (int Option :
+       {int(PTO.LoopInterleaving), int(PTO.LoopVectorization),
+        int(PTO.SLPVectorization), int(PTO.LoopUnrolling),
+        int(PTO.ForgetAllSCEVInLoopUnroll), int(PTO.LicmMssaOptCap),
+        int(PTO.LicmMssaNoAccForPromotionCap), int(PTO.CallGraphProfile),
+        int(PTO.UnifiedLTO), int(PTO.MergeFunctions), PTO.InlinerThreshold,
+        int(PTO.EagerlyInvalidateAnalyses)})
+    OS << Option << '\0';
+}
+
+/// Writes the PGO options to \p OS. A profile is identified by its path, its
+/// size and the time it was last modified, rather than by hashing the whole
+/// file once per thread.
+static void printPGOOptions(raw_ostream &OS,
+                            const std::optional<PGOOptions> &PGOOpt) {
+  if (!PGOOpt) {
+    OS << "nopgo" << '\0';
+    return;
+  }
+  IntrusiveRefCntPtr<vfs::FileSystem> FS =
+      PGOOpt->FS ? PGOOpt->FS : vfs::getRealFileSystem();
+  for (const std::string &Path :
+       {PGOOpt->ProfileFile, PGOOpt->CSProfileGenFile,
+        PGOOpt->ProfileRemappingFile, PGOOpt->MemoryProfile}) {
+    OS << Path << '\0';
+    if (Path.empty())
+      continue;
+    if (ErrorOr<vfs::Status> Status = FS->status(Path))
+      OS << Status->getSize() << '\0'
+         << Status->getLastModificationTime().time_since_epoch().count()
+         << '\0';
+  }
+  OS << int(PGOOpt->Action) << '\0' << int(PGOOpt->CSAction) << '\0'
+     << int(PGOOpt->ColdOptType) << '\0' << PGOOpt->DebugInfoForProfiling
+     << '\0' << PGOOpt->PseudoProbeForProfiling << '\0'
+     << PGOOpt->AtomicCounterUpdate << '\0';
+}
+
+static Expected<std::unique_ptr<ParallelFunctionPipeline>>
+buildParallelFunctionPipeline(StringRef PipelineText, const TargetMachine *TM,
+                              const PipelineTuningOptions &PTO,
+                              const std::optional<PGOOptions> &PGOOpt) {
+  std::unique_ptr<TargetMachine> ThreadTM;
+  std::string Configuration;
+  raw_string_ostream OS(Configuration);
+  if (TM) {
+    ThreadTM.reset(TM->getTarget().createTargetMachine(
+        TM->getTargetTriple().str(), TM->getTargetCPU(),
+        TM->getTargetFeatureString(), TM->Options, TM->getRelocationModel(),
+        TM->getCodeModel(), TM->getOptLevel()));
+    OS << TM->getTargetTriple().str() << '\0' << TM->getTargetCPU() << '\0'
+       << TM->getTargetFeatureString() << '\0' << TM->getRelocationModel()
+       << '\0' << TM->getCodeModel() << '\0' << int(TM->getOptLevel())
+       << '\0';
+    printTargetOptions(OS, TM->Options);
+  } else {
+    OS << "notarget" << '\0';
+  }
+  printTuningOptions(OS, PTO);
+  printPGOOptions(OS, PGOOpt);
+  auto P = std::make_unique<PassBuilderParallelFunctionPipeline>(
+      std::move(ThreadTM), PTO, PGOOpt);
+  P->Configuration = std::move(Configuration);
+  if (auto Err = P->PB.parsePassPipeline(P->FPM, PipelineText))
+    return std::move(Err);
+  return std::move(P);
+}
+
+Error PassBuilder::parseParallelFunctionPass(ModulePassManager &MPM,
+                                             ArrayRef<PipelineElement> Pipeline,
+                                             unsigned Threads) {
+  // Pass instrumentation and the parsing callbacks are not thread-safe, so
+  // each thread parses the pipeline again with a PassBuilder of its own. Do
+  // it once here, so that errors are reported to the caller.
+  std::string PipelineText;
+  raw_string_ostream OS(PipelineText);
+  printPipelineText(OS, Pipeline);
+  if (auto P = buildParallelFunctionPipeline(PipelineText, TM, PTO, PGOOpt);
+      !P)
+    return P.takeError();
+
+  MPM.addPass(ParallelModuleToFunctionPassAdaptor(
+      [PipelineText, TM = TM, PTO = PTO, PGOOpt = PGOOpt] {
+        return cantFail(
+            buildParallelFunctionPipeline(PipelineText, TM, PTO, PGOOpt));
+      },
+      Threads));
+  return Error::success();
+}
+
 // Primary pass pipeline description parsing routine for a \c ModulePassManager
 // FIXME: Should this routine accept a TargetMachine or require the caller to
 // pre-populate the analysis managers with target-specific stuff?
@@ -11,6 +11,8 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Memory.h"
 #include "llvm/Support/raw_ostream.h"
 
 namespace llvm {
@@ -28,6 +30,34 @@ void printBumpPtrAllocatorStats(unsigned NumSlabs, size_t BytesAllocated,
 
 } // namespace detail
 
+void *HugePageSlabAllocator::Allocate(size_t Size, size_t Alignment) {
+  if (Size < HugePageSize)
+    return allocate_buffer(Size, Alignment);
+
+  // Mappings are page aligned, which is plenty for any slab.
+  assert(Alignment <= 4096 && "Alignment is larger than a page");
+  std::error_code EC;
+  sys::MemoryBlock Block = sys::Memory::allocateMappedMemory(
+      alignTo(Size, HugePageSize), nullptr,
+      sys::Memory::MF_READ | sys::Memory::MF_WRITE |
+          sys::Memory::MF_HUGE_HINT,
+      EC);
+  if (EC)
+    report_bad_alloc_error("Huge page slab allocation failed");
+  return Block.base();
+}
+
+void HugePageSlabAllocator::Deallocate(const void *Ptr, size_t Size,
+                                       size_t Alignment) {
+  if (Size < HugePageSize) {
+    deallocate_buffer(const_cast<void *>(Ptr), Size, Alignment);
+    return;
+  }
+
+  sys::MemoryBlock Block(const_cast<void *>(Ptr), alignTo(Size, HugePageSize));
+  sys::Memory::releaseMappedMemory(Block);
+}
+
 void PrintRecyclerStats(size_t Size,
                         size_t Align,
                         size_t FreeListSize) {
@@ -0,0 +1,31 @@
+//===- BLAKE3.cpp - BLAKE3 C++ wrapper for LLVM ---------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the parts of the BLAKE3 wrapper that use llvm::parallel
+// to hash large inputs on multiple threads.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/BLAKE3.h"
+#include "llvm/Support/Parallel.h"
+
+using namespace llvm;
+
+static void forEachParallel(void *Context, size_t Count,
+                            void (*Fn)(void *Arg, size_t Index), void *Arg) {
+  parallelFor(0, Count, [&](size_t I) { Fn(Arg, I); });
+}
+
+void BLAKE3::updateParallel(ArrayRef<uint8_t> Data) {
+  if (Data.size() < MinParallelSize) {
+    update(Data);
+    return;
+  }
+  llvm_blake3_hasher_update_parallel(&Hasher, Data.data(), Data.size(),
+                                     forEachParallel, nullptr);
+}
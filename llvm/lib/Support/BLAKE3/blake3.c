@@ -459,8 +459,69 @@ INLINE void hasher_push_cv(blake3_hasher *self, uint8_t new_cv[BLAKE3_OUT_LEN],
   self->cv_stack_len += 1;
 }
 
-void llvm_blake3_hasher_update(blake3_hasher *self, const void *input,
-                          size_t input_len) {
+// Subtrees handed to a for_each callback are at least this long, so that each
+// task amortizes the cost of scheduling it, and there are at most
+// PARALLEL_MAX_TASKS of them per call so that their chaining values fit on the
+// stack.
+#define PARALLEL_MIN_TASK_LEN (128 * 1024)
+#define PARALLEL_MAX_TASKS 256
+
+typedef struct {
+  const uint8_t *input;
+  size_t task_len;
+  const uint32_t *key;
+  uint64_t chunk_counter;
+  uint8_t flags;
+  uint8_t *cv_pairs;
+} parallel_subtrees_t;
+
+static void compress_parallel_subtree(void *arg, size_t index) {
+  const parallel_subtrees_t *subtrees = (const parallel_subtrees_t *)arg;
+  uint64_t task_chunks = subtrees->task_len / BLAKE3_CHUNK_LEN;
+  compress_subtree_to_parent_node(
+      &subtrees->input[index * subtrees->task_len], subtrees->task_len,
+      subtrees->key, subtrees->chunk_counter + index * task_chunks,
+      subtrees->flags, &subtrees->cv_pairs[index * 2 * BLAKE3_OUT_LEN]);
+}
+
+// Compress a complete subtree of subtree_len bytes by splitting it into equal,
+// smaller subtrees and compressing those with for_each. Pushing their CV pairs
+// in order gives the same stack as compressing the whole subtree at once,
+// because each of them is itself a valid subtree at that position.
+static void hasher_push_subtree_parallel(blake3_hasher *self,
+                                         const uint8_t *input,
+                                         size_t subtree_len,
+                                         llvm_blake3_for_each_fn for_each,
+                                         void *context) {
+  size_t task_len = subtree_len / PARALLEL_MAX_TASKS;
+  if (task_len < PARALLEL_MIN_TASK_LEN) {
+    task_len = PARALLEL_MIN_TASK_LEN;
+  }
+  size_t num_tasks = subtree_len / task_len;
+  uint64_t task_chunks = task_len / BLAKE3_CHUNK_LEN;
+
+  uint8_t cv_pairs[PARALLEL_MAX_TASKS * 2 * BLAKE3_OUT_LEN];
+  parallel_subtrees_t subtrees = {input,
+                                  task_len,
+                                  self->key,
+                                  self->chunk.chunk_counter,
+                                  self->chunk.flags,
+                                  cv_pairs};
+  for_each(context, num_tasks, compress_parallel_subtree, &subtrees);
+
+  for (size_t i = 0; i < num_tasks; i++) {
+    uint64_t chunk_counter = self->chunk.chunk_counter + i * task_chunks;
+    uint8_t *cv_pair = &cv_pairs[i * 2 * BLAKE3_OUT_LEN];
+    hasher_push_cv(self, cv_pair, chunk_counter);
+    hasher_push_cv(self, &cv_pair[BLAKE3_OUT_LEN],
+                   chunk_counter + (task_chunks / 2));
+  }
+}
+
+static void hasher_update_base(blake3_hasher *self, const void *input,
+                               size_t input_len,
+                               llvm_blake3_for_each_fn for_each,
+                               void *context) {
   // Explicitly checking for zero avoids causing UB by passing a null pointer
   // to memcpy. This comes up in practice with things like:
   //   std::vector<uint8_t> v;
@@ -540,6 +601,11 @@ void llvm_blake3_hasher_update(blake3_hasher *self, const void *input,
       uint8_t cv[BLAKE3_OUT_LEN];
       output_chaining_value(&output, cv);
       hasher_push_cv(self, cv, chunk_state.chunk_counter);
+    } else if (for_each != NULL &&
+               subtree_len >= 2 * PARALLEL_MIN_TASK_LEN) {
+      // Large subtrees are split up further and compressed in parallel.
+      hasher_push_subtree_parallel(self, input_bytes, subtree_len, for_each,
+                                   context);
     } else {
       // This is the high-performance happy path, though getting here depends
       // on the caller giving us a long enough input.
@@ -568,6 +634,18 @@ void llvm_blake3_hasher_update(blake3_hasher *self, const void *input,
   }
 }
 
+void llvm_blake3_hasher_update(blake3_hasher *self, const void *input,
+                               size_t input_len) {
+  hasher_update_base(self, input, input_len, NULL, NULL);
+}
+
+void llvm_blake3_hasher_update_parallel(blake3_hasher *self, const void *input,
+                                        size_t input_len,
+                                        llvm_blake3_for_each_fn for_each,
+                                        void *context) {
+  hasher_update_base(self, input, input_len, for_each, context);
+}
+
 void llvm_blake3_hasher_finalize(const blake3_hasher *self, uint8_t *out,
                             size_t out_len) {
   llvm_blake3_hasher_finalize_seek(self, 0, out, out_len);
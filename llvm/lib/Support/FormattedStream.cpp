@@ -75,6 +75,14 @@ void formatted_raw_ostream::UpdatePosition(const char *Ptr, size_t Size) {
   // Now scan the rest of the buffer.
   unsigned NumBytes;
   for (const char *End = Ptr + Size; Ptr < End; Ptr += NumBytes) {
+    // Printable ASCII, which is most of the output, just takes one column.
+    unsigned char C = *Ptr;
+    if (C >= 0x20 && C < 0x7f) {
+      ++Column;
+      NumBytes = 1;
+      continue;
+    }
+
     NumBytes = getNumBytesForUTF8(*Ptr);
 
     // The buffer might end part way through a UTF-8 code unit sequence for a
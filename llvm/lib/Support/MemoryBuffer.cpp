@@ -238,6 +238,20 @@ public:
   }
 
   void dontNeedIfMmap() override { MFR.dontNeed(); }
+
+  void adviseIfMmap(MemoryBuffer::AccessPattern Pattern) override {
+    using MappedPattern = sys::fs::mapped_file_region::AccessPattern;
+    switch (Pattern) {
+    case MemoryBuffer::AccessPattern::Normal:
+      return MFR.advise(MappedPattern::Normal);
+    case MemoryBuffer::AccessPattern::Sequential:
+      return MFR.advise(MappedPattern::Sequential);
+    case MemoryBuffer::AccessPattern::Random:
+      return MFR.advise(MappedPattern::Random);
+    case MemoryBuffer::AccessPattern::WillNeed:
+      return MFR.advise(MappedPattern::WillNeed);
+    }
+  }
 };
 } // namespace
 
@@ -12,8 +12,11 @@
 #include "llvm/Support/Threading.h"
 
 #include <atomic>
+#include <condition_variable>
 #include <deque>
 #include <future>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include <vector>
 
@@ -45,12 +48,21 @@ public:
   static Executor *getDefaultExecutor();
 };
 
-/// An implementation of an Executor that runs closures on a thread pool
-///   in filo order.
+/// An implementation of an Executor that runs closures on a thread pool.
+///
+/// Each worker thread owns a queue. A worker runs the tasks of its own queue in
+/// filo order, and steals the oldest task of a randomly chosen other queue if
+/// its own queue is empty. Tasks added from outside the pool are distributed
+/// round robin over the queues, so that submitting threads and workers do not
+/// all contend on the same lock.
+///
+/// Sequential tasks are kept in a separate queue. They are run in the order
+/// they were added, and never concurrently with each other.
 class ThreadPoolExecutor : public Executor {
 public:
   explicit ThreadPoolExecutor(ThreadPoolStrategy S = hardware_concurrency()) {
     ThreadCount = S.compute_thread_count();
+    Queues = std::make_unique<WorkerQueue[]>(ThreadCount);
     // Spawn all but one of the threads in another thread as spawning threads
     // can take a while.
     Threads.reserve(ThreadCount);
@@ -99,55 +111,138 @@ public:
   };
 
   void add(std::function<void()> F, bool Sequential = false) override {
-    {
-      std::lock_guard<std::mutex> Lock(Mutex);
-      if (Sequential)
-        WorkQueueSequential.emplace_front(std::move(F));
-      else
-        WorkQueue.emplace_back(std::move(F));
+    if (Sequential) {
+      {
+        std::lock_guard<std::mutex> Lock(SequentialMutex);
+        SequentialQueue.push_back(std::move(F));
+        // A worker which is already running the sequential tasks also picks up
+        // the new one.
+        if (SequentialScheduled)
+          return;
+        SequentialScheduled = true;
+      }
+      // Publish the pending count before the task, so that a worker which
+      // finds the task never decrements the count below zero.
+      ++NumPending;
+      SequentialReady = true;
+    } else {
+      // A worker adds to its own queue, other threads pick one round robin.
+      unsigned Index = threadIndex < ThreadCount
+                           ? threadIndex
+                           : NextQueue.fetch_add(1, std::memory_order_relaxed) %
+                                 ThreadCount;
+      ++NumPending;
+      WorkerQueue &Queue = Queues[Index];
+      std::lock_guard<std::mutex> Lock(Queue.Mutex);
+      Queue.Tasks.push_back(std::move(F));
+    }
+
+    // Wake up a sleeping worker. Taking the lock ensures that the worker is
+    // either still before its check of NumPending, or already waiting.
+    if (NumSleeping > 0) {
+      { std::lock_guard<std::mutex> Lock(Mutex); }
+      Cond.notify_one();
     }
-    Cond.notify_one();
   }
 
   size_t getThreadCount() const override { return ThreadCount; }
 
 private:
-  bool hasSequentialTasks() const {
-    return !WorkQueueSequential.empty() && !SequentialQueueIsLocked;
+  struct alignas(64) WorkerQueue {
+    std::mutex Mutex;
+    std::deque<std::function<void()>> Tasks;
+  };
+
+  // Runs the sequential tasks until the queue is empty.
+  void runSequentialTasks() {
+    while (true) {
+      std::function<void()> Task;
+      {
+        std::lock_guard<std::mutex> Lock(SequentialMutex);
+        if (SequentialQueue.empty()) {
+          SequentialScheduled = false;
+          return;
+        }
+        Task = std::move(SequentialQueue.front());
+        SequentialQueue.pop_front();
+      }
+      Task();
+    }
   }
 
-  bool hasGeneralTasks() const { return !WorkQueue.empty(); }
+  // Takes the newest task from the own queue, or the oldest task from the
+  // queue of another worker.
+  bool getTask(unsigned ThreadID, uint32_t &Seed,
+               std::function<void()> &Task) {
+    {
+      WorkerQueue &Queue = Queues[ThreadID];
+      std::lock_guard<std::mutex> Lock(Queue.Mutex);
+      if (!Queue.Tasks.empty()) {
+        Task = std::move(Queue.Tasks.back());
+        Queue.Tasks.pop_back();
+        --NumPending;
+        return true;
+      }
+    }
+
+    // Start stealing at a random queue to spread the victims.
+    Seed ^= Seed << 13;
+    Seed ^= Seed >> 17;
+    Seed ^= Seed << 5;
+    unsigned Start = Seed % ThreadCount;
+    for (unsigned I = 0; I < ThreadCount; ++I) {
+      unsigned Victim = (Start + I) % ThreadCount;
+      if (Victim == ThreadID)
+        continue;
+      WorkerQueue &Queue = Queues[Victim];
+      std::lock_guard<std::mutex> Lock(Queue.Mutex);
+      if (!Queue.Tasks.empty()) {
+        Task = std::move(Queue.Tasks.front());
+        Queue.Tasks.pop_front();
+        --NumPending;
+        return true;
+      }
+    }
+    return false;
+  }
 
   void work(ThreadPoolStrategy S, unsigned ThreadID) {
     threadIndex = ThreadID;
     S.apply_thread_strategy(ThreadID);
-    while (true) {
-      std::unique_lock<std::mutex> Lock(Mutex);
-      Cond.wait(Lock, [&] {
-        return Stop || hasGeneralTasks() || hasSequentialTasks();
-      });
-      if (Stop)
-        break;
-      bool Sequential = hasSequentialTasks();
-      if (Sequential)
-        SequentialQueueIsLocked = true;
-      else
-        assert(hasGeneralTasks());
+    uint32_t Seed = ThreadID * 0x9e3779b9U + 1;
+    while (!Stop) {
+      // Sequential tasks take priority.
+      if (SequentialReady && SequentialReady.exchange(false)) {
+        --NumPending;
+        runSequentialTasks();
+        continue;
+      }
 
-      auto &Queue = Sequential ? WorkQueueSequential : WorkQueue;
-      auto Task = std::move(Queue.back());
-      Queue.pop_back();
-      Lock.unlock();
-      Task();
-      if (Sequential)
-        SequentialQueueIsLocked = false;
+      std::function<void()> Task;
+      if (getTask(ThreadID, Seed, Task)) {
+        Task();
+        continue;
+      }
+
+      // No work was found, so wait for new tasks.
+      std::unique_lock<std::mutex> Lock(Mutex);
+      ++NumSleeping;
+      Cond.wait(Lock, [&] { return Stop || NumPending > 0; });
+      --NumSleeping;
     }
   }
 
   std::atomic<bool> Stop{false};
-  std::atomic<bool> SequentialQueueIsLocked{false};
-  std::deque<std::function<void()>> WorkQueue;
-  std::deque<std::function<void()>> WorkQueueSequential;
+  // Number of tasks which are queued but not yet taken by a worker. The
+  // sequential queue counts as one task while it is waiting for a worker.
+  std::atomic<size_t> NumPending{0};
+  std::atomic<unsigned> NumSleeping{0};
+  std::atomic<unsigned> NextQueue{0};
+  std::unique_ptr<WorkerQueue[]> Queues;
+  std::atomic<bool> SequentialReady{false};
+  bool SequentialScheduled = false;
+  std::deque<std::function<void()>> SequentialQueue;
+  std::mutex SequentialMutex;
   std::mutex Mutex;
   std::condition_variable Cond;
   std::promise<void> ThreadsCreated;
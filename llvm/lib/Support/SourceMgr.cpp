@@ -14,6 +14,7 @@
 
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/GroupProbing.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
@@ -71,15 +72,56 @@ SourceMgr::OpenIncludeFile(const std::string &Filename,
 }
 
 unsigned SourceMgr::FindBufferContainingLoc(SMLoc Loc) const {
-  for (unsigned i = 0, e = Buffers.size(); i != e; ++i)
-    if (Loc.getPointer() >= Buffers[i].Buffer->getBufferStart() &&
-        // Use <= here so that a pointer to the null at the end of the buffer
-        // is included as part of the buffer.
-        Loc.getPointer() <= Buffers[i].Buffer->getBufferEnd())
-      return i + 1;
+  // Locations tend to come in runs from the same buffer, so try the buffer of
+  // the last lookup first. It is only remembered if no earlier buffer overlaps
+  // it, so that this finds the same buffer as the search below.
+  const char *Ptr = Loc.getPointer();
+  if (isValidBufferID(LastBufferID)) {
+    const MemoryBuffer *Buffer = Buffers[LastBufferID - 1].Buffer.get();
+    if (Ptr >= Buffer->getBufferStart() && Ptr <= Buffer->getBufferEnd())
+      return LastBufferID;
+  }
+
+  for (unsigned i = 0, e = Buffers.size(); i != e; ++i) {
+    const MemoryBuffer *Buffer = Buffers[i].Buffer.get();
+    // Use <= here so that a pointer to the null at the end of the buffer
+    // is included as part of the buffer.
+    if (Ptr < Buffer->getBufferStart() || Ptr > Buffer->getBufferEnd())
+      continue;
+
+    // A pointer to the start of a buffer may also be the end of an earlier
+    // buffer, and buffers may share memory, e.g. the same file included twice
+    // as a memory buffer. Locations in such a buffer always take the search.
+    bool OverlapsEarlier =
+        any_of(ArrayRef(Buffers).take_front(i), [&](const SrcBuffer &B) {
+          return B.Buffer->getBufferStart() <= Buffer->getBufferEnd() &&
+                 Buffer->getBufferStart() <= B.Buffer->getBufferEnd();
+        });
+    LastBufferID = OverlapsEarlier ? 0 : i + 1;
+    return i + 1;
+  }
   return 0;
 }
 
+/// Appends the offsets of the '\n' characters in \p S to \p Offsets. The
+/// buffer is compared with '\n' a group of bytes at a time, which is much
+/// faster than a byte loop for typical line lengths.
+template <typename T>
+static void findNewlines(StringRef S, std::vector<T> &Offsets) {
+  using Group = detail::ProbeGroup;
+  const char *Begin = S.begin();
+  const char *P = Begin;
+  const char *End = S.end();
+  for (; End - P >= Group::Width; P += Group::Width) {
+    Group G(reinterpret_cast<const uint8_t *>(P));
+    for (uint64_t Mask = G.match('\n'); Mask; Mask &= Mask - 1)
+      Offsets.push_back(static_cast<T>(P - Begin + Group::lowestIndex(Mask)));
+  }
+  for (; P != End; ++P)
+    if (*P == '\n')
+      Offsets.push_back(static_cast<T>(P - Begin));
+}
+
 template <typename T>
 static std::vector<T> &GetOrCreateOffsetCache(void *&OffsetCache,
                                               MemoryBuffer *Buffer) {
@@ -90,11 +132,7 @@ static std::vector<T> &GetOrCreateOffsetCache(void *&OffsetCache,
   auto *Offsets = new std::vector<T>();
   size_t Sz = Buffer->getBufferSize();
   assert(Sz <= std::numeric_limits<T>::max());
-  StringRef S = Buffer->getBuffer();
-  for (size_t N = 0; N < Sz; ++N) {
-    if (S[N] == '\n')
-      Offsets->push_back(static_cast<T>(N));
-  }
+  findNewlines(Buffer->getBuffer(), *Offsets);
 
   OffsetCache = Offsets;
   return *Offsets;
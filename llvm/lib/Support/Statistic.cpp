@@ -36,6 +36,7 @@
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cstring>
+#include <mutex>
 using namespace llvm;
 
 /// -stats - Command line option to cause transformations to emit stats about
@@ -46,12 +47,20 @@ static bool StatsAsJSON;
 static bool Enabled;
 static bool PrintOnExit;
 
+std::atomic<bool> llvm::detail::StatisticsEnabled;
+
+static void updateStatisticsEnabled() {
+  detail::StatisticsEnabled.store(EnableStats || Enabled,
+                                  std::memory_order_relaxed);
+}
+
 void llvm::initStatisticOptions() {
   static cl::opt<bool, true> registerEnableStats{
       "stats",
       cl::desc(
           "Enable statistics output from program (available with Asserts)"),
-      cl::location(EnableStats), cl::Hidden};
+      cl::location(EnableStats), cl::Hidden,
+      cl::callback([](const bool &) { updateStatisticsEnabled(); })};
   static cl::opt<bool, true> registerStatsAsJson{
       "stats-json", cl::desc("Display statistics as json data"),
       cl::location(StatsAsJSON), cl::Hidden};
@@ -93,6 +102,128 @@ public:
 static ManagedStatic<StatisticInfo> StatInfo;
 static ManagedStatic<sys::SmartMutex<true> > StatLock;
 
+namespace {
+/// The shards of all threads that have updated a statistic, and the
+/// statistics by id. This is never destroyed, as threads may exit after the
+/// static destructors have run.
+struct StatisticShards {
+  std::mutex Lock;
+  std::vector<detail::StatisticShard *> Shards;
+  // Id 0 means that no id has been assigned yet.
+  std::vector<TrackingStatistic *> ById = {nullptr};
+};
+
+/// Adds the counters of the shard of the current thread to the statistics
+/// when the thread exits.
+struct StatisticShardOwner {
+  detail::StatisticShard *Shard = nullptr;
+  ~StatisticShardOwner();
+};
+} // end anonymous namespace
+
+static StatisticShards &getStatisticShards() {
+  static StatisticShards *Shards = new StatisticShards();
+  return *Shards;
+}
+
+LLVM_THREAD_LOCAL detail::StatisticShard *detail::CurrentStatisticShard =
+    nullptr;
+static thread_local StatisticShardOwner ShardOwner;
+// Set once the shard of the current thread has been released, statistics
+// updated after that use their shared value.
+static LLVM_THREAD_LOCAL bool ShardReleased = false;
+
+#ifdef _WIN32
+std::atomic<uint64_t> *detail::getStatisticCounter(unsigned Id) {
+  if (CurrentStatisticShard && Id && Id < StatisticShard::MaxStatistics)
+    if (std::atomic<uint64_t> *Block =
+            CurrentStatisticShard->Blocks[Id >> StatisticShard::BlockBits]
+                .load(std::memory_order_relaxed))
+      return &Block[Id & (StatisticShard::BlockSize - 1)];
+  return getStatisticCounterSlow(Id);
+}
+#endif
+
+std::atomic<uint64_t> *detail::getStatisticCounterSlow(unsigned Id) {
+  if (!Id || Id >= StatisticShard::MaxStatistics || ShardReleased)
+    return nullptr;
+
+  StatisticShard *Shard = CurrentStatisticShard;
+  if (!Shard) {
+    Shard = new StatisticShard();
+    StatisticShards &Shards = getStatisticShards();
+    {
+      std::lock_guard<std::mutex> Guard(Shards.Lock);
+      Shards.Shards.push_back(Shard);
+    }
+    ShardOwner.Shard = Shard;
+    CurrentStatisticShard = Shard;
+  }
+
+  auto &Block = Shard->Blocks[Id >> StatisticShard::BlockBits];
+  std::atomic<uint64_t> *Counters = Block.load(std::memory_order_relaxed);
+  if (!Counters) {
+    Counters = new std::atomic<uint64_t>[StatisticShard::BlockSize]();
+    // Readers on other threads load the block with acquire.
+    Block.store(Counters, std::memory_order_release);
+  }
+  return &Counters[Id & (StatisticShard::BlockSize - 1)];
+}
+
+StatisticShardOwner::~StatisticShardOwner() {
+  ShardReleased = true;
+  detail::CurrentStatisticShard = nullptr;
+  if (!Shard)
+    return;
+
+  StatisticShards &Shards = getStatisticShards();
+  std::lock_guard<std::mutex> Guard(Shards.Lock);
+  llvm::erase(Shards.Shards, Shard);
+  for (unsigned B = 0; B != detail::StatisticShard::NumBlocks; ++B) {
+    std::atomic<uint64_t> *Counters =
+        Shard->Blocks[B].load(std::memory_order_relaxed);
+    if (!Counters)
+      continue;
+    for (unsigned I = 0; I != detail::StatisticShard::BlockSize; ++I) {
+      unsigned Id = B * detail::StatisticShard::BlockSize + I;
+      if (uint64_t V = Counters[I].load(std::memory_order_relaxed))
+        Shards.ById[Id]->Value.fetch_add(V, std::memory_order_relaxed);
+    }
+    delete[] Counters;
+  }
+  delete Shard;
+}
+
+/// Returns the sum of the counters of all threads for the statistic with id
+/// \p Id. The lock of \p Shards must be held.
+static uint64_t sumCounters(const StatisticShards &Shards, unsigned Id) {
+  if (!Id || Id >= detail::StatisticShard::MaxStatistics)
+    return 0;
+  uint64_t Sum = 0;
+  for (const detail::StatisticShard *Shard : Shards.Shards)
+    if (const std::atomic<uint64_t> *Counters =
+            Shard->Blocks[Id >> detail::StatisticShard::BlockBits].load(
+                std::memory_order_acquire))
+      Sum += Counters[Id & (detail::StatisticShard::BlockSize - 1)].load(
+          std::memory_order_relaxed);
+  return Sum;
+}
+
+uint64_t TrackingStatistic::getValue() const {
+  StatisticShards &Shards = getStatisticShards();
+  std::lock_guard<std::mutex> Guard(Shards.Lock);
+  return Value.load(std::memory_order_relaxed) +
+         sumCounters(Shards, Id.load(std::memory_order_relaxed));
+}
+
+void TrackingStatistic::setValue(uint64_t Val) {
+  // Updates by other threads may be lost, as with concurrent stores.
+  StatisticShards &Shards = getStatisticShards();
+  std::lock_guard<std::mutex> Guard(Shards.Lock);
+  Value.store(Val - sumCounters(Shards, Id.load(std::memory_order_relaxed)),
+              std::memory_order_relaxed);
+}
+
 /// RegisterStatistic - The first time a statistic is bumped, this method is
 /// called.
 void TrackingStatistic::RegisterStatistic() {
@@ -114,6 +245,14 @@ void TrackingStatistic::RegisterStatistic() {
     if (EnableStats || Enabled)
       SI.addStatistic(this);
 
+    // Give the statistic its counters in the shards the first time.
+    if (!Id.load(std::memory_order_relaxed)) {
+      StatisticShards &Shards = getStatisticShards();
+      std::lock_guard<std::mutex> Guard(Shards.Lock);
+      Id.store(Shards.ById.size(), std::memory_order_relaxed);
+      Shards.ById.push_back(this);
+    }
+
     // Remember we have been registered.
     Initialized.store(true, std::memory_order_release);
   }
@@ -134,6 +273,7 @@ StatisticInfo::~StatisticInfo() {
 void llvm::EnableStatistics(bool DoPrintOnExit) {
   Enabled = true;
   PrintOnExit = DoPrintOnExit;
+  updateStatisticsEnabled();
 }
 
 bool llvm::AreStatisticsEnabled() { return Enabled || EnableStats; }
@@ -162,7 +302,7 @@ void StatisticInfo::reset() {
     // Value updates to a statistic that complete before this statement in the
     // iteration for that statistic will be lost as intended.
     Stat->Initialized = false;
-    Stat->Value = 0;
+    Stat->setValue(0);
   }
 
   // Clear the registration list and release the lock once we're done. Any
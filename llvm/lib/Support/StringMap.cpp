@@ -11,9 +11,11 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/GroupProbing.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/ReverseIteration.h"
 #include "llvm/Support/xxhash.h"
+#include <cstring>
 
 using namespace llvm;
 
@@ -28,14 +30,22 @@ static inline unsigned getMinBucketToReserveForEntries(unsigned NumEntries) {
   return NextPowerOf2(NumEntries * 4 / 3 + 1);
 }
 
-static inline StringMapEntryBase **createTable(unsigned NewNumBuckets) {
-  auto **Table = static_cast<StringMapEntryBase **>(safe_calloc(
-      NewNumBuckets + 1, sizeof(StringMapEntryBase **) + sizeof(unsigned)));
+using detail::CtrlDeleted;
+using detail::CtrlEmpty;
+using detail::setCtrl;
+using Group = detail::ProbeGroup;
+using ProbeSeq = detail::GroupProbeSeq;
 
-  // Allocate one extra bucket, set it to look filled so the iterators stop at
-  // end.
-  Table[NewNumBuckets] = (StringMapEntryBase *)2;
-  return Table;
+static constexpr unsigned GroupWidth = Group::Width;
+
+/// The control byte of a full bucket holds the top seven bits of its hash.
+static inline uint8_t getH2(uint32_t FullHashValue) {
+  return FullHashValue >> 25;
+}
+
+static inline size_t getTableSize(unsigned NumBuckets) {
+  return (NumBuckets + 1) * sizeof(StringMapEntryBase *) +
+         NumBuckets * sizeof(unsigned) + NumBuckets + GroupWidth;
 }
 
 static inline unsigned *getHashTable(StringMapEntryBase **TheTable,
@@ -43,6 +53,27 @@ static inline unsigned *getHashTable(StringMapEntryBase **TheTable,
   return reinterpret_cast<unsigned *>(TheTable + NumBuckets + 1);
 }
 
+/// The control bytes follow the hash values. The first GroupWidth control
+/// bytes are mirrored after the end, so that a group can be loaded starting at
+/// any bucket without wrapping around.
+static inline uint8_t *getCtrlTable(StringMapEntryBase **TheTable,
+                                    unsigned NumBuckets) {
+  return reinterpret_cast<uint8_t *>(getHashTable(TheTable, NumBuckets) +
+                                     NumBuckets);
+}
+
+static inline StringMapEntryBase **createTable(unsigned NewNumBuckets) {
+  auto **Table = static_cast<StringMapEntryBase **>(
+      safe_calloc(getTableSize(NewNumBuckets), 1));
+
+  // Allocate one extra bucket, set it to look filled so the iterators stop at
+  // end.
+  Table[NewNumBuckets] = (StringMapEntryBase *)2;
+  std::memset(getCtrlTable(Table, NewNumBuckets), CtrlEmpty,
+              NewNumBuckets + GroupWidth);
+  return Table;
+}
+
 uint32_t StringMapImpl::hash(StringRef Key) { return xxh3_64bits(Key); }
 
 StringMapImpl::StringMapImpl(unsigned InitSize, unsigned itemSize) {
@@ -78,6 +109,18 @@ void StringMapImpl::init(unsigned InitSize) {
   NumBuckets = NewNumBuckets;
 }
 
+void StringMapImpl::copyMetadata(const StringMapImpl &RHS) {
+  assert(NumBuckets == RHS.NumBuckets && "Tables have different sizes");
+  std::memcpy(getHashTable(TheTable, NumBuckets),
+              getHashTable(RHS.TheTable, NumBuckets),
+              NumBuckets * sizeof(unsigned) + NumBuckets + GroupWidth);
+}
+
+void StringMapImpl::clearMetadata() {
+  std::memset(getCtrlTable(TheTable, NumBuckets), CtrlEmpty,
+              NumBuckets + GroupWidth);
+}
+
 /// LookupBucketFor - Look up the bucket that the specified string should end
 /// up in.  If it already exists as a key in the map, the Item pointer for the
 /// specified bucket will be non-null.  Otherwise, it will be null.  In either
@@ -93,35 +136,22 @@ unsigned StringMapImpl::LookupBucketFor(StringRef Name,
     init(16);
   if (shouldReverseIterate())
     FullHashValue = ~FullHashValue;
-  unsigned BucketNo = FullHashValue & (NumBuckets - 1);
   unsigned *HashTable = getHashTable(TheTable, NumBuckets);
+  uint8_t *Ctrl = getCtrlTable(TheTable, NumBuckets);
+  uint8_t H2 = getH2(FullHashValue);
 
-  unsigned ProbeAmt = 1;
-  int FirstTombstone = -1;
+  ProbeSeq Seq(FullHashValue, NumBuckets);
+  int FirstAvailable = -1;
   while (true) {
-    StringMapEntryBase *BucketItem = TheTable[BucketNo];
-    // If we found an empty bucket, this key isn't in the table yet, return it.
-    if (LLVM_LIKELY(!BucketItem)) {
-      // If we found a tombstone, we want to reuse the tombstone instead of an
-      // empty bucket.  This reduces probing.
-      if (FirstTombstone != -1) {
-        HashTable[FirstTombstone] = FullHashValue;
-        return FirstTombstone;
-      }
-
-      HashTable[BucketNo] = FullHashValue;
-      return BucketNo;
-    }
-
-    if (BucketItem == getTombstoneVal()) {
-      // Skip over tombstones.  However, remember the first one we see.
-      if (FirstTombstone == -1)
-        FirstTombstone = BucketNo;
-    } else if (LLVM_LIKELY(HashTable[BucketNo] == FullHashValue)) {
-      // If the full hash value matches, check deeply for a match.  The common
-      // case here is that we are only looking at the buckets (for item info
-      // being non-null and for the full hash value) not at the items.  This
-      // is important for cache locality.
+    Group G(Ctrl + Seq.offset());
+    for (uint64_t Mask = G.match(H2); Mask; Mask &= Mask - 1) {
+      unsigned BucketNo = Seq.bucket(Group::lowestIndex(Mask));
+      StringMapEntryBase *BucketItem = TheTable[BucketNo];
+      // The control byte only holds part of the hash, so check the full hash
+      // value before looking at the key. Buckets handed out by an earlier
+      // lookup may not have been filled in yet.
+      if (!BucketItem || HashTable[BucketNo] != FullHashValue)
+        continue;
 
       // Do the comparison like this because Name isn't necessarily
       // null-terminated!
@@ -132,13 +162,21 @@ unsigned StringMapImpl::LookupBucketFor(StringRef Name,
       }
     }
 
-    // Okay, we didn't find the item.  Probe to the next bucket.
-    BucketNo = (BucketNo + ProbeAmt) & (NumBuckets - 1);
+    // Remember the first empty or deleted bucket, reusing tombstones reduces
+    // probing.
+    if (FirstAvailable == -1)
+      if (uint64_t Mask = G.matchAvailable())
+        FirstAvailable = Seq.bucket(Group::lowestIndex(Mask));
 
-    // Use quadratic probing, it has fewer clumping artifacts than linear
-    // probing and has good cache behavior in the common case.
-    ++ProbeAmt;
+    // An empty bucket ends the probe sequence, the key isn't in the table.
+    if (LLVM_LIKELY(G.matchEmpty()))
+      break;
+    Seq.next();
   }
+
+  HashTable[FirstAvailable] = FullHashValue;
+  setCtrl(Ctrl, NumBuckets, FirstAvailable, H2);
+  return FirstAvailable;
 }
 
 /// FindKey - Look up the bucket that contains the specified key. If it exists
@@ -152,23 +190,18 @@ int StringMapImpl::FindKey(StringRef Key, uint32_t FullHashValue) const {
 #endif
   if (shouldReverseIterate())
     FullHashValue = ~FullHashValue;
-  unsigned BucketNo = FullHashValue & (NumBuckets - 1);
   unsigned *HashTable = getHashTable(TheTable, NumBuckets);
+  const uint8_t *Ctrl = getCtrlTable(TheTable, NumBuckets);
+  uint8_t H2 = getH2(FullHashValue);
 
-  unsigned ProbeAmt = 1;
+  ProbeSeq Seq(FullHashValue, NumBuckets);
   while (true) {
-    StringMapEntryBase *BucketItem = TheTable[BucketNo];
-    // If we found an empty bucket, this key isn't in the table yet, return.
-    if (LLVM_LIKELY(!BucketItem))
-      return -1;
-
-    if (BucketItem == getTombstoneVal()) {
-      // Ignore tombstones.
-    } else if (LLVM_LIKELY(HashTable[BucketNo] == FullHashValue)) {
-      // If the full hash value matches, check deeply for a match.  The common
-      // case here is that we are only looking at the buckets (for item info
-      // being non-null and for the full hash value) not at the items.  This
-      // is important for cache locality.
+    Group G(Ctrl + Seq.offset());
+    for (uint64_t Mask = G.match(H2); Mask; Mask &= Mask - 1) {
+      unsigned BucketNo = Seq.bucket(Group::lowestIndex(Mask));
+      StringMapEntryBase *BucketItem = TheTable[BucketNo];
+      if (!BucketItem || HashTable[BucketNo] != FullHashValue)
+        continue;
 
       // Do the comparison like this because NameStart isn't necessarily
       // null-terminated!
@@ -179,12 +212,10 @@ int StringMapImpl::FindKey(StringRef Key, uint32_t FullHashValue) const {
       }
     }
 
-    // Okay, we didn't find the item.  Probe to the next bucket.
-    BucketNo = (BucketNo + ProbeAmt) & (NumBuckets - 1);
-
-    // Use quadratic probing, it has fewer clumping artifacts than linear
-    // probing and has good cache behavior in the common case.
-    ++ProbeAmt;
+    // If we found an empty bucket, this key isn't in the table.
+    if (LLVM_LIKELY(G.matchEmpty()))
+      return -1;
+    Seq.next();
   }
 }
 
@@ -206,6 +237,7 @@ StringMapEntryBase *StringMapImpl::RemoveKey(StringRef Key) {
 
   StringMapEntryBase *Result = TheTable[Bucket];
   TheTable[Bucket] = getTombstoneVal();
+  setCtrl(getCtrlTable(TheTable, NumBuckets), NumBuckets, Bucket, CtrlDeleted);
   --NumItems;
   ++NumTombstones;
   assert(NumItems + NumTombstones <= NumBuckets);
@@ -232,6 +264,7 @@ unsigned StringMapImpl::RehashTable(unsigned BucketNo) {
   unsigned NewBucketNo = BucketNo;
   auto **NewTableArray = createTable(NewSize);
   unsigned *NewHashArray = getHashTable(NewTableArray, NewSize);
+  uint8_t *NewCtrl = getCtrlTable(NewTableArray, NewSize);
   unsigned *HashTable = getHashTable(TheTable, NumBuckets);
 
   // Rehash all the items into their new buckets.  Luckily :) we already have
@@ -239,19 +272,18 @@ unsigned StringMapImpl::RehashTable(unsigned BucketNo) {
   for (unsigned I = 0, E = NumBuckets; I != E; ++I) {
     StringMapEntryBase *Bucket = TheTable[I];
     if (Bucket && Bucket != getTombstoneVal()) {
-      // If the bucket is not available, probe for a spot.
+      // The new table has no tombstones, so take the first empty bucket.
       unsigned FullHash = HashTable[I];
-      unsigned NewBucket = FullHash & (NewSize - 1);
-      if (NewTableArray[NewBucket]) {
-        unsigned ProbeSize = 1;
-        do {
-          NewBucket = (NewBucket + ProbeSize++) & (NewSize - 1);
-        } while (NewTableArray[NewBucket]);
-      }
+      ProbeSeq Seq(FullHash, NewSize);
+      uint64_t Mask;
+      while (!(Mask = Group(NewCtrl + Seq.offset()).matchEmpty()))
+        Seq.next();
+      unsigned NewBucket = Seq.bucket(Group::lowestIndex(Mask));
 
       // Finally found a slot.  Fill it in.
       NewTableArray[NewBucket] = Bucket;
       NewHashArray[NewBucket] = FullHash;
+      setCtrl(NewCtrl, NewSize, NewBucket, getH2(FullHash));
       if (I == BucketNo)
         NewBucketNo = NewBucket;
     }
@@ -14,13 +14,17 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/STLFunctionalExtras.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/BinaryStreamReader.h"
 #include "llvm/Support/JSON.h"
+#include "llvm/Support/LEB128.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Process.h"
 #include "llvm/Support/Threading.h"
 #include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cinttypes>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -63,95 +67,184 @@ using ClockType = steady_clock;
 using TimePointType = time_point<ClockType>;
 using DurationType = duration<ClockType::rep, ClockType::period>;
 using CountAndDurationType = std::pair<size_t, DurationType>;
-using NameAndCountAndDurationType =
-    std::pair<std::string, CountAndDurationType>;
 
-} // anonymous namespace
+// Calculate timings for FlameGraph. Cast time points to microsecond precision
+// rather than casting duration. This avoids truncation issues causing inner
+// scopes overruning outer scopes.
+int64_t getFlameGraphUs(TimePointType Point, TimePointType StartTime) {
+  return (time_point_cast<microseconds>(Point) -
+          time_point_cast<microseconds>(StartTime))
+      .count();
+}
 
-/// Represents an open or completed time section entry to be captured.
-struct llvm::TimeTraceProfilerEntry {
-  const TimePointType Start;
+/// A completed time section.
+struct CompletedEntry {
+  TimePointType Start;
   TimePointType End;
-  const std::string Name;
-  const std::string Detail;
-  const bool AsyncEvent = false;
-  TimeTraceProfilerEntry(TimePointType &&S, TimePointType &&E, std::string &&N,
-                         std::string &&Dt, bool Ae)
-      : Start(std::move(S)), End(std::move(E)), Name(std::move(N)),
-        Detail(std::move(Dt)), AsyncEvent(Ae) {}
-
-  // Calculate timings for FlameGraph. Cast time points to microsecond precision
-  // rather than casting duration. This avoids truncation issues causing inner
-  // scopes overruning outer scopes.
-  ClockType::rep getFlameGraphStartUs(TimePointType StartTime) const {
-    return (time_point_cast<microseconds>(Start) -
-            time_point_cast<microseconds>(StartTime))
-        .count();
-  }
+  uint32_t NameId;
+  bool AsyncEvent;
+  std::string Detail;
+};
 
-  ClockType::rep getFlameGraphDurUs() const {
-    return (time_point_cast<microseconds>(End) -
-            time_point_cast<microseconds>(Start))
-        .count();
-  }
+/// The contents of a trace, independent of whether they come from the
+/// profilers of this process or from a binary trace file. Strings refer to
+/// the profilers or to the file.
+struct TraceEvent {
+  int64_t StartUs;
+  int64_t DurUs;
+  StringRef Name;
+  StringRef Detail;
+  bool AsyncEvent;
+};
+
+struct TraceThread {
+  uint64_t Tid;
+  StringRef ThreadName;
+  uint64_t DroppedEvents;
+  std::vector<TraceEvent> Events;
+};
+
+struct TraceTotal {
+  StringRef Name;
+  uint64_t Count;
+  int64_t DurNs;
+};
+
+struct Trace {
+  int64_t Pid;
+  StringRef ProcName;
+  int64_t BeginningOfTimeUs;
+  /// The thread that wrote the trace comes first.
+  std::vector<TraceThread> Threads;
+  /// Totals by section name, combined over all threads.
+  std::vector<TraceTotal> Totals;
+};
+
+} // anonymous namespace
+
+/// Represents an open time section. Entries are recycled once they have been
+/// ended, so that beginning a section does not allocate memory.
+struct llvm::TimeTraceProfilerEntry {
+  TimePointType Start;
+  uint32_t NameId;
+  bool AsyncEvent;
+  std::string Detail;
 };
 
 struct llvm::TimeTraceProfiler {
-  TimeTraceProfiler(unsigned TimeTraceGranularity = 0, StringRef ProcName = "")
+  TimeTraceProfiler(const TimeTraceProfilerOptions &Options,
+                    StringRef ProcName = "")
       : BeginningOfTime(system_clock::now()), StartTime(ClockType::now()),
         ProcName(ProcName), Pid(sys::Process::getProcessId()),
-        Tid(llvm::get_threadid()), TimeTraceGranularity(TimeTraceGranularity) {
+        Tid(llvm::get_threadid()), TimeTraceGranularity(Options.Granularity),
+        RingBufferSize(Options.RingBufferSize),
+        SamplingPeriod(std::max(Options.SamplingPeriod, 1u)) {
     llvm::get_thread_name(ThreadName);
+    if (RingBufferSize)
+      Entries.reserve(RingBufferSize);
   }
 
-  TimeTraceProfilerEntry *begin(std::string Name,
+  TimeTraceProfilerEntry *begin(StringRef Name,
                                 llvm::function_ref<std::string()> Detail,
                                 bool AsyncEvent = false) {
-    Stack.emplace_back(std::make_unique<TimeTraceProfilerEntry>(
-        ClockType::now(), TimePointType(), std::move(Name), Detail(),
-        AsyncEvent));
-    return Stack.back().get();
+    TimeTraceProfilerEntry *E;
+    if (FreeEntries.empty())
+      E = new (EntryAllocator.Allocate()) TimeTraceProfilerEntry();
+    else
+      E = FreeEntries.pop_back_val();
+    E->NameId = internName(Name);
+    E->AsyncEvent = AsyncEvent;
+    E->Detail = Detail();
+    Stack.push_back(E);
+    // Read the clock last so that the bookkeeping above is not attributed to
+    // the section.
+    E->Start = ClockType::now();
+    return E;
   }
 
   void end() {
     assert(!Stack.empty() && "Must call begin() first");
-    end(*Stack.back().get());
+    end(*Stack.back());
   }
 
   void end(TimeTraceProfilerEntry &E) {
+    TimePointType End = ClockType::now();
     assert(!Stack.empty() && "Must call begin() first");
-    E.End = ClockType::now();
 
     // Calculate duration at full precision for overall counts.
-    DurationType Duration = E.End - E.Start;
+    DurationType Duration = End - E.Start;
 
-    // Only include sections longer or equal to TimeTraceGranularity msec.
-    if (duration_cast<microseconds>(Duration).count() >= TimeTraceGranularity)
-      Entries.emplace_back(E);
+    // Only include sections longer or equal to TimeTraceGranularity msec, and
+    // in sampling mode only one in every SamplingPeriod of those.
+    if (duration_cast<microseconds>(Duration).count() >= TimeTraceGranularity &&
+        (SamplingPeriod == 1 || NumSampled++ % SamplingPeriod == 0))
+      record(E, End);
 
     // Track total time taken by each "name", but only the topmost levels of
     // them; e.g. if there's a template instantiation that instantiates other
     // templates from within, we only want to add the topmost one. "topmost"
     // happens to be the ones that don't have any currently open entries above
     // itself.
-    if (llvm::none_of(llvm::drop_begin(llvm::reverse(Stack)),
-                      [&](const std::unique_ptr<TimeTraceProfilerEntry> &Val) {
-                        return Val->Name == E.Name;
-                      })) {
-      auto &CountAndTotal = CountAndTotalPerName[E.Name];
+    if (llvm::none_of(Stack, [&](const TimeTraceProfilerEntry *Val) {
+          return Val != &E && Val->NameId == E.NameId;
+        })) {
+      auto &CountAndTotal = CountAndTotalPerName[E.NameId];
       CountAndTotal.first++;
       CountAndTotal.second += Duration;
-    };
+    }
+
+    if (Stack.back() == &E)
+      Stack.pop_back();
+    else
+      Stack.erase(llvm::find(Stack, &E));
+    E.Detail.clear();
+    FreeEntries.push_back(&E);
+  }
+
+  /// Adds the completed section \p E to the trace. In ring buffer mode the
+  /// oldest completed section is dropped once the buffer is full.
+  void record(TimeTraceProfilerEntry &E, TimePointType End) {
+    CompletedEntry Completed{E.Start, End, E.NameId, E.AsyncEvent,
+                             std::move(E.Detail)};
+    if (!RingBufferSize || Entries.size() < RingBufferSize) {
+      Entries.push_back(std::move(Completed));
+      return;
+    }
+    Entries[NextEntry] = std::move(Completed);
+    NextEntry = (NextEntry + 1) % RingBufferSize;
+    ++DroppedEntries;
+  }
 
-    llvm::erase_if(Stack,
-                   [&](const std::unique_ptr<TimeTraceProfilerEntry> &Val) {
-                     return Val.get() == &E;
-                   });
+  uint32_t internName(StringRef Name) {
+    auto [It, Inserted] = NameIds.try_emplace(Name, Names.size());
+    if (Inserted) {
+      Names.push_back(It->getKey());
+      CountAndTotalPerName.emplace_back();
+    }
+    return It->second;
   }
 
-  // Write events from this TimeTraceProfilerInstance and
-  // ThreadTimeTraceProfilerInstances.
-  void write(raw_pwrite_stream &OS) {
+  void addThread(Trace &T, TimePointType TraceStartTime) const {
+    TraceThread &Thread = T.Threads.emplace_back();
+    Thread.Tid = Tid;
+    Thread.ThreadName = ThreadName;
+    Thread.DroppedEvents = DroppedEntries;
+    Thread.Events.reserve(Entries.size());
+    // The first entry in ring buffer order is the oldest one.
+    for (size_t I = 0, E = Entries.size(); I != E; ++I) {
+      const CompletedEntry &Entry = Entries[(NextEntry + I) % E];
+      int64_t StartUs = getFlameGraphUs(Entry.Start, TraceStartTime);
+      Thread.Events.push_back({StartUs,
+                               getFlameGraphUs(Entry.End, Entry.Start),
+                               Names[Entry.NameId], Entry.Detail,
+                               Entry.AsyncEvent});
+    }
+  }
+
+  // Collect events from this TimeTraceProfilerInstance and
+  // ThreadTimeTraceProfilerInstances, and write them with \p Writer.
+  void write(raw_pwrite_stream &OS, void (*Writer)(const Trace &,
+                                                   raw_pwrite_stream &)) {
     // Acquire Mutex as reading ThreadTimeTraceProfilerInstances.
     auto &Instances = getTimeTraceProfilerInstances();
     std::lock_guard<std::mutex> Lock(Instances.Lock);
@@ -161,141 +254,52 @@ struct llvm::TimeTraceProfiler {
                         [](const auto &TTP) { return TTP->Stack.empty(); }) &&
            "All profiler sections should be ended when calling write");
 
-    json::OStream J(OS);
-    J.objectBegin();
-    J.attributeBegin("traceEvents");
-    J.arrayBegin();
-
-    // Emit all events for the main flame graph.
-    auto writeEvent = [&](const auto &E, uint64_t Tid) {
-      auto StartUs = E.getFlameGraphStartUs(StartTime);
-      auto DurUs = E.getFlameGraphDurUs();
-
-      J.object([&] {
-        J.attribute("pid", Pid);
-        J.attribute("tid", int64_t(Tid));
-        J.attribute("ts", StartUs);
-        if (E.AsyncEvent) {
-          J.attribute("cat", E.Name);
-          J.attribute("ph", "b");
-          J.attribute("id", 0);
-        } else {
-          J.attribute("ph", "X");
-          J.attribute("dur", DurUs);
-        }
-        J.attribute("name", E.Name);
-        if (!E.Detail.empty()) {
-          J.attributeObject("args", [&] { J.attribute("detail", E.Detail); });
-        }
-      });
-
-      if (E.AsyncEvent) {
-        J.object([&] {
-          J.attribute("pid", Pid);
-          J.attribute("tid", int64_t(Tid));
-          J.attribute("ts", StartUs + DurUs);
-          J.attribute("cat", E.Name);
-          J.attribute("ph", "e");
-          J.attribute("id", 0);
-          J.attribute("name", E.Name);
-        });
-      }
-    };
-    for (const TimeTraceProfilerEntry &E : Entries)
-      writeEvent(E, this->Tid);
-    for (const TimeTraceProfiler *TTP : Instances.List)
-      for (const TimeTraceProfilerEntry &E : TTP->Entries)
-        writeEvent(E, TTP->Tid);
-
-    // Emit totals by section name as additional "thread" events, sorted from
-    // longest one.
-    // Find highest used thread id.
-    uint64_t MaxTid = this->Tid;
+    Trace T;
+    T.Pid = Pid;
+    T.ProcName = ProcName;
+    T.BeginningOfTimeUs = time_point_cast<microseconds>(BeginningOfTime)
+                              .time_since_epoch()
+                              .count();
+    addThread(T, StartTime);
     for (const TimeTraceProfiler *TTP : Instances.List)
-      MaxTid = std::max(MaxTid, TTP->Tid);
+      TTP->addThread(T, StartTime);
 
     // Combine all CountAndTotalPerName from threads into one.
     StringMap<CountAndDurationType> AllCountAndTotalPerName;
-    auto combineStat = [&](const auto &Stat) {
-      StringRef Key = Stat.getKey();
-      auto Value = Stat.getValue();
-      auto &CountAndTotal = AllCountAndTotalPerName[Key];
-      CountAndTotal.first += Value.first;
-      CountAndTotal.second += Value.second;
+    auto combineStats = [&](const TimeTraceProfiler &TTP) {
+      for (auto [NameId, Stat] : llvm::enumerate(TTP.CountAndTotalPerName)) {
+        if (!Stat.first)
+          continue;
+        auto &CountAndTotal = AllCountAndTotalPerName[TTP.Names[NameId]];
+        CountAndTotal.first += Stat.first;
+        CountAndTotal.second += Stat.second;
+      }
     };
-    for (const auto &Stat : CountAndTotalPerName)
-      combineStat(Stat);
+    combineStats(*this);
     for (const TimeTraceProfiler *TTP : Instances.List)
-      for (const auto &Stat : TTP->CountAndTotalPerName)
-        combineStat(Stat);
-
-    std::vector<NameAndCountAndDurationType> SortedTotals;
-    SortedTotals.reserve(AllCountAndTotalPerName.size());
+      combineStats(*TTP);
     for (const auto &Total : AllCountAndTotalPerName)
-      SortedTotals.emplace_back(std::string(Total.getKey()), Total.getValue());
-
-    llvm::sort(SortedTotals, [](const NameAndCountAndDurationType &A,
-                                const NameAndCountAndDurationType &B) {
-      return A.second.second > B.second.second;
-    });
-
-    // Report totals on separate threads of tracing file.
-    uint64_t TotalTid = MaxTid + 1;
-    for (const NameAndCountAndDurationType &Total : SortedTotals) {
-      auto DurUs = duration_cast<microseconds>(Total.second.second).count();
-      auto Count = AllCountAndTotalPerName[Total.first].first;
-
-      J.object([&] {
-        J.attribute("pid", Pid);
-        J.attribute("tid", int64_t(TotalTid));
-        J.attribute("ph", "X");
-        J.attribute("ts", 0);
-        J.attribute("dur", DurUs);
-        J.attribute("name", "Total " + Total.first);
-        J.attributeObject("args", [&] {
-          J.attribute("count", int64_t(Count));
-          J.attribute("avg ms", int64_t(DurUs / Count / 1000));
-        });
-      });
-
-      ++TotalTid;
-    }
-
-    auto writeMetadataEvent = [&](const char *Name, uint64_t Tid,
-                                  StringRef arg) {
-      J.object([&] {
-        J.attribute("cat", "");
-        J.attribute("pid", Pid);
-        J.attribute("tid", int64_t(Tid));
-        J.attribute("ts", 0);
-        J.attribute("ph", "M");
-        J.attribute("name", Name);
-        J.attributeObject("args", [&] { J.attribute("name", arg); });
-      });
-    };
-
-    writeMetadataEvent("process_name", Tid, ProcName);
-    writeMetadataEvent("thread_name", Tid, ThreadName);
-    for (const TimeTraceProfiler *TTP : Instances.List)
-      writeMetadataEvent("thread_name", TTP->Tid, TTP->ThreadName);
+      T.Totals.push_back(
+          {Total.getKey(), Total.getValue().first,
+           std::chrono::duration_cast<std::chrono::nanoseconds>(
+               Total.getValue().second)
+               .count()});
 
-    J.arrayEnd();
-    J.attributeEnd();
-
-    // Emit the absolute time when this TimeProfiler started.
-    // This can be used to combine the profiling data from
-    // multiple processes and preserve actual time intervals.
-    J.attribute("beginningOfTime",
-                time_point_cast<microseconds>(BeginningOfTime)
-                    .time_since_epoch()
-                    .count());
-
-    J.objectEnd();
+    Writer(T, OS);
   }
 
-  SmallVector<std::unique_ptr<TimeTraceProfilerEntry>, 16> Stack;
-  SmallVector<TimeTraceProfilerEntry, 128> Entries;
-  StringMap<CountAndDurationType> CountAndTotalPerName;
+  SmallVector<TimeTraceProfilerEntry *, 16> Stack;
+  SmallVector<TimeTraceProfilerEntry *, 16> FreeEntries;
+  SpecificBumpPtrAllocator<TimeTraceProfilerEntry> EntryAllocator;
+  std::vector<CompletedEntry> Entries;
+  // In ring buffer mode, the index of the oldest entry once Entries is full.
+  size_t NextEntry = 0;
+  uint64_t DroppedEntries = 0;
+  uint64_t NumSampled = 0;
+  // Section names seen by this thread, and the totals for each of them.
+  StringMap<uint32_t> NameIds;
+  SmallVector<StringRef, 0> Names;
+  std::vector<CountAndDurationType> CountAndTotalPerName;
   // System clock time when the session was begun.
   const time_point<system_clock> BeginningOfTime;
   // Profiling clock time when the session was begun.
@@ -307,14 +311,327 @@ struct llvm::TimeTraceProfiler {
 
   // Minimum time granularity (in microseconds)
   const unsigned TimeTraceGranularity;
+  // Maximum number of completed entries to keep, or 0 for no limit.
+  const size_t RingBufferSize;
+  // Record one in every SamplingPeriod entries.
+  const unsigned SamplingPeriod;
 };
 
+/// Writes \p T in Chrome "Trace Event" format.
+static void writeJSON(const Trace &T, raw_pwrite_stream &OS) {
+  json::OStream J(OS);
+  J.objectBegin();
+  J.attributeBegin("traceEvents");
+  J.arrayBegin();
+
+  // Emit all events for the main flame graph.
+  auto writeEvent = [&](const TraceEvent &E, uint64_t Tid) {
+    J.object([&] {
+      J.attribute("pid", T.Pid);
+      J.attribute("tid", int64_t(Tid));
+      J.attribute("ts", E.StartUs);
+      if (E.AsyncEvent) {
+        J.attribute("cat", E.Name);
+        J.attribute("ph", "b");
+        J.attribute("id", 0);
+      } else {
+        J.attribute("ph", "X");
+        J.attribute("dur", E.DurUs);
+      }
+      J.attribute("name", E.Name);
+      if (!E.Detail.empty()) {
+        J.attributeObject("args", [&] { J.attribute("detail", E.Detail); });
+      }
+    });
+
+    if (E.AsyncEvent) {
+      J.object([&] {
+        J.attribute("pid", T.Pid);
+        J.attribute("tid", int64_t(Tid));
+        J.attribute("ts", E.StartUs + E.DurUs);
+        J.attribute("cat", E.Name);
+        J.attribute("ph", "e");
+        J.attribute("id", 0);
+        J.attribute("name", E.Name);
+      });
+    }
+  };
+  for (const TraceThread &Thread : T.Threads)
+    for (const TraceEvent &E : Thread.Events)
+      writeEvent(E, Thread.Tid);
+
+  // Emit totals by section name as additional "thread" events, sorted from
+  // longest one.
+  // Find highest used thread id.
+  uint64_t MaxTid = 0;
+  for (const TraceThread &Thread : T.Threads)
+    MaxTid = std::max(MaxTid, Thread.Tid);
+
+  std::vector<TraceTotal> SortedTotals(T.Totals);
+  llvm::stable_sort(SortedTotals, [](const TraceTotal &A, const TraceTotal &B) {
+    return A.DurNs > B.DurNs;
+  });
+
+  // Report totals on separate threads of tracing file.
+  uint64_t TotalTid = MaxTid + 1;
+  for (const TraceTotal &Total : SortedTotals) {
+    int64_t DurUs = Total.DurNs / 1000;
+
+    J.object([&] {
+      J.attribute("pid", T.Pid);
+      J.attribute("tid", int64_t(TotalTid));
+      J.attribute("ph", "X");
+      J.attribute("ts", 0);
+      J.attribute("dur", DurUs);
+      J.attribute("name", "Total " + Total.Name.str());
+      J.attributeObject("args", [&] {
+        J.attribute("count", int64_t(Total.Count));
+        J.attribute("avg ms", int64_t(DurUs / Total.Count / 1000));
+      });
+    });
+
+    ++TotalTid;
+  }
+
+  auto writeMetadataEvent = [&](const char *Name, uint64_t Tid,
+                                StringRef arg) {
+    J.object([&] {
+      J.attribute("cat", "");
+      J.attribute("pid", T.Pid);
+      J.attribute("tid", int64_t(Tid));
+      J.attribute("ts", 0);
+      J.attribute("ph", "M");
+      J.attribute("name", Name);
+      J.attributeObject("args", [&] { J.attribute("name", arg); });
+    });
+  };
+
+  if (!T.Threads.empty())
+    writeMetadataEvent("process_name", T.Threads.front().Tid, T.ProcName);
+  uint64_t DroppedEvents = 0;
+  for (const TraceThread &Thread : T.Threads) {
+    writeMetadataEvent("thread_name", Thread.Tid, Thread.ThreadName);
+    DroppedEvents += Thread.DroppedEvents;
+  }
+
+  J.arrayEnd();
+  J.attributeEnd();
+
+  // Emit the absolute time when this TimeProfiler started.
+  // This can be used to combine the profiling data from
+  // multiple processes and preserve actual time intervals.
+  J.attribute("beginningOfTime", T.BeginningOfTimeUs);
+
+  // In ring buffer mode, the number of events that were overwritten by newer
+  // ones.
+  if (DroppedEvents)
+    J.attribute("droppedEvents", int64_t(DroppedEvents));
+
+  J.objectEnd();
+}
+
+// The binary trace format. All integers are LEB128 encoded, and strings are
+// indices into a table of unique strings that precedes the threads.
+//
+//   Magic Version Pid BeginningOfTimeUs
+//   NumStrings (Length Bytes)* ProcName
+//   NumThreads (Tid ThreadName DroppedEvents NumEvents Event*)*
+//   NumTotals (Name Count DurNs)*
+//
+// where an Event is
+//
+//   StartUs DurUs Name Detail AsyncEvent
+//
+// and StartUs is relative to the start of the previous event of the thread.
+static constexpr StringLiteral BinaryMagic("LLVMTTRC");
+static constexpr uint64_t BinaryVersion = 1;
+
+static void writeBinary(const Trace &T, raw_pwrite_stream &OS) {
+  StringMap<uint64_t> StringIds;
+  std::vector<StringRef> Strings;
+  auto getStringId = [&](StringRef S) {
+    auto [It, Inserted] = StringIds.try_emplace(S, Strings.size());
+    if (Inserted)
+      Strings.push_back(S);
+    return It->second;
+  };
+  getStringId(T.ProcName);
+  for (const TraceThread &Thread : T.Threads) {
+    getStringId(Thread.ThreadName);
+    for (const TraceEvent &E : Thread.Events) {
+      getStringId(E.Name);
+      getStringId(E.Detail);
+    }
+  }
+  for (const TraceTotal &Total : T.Totals)
+    getStringId(Total.Name);
+
+  OS << BinaryMagic;
+  encodeULEB128(BinaryVersion, OS);
+  encodeSLEB128(T.Pid, OS);
+  encodeSLEB128(T.BeginningOfTimeUs, OS);
+  encodeULEB128(Strings.size(), OS);
+  for (StringRef S : Strings) {
+    encodeULEB128(S.size(), OS);
+    OS << S;
+  }
+  encodeULEB128(StringIds.lookup(T.ProcName), OS);
+
+  encodeULEB128(T.Threads.size(), OS);
+  for (const TraceThread &Thread : T.Threads) {
+    encodeULEB128(Thread.Tid, OS);
+    encodeULEB128(StringIds.lookup(Thread.ThreadName), OS);
+    encodeULEB128(Thread.DroppedEvents, OS);
+    encodeULEB128(Thread.Events.size(), OS);
+    int64_t PrevStartUs = 0;
+    for (const TraceEvent &E : Thread.Events) {
+      encodeSLEB128(E.StartUs - PrevStartUs, OS);
+      encodeSLEB128(E.DurUs, OS);
+      encodeULEB128(StringIds.lookup(E.Name), OS);
+      encodeULEB128(StringIds.lookup(E.Detail), OS);
+      encodeULEB128(E.AsyncEvent, OS);
+      PrevStartUs = E.StartUs;
+    }
+  }
+
+  encodeULEB128(T.Totals.size(), OS);
+  for (const TraceTotal &Total : T.Totals) {
+    encodeULEB128(StringIds.lookup(Total.Name), OS);
+    encodeULEB128(Total.Count, OS);
+    encodeSLEB128(Total.DurNs, OS);
+  }
+}
+
+/// Reads a trace written by writeBinary. The strings of the result refer to
+/// \p Data.
+static Expected<Trace> readBinary(StringRef Data) {
+  BinaryStreamReader Reader(Data, llvm::endianness::little);
+  StringRef Magic;
+  uint64_t Version;
+  if (Error E = Reader.readFixedString(Magic, BinaryMagic.size()))
+    return std::move(E);
+  if (Magic != BinaryMagic)
+    return createStringError(inconvertibleErrorCode(),
+                             "not a binary time trace");
+  if (Error E = Reader.readULEB128(Version))
+    return std::move(E);
+  if (Version != BinaryVersion)
+    return createStringError(inconvertibleErrorCode(),
+                             "unsupported binary time trace version %" PRIu64,
+                             Version);
+
+  Trace T;
+  uint64_t NumStrings;
+  if (Error E = Reader.readSLEB128(T.Pid))
+    return std::move(E);
+  if (Error E = Reader.readSLEB128(T.BeginningOfTimeUs))
+    return std::move(E);
+  if (Error E = Reader.readULEB128(NumStrings))
+    return std::move(E);
+  // Every string takes at least one byte.
+  if (NumStrings > Reader.bytesRemaining())
+    return createStringError(inconvertibleErrorCode(),
+                             "invalid binary time trace string table");
+  std::vector<StringRef> Strings(NumStrings);
+  for (StringRef &S : Strings) {
+    uint64_t Length;
+    if (Error E = Reader.readULEB128(Length))
+      return std::move(E);
+    if (Length > Reader.bytesRemaining())
+      return createStringError(inconvertibleErrorCode(),
+                               "invalid binary time trace string");
+    if (Error E = Reader.readFixedString(S, Length))
+      return std::move(E);
+  }
+
+  auto readString = [&](StringRef &S) -> Error {
+    uint64_t Id;
+    if (Error E = Reader.readULEB128(Id))
+      return E;
+    if (Id >= Strings.size())
+      return createStringError(inconvertibleErrorCode(),
+                               "invalid binary time trace string index");
+    S = Strings[Id];
+    return Error::success();
+  };
+  auto readCount = [&](uint64_t &Count) -> Error {
+    if (Error E = Reader.readULEB128(Count))
+      return E;
+    // Every element takes at least one byte.
+    if (Count > Reader.bytesRemaining())
+      return createStringError(inconvertibleErrorCode(),
+                               "invalid binary time trace count");
+    return Error::success();
+  };
+
+  uint64_t NumThreads;
+  if (Error E = readString(T.ProcName))
+    return std::move(E);
+  if (Error E = readCount(NumThreads))
+    return std::move(E);
+  T.Threads.resize(NumThreads);
+  for (TraceThread &Thread : T.Threads) {
+    uint64_t NumEvents;
+    if (Error E = Reader.readULEB128(Thread.Tid))
+      return std::move(E);
+    if (Error E = readString(Thread.ThreadName))
+      return std::move(E);
+    if (Error E = Reader.readULEB128(Thread.DroppedEvents))
+      return std::move(E);
+    if (Error E = readCount(NumEvents))
+      return std::move(E);
+    Thread.Events.resize(NumEvents);
+    int64_t PrevStartUs = 0;
+    for (TraceEvent &Event : Thread.Events) {
+      int64_t StartUs;
+      uint64_t AsyncEvent;
+      if (Error E = Reader.readSLEB128(StartUs))
+        return std::move(E);
+      if (Error E = Reader.readSLEB128(Event.DurUs))
+        return std::move(E);
+      if (Error E = readString(Event.Name))
+        return std::move(E);
+      if (Error E = readString(Event.Detail))
+        return std::move(E);
+      if (Error E = Reader.readULEB128(AsyncEvent))
+        return std::move(E);
+      Event.StartUs = PrevStartUs + StartUs;
+      Event.AsyncEvent = AsyncEvent;
+      PrevStartUs = Event.StartUs;
+    }
+  }
+
+  uint64_t NumTotals;
+  if (Error E = readCount(NumTotals))
+    return std::move(E);
+  T.Totals.resize(NumTotals);
+  for (TraceTotal &Total : T.Totals) {
+    if (Error E = readString(Total.Name))
+      return std::move(E);
+    if (Error E = Reader.readULEB128(Total.Count))
+      return std::move(E);
+    if (Error E = Reader.readSLEB128(Total.DurNs))
+      return std::move(E);
+    if (!Total.Count)
+      return createStringError(inconvertibleErrorCode(),
+                               "invalid binary time trace total");
+  }
+  return std::move(T);
+}
+
 void llvm::timeTraceProfilerInitialize(unsigned TimeTraceGranularity,
                                        StringRef ProcName) {
+  TimeTraceProfilerOptions Options;
+  Options.Granularity = TimeTraceGranularity;
+  timeTraceProfilerInitialize(Options, ProcName);
+}
+
+void llvm::timeTraceProfilerInitialize(const TimeTraceProfilerOptions &Options,
+                                       StringRef ProcName) {
   assert(TimeTraceProfilerInstance == nullptr &&
          "Profiler should not be initialized");
-  TimeTraceProfilerInstance = new TimeTraceProfiler(
-      TimeTraceGranularity, llvm::sys::path::filename(ProcName));
+  TimeTraceProfilerInstance =
+      new TimeTraceProfiler(Options, llvm::sys::path::filename(ProcName));
 }
 
 // Removes all TimeTraceProfilerInstances.
@@ -342,7 +659,22 @@ void llvm::timeTraceProfilerFinishThread() {
 void llvm::timeTraceProfilerWrite(raw_pwrite_stream &OS) {
   assert(TimeTraceProfilerInstance != nullptr &&
          "Profiler object can't be null");
-  TimeTraceProfilerInstance->write(OS);
+  TimeTraceProfilerInstance->write(OS, writeJSON);
+}
+
+void llvm::timeTraceProfilerWriteBinary(raw_pwrite_stream &OS) {
+  assert(TimeTraceProfilerInstance != nullptr &&
+         "Profiler object can't be null");
+  TimeTraceProfilerInstance->write(OS, writeBinary);
+}
+
+Error llvm::timeTraceProfilerConvertToJSON(StringRef Binary,
+                                           raw_pwrite_stream &OS) {
+  Expected<Trace> T = readBinary(Binary);
+  if (!T)
+    return T.takeError();
+  writeJSON(*T, OS);
+  return Error::success();
 }
 
 Error llvm::timeTraceProfilerWrite(StringRef PreferredFileName,
@@ -369,7 +701,7 @@ TimeTraceProfilerEntry *llvm::timeTraceProfilerBegin(StringRef Name,
                                                      StringRef Detail) {
   if (TimeTraceProfilerInstance != nullptr)
     return TimeTraceProfilerInstance->begin(
-        std::string(Name), [&]() { return std::string(Detail); }, false);
+        Name, [&]() { return std::string(Detail); }, false);
   return nullptr;
 }
 
@@ -377,7 +709,7 @@ TimeTraceProfilerEntry *
 llvm::timeTraceProfilerBegin(StringRef Name,
                              llvm::function_ref<std::string()> Detail) {
   if (TimeTraceProfilerInstance != nullptr)
-    return TimeTraceProfilerInstance->begin(std::string(Name), Detail, false);
+    return TimeTraceProfilerInstance->begin(Name, Detail, false);
   return nullptr;
 }
 
@@ -385,7 +717,7 @@ TimeTraceProfilerEntry *llvm::timeTraceAsyncProfilerBegin(StringRef Name,
                                                           StringRef Detail) {
   if (TimeTraceProfilerInstance != nullptr)
     return TimeTraceProfilerInstance->begin(
-        std::string(Name), [&]() { return std::string(Detail); }, true);
+        Name, [&]() { return std::string(Detail); }, true);
   return nullptr;
 }
 
@@ -14,6 +14,8 @@
 
 #include "DebugOptions.h"
 
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Config/config.h"
@@ -26,6 +28,8 @@
 #include "llvm/Support/Signposts.h"
 #include "llvm/Support/YAMLTraits.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstring>
 #include <limits>
 
 #if HAVE_UNISTD_H
@@ -36,6 +40,15 @@
 #include <libproc.h>
 #endif
 
+#ifdef HAVE_GETRUSAGE
+#include <sys/resource.h>
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
 using namespace llvm;
 
 // This ugly hack is brought to you courtesy of constructor/destructor ordering
@@ -65,6 +78,17 @@ struct CreateTrackSpace {
   }
 };
 static ManagedStatic<cl::opt<bool>, CreateTrackSpace> TrackSpace;
+struct CreateTrackPerfCounters {
+  static void *call() {
+    return new cl::opt<bool>(
+        "track-perf-counters",
+        cl::desc("Enable -time-passes tracking of instructions, cycles, cache "
+                 "and branch misses with perf_event_open where available, and "
+                 "of the growth of the peak resident set size"),
+        cl::Hidden);
+  }
+};
+static ManagedStatic<cl::opt<bool>, CreateTrackPerfCounters> TrackPerfCounters;
 struct CreateInfoOutputFilename {
   static void *call() {
     return new cl::opt<std::string, true>(
@@ -89,6 +113,7 @@ ManagedStatic<cl::opt<bool>, CreateSortTimers> SortTimers;
 
 void llvm::initTimerOptions() {
   *TrackSpace;
+  *TrackPerfCounters;
   *InfoOutputFilename;
   *SortTimers;
 }
@@ -165,19 +190,145 @@ static uint64_t getCurInstructionsExecuted() {
   return 0;
 }
 
+static size_t getPeakMemUsage() {
+#ifdef HAVE_GETRUSAGE
+  struct rusage RU;
+  if (::getrusage(RUSAGE_SELF, &RU) == 0)
+#ifdef __APPLE__
+    return RU.ru_maxrss;
+#else
+    return RU.ru_maxrss * 1024;
+#endif
+#endif
+  return 0;
+}
+
+namespace {
+/// The hardware performance counters of the calling thread. The events that
+/// cannot be opened, because the kernel or the processor does not support
+/// them or the user may not access them, read as zero.
+class PerfCounters {
+public:
+  enum Event { Instructions, Cycles, CacheMisses, BranchMisses, NumEvents };
+
+  PerfCounters();
+  ~PerfCounters();
+
+  /// Whether \p E is counted.
+  bool counts(Event E) const { return is_contained(OpenEvents, E); }
+
+  /// Read the current value of each event into \p Values, and how long the
+  /// group has been enabled and counting into \p Enabled and \p Running.
+  /// Both times keep growing from when the group was opened, so only their
+  /// differences between two reads tell whether the kernel multiplexed the
+  /// group in between. Returns false if the group could not be read.
+  bool read(uint64_t (&Values)[NumEvents], uint64_t &Enabled,
+            uint64_t &Running) const;
+
+private:
+  /// The events that were opened, the first one leads the group of the
+  /// others so that they can all be read at once.
+  SmallVector<int, NumEvents> FDs;
+  SmallVector<Event, NumEvents> OpenEvents;
+};
+} // namespace
+
+PerfCounters::PerfCounters() {
+#ifdef __linux__
+  static const uint64_t Configs[NumEvents] = {
+      PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CPU_CYCLES,
+      PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+  for (unsigned E = 0; E != NumEvents; ++E) {
+    struct perf_event_attr Attr;
+    memset(&Attr, 0, sizeof(Attr));
+    Attr.size = sizeof(Attr);
+    Attr.type = PERF_TYPE_HARDWARE;
+    Attr.config = Configs[E];
+    Attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // Unprivileged users may only count their own code.
+    Attr.exclude_kernel = 1;
+    Attr.exclude_hv = 1;
+    int FD = syscall(SYS_perf_event_open, &Attr, /*pid=*/0, /*cpu=*/-1,
+                     FDs.empty() ? -1 : FDs.front(), PERF_FLAG_FD_CLOEXEC);
+    if (FD < 0)
+      continue;
+    FDs.push_back(FD);
+    OpenEvents.push_back(Event(E));
+  }
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+  // Close the group leader last.
+  for (int FD : llvm::reverse(FDs))
+    ::close(FD);
+#endif
+}
+
+bool PerfCounters::read(uint64_t (&Values)[NumEvents], uint64_t &Enabled,
+                        uint64_t &Running) const {
+  std::fill(std::begin(Values), std::end(Values), 0);
+  Enabled = Running = 0;
+#ifdef __linux__
+  if (FDs.empty())
+    return true;
+  struct {
+    uint64_t NumValues;
+    uint64_t TimeEnabled;
+    uint64_t TimeRunning;
+    uint64_t Values[NumEvents];
+  } Group;
+  ssize_t Size = ::read(FDs.front(), &Group, sizeof(Group));
+  if (Size < ssize_t(sizeof(uint64_t) * (3 + OpenEvents.size())) ||
+      Group.NumValues != OpenEvents.size())
+    return false;
+  Enabled = Group.TimeEnabled;
+  Running = Group.TimeRunning;
+  for (unsigned I = 0, E = OpenEvents.size(); I != E; ++I)
+    Values[OpenEvents[I]] = Group.Values[I];
+#endif
+  return true;
+}
+
 TimeRecord TimeRecord::getCurrentTime(bool Start) {
   using Seconds = std::chrono::duration<double, std::ratio<1>>;
   TimeRecord Result;
   sys::TimePoint<> now;
   std::chrono::nanoseconds user, sys;
 
+  auto GetCounters = [&Result] {
+    Result.InstructionsExecuted = getCurInstructionsExecuted();
+    if (!*TrackPerfCounters)
+      return;
+    // Each thread opens its counters the first time it reads them.
+    static thread_local PerfCounters Counters;
+    Result.PeakMemUsed = getPeakMemUsage();
+    uint64_t Values[PerfCounters::NumEvents];
+    if (!Counters.read(Values, Result.CountersEnabled,
+                       Result.CountersRunning)) {
+      // The difference with the other end of the timer would be meaningless.
+      // The counters of the timer read as zero instead.
+      Result.invalidateCounters();
+      return;
+    }
+    // Instructions come from the same source at both ends of a timer, which
+    // is the perf event whenever the thread could open it.
+    if (Counters.counts(PerfCounters::Instructions))
+      Result.InstructionsExecuted = Values[PerfCounters::Instructions];
+    Result.Cycles = Values[PerfCounters::Cycles];
+    Result.CacheMisses = Values[PerfCounters::CacheMisses];
+    Result.BranchMisses = Values[PerfCounters::BranchMisses];
+  };
+
   if (Start) {
     Result.MemUsed = getMemUsage();
-    Result.InstructionsExecuted = getCurInstructionsExecuted();
+    GetCounters();
     sys::Process::GetTimeUsage(now, user, sys);
   } else {
     sys::Process::GetTimeUsage(now, user, sys);
-    Result.InstructionsExecuted = getCurInstructionsExecuted();
+    GetCounters();
     Result.MemUsed = getMemUsage();
   }
 
@@ -229,6 +380,14 @@ void TimeRecord::print(const TimeRecord &Total, raw_ostream &OS) const {
     OS << format("%9" PRId64 "  ", (int64_t)getMemUsed());
   if (Total.getInstructionsExecuted())
     OS << format("%9" PRId64 "  ", (int64_t)getInstructionsExecuted());
+  if (Total.getCycles())
+    OS << format("%12" PRId64 "  ", (int64_t)getCycles());
+  if (Total.getCacheMisses())
+    OS << format("%12" PRId64 "  ", (int64_t)getCacheMisses());
+  if (Total.getBranchMisses())
+    OS << format("%12" PRId64 "  ", (int64_t)getBranchMisses());
+  if (Total.getPeakMemUsed())
+    OS << format("%9" PRId64 "  ", (int64_t)getPeakMemUsed());
 }
 
 
@@ -390,6 +549,14 @@ void TimerGroup::PrintQueuedTimers(raw_ostream &OS) {
     OS << "  ---Mem---";
   if (Total.getInstructionsExecuted())
     OS << "  ---Instr---";
+  if (Total.getCycles())
+    OS << "  ---Cycles---";
+  if (Total.getCacheMisses())
+    OS << "  --CacheMiss-";
+  if (Total.getBranchMisses())
+    OS << "  -BranchMiss-";
+  if (Total.getPeakMemUsed())
+    OS << "  -PeakMem-";
   OS << "  --- Name ---\n";
 
   // Loop through all of the timing data, printing it out.
@@ -487,6 +654,22 @@ const char *TimerGroup::printJSONValues(raw_ostream &OS, const char *delim) {
       OS << delim;
       printJSONValue(OS, R, ".instr", T.getInstructionsExecuted());
     }
+    if (T.getCycles()) {
+      OS << delim;
+      printJSONValue(OS, R, ".cycles", T.getCycles());
+    }
+    if (T.getCacheMisses()) {
+      OS << delim;
+      printJSONValue(OS, R, ".cache-misses", T.getCacheMisses());
+    }
+    if (T.getBranchMisses()) {
+      OS << delim;
+      printJSONValue(OS, R, ".branch-misses", T.getBranchMisses());
+    }
+    if (T.getPeakMemUsed()) {
+      OS << delim;
+      printJSONValue(OS, R, ".peak-mem", T.getPeakMemUsed());
+    }
   }
   TimersToPrint.clear();
   return delim;
@@ -911,7 +911,8 @@ Token &Scanner::peekNext() {
 }
 
 Token Scanner::getNext() {
-  Token Ret = peekNext();
+  // The token is popped below, so its value can be moved out.
+  Token Ret = std::move(peekNext());
   // TokenQueue can be empty if there was an error getting the next token.
   if (!TokenQueue.empty())
     TokenQueue.pop_front();
@@ -1017,8 +1018,7 @@ void Scanner::scan_ns_uri_char() {
           && is_ns_hex_digit(*(Current + 1))
           && is_ns_hex_digit(*(Current + 2)))
         || is_ns_word_char(*Current)
-        || StringRef(Current, 1).find_first_of("#;/?:@&=+$,_.!~*'()[]")
-          != StringRef::npos) {
+        || StringRef("#;/?:@&=+$,_.!~*'()[]").contains(*Current)) {
       ++Current;
       ++Column;
     } else
@@ -1061,8 +1061,7 @@ bool Scanner::isBlankOrBreak(StringRef::iterator Position) {
 bool Scanner::isPlainSafeNonBlank(StringRef::iterator Position) {
   if (Position == End || isBlankOrBreak(Position))
     return false;
-  if (FlowLevel &&
-      StringRef(Position, 1).find_first_of(",[]{}") != StringRef::npos)
+  if (FlowLevel && StringRef(",[]{}").contains(*Position))
     return false;
   return true;
 }
@@ -1901,11 +1900,9 @@ bool Scanner::fetchMoreTokens() {
     return scanFlowScalar(true);
 
   // Get a plain scalar.
-  StringRef FirstChar(Current, 1);
   if ((!isBlankOrBreak(Current) &&
-       FirstChar.find_first_of("-?:,[]{}#&*!|>'\"%@`") == StringRef::npos) ||
-      (FirstChar.find_first_of("?:-") != StringRef::npos &&
-       isPlainSafeNonBlank(Current + 1)))
+       !StringRef("-?:,[]{}#&*!|>'\"%@`").contains(*Current)) ||
+      (StringRef("?:-").contains(*Current) && isPlainSafeNonBlank(Current + 1)))
     return scanPlainScalar();
 
   setError("Unrecognized character while tokenizing.", Current);
@@ -2054,7 +2051,7 @@ StringRef ScalarNode::getValue(SmallVectorImpl<char> &Storage) const {
 static StringRef
 parseScalarValue(StringRef UnquotedValue, SmallVectorImpl<char> &Storage,
                  StringRef LookupChars,
-                 std::function<StringRef(StringRef, SmallVectorImpl<char> &)>
+                 function_ref<StringRef(StringRef, SmallVectorImpl<char> &)>
                      UnescapeCallback) {
   size_t I = UnquotedValue.find_first_of(LookupChars);
   if (I == StringRef::npos)
@@ -2467,10 +2464,19 @@ void SequenceNode::increment() {
 }
 
 Document::Document(Stream &S) : stream(S), Root(nullptr) {
+  setDefaultTagMap();
+  parseDocumentStart();
+}
+
+void Document::setDefaultTagMap() {
   // Tag maps starts with two default mappings.
+  TagMap.clear();
   TagMap["!"] = "!";
   TagMap["!!"] = "tag:yaml.org,2002:";
+  HasTagDirectives = false;
+}
 
+void Document::parseDocumentStart() {
   if (parseDirectives())
     expectToken(Token::TK_DocumentStart);
   Token &T = peekNext();
@@ -2478,6 +2484,16 @@ Document::Document(Stream &S) : stream(S), Root(nullptr) {
     getNext();
 }
 
+void Document::startNextDocument() {
+  // The nodes of the previous document are dead, keep the memory for the
+  // nodes of the next one.
+  Root = nullptr;
+  NodeAllocator.Reset();
+  if (HasTagDirectives)
+    setDefaultTagMap();
+  parseDocumentStart();
+}
+
 bool Document::skip()  {
   if (stream.scanner->failed())
     return false;
@@ -2651,6 +2667,7 @@ void Document::parseTAGDirective() {
   StringRef TagHandle = T.substr(0, HandleEnd);
   StringRef TagPrefix = T.substr(HandleEnd).ltrim(" \t");
   TagMap[TagHandle] = TagPrefix;
+  HasTagDirectives = true;
 }
 
 bool Document::expectToken(int TK) {
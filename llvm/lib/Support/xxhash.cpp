@@ -38,11 +38,41 @@
 // xxh3_64bits is based on commit d5891596637d21366b9b1dcf2c0007a3edb26a9e (July
 // 2023).
 
+// xxh3_128bits and the SSE2, AVX2 and NEON accumulate and scramble kernels are
+// based on v0.8.2.
+
 #include "llvm/Support/xxhash.h"
+#include "llvm/ADT/bit.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/Endian.h"
 
 #include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define XXH_VECTOR_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// AVX2 is used unconditionally when the compiler targets it, and is otherwise
+// selected at run time on compilers that support target attributes.
+#if defined(__AVX2__)
+#define XXH_VECTOR_AVX2 1
+#define XXH_TARGET_AVX2
+#include <immintrin.h>
+#elif XXH_VECTOR_SSE2 && defined(__GNUC__) && !defined(_MSC_VER) &&            \
+    (defined(__x86_64__) || defined(__i386__))
+#define XXH_VECTOR_AVX2 1
+#define XXH_DISPATCH_AVX2 1
+#define XXH_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__) && !defined(__AARCH64EB__)
+#define XXH_VECTOR_NEON 1
+#include <arm_neon.h>
+#endif
 
 using namespace llvm;
 using namespace support;
@@ -199,6 +229,11 @@ constexpr size_t XXH_STRIPE_LEN = 64;
 constexpr size_t XXH_SECRET_CONSUME_RATE = 8;
 constexpr size_t XXH_ACC_NB = XXH_STRIPE_LEN / sizeof(uint64_t);
 
+constexpr uint64_t XXH3_INIT_ACC[XXH_ACC_NB] = {
+    PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3,
+    PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1,
+};
+
 static uint64_t XXH3_avalanche(uint64_t hash) {
   hash ^= hash >> 37;
   hash *= PRIME_MX1;
@@ -331,15 +366,17 @@ static void XXH3_accumulate_512_scalar(uint64_t *acc, const uint8_t *input,
   }
 }
 
-LLVM_ATTRIBUTE_ALWAYS_INLINE
-static void XXH3_accumulate_scalar(uint64_t *acc, const uint8_t *input,
-                                   const uint8_t *secret, size_t nbStripes) {
+[[maybe_unused]] static void XXH3_accumulate_scalar(uint64_t *acc,
+                                                    const uint8_t *input,
+                                                    const uint8_t *secret,
+                                                    size_t nbStripes) {
   for (size_t n = 0; n < nbStripes; ++n)
     XXH3_accumulate_512_scalar(acc, input + n * XXH_STRIPE_LEN,
                                secret + n * XXH_SECRET_CONSUME_RATE);
 }
 
-static void XXH3_scrambleAcc(uint64_t *acc, const uint8_t *secret) {
+[[maybe_unused]] static void XXH3_scrambleAcc_scalar(uint64_t *acc,
+                                                     const uint8_t *secret) {
   for (size_t i = 0; i < XXH_ACC_NB; ++i) {
     acc[i] ^= acc[i] >> 47;
     acc[i] ^= endian::read64le(secret + 8 * i);
@@ -347,6 +384,186 @@ static void XXH3_scrambleAcc(uint64_t *acc, const uint8_t *secret) {
   }
 }
 
+// The vector kernels below compute exactly what the scalar ones do, one
+// 128-bit or 256-bit lane of accumulators at a time. Swapping the 64-bit
+// halves of the input implements acc[i ^ 1] += data_val, and the 32x32->64
+// multiplies implement lo32(data_key) * hi32(data_key).
+#if XXH_VECTOR_SSE2
+[[maybe_unused]] static void XXH3_accumulate_sse2(uint64_t *acc,
+                                                  const uint8_t *input,
+                                                  const uint8_t *secret,
+                                                  size_t nbStripes) {
+  constexpr size_t NbLanes = XXH_STRIPE_LEN / sizeof(__m128i);
+  auto *xacc = reinterpret_cast<__m128i *>(acc);
+  __m128i lanes[NbLanes];
+  for (size_t i = 0; i < NbLanes; ++i)
+    lanes[i] = _mm_loadu_si128(xacc + i);
+
+  for (size_t n = 0; n < nbStripes; ++n) {
+    const auto *xinput =
+        reinterpret_cast<const __m128i *>(input + n * XXH_STRIPE_LEN);
+    const auto *xsecret =
+        reinterpret_cast<const __m128i *>(secret + n * XXH_SECRET_CONSUME_RATE);
+    for (size_t i = 0; i < NbLanes; ++i) {
+      __m128i data_vec = _mm_loadu_si128(xinput + i);
+      __m128i data_key = _mm_xor_si128(data_vec, _mm_loadu_si128(xsecret + i));
+      __m128i data_key_hi =
+          _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+      __m128i product = _mm_mul_epu32(data_key, data_key_hi);
+      __m128i data_swap = _mm_shuffle_epi32(data_vec, _MM_SHUFFLE(1, 0, 3, 2));
+      lanes[i] = _mm_add_epi64(lanes[i], _mm_add_epi64(product, data_swap));
+    }
+  }
+
+  for (size_t i = 0; i < NbLanes; ++i)
+    _mm_storeu_si128(xacc + i, lanes[i]);
+}
+
+[[maybe_unused]] static void XXH3_scrambleAcc_sse2(uint64_t *acc,
+                                                   const uint8_t *secret) {
+  constexpr size_t NbLanes = XXH_STRIPE_LEN / sizeof(__m128i);
+  auto *xacc = reinterpret_cast<__m128i *>(acc);
+  const auto *xsecret = reinterpret_cast<const __m128i *>(secret);
+  const __m128i prime32 = _mm_set1_epi32(static_cast<int>(PRIME32_1));
+  for (size_t i = 0; i < NbLanes; ++i) {
+    __m128i acc_vec = _mm_loadu_si128(xacc + i);
+    acc_vec = _mm_xor_si128(acc_vec, _mm_srli_epi64(acc_vec, 47));
+    acc_vec = _mm_xor_si128(acc_vec, _mm_loadu_si128(xsecret + i));
+    // Multiply each 64-bit lane by a 32-bit prime with two 32x32 multiplies.
+    __m128i acc_hi = _mm_shuffle_epi32(acc_vec, _MM_SHUFFLE(0, 3, 0, 1));
+    __m128i prod_lo = _mm_mul_epu32(acc_vec, prime32);
+    __m128i prod_hi = _mm_mul_epu32(acc_hi, prime32);
+    _mm_storeu_si128(xacc + i,
+                     _mm_add_epi64(prod_lo, _mm_slli_epi64(prod_hi, 32)));
+  }
+}
+#endif
+
+#if XXH_VECTOR_AVX2
+XXH_TARGET_AVX2
+static void XXH3_accumulate_avx2(uint64_t *acc, const uint8_t *input,
+                                 const uint8_t *secret, size_t nbStripes) {
+  constexpr size_t NbLanes = XXH_STRIPE_LEN / sizeof(__m256i);
+  auto *xacc = reinterpret_cast<__m256i *>(acc);
+  __m256i lanes[NbLanes];
+  for (size_t i = 0; i < NbLanes; ++i)
+    lanes[i] = _mm256_loadu_si256(xacc + i);
+
+  for (size_t n = 0; n < nbStripes; ++n) {
+    const auto *xinput =
+        reinterpret_cast<const __m256i *>(input + n * XXH_STRIPE_LEN);
+    const auto *xsecret =
+        reinterpret_cast<const __m256i *>(secret + n * XXH_SECRET_CONSUME_RATE);
+    for (size_t i = 0; i < NbLanes; ++i) {
+      __m256i data_vec = _mm256_loadu_si256(xinput + i);
+      __m256i data_key =
+          _mm256_xor_si256(data_vec, _mm256_loadu_si256(xsecret + i));
+      __m256i data_key_hi =
+          _mm256_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+      __m256i product = _mm256_mul_epu32(data_key, data_key_hi);
+      __m256i data_swap =
+          _mm256_shuffle_epi32(data_vec, _MM_SHUFFLE(1, 0, 3, 2));
+      lanes[i] =
+          _mm256_add_epi64(lanes[i], _mm256_add_epi64(product, data_swap));
+    }
+  }
+
+  for (size_t i = 0; i < NbLanes; ++i)
+    _mm256_storeu_si256(xacc + i, lanes[i]);
+}
+
+XXH_TARGET_AVX2
+static void XXH3_scrambleAcc_avx2(uint64_t *acc, const uint8_t *secret) {
+  constexpr size_t NbLanes = XXH_STRIPE_LEN / sizeof(__m256i);
+  auto *xacc = reinterpret_cast<__m256i *>(acc);
+  const auto *xsecret = reinterpret_cast<const __m256i *>(secret);
+  const __m256i prime32 = _mm256_set1_epi32(static_cast<int>(PRIME32_1));
+  for (size_t i = 0; i < NbLanes; ++i) {
+    __m256i acc_vec = _mm256_loadu_si256(xacc + i);
+    acc_vec = _mm256_xor_si256(acc_vec, _mm256_srli_epi64(acc_vec, 47));
+    acc_vec = _mm256_xor_si256(acc_vec, _mm256_loadu_si256(xsecret + i));
+    __m256i acc_hi = _mm256_shuffle_epi32(acc_vec, _MM_SHUFFLE(0, 3, 0, 1));
+    __m256i prod_lo = _mm256_mul_epu32(acc_vec, prime32);
+    __m256i prod_hi = _mm256_mul_epu32(acc_hi, prime32);
+    _mm256_storeu_si256(
+        xacc + i, _mm256_add_epi64(prod_lo, _mm256_slli_epi64(prod_hi, 32)));
+  }
+}
+#endif
+
+#if XXH_VECTOR_NEON
+static void XXH3_accumulate_neon(uint64_t *acc, const uint8_t *input,
+                                 const uint8_t *secret, size_t nbStripes) {
+  constexpr size_t NbLanes = XXH_STRIPE_LEN / sizeof(uint64x2_t);
+  uint64x2_t lanes[NbLanes];
+  for (size_t i = 0; i < NbLanes; ++i)
+    lanes[i] = vld1q_u64(acc + 2 * i);
+
+  for (size_t n = 0; n < nbStripes; ++n) {
+    const uint8_t *xinput = input + n * XXH_STRIPE_LEN;
+    const uint8_t *xsecret = secret + n * XXH_SECRET_CONSUME_RATE;
+    for (size_t i = 0; i < NbLanes; ++i) {
+      uint64x2_t data_vec = vreinterpretq_u64_u8(vld1q_u8(xinput + 16 * i));
+      uint64x2_t key_vec = vreinterpretq_u64_u8(vld1q_u8(xsecret + 16 * i));
+      uint64x2_t data_key = veorq_u64(data_vec, key_vec);
+      uint64x2_t data_swap = vextq_u64(data_vec, data_vec, 1);
+      uint64x2_t sum = vaddq_u64(lanes[i], data_swap);
+      lanes[i] =
+          vmlal_u32(sum, vmovn_u64(data_key), vshrn_n_u64(data_key, 32));
+    }
+  }
+
+  for (size_t i = 0; i < NbLanes; ++i)
+    vst1q_u64(acc + 2 * i, lanes[i]);
+}
+
+static void XXH3_scrambleAcc_neon(uint64_t *acc, const uint8_t *secret) {
+  constexpr size_t NbLanes = XXH_STRIPE_LEN / sizeof(uint64x2_t);
+  const uint32x2_t prime32 = vdup_n_u32(PRIME32_1);
+  for (size_t i = 0; i < NbLanes; ++i) {
+    uint64x2_t acc_vec = vld1q_u64(acc + 2 * i);
+    acc_vec = veorq_u64(acc_vec, vshrq_n_u64(acc_vec, 47));
+    acc_vec = veorq_u64(acc_vec,
+                        vreinterpretq_u64_u8(vld1q_u8(secret + 16 * i)));
+    uint64x2_t prod_hi = vmull_u32(vshrn_n_u64(acc_vec, 32), prime32);
+    prod_hi = vshlq_n_u64(prod_hi, 32);
+    vst1q_u64(acc + 2 * i, vmlal_u32(prod_hi, vmovn_u64(acc_vec), prime32));
+  }
+}
+#endif
+
+namespace {
+/// The kernels used to hash inputs longer than XXH3_MIDSIZE_MAX, which is
+/// where nearly all of the time goes for large inputs.
+struct XXH3Kernels {
+  void (*accumulate)(uint64_t *acc, const uint8_t *input,
+                     const uint8_t *secret, size_t nbStripes);
+  void (*scrambleAcc)(uint64_t *acc, const uint8_t *secret);
+};
+} // end anonymous namespace
+
+static XXH3Kernels XXH3_detectKernels() {
+#if XXH_DISPATCH_AVX2
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return {XXH3_accumulate_avx2, XXH3_scrambleAcc_avx2};
+#endif
+#if XXH_VECTOR_AVX2 && !XXH_DISPATCH_AVX2
+  return {XXH3_accumulate_avx2, XXH3_scrambleAcc_avx2};
+#elif XXH_VECTOR_SSE2
+  return {XXH3_accumulate_sse2, XXH3_scrambleAcc_sse2};
+#elif XXH_VECTOR_NEON
+  return {XXH3_accumulate_neon, XXH3_scrambleAcc_neon};
+#else
+  return {XXH3_accumulate_scalar, XXH3_scrambleAcc_scalar};
+#endif
+}
+
+static const XXH3Kernels &XXH3_getKernels() {
+  static const XXH3Kernels Kernels = XXH3_detectKernels();
+  return Kernels;
+}
+
 static uint64_t XXH3_mix2Accs(const uint64_t *acc, const uint8_t *secret) {
   return XXH3_mul128_fold64(acc[0] ^ endian::read64le(secret),
                             acc[1] ^ endian::read64le(secret + 8));
@@ -360,36 +577,43 @@ static uint64_t XXH3_mergeAccs(const uint64_t *acc, const uint8_t *key,
   return XXH3_avalanche(result64);
 }
 
-LLVM_ATTRIBUTE_NOINLINE
-static uint64_t XXH3_hashLong_64b(const uint8_t *input, size_t len,
-                                  const uint8_t *secret, size_t secretSize) {
+constexpr size_t XXH_SECRET_MERGEACCS_START = 11;
+
+LLVM_ATTRIBUTE_ALWAYS_INLINE
+static void XXH3_hashLong_internal_loop(uint64_t *acc, const uint8_t *input,
+                                        size_t len, const uint8_t *secret,
+                                        size_t secretSize) {
+  const XXH3Kernels &kernels = XXH3_getKernels();
   const size_t nbStripesPerBlock =
       (secretSize - XXH_STRIPE_LEN) / XXH_SECRET_CONSUME_RATE;
   const size_t block_len = XXH_STRIPE_LEN * nbStripesPerBlock;
   const size_t nb_blocks = (len - 1) / block_len;
-  alignas(16) uint64_t acc[XXH_ACC_NB] = {
-      PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3,
-      PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1,
-  };
   for (size_t n = 0; n < nb_blocks; ++n) {
-    XXH3_accumulate_scalar(acc, input + n * block_len, secret,
-                           nbStripesPerBlock);
-    XXH3_scrambleAcc(acc, secret + secretSize - XXH_STRIPE_LEN);
+    kernels.accumulate(acc, input + n * block_len, secret, nbStripesPerBlock);
+    kernels.scrambleAcc(acc, secret + secretSize - XXH_STRIPE_LEN);
   }
 
   /* last partial block */
   const size_t nbStripes = (len - 1 - (block_len * nb_blocks)) / XXH_STRIPE_LEN;
   assert(nbStripes <= secretSize / XXH_SECRET_CONSUME_RATE);
-  XXH3_accumulate_scalar(acc, input + nb_blocks * block_len, secret, nbStripes);
+  kernels.accumulate(acc, input + nb_blocks * block_len, secret, nbStripes);
 
   /* last stripe */
   constexpr size_t XXH_SECRET_LASTACC_START = 7;
-  XXH3_accumulate_512_scalar(acc, input + len - XXH_STRIPE_LEN,
-                             secret + secretSize - XXH_STRIPE_LEN -
-                                 XXH_SECRET_LASTACC_START);
+  kernels.accumulate(acc, input + len - XXH_STRIPE_LEN,
+                     secret + secretSize - XXH_STRIPE_LEN -
+                         XXH_SECRET_LASTACC_START,
+                     1);
+}
+
+LLVM_ATTRIBUTE_NOINLINE
+static uint64_t XXH3_hashLong_64b(const uint8_t *input, size_t len,
+                                  const uint8_t *secret, size_t secretSize) {
+  alignas(32) uint64_t acc[XXH_ACC_NB];
+  memcpy(acc, XXH3_INIT_ACC, sizeof(acc));
+  XXH3_hashLong_internal_loop(acc, input, len, secret, secretSize);
 
   /* converge into final hash */
-  constexpr size_t XXH_SECRET_MERGEACCS_START = 11;
   return XXH3_mergeAccs(acc, secret + XXH_SECRET_MERGEACCS_START,
                         (uint64_t)len * PRIME64_1);
 }
@@ -405,3 +629,259 @@ uint64_t llvm::xxh3_64bits(ArrayRef<uint8_t> data) {
     return XXH3_len_129to240_64b(in, len, kSecret, 0);
   return XXH3_hashLong_64b(in, len, kSecret, sizeof(kSecret));
 }
+
+/* ==========================================
+ * XXH3 128 bits (a.k.a XXH128)
+ * ==========================================
+ * XXH3's 128-bit variant has better mixing and strength than the 64-bit
+ * variant, even without counting the significantly larger output size.
+ *
+ * For example, extra steps are taken to avoid the seed-dependent collisions
+ * in 17-240 byte inputs (See XXH3_mix16B and XXH128_mix32B).
+ *
+ * This strength naturally comes at the cost of some speed, especially on short
+ * lengths. Note that longer hashes are about as fast as the 64-bit version
+ * due to it using only a slight modification of the 64-bit loop.
+ */
+
+// Calculates a 64-bit to 128-bit multiply.
+static XXH128_hash_t XXH_mult64to128(uint64_t lhs, uint64_t rhs) {
+#if defined(__SIZEOF_INT128__) ||                                              \
+    (defined(_INTEGRAL_MAX_BITS) && _INTEGRAL_MAX_BITS >= 128)
+  __uint128_t product = (__uint128_t)lhs * (__uint128_t)rhs;
+  return {uint64_t(product), uint64_t(product >> 64)};
+
+#else
+  /* First calculate all of the cross products. */
+  const uint64_t lo_lo = (lhs & 0xFFFFFFFF) * (rhs & 0xFFFFFFFF);
+  const uint64_t hi_lo = (lhs >> 32) * (rhs & 0xFFFFFFFF);
+  const uint64_t lo_hi = (lhs & 0xFFFFFFFF) * (rhs >> 32);
+  const uint64_t hi_hi = (lhs >> 32) * (rhs >> 32);
+
+  /* Now add the products together. These will never overflow. */
+  const uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+  const uint64_t upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+  const uint64_t lower = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+
+  return {lower, upper};
+#endif
+}
+
+LLVM_ATTRIBUTE_ALWAYS_INLINE
+static XXH128_hash_t XXH3_len_1to3_128b(const uint8_t *input, size_t len,
+                                        const uint8_t *secret, uint64_t seed) {
+  /* A doubled version of 1to3_64b with different constants. */
+  const uint8_t c1 = input[0];
+  const uint8_t c2 = input[len >> 1];
+  const uint8_t c3 = input[len - 1];
+  const uint32_t combinedl = ((uint32_t)c1 << 16) | ((uint32_t)c2 << 24) |
+                             ((uint32_t)c3 << 0) | ((uint32_t)len << 8);
+  const uint32_t combinedh = llvm::rotl(byteswap(combinedl), 13);
+  const uint64_t bitflipl =
+      (endian::read32le(secret) ^ endian::read32le(secret + 4)) + seed;
+  const uint64_t bitfliph =
+      (endian::read32le(secret + 8) ^ endian::read32le(secret + 12)) - seed;
+  const uint64_t keyed_lo = (uint64_t)combinedl ^ bitflipl;
+  const uint64_t keyed_hi = (uint64_t)combinedh ^ bitfliph;
+  return {XXH64_avalanche(keyed_lo), XXH64_avalanche(keyed_hi)};
+}
+
+LLVM_ATTRIBUTE_ALWAYS_INLINE
+static XXH128_hash_t XXH3_len_4to8_128b(const uint8_t *input, size_t len,
+                                        const uint8_t *secret, uint64_t seed) {
+  seed ^= (uint64_t)byteswap(uint32_t(seed)) << 32;
+  const uint32_t input_lo = endian::read32le(input);
+  const uint32_t input_hi = endian::read32le(input + len - 4);
+  const uint64_t input_64 = input_lo + ((uint64_t)input_hi << 32);
+  const uint64_t bitflip =
+      (endian::read64le(secret + 16) ^ endian::read64le(secret + 24)) + seed;
+  const uint64_t keyed = input_64 ^ bitflip;
+
+  /* Shift len to the left to ensure it is even, this avoids even multiplies. */
+  XXH128_hash_t m128 = XXH_mult64to128(keyed, PRIME64_1 + (len << 2));
+
+  m128.high64 += (m128.low64 << 1);
+  m128.low64 ^= (m128.high64 >> 3);
+
+  m128.low64 ^= m128.low64 >> 35;
+  m128.low64 *= PRIME_MX2;
+  m128.low64 ^= m128.low64 >> 28;
+  m128.high64 = XXH3_avalanche(m128.high64);
+  return m128;
+}
+
+LLVM_ATTRIBUTE_ALWAYS_INLINE
+static XXH128_hash_t XXH3_len_9to16_128b(const uint8_t *input, size_t len,
+                                         const uint8_t *secret,
+                                         uint64_t seed) {
+  const uint64_t bitflipl =
+      (endian::read64le(secret + 32) ^ endian::read64le(secret + 40)) - seed;
+  const uint64_t bitfliph =
+      (endian::read64le(secret + 48) ^ endian::read64le(secret + 56)) + seed;
+  const uint64_t input_lo = endian::read64le(input);
+  uint64_t input_hi = endian::read64le(input + len - 8);
+  XXH128_hash_t m128 =
+      XXH_mult64to128(input_lo ^ input_hi ^ bitflipl, PRIME64_1);
+  /*
+   * Put len in the middle of m128 to ensure that the length gets mixed to
+   * both the low and high bits in the 128x64 multiply below.
+   */
+  m128.low64 += (uint64_t)(len - 1) << 54;
+  input_hi ^= bitfliph;
+  /*
+   * Add the high 32 bits of input_hi to the high 32 bits of m128, then
+   * add the long product of the low 32 bits of input_hi and PRIME32_2 to
+   * the high 64 bits of m128.
+   */
+  m128.high64 += input_hi + uint64_t(uint32_t(input_hi)) * (PRIME32_2 - 1);
+  /* m128 ^= XXH_swap64(m128 >> 64); */
+  m128.low64 ^= byteswap(m128.high64);
+
+  /* 128x64 multiply: h128 = m128 * PRIME64_2; */
+  XXH128_hash_t h128 = XXH_mult64to128(m128.low64, PRIME64_2);
+  h128.high64 += m128.high64 * PRIME64_2;
+
+  h128.low64 = XXH3_avalanche(h128.low64);
+  h128.high64 = XXH3_avalanche(h128.high64);
+  return h128;
+}
+
+/*
+ * Assumption: `secret` size is >= XXH3_SECRET_SIZE_MIN
+ */
+LLVM_ATTRIBUTE_ALWAYS_INLINE
+static XXH128_hash_t XXH3_len_0to16_128b(const uint8_t *input, size_t len,
+                                         const uint8_t *secret,
+                                         uint64_t seed) {
+  if (len > 8)
+    return XXH3_len_9to16_128b(input, len, secret, seed);
+  if (len >= 4)
+    return XXH3_len_4to8_128b(input, len, secret, seed);
+  if (len)
+    return XXH3_len_1to3_128b(input, len, secret, seed);
+  const uint64_t bitflipl =
+      endian::read64le(secret + 64) ^ endian::read64le(secret + 72);
+  const uint64_t bitfliph =
+      endian::read64le(secret + 80) ^ endian::read64le(secret + 88);
+  return {XXH64_avalanche(seed ^ bitflipl), XXH64_avalanche(seed ^ bitfliph)};
+}
+
+/*
+ * A bit slower than XXH3_mix16B, but handles multiply by zero better.
+ */
+LLVM_ATTRIBUTE_ALWAYS_INLINE
+static XXH128_hash_t XXH128_mix32B(XXH128_hash_t acc, const uint8_t *input_1,
+                                   const uint8_t *input_2,
+                                   const uint8_t *secret, uint64_t seed) {
+  acc.low64 += XXH3_mix16B(input_1, secret + 0, seed);
+  acc.low64 ^= endian::read64le(input_2) + endian::read64le(input_2 + 8);
+  acc.high64 += XXH3_mix16B(input_2, secret + 16, seed);
+  acc.high64 ^= endian::read64le(input_1) + endian::read64le(input_1 + 8);
+  return acc;
+}
+
+static XXH128_hash_t XXH3_finalizeMid128b(XXH128_hash_t acc, size_t len,
+                                          uint64_t seed) {
+  XXH128_hash_t h128;
+  h128.low64 = acc.low64 + acc.high64;
+  h128.high64 = (acc.low64 * PRIME64_1) + (acc.high64 * PRIME64_4) +
+                ((len - seed) * PRIME64_2);
+  h128.low64 = XXH3_avalanche(h128.low64);
+  h128.high64 = (uint64_t)0 - XXH3_avalanche(h128.high64);
+  return h128;
+}
+
+LLVM_ATTRIBUTE_ALWAYS_INLINE
+static XXH128_hash_t XXH3_len_17to128_128b(const uint8_t *input, size_t len,
+                                           const uint8_t *secret,
+                                           uint64_t seed) {
+  XXH128_hash_t acc;
+  acc.low64 = len * PRIME64_1;
+  acc.high64 = 0;
+  if (len > 32) {
+    if (len > 64) {
+      if (len > 96)
+        acc = XXH128_mix32B(acc, input + 48, input + len - 64, secret + 96,
+                            seed);
+      acc =
+          XXH128_mix32B(acc, input + 32, input + len - 48, secret + 64, seed);
+    }
+    acc = XXH128_mix32B(acc, input + 16, input + len - 32, secret + 32, seed);
+  }
+  acc = XXH128_mix32B(acc, input, input + len - 16, secret, seed);
+  return XXH3_finalizeMid128b(acc, len, seed);
+}
+
+LLVM_ATTRIBUTE_NOINLINE
+static XXH128_hash_t XXH3_len_129to240_128b(const uint8_t *input, size_t len,
+                                            const uint8_t *secret,
+                                            uint64_t seed) {
+  constexpr size_t XXH3_MIDSIZE_STARTOFFSET = 3;
+  constexpr size_t XXH3_MIDSIZE_LASTOFFSET = 17;
+  XXH128_hash_t acc;
+  acc.low64 = len * PRIME64_1;
+  acc.high64 = 0;
+  /*
+   *  We set as `i` as offset + 32. We do this so that unchanged
+   * `len` can be used as upper bound. This reaches a sweet spot
+   * where both x86 and aarch64 get simple agen and good codegen
+   * for the loop.
+   */
+  for (size_t i = 32; i < 160; i += 32)
+    acc = XXH128_mix32B(acc, input + i - 32, input + i - 16, secret + i - 32,
+                        seed);
+  acc.low64 = XXH3_avalanche(acc.low64);
+  acc.high64 = XXH3_avalanche(acc.high64);
+  /*
+   * NB: `i <= len` will duplicate the last 32-bytes if
+   * len % 32 was zero. This is an unfortunate necessity to keep
+   * the hash result stable.
+   */
+  for (size_t i = 160; i <= len; i += 32)
+    acc = XXH128_mix32B(acc, input + i - 32, input + i - 16,
+                        secret + XXH3_MIDSIZE_STARTOFFSET + i - 160, seed);
+  /* last bytes */
+  acc = XXH128_mix32B(acc, input + len - 16, input + len - 32,
+                      secret + XXH3_SECRETSIZE_MIN - XXH3_MIDSIZE_LASTOFFSET -
+                          16,
+                      (uint64_t)0 - seed);
+  return XXH3_finalizeMid128b(acc, len, seed);
+}
+
+LLVM_ATTRIBUTE_NOINLINE
+static XXH128_hash_t XXH3_hashLong_128b(const uint8_t *input, size_t len,
+                                        const uint8_t *secret,
+                                        size_t secretSize) {
+  alignas(32) uint64_t acc[XXH_ACC_NB];
+  memcpy(acc, XXH3_INIT_ACC, sizeof(acc));
+  XXH3_hashLong_internal_loop(acc, input, len, secret, secretSize);
+
+  /* converge into final hash */
+  static_assert(sizeof(acc) == 64, "unexpected accumulator size");
+  XXH128_hash_t h128;
+  h128.low64 = XXH3_mergeAccs(acc, secret + XXH_SECRET_MERGEACCS_START,
+                              (uint64_t)len * PRIME64_1);
+  h128.high64 = XXH3_mergeAccs(
+      acc, secret + secretSize - sizeof(acc) - XXH_SECRET_MERGEACCS_START,
+      ~((uint64_t)len * PRIME64_2));
+  return h128;
+}
+
+llvm::XXH128_hash_t llvm::xxh3_128bits(ArrayRef<uint8_t> data) {
+  size_t len = data.size();
+  const uint8_t *input = data.data();
+
+  /*
+   * If an action is to be taken if `secret` conditions are not respected,
+   * it should be done here.
+   * For now, it's a contract pre-condition.
+   * Adding a check and a branch here would cost performance at every hash.
+   */
+  if (len <= 16)
+    return XXH3_len_0to16_128b(input, len, kSecret, /*seed64=*/0);
+  if (len <= 128)
+    return XXH3_len_17to128_128b(input, len, kSecret, /*seed64=*/0);
+  if (len <= XXH3_MIDSIZE_MAX)
+    return XXH3_len_129to240_128b(input, len, kSecret, /*seed64=*/0);
+  return XXH3_hashLong_128b(input, len, kSecret, sizeof(kSecret));
+}
@@ -11,11 +11,17 @@
 #include "llvm/MC/MCDecoderOps.h"
 #include "llvm/MC/MCDisassembler/MCDisassembler.h"
 #include "llvm/MC/MCInst.h"
+#include "llvm/MC/MCInstrInfo.h"
 #include "llvm/MC/MCSubtargetInfo.h"
 #include "llvm/MC/TargetRegistry.h"
 #include "llvm/Support/Compiler.h"
+#include "llvm/Support/LEB128.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <cstdint>
+#include <iterator>
+#include <memory>
 
 using namespace llvm;
 
@@ -25,10 +31,41 @@ using DecodeStatus = MCDisassembler::DecodeStatus;
 
 namespace {
 
+// All instructions are first dispatched on the primary opcode in the upper 6
+// bits. The generated decoder tables test the primary opcode values one after
+// the other, which is the dominating cost when disassembling large images.
+// This index records where the decoding of each primary opcode starts, so that
+// the decoder can jump right to it.
+class PrimaryOpcodeIndex {
+  static constexpr unsigned Start = 26;
+  static constexpr unsigned Len = 6;
+  static constexpr uint32_t NoEntry = ~0U;
+
+  const uint8_t *Table;
+  uint32_t Offsets[1 << Len];
+  bool Valid = false;
+
+public:
+  PrimaryOpcodeIndex(const uint8_t *Table);
+
+  // Returns the decoder table to use for Inst, or nullptr if no instruction
+  // has this primary opcode.
+  const uint8_t *lookup(uint32_t Inst) const {
+    if (!Valid)
+      return Table;
+    uint32_t Offset = Offsets[Inst >> Start];
+    return Offset == NoEntry ? nullptr : Table + Offset;
+  }
+};
+
 class M88kDisassembler : public MCDisassembler {
+  std::unique_ptr<const MCInstrInfo> MCII;
+  PrimaryOpcodeIndex M88kIndex;
+  PrimaryOpcodeIndex MC88110Index;
+
 public:
-  M88kDisassembler(const MCSubtargetInfo &STI, MCContext &Ctx)
-      : MCDisassembler(STI, Ctx) {}
+  M88kDisassembler(const MCSubtargetInfo &STI, MCContext &Ctx,
+                   const MCInstrInfo *MCII);
   ~M88kDisassembler() override = default;
 
   DecodeStatus getInstruction(MCInst &Instr, uint64_t &Size,
@@ -41,7 +78,7 @@ public:
 static MCDisassembler *createM88kDisassembler(const Target &T,
                                               const MCSubtargetInfo &STI,
                                               MCContext &Ctx) {
-  return new M88kDisassembler(STI, Ctx);
+  return new M88kDisassembler(STI, Ctx, T.createMCInstrInfo());
 }
 
 // NOLINTNEXTLINE(readability-identifier-naming)
@@ -225,6 +262,41 @@ static DecodeStatus decodePC16BranchOperand(MCInst &Inst, uint64_t Imm,
 
 #include "M88kGenDisassemblerTables.inc"
 
+PrimaryOpcodeIndex::PrimaryOpcodeIndex(const uint8_t *Table) : Table(Table) {
+  std::fill(std::begin(Offsets), std::end(Offsets), NoEntry);
+
+  // The table must start with the extraction of the primary opcode, followed
+  // by a filter for each value. Each filter skips to the next one if the value
+  // does not match, and the last one skips to the final failure. Otherwise the
+  // whole table is used.
+  const uint8_t *Ptr = Table;
+  unsigned N;
+  if (*Ptr++ != MCD::OPC_ExtractField || decodeULEB128(Ptr, &N) != Start)
+    return;
+  Ptr += N;
+  if (*Ptr++ != Len)
+    return;
+  while (*Ptr == MCD::OPC_FilterValue) {
+    uint64_t Val = decodeULEB128(++Ptr, &N);
+    Ptr += N;
+    if (Val >= (1 << Len))
+      return;
+    // NumToSkip is a plain 24-bit integer.
+    unsigned NumToSkip = Ptr[0] | (Ptr[1] << 8) | (Ptr[2] << 16);
+    Ptr += 3;
+    // The decoding of a primary opcode never continues with the next filter,
+    // so it is safe to start right after the filter.
+    Offsets[Val] = Ptr - Table;
+    Ptr += NumToSkip;
+  }
+  Valid = *Ptr == MCD::OPC_Fail;
+}
+
+M88kDisassembler::M88kDisassembler(const MCSubtargetInfo &STI, MCContext &Ctx,
+                                   const MCInstrInfo *MCII)
+    : MCDisassembler(STI, Ctx), MCII(MCII), M88kIndex(DecoderTableM88k32),
+      MC88110Index(DecoderTableMC8811032) {}
+
 DecodeStatus M88kDisassembler::getInstruction(MCInst &MI, uint64_t &Size,
                                               ArrayRef<uint8_t> Bytes,
                                               uint64_t Address,
@@ -241,12 +313,24 @@ DecodeStatus M88kDisassembler::getInstruction(MCInst &MI, uint64_t &Size,
   for (uint32_t I = 0; I < Size; ++I)
     Inst = (Inst << 8) | Bytes[I];
 
-  if (decodeInstruction(DecoderTableM88k32, MI, Inst, Address, this, STI) !=
-      MCDisassembler::Success) {
-    if (STI.getFeatureBits()[M88k::Proc88110])
-      return decodeInstruction(DecoderTableMC8811032, MI, Inst, Address, this,
-                               STI);
-    return MCDisassembler::Fail;
+  const uint8_t *Table = M88kIndex.lookup(Inst);
+  if (!Table ||
+      decodeInstruction(Table, MI, Inst, Address, this, STI) !=
+          MCDisassembler::Success) {
+    if (!STI.getFeatureBits()[M88k::Proc88110])
+      return MCDisassembler::Fail;
+    Table = MC88110Index.lookup(Inst);
+    MI.clear();
+    if (!Table || decodeInstruction(Table, MI, Inst, Address, this, STI) !=
+                      MCDisassembler::Success)
+      return MCDisassembler::Fail;
   }
+
+  // The instruction following a branch with delay slot is executed before
+  // the branch is taken. Only the bytes from Address on are available, so the
+  // branch is annotated rather than the instruction in its delay slot.
+  if (MCII->get(MI.getOpcode()).hasDelaySlot())
+    CS << "delay slot follows";
+
   return MCDisassembler::Success;
 }
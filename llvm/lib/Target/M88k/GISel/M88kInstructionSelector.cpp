@@ -460,18 +460,11 @@ bool M88kInstructionSelector::selectGlobalValue(
 
   const GlobalValue *GV = I.getOperand(1).getGlobal();
 
-  Register Temp = MRI.createVirtualRegister(&M88k::GPRRegClass);
-  MachineInstr *MI = BuildMI(MBB, I, I.getDebugLoc(), TII.get(M88k::ORriu))
-                         .addReg(Temp, RegState::Define)
-                         .addReg(M88k::R0)
-                         .addGlobalAddress(GV, 0, M88kII::MO_ABS_HI);
-  if (!constrainSelectedInstRegOperands(*MI, MRI, TII, TRI, RBI))
-    return false;
-
-  MI = BuildMI(MBB, I, I.getDebugLoc(), TII.get(M88k::ORri))
-           .add(I.getOperand(0))
-           .addReg(Temp, RegState::Kill)
-           .addGlobalAddress(GV, 0, M88kII::MO_ABS_LO);
+  // The address is materialized with a rematerializable pseudo instruction,
+  // which is expanded after register allocation.
+  MachineInstr *MI = BuildMI(MBB, I, I.getDebugLoc(), TII.get(M88k::MOVri32))
+                         .add(I.getOperand(0))
+                         .addGlobalAddress(GV);
 
   I.eraseFromParent();
   return constrainSelectedInstRegOperands(*MI, MRI, TII, TRI, RBI);
@@ -723,10 +716,15 @@ bool M88kInstructionSelector::selectBrJT(MachineInstr &I,
 
   Register DstReg = MRI.createVirtualRegister(&M88k::GPRRegClass);
   if (EntrySize == 4) {
-    MI = BuildMI(MBB, I, I.getDebugLoc(), TII.get(M88k::LDrrsw))
+    // The pseudo instruction allows the jump table to be compressed after the
+    // final layout of the function is known.
+    Register ScratchReg = MRI.createVirtualRegister(&M88k::GPRRegClass);
+    MI = BuildMI(MBB, I, I.getDebugLoc(), TII.get(M88k::JTDEST32))
              .addReg(DstReg, RegState::Define)
+             .addReg(ScratchReg, RegState::Define | RegState::Dead)
              .addReg(JTPtrReg)
-             .addReg(JTIndexReg);
+             .addReg(JTIndexReg)
+             .addJumpTableIndex(I.getOperand(1).getIndex());
   } else {
     MI = BuildMI(MBB, I, I.getDebugLoc(), TII.get(M88k::LDrruw))
              .addReg(DstReg, RegState::Define)
@@ -0,0 +1,90 @@
+//===-- M88kRegBankSelect.cpp -----------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/// \file
+/// This file implements the M88k specific register bank selection pass. The
+/// assignment itself is done by the generic pass. On the MC88110, floating
+/// point values can live in either the GR or the XR register bank, and each
+/// copy between the banks is a transfer between the register files. The
+/// number of these copies is reported as an analysis remark.
+//===----------------------------------------------------------------------===//
+
+#include "M88kRegBankSelect.h"
+#include "M88k.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/OptimizationRemarkEmitter.h"
+#include "llvm/CodeGen/MachineFunction.h"
+#include "llvm/CodeGen/MachineOptimizationRemarkEmitter.h"
+#include "llvm/CodeGen/MachineRegisterInfo.h"
+#include "llvm/CodeGen/RegisterBank.h"
+#include "llvm/CodeGen/RegisterBankInfo.h"
+#include "llvm/InitializePasses.h"
+
+#define DEBUG_TYPE "m88k-regbankselect"
+
+using namespace llvm;
+
+STATISTIC(NumCrossBankCopies,
+          "Number of copies between register banks after bank selection");
+
+M88kRegBankSelect::M88kRegBankSelect(Mode RunningMode)
+    : RegBankSelect(M88kRegBankSelect::ID, RunningMode) {
+  initializeM88kRegBankSelectPass(*PassRegistry::getPassRegistry());
+}
+
+char M88kRegBankSelect::ID = 0;
+
+INITIALIZE_PASS_BEGIN(M88kRegBankSelect, DEBUG_TYPE,
+                      "M88k Register Bank Select", false, false)
+INITIALIZE_PASS_DEPENDENCY(MachineBlockFrequencyInfo)
+INITIALIZE_PASS_DEPENDENCY(MachineBranchProbabilityInfo)
+INITIALIZE_PASS_DEPENDENCY(TargetPassConfig)
+INITIALIZE_PASS_END(M88kRegBankSelect, DEBUG_TYPE,
+                    "M88k Register Bank Select", false, false)
+
+bool M88kRegBankSelect::runOnMachineFunction(MachineFunction &MF) {
+  // If the ISel pipeline failed, do not bother running that pass.
+  if (MF.getProperties().hasProperty(
+          MachineFunctionProperties::Property::FailedISel))
+    return false;
+
+  bool Changed = RegBankSelect::runOnMachineFunction(MF);
+  reportCrossBankCopies(MF);
+  return Changed;
+}
+
+void M88kRegBankSelect::reportCrossBankCopies(MachineFunction &MF) {
+  // Counting is only necessary for the statistic or the remark.
+  if (!AreStatisticsEnabled() && !MORE->allowExtraAnalysis(DEBUG_TYPE))
+    return;
+
+  unsigned NumCopies = 0;
+  for (const MachineBasicBlock &MBB : MF) {
+    for (const MachineInstr &MI : MBB) {
+      if (!MI.isCopy())
+        continue;
+      const RegisterBank *DstRB =
+          RBI->getRegBank(MI.getOperand(0).getReg(), *MRI, *TRI);
+      const RegisterBank *SrcRB =
+          RBI->getRegBank(MI.getOperand(1).getReg(), *MRI, *TRI);
+      if (DstRB && SrcRB && DstRB != SrcRB)
+        ++NumCopies;
+    }
+  }
+  NumCrossBankCopies += NumCopies;
+
+  if (NumCopies == 0)
+    return;
+  MORE->emit([&]() {
+    MachineOptimizationRemarkAnalysis R(DEBUG_TYPE, "CrossBankCopies",
+                                        MF.getFunction().getSubprogram(),
+                                        &MF.front());
+    R << ore::NV("NumCopies", NumCopies)
+      << " copies between register banks";
+    return R;
+  });
+}
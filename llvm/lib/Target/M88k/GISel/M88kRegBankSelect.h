@@ -0,0 +1,38 @@
+//===-- M88kRegBankSelect.h -------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/// \file
+/// This file declares the M88k specific register bank selection pass.
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_LIB_TARGET_M88K_GISEL_M88KREGBANKSELECT_H
+#define LLVM_LIB_TARGET_M88K_GISEL_M88KREGBANKSELECT_H
+
+#include "llvm/CodeGen/GlobalISel/RegBankSelect.h"
+
+namespace llvm {
+
+/// Register bank selection which reports the copies between the register
+/// banks remaining in a function.
+class M88kRegBankSelect final : public RegBankSelect {
+public:
+  static char ID;
+
+  M88kRegBankSelect(Mode RunningMode = Fast);
+
+  StringRef getPassName() const override { return "M88kRegBankSelect"; }
+
+  bool runOnMachineFunction(MachineFunction &MF) override;
+
+private:
+  /// Count the copies between different register banks, and report them as
+  /// an optimization remark.
+  void reportCrossBankCopies(MachineFunction &MF);
+};
+
+} // end namespace llvm
+#endif
@@ -24,6 +24,7 @@
 #include "llvm/CodeGen/TargetSubtargetInfo.h"
 #include "llvm/CodeGenTypes/LowLevelType.h"
 #include "llvm/IR/IntrinsicsM88k.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/ErrorHandling.h"
 #include <cassert>
@@ -36,6 +37,10 @@
 
 using namespace llvm;
 
+static cl::opt<unsigned> CrossBankCopyCost(
+    "m88k-cross-bank-copy-cost", cl::Hidden, cl::init(3),
+    cl::desc("M88k: Cost of a copy between the GR and the XR register bank."));
+
 M88kRegisterBankInfo::M88kRegisterBankInfo(const TargetRegisterInfo &TRI)
     : M88kGenRegisterBankInfo() {}
 
@@ -345,6 +350,19 @@ M88kRegisterBankInfo::getInstrAlternativeMappings(
   return RegisterBankInfo::getInstrAlternativeMappings(MI);
 }
 
+unsigned M88kRegisterBankInfo::copyCost(const RegisterBank &A,
+                                        const RegisterBank &B,
+                                        TypeSize Size) const {
+  // A copy between the GR and the XR register file is executed by the floating
+  // point unit, and is more expensive than a simple integer instruction. A
+  // 64 bit value requires a register pair in the GR bank.
+  if ((A.getID() == M88k::GRRegBankID && B.getID() == M88k::XRRegBankID) ||
+      (A.getID() == M88k::XRRegBankID && B.getID() == M88k::GRRegBankID))
+    return Size.getFixedValue() > 32 ? CrossBankCopyCost + 1
+                                     : CrossBankCopyCost;
+  return RegisterBankInfo::copyCost(A, B, Size);
+}
+
 void M88kRegisterBankInfo::applyMappingImpl(
     MachineIRBuilder &Builder, const OperandsMapper &OpdMapper) const {
   return applyDefaultMapping(OpdMapper);
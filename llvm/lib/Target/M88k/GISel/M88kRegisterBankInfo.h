@@ -88,6 +88,9 @@ public:
   InstructionMappings
   getInstrAlternativeMappings(const MachineInstr &MI) const override;
 
+  unsigned copyCost(const RegisterBank &A, const RegisterBank &B,
+                    TypeSize Size) const override;
+
   void applyMappingImpl(MachineIRBuilder &Builder,
                         const OperandsMapper &OpdMapper) const override;
 };
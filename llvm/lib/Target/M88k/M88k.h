@@ -35,12 +35,15 @@ createM88kInstructionSelector(const M88kTargetMachine &, const M88kSubtarget &,
 FunctionPass *createM88kPreLegalizerCombiner();
 FunctionPass *createM88kPostLegalizerCombiner(bool IsOptNone);
 FunctionPass *createM88kPostLegalizerLowering(bool IsOptNone);
+FunctionPass *createM88kCompressJumpTables();
 FunctionPass *createM88kDelaySlotFiller();
 FunctionPass *createM88kFFS();
 
 void initializeM88kPreLegalizerCombinerPass(PassRegistry &Registry);
 void initializeM88kPostLegalizerCombinerPass(PassRegistry &Registry);
 void initializeM88kPostLegalizerLoweringPass(PassRegistry &Registry);
+void initializeM88kRegBankSelectPass(PassRegistry &Registry);
+void initializeM88kCompressJumpTablesPass(PassRegistry &Registry);
 void initializeM88kDelaySlotFillerPass(PassRegistry &Registry);
 void initializeM88kFFSPass(PassRegistry &Registry);
 
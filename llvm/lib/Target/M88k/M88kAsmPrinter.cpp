@@ -11,17 +11,26 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "M88kInstrInfo.h"
 #include "M88kMCInstLower.h"
+#include "M88kMachineFunctionInfo.h"
 #include "M88kSubtarget.h"
 #include "MCTargetDesc/M88kInstPrinter.h"
+#include "MCTargetDesc/M88kMCExpr.h"
 #include "MCTargetDesc/M88kMCTargetDesc.h"
 #include "TargetInfo/M88kTargetInfo.h"
+#include "llvm/Analysis/OptimizationRemarkEmitter.h"
 #include "llvm/CodeGen/AsmPrinter.h"
+#include "llvm/CodeGen/LazyMachineBlockFrequencyInfo.h"
+#include "llvm/CodeGen/MachineBranchProbabilityInfo.h"
 #include "llvm/CodeGen/MachineInstr.h"
+#include "llvm/CodeGen/MachineJumpTableInfo.h"
+#include "llvm/CodeGen/MachineOptimizationRemarkEmitter.h"
 #include "llvm/CodeGen/TargetLoweringObjectFileImpl.h"
 #include "llvm/IR/Mangler.h"
 #include "llvm/MC/MCAsmInfo.h"
 #include "llvm/MC/MCContext.h"
+#include "llvm/MC/MCExpr.h"
 #include "llvm/MC/MCInst.h"
 #include "llvm/MC/MCInstBuilder.h"
 #include "llvm/MC/MCStreamer.h"
@@ -54,12 +63,25 @@ public:
 
   StringRef getPassName() const override { return "M88k Assembly Printer"; }
 
+  void getAnalysisUsage(AnalysisUsage &AU) const override;
+
   bool PrintAsmOperand(const MachineInstr *MI, unsigned OpNo,
                        const char *ExtraCode, raw_ostream &OS) override;
   void emitInstruction(const MachineInstr *MI) override;
+  void emitFunctionBodyEnd() override;
+  void emitJumpTableInfo() override;
+
+private:
+  void lowerJumpTableDest(const MachineInstr &MI);
 };
 } // end of anonymous namespace
 
+void M88kAsmPrinter::getAnalysisUsage(AnalysisUsage &AU) const {
+  AsmPrinter::getAnalysisUsage(AU);
+  AU.addRequired<LazyMachineBlockFrequencyInfoPass>();
+  AU.addRequired<MachineBranchProbabilityInfo>();
+}
+
 bool M88kAsmPrinter::PrintAsmOperand(const MachineInstr *MI, unsigned OpNo,
                                      const char *ExtraCode, raw_ostream &OS) {
   if (ExtraCode)
@@ -82,6 +104,11 @@ void M88kAsmPrinter::emitInstruction(const MachineInstr *MI) {
 
     MCInst LoweredMI;
     switch (I->getOpcode()) {
+    case M88k::JTDEST32:
+    case M88k::JTDEST16:
+    case M88k::JTDEST8:
+      lowerJumpTableDest(*I);
+      continue;
     default:
       M88kMCInstLower Lower(MF->getContext(), *this);
       Lower.lower(&*I, LoweredMI);
@@ -92,6 +119,154 @@ void M88kAsmPrinter::emitInstruction(const MachineInstr *MI) {
   } while ((++I != E) && I->isInsideBundle()); // Delay slot check.
 }
 
+void M88kAsmPrinter::lowerJumpTableDest(const MachineInstr &MI) {
+  const TargetRegisterInfo *TRI = MF->getSubtarget().getRegisterInfo();
+  M88kMCInstLower Lower(MF->getContext(), *this);
+  MCOperand Dest = Lower.lowerOperand(MI.getOperand(0), TRI);
+  MCOperand Scratch = Lower.lowerOperand(MI.getOperand(1), TRI);
+  MCOperand Table = Lower.lowerOperand(MI.getOperand(2), TRI);
+  MCOperand Entry = Lower.lowerOperand(MI.getOperand(3), TRI);
+  int JTIdx = MI.getOperand(4).getIndex();
+
+  auto *MFI = MF->getInfo<M88kMachineFunctionInfo>();
+  unsigned Size = MFI->getJumpTableEntrySize(JTIdx);
+
+  // An uncompressed table holds the addresses of the target blocks.
+  if (Size == 4) {
+    EmitToStreamer(*OutStreamer, MCInstBuilder(M88k::LDrrsw)
+                                     .addOperand(Dest)
+                                     .addOperand(Table)
+                                     .addOperand(Entry));
+    return;
+  }
+
+  // Load the distance in words to the base block. The table and the entry
+  // register may be reused for the destination, so the load must be first.
+  EmitToStreamer(*OutStreamer,
+                 MCInstBuilder(Size == 1 ? M88k::LDurrub : M88k::LDurrsh)
+                     .addOperand(Scratch)
+                     .addOperand(Table)
+                     .addOperand(Entry));
+
+  // Materialize the address of the base block.
+  const MCExpr *Base =
+      MCSymbolRefExpr::create(MFI->getJumpTableEntryBase(JTIdx), OutContext);
+  EmitToStreamer(*OutStreamer,
+                 MCInstBuilder(M88k::ORriu)
+                     .addOperand(Dest)
+                     .addReg(M88k::R0)
+                     .addExpr(M88kMCExpr::create(M88kMCExpr::VK_ABS_HI, Base,
+                                                 OutContext)));
+  EmitToStreamer(*OutStreamer,
+                 MCInstBuilder(M88k::ORri)
+                     .addOperand(Dest)
+                     .addOperand(Dest)
+                     .addExpr(M88kMCExpr::create(M88kMCExpr::VK_ABS_LO, Base,
+                                                 OutContext)));
+
+  // The scaled lda adds the distance multiplied by 4.
+  EmitToStreamer(*OutStreamer, MCInstBuilder(M88k::LDAws)
+                                   .addOperand(Dest)
+                                   .addOperand(Dest)
+                                   .addOperand(Scratch));
+}
+
+void M88kAsmPrinter::emitJumpTableInfo() {
+  auto *MFI = MF->getInfo<M88kMachineFunctionInfo>();
+  if (!MFI->hasCompressedJumpTables()) {
+    AsmPrinter::emitJumpTableInfo();
+    return;
+  }
+
+  // Compressed tables are only created for absolute block addresses, which
+  // are always placed in the read-only section.
+  const MachineJumpTableInfo *MJTI = MF->getJumpTableInfo();
+  const TargetLoweringObjectFile &TLOF = getObjFileLowering();
+  OutStreamer->switchSection(
+      TLOF.getSectionForJumpTable(MF->getFunction(), TM));
+
+  const std::vector<MachineJumpTableEntry> &JT = MJTI->getJumpTables();
+  for (unsigned JTI = 0, E = JT.size(); JTI != E; ++JTI) {
+    const std::vector<MachineBasicBlock *> &JTBBs = JT[JTI].MBBs;
+
+    // If this jump table was deleted, ignore it.
+    if (JTBBs.empty())
+      continue;
+
+    unsigned Size = MFI->getJumpTableEntrySize(JTI);
+    emitAlignment(Align(Size));
+    OutStreamer->emitLabel(GetJTISymbol(JTI));
+
+    const MCSymbol *BaseSym = MFI->getJumpTableEntryBase(JTI);
+    for (const MachineBasicBlock *JTBB : JTBBs) {
+      // Each entry is either
+      //     .word LBB
+      // or
+      //     .byte/.half (LBB - Lbase) >> 2
+      const MCExpr *Value =
+          MCSymbolRefExpr::create(JTBB->getSymbol(), OutContext);
+      if (BaseSym) {
+        Value = MCBinaryExpr::createSub(
+            Value, MCSymbolRefExpr::create(BaseSym, OutContext), OutContext);
+        Value = MCBinaryExpr::createLShr(
+            Value, MCConstantExpr::create(2, OutContext), OutContext);
+      }
+      OutStreamer->emitValue(Value, Size);
+    }
+  }
+}
+
+// Report how often the conditional branches of the function are taken and not
+// taken, weighted by the (profile) block frequencies. Taken branches with an
+// unfilled delay slot are the most expensive ones, and are reported separately.
+void M88kAsmPrinter::emitFunctionBodyEnd() {
+  if (!ORE->allowExtraAnalysis(DEBUG_TYPE))
+    return;
+
+  const MachineBlockFrequencyInfo &MBFI =
+      getAnalysis<LazyMachineBlockFrequencyInfoPass>().getBFI();
+  const MachineBranchProbabilityInfo &MBPI =
+      getAnalysis<MachineBranchProbabilityInfo>();
+  const M88kInstrInfo &TII = *MF->getSubtarget<M88kSubtarget>().getInstrInfo();
+
+  unsigned NumCondBranches = 0;
+  double Taken = 0.0, TakenUnfilled = 0.0, NotTaken = 0.0;
+  for (const MachineBasicBlock &MBB : *MF) {
+    double Freq = MBFI.getBlockFreqRelativeToEntryBlock(&MBB);
+    for (const MachineInstr &MI : MBB.instrs()) {
+      if (!MI.getDesc().isConditionalBranch())
+        continue;
+      BranchProbability Prob =
+          MBPI.getEdgeProbability(&MBB, TII.getBranchDestBlock(MI));
+      double TakenFreq =
+          Freq * Prob.getNumerator() / BranchProbability::getDenominator();
+      ++NumCondBranches;
+      Taken += TakenFreq;
+      NotTaken += Freq - TakenFreq;
+      // The filler replaces the opcode only if it filled the delay slot.
+      if (M88k::getOpcodeWithDelaySlot(MI.getOpcode()) != -1)
+        TakenUnfilled += TakenFreq;
+    }
+  }
+
+  double Total = Taken + NotTaken;
+  if (NumCondBranches == 0 || Total <= 0.0)
+    return;
+
+  auto Percent = [Total](double Val) {
+    return static_cast<unsigned>(100.0 * Val / Total + 0.5);
+  };
+  MachineOptimizationRemarkAnalysis R(DEBUG_TYPE, "BranchDirections",
+                                      MF->getFunction().getSubprogram(),
+                                      &MF->front());
+  R << ore::NV("NumCondBranches", NumCondBranches)
+    << " conditional branches: " << ore::NV("TakenPercent", Percent(Taken))
+    << "% taken (" << ore::NV("UnfilledTakenPercent", Percent(TakenUnfilled))
+    << "% with an unfilled delay slot), "
+    << ore::NV("NotTakenPercent", Percent(NotTaken)) << "% not taken";
+  ORE->emit(R);
+}
+
 // Force static initialization.
 // NOLINTNEXTLINE(readability-identifier-naming)
 extern "C" LLVM_EXTERNAL_VISIBILITY void LLVMInitializeM88kAsmPrinter() {
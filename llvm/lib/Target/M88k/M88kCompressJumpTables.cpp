@@ -0,0 +1,187 @@
+//===-- M88kCompressJumpTables.cpp - Compress jump tables for M88k --------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass looks at the basic blocks each jump table refers to, and works out
+// whether the table can be emitted with 8-bit or 16-bit entries. A compressed
+// entry holds the distance in words from the lowest addressed target block.
+// The decision is based on the final layout of the function, so the pass runs
+// after branch relaxation.
+//
+//===----------------------------------------------------------------------===//
+
+#include "M88kInstrInfo.h"
+#include "M88kMachineFunctionInfo.h"
+#include "M88kSubtarget.h"
+#include "MCTargetDesc/M88kMCTargetDesc.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/CodeGen/MachineBasicBlock.h"
+#include "llvm/CodeGen/MachineFunction.h"
+#include "llvm/CodeGen/MachineFunctionPass.h"
+#include "llvm/CodeGen/MachineJumpTableInfo.h"
+#include "llvm/Support/Alignment.h"
+#include "llvm/Support/MathExtras.h"
+#include <limits>
+#include <optional>
+
+#define DEBUG_TYPE "m88k-compress-jump-tables"
+
+using namespace llvm;
+
+STATISTIC(NumJT8, "Number of jump tables with 1-byte entries");
+STATISTIC(NumJT16, "Number of jump tables with 2-byte entries");
+STATISTIC(NumJT32, "Number of jump tables with 4-byte entries");
+
+namespace {
+class M88kCompressJumpTables : public MachineFunctionPass {
+  const M88kInstrInfo *TII;
+  MachineFunction *MF;
+
+  // Upper bound of the offset of each basic block, indexed by block number.
+  SmallVector<unsigned, 16> BlockOffsets;
+
+public:
+  static char ID;
+
+  M88kCompressJumpTables();
+
+  MachineFunctionProperties getRequiredProperties() const override;
+
+  bool runOnMachineFunction(MachineFunction &MF) override;
+
+  StringRef getPassName() const override {
+    return "M88k Compress Jump Tables";
+  }
+
+private:
+  std::optional<unsigned> computeBlockSize(const MachineBasicBlock &MBB);
+  bool scanFunction();
+  bool compressJumpTable(MachineInstr &MI);
+};
+} // end anonymous namespace
+
+M88kCompressJumpTables::M88kCompressJumpTables() : MachineFunctionPass(ID) {
+  initializeM88kCompressJumpTablesPass(*PassRegistry::getPassRegistry());
+}
+
+MachineFunctionProperties
+M88kCompressJumpTables::getRequiredProperties() const {
+  return MachineFunctionProperties().set(
+      MachineFunctionProperties::Property::NoVRegs);
+}
+
+std::optional<unsigned>
+M88kCompressJumpTables::computeBlockSize(const MachineBasicBlock &MBB) {
+  unsigned Size = 0;
+  for (const MachineInstr &MI : MBB) {
+    // The length of inline assembly is only an estimate, and directives like
+    // .byte may break the alignment of the following blocks.
+    if (MI.isInlineAsm())
+      return std::nullopt;
+    Size += TII->getInstSizeInBytes(MI);
+  }
+  return Size;
+}
+
+bool M88kCompressJumpTables::scanFunction() {
+  BlockOffsets.clear();
+  BlockOffsets.resize(MF->getNumBlockIDs());
+
+  unsigned Offset = 0;
+  for (const MachineBasicBlock &MBB : *MF) {
+    // Assume the worst case padding for aligned blocks.
+    Align Alignment = MBB.getAlignment();
+    if (Alignment > Align(4))
+      Offset += Alignment.value() - 4;
+    BlockOffsets[MBB.getNumber()] = Offset;
+    std::optional<unsigned> Size = computeBlockSize(MBB);
+    if (!Size)
+      return false;
+    Offset += *Size;
+  }
+  return true;
+}
+
+bool M88kCompressJumpTables::compressJumpTable(MachineInstr &MI) {
+  if (MI.getOpcode() != M88k::JTDEST32)
+    return false;
+
+  int JTIdx = MI.getOperand(4).getIndex();
+  const MachineJumpTableEntry &JT =
+      MF->getJumpTableInfo()->getJumpTables()[JTIdx];
+
+  // The jump table might have been optimized away.
+  if (JT.MBBs.empty())
+    return false;
+
+  unsigned MinOffset = std::numeric_limits<unsigned>::max();
+  unsigned MaxOffset = 0;
+  MachineBasicBlock *MinBlock = nullptr;
+  for (MachineBasicBlock *Block : JT.MBBs) {
+    unsigned BlockOffset = BlockOffsets[Block->getNumber()];
+    assert(BlockOffset % 4 == 0 && "Misaligned basic block");
+    MaxOffset = std::max(MaxOffset, BlockOffset);
+    if (BlockOffset <= MinOffset) {
+      MinOffset = BlockOffset;
+      MinBlock = Block;
+    }
+  }
+  assert(MinBlock && "Failed to find block with minimum offset");
+
+  // Block sizes and alignment padding are upper bounds, so the span of the
+  // final layout can only be smaller.
+  unsigned Span = (MaxOffset - MinOffset) / 4;
+  auto *MFI = MF->getInfo<M88kMachineFunctionInfo>();
+  if (isUInt<8>(Span)) {
+    MFI->setJumpTableEntryInfo(JTIdx, 1, MinBlock->getSymbol());
+    MI.setDesc(TII->get(M88k::JTDEST8));
+    ++NumJT8;
+    return true;
+  }
+  if (isUInt<16>(Span)) {
+    MFI->setJumpTableEntryInfo(JTIdx, 2, MinBlock->getSymbol());
+    MI.setDesc(TII->get(M88k::JTDEST16));
+    ++NumJT16;
+    return true;
+  }
+
+  ++NumJT32;
+  return false;
+}
+
+bool M88kCompressJumpTables::runOnMachineFunction(MachineFunction &MFIn) {
+  MF = &MFIn;
+  TII = MF->getSubtarget<M88kSubtarget>().getInstrInfo();
+
+  // Compressed entries are relative to a block of the function, which only
+  // makes sense if the table would otherwise hold absolute addresses.
+  const MachineJumpTableInfo *MJTI = MF->getJumpTableInfo();
+  if (!MJTI || MJTI->getJumpTables().empty() ||
+      MJTI->getEntryKind() != MachineJumpTableInfo::EK_BlockAddress)
+    return false;
+
+  if (!scanFunction())
+    return false;
+
+  bool Changed = false;
+  for (MachineBasicBlock &MBB : *MF)
+    for (MachineInstr &MI : MBB)
+      Changed |= compressJumpTable(MI);
+
+  return Changed;
+}
+
+char M88kCompressJumpTables::ID = 0;
+INITIALIZE_PASS(M88kCompressJumpTables, DEBUG_TYPE,
+                "M88k compress jump tables", false, false)
+
+namespace llvm {
+FunctionPass *createM88kCompressJumpTables() {
+  return new M88kCompressJumpTables();
+}
+} // end namespace llvm
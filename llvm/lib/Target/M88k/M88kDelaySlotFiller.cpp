@@ -172,7 +172,8 @@ bool M88kDelaySlotFiller::delayHasHazard(MachineBasicBlock::instr_iterator MI,
                                          bool &SawLoad, bool &SawStore,
                                          SmallSet<unsigned, 32> &RegDefs,
                                          SmallSet<unsigned, 32> &RegUses) {
-  if (MI->isImplicitDef() || MI->isKill())
+  // Pseudo instructions may expand to several instructions.
+  if (MI->isImplicitDef() || MI->isKill() || MI->isPseudo())
     return true;
 
   // Loads or stores cannot be moved past a store to the delay slot
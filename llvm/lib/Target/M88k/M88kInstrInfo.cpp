@@ -16,6 +16,8 @@
 #include "M88kSubtarget.h"
 #include "MCTargetDesc/M88kBaseInfo.h"
 #include "MCTargetDesc/M88kMCTargetDesc.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/CodeGen/LiveInterval.h"
 #include "llvm/CodeGen/LiveIntervals.h"
 #include "llvm/CodeGen/LiveVariables.h"
@@ -36,6 +38,7 @@
 #include "llvm/MC/MCInstrDesc.h"
 #include "llvm/MC/MCRegister.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Target/TargetMachine.h"
@@ -53,6 +56,12 @@ using namespace llvm;
 
 #define DEBUG_TYPE "m88k-ii"
 
+static cl::opt<unsigned> UnfilledBranchLikelyProb(
+    "m88k-unfilled-branch-likely-prob", cl::Hidden, cl::init(40),
+    cl::desc("M88k: Branch probability threshold in percent to place the hot "
+             "successor as fall-through if the delay slot of the conditional "
+             "branch cannot be filled (only used with profile data)."));
+
 // Pin the vtable to this file.
 void M88kInstrInfo::anchor() {}
 
@@ -315,30 +324,80 @@ bool M88kInstrInfo::reverseBranchCondition(
     // Invert bits to get reverse condition.
     Cond[1].setImm(~Cond[1].getImm() & 0x0f);
     break;
-#if 0
-  case M88k::BB1:
-  case M88k::BB0: {
-    // TODO This only works if the value was produced by cmp/fcmp.
-    // Inverse condition is:
-    // - even bit number: next bit numner
-    // - odd bit number: previous bit numner
-    unsigned CC = Cond[1].getImm();
-    CC = (CC & ~1) | (1 - (CC & 0x01));
-    Cond[1].setImm(CC);
+  // Branching on a cleared bit is the inverse of branching on the same bit
+  // being set, regardless of the instruction which produced the value.
+  case M88k::BB0:
+    Cond[0].setImm(M88k::BB1);
     break;
-  }
-#else
   case M88k::BB1:
-  case M88k::BB0:
-    // The save way is to delare that the condition cannot be reversed.
-    return true;
-#endif
+    Cond[0].setImm(M88k::BB0);
+    break;
   default:
     return true;
   }
   return false;
 }
 
+// Returns true if the delay slot filler is likely to find an instruction for
+// the delay slot of the branch Br. This is a simplified version of the search
+// done by the filler: walking backwards from the branch, the first instruction
+// which does not conflict with the registers of the instructions after it is a
+// candidate.
+static bool canFillDelaySlot(const MachineBasicBlock &MBB,
+                             MachineBasicBlock::const_iterator Br,
+                             const TargetRegisterInfo &TRI) {
+  SmallVector<Register, 8> Defs;
+  SmallVector<Register, 8> Uses;
+  auto Overlaps = [&TRI](ArrayRef<Register> Regs, Register Reg) {
+    return any_of(Regs, [&](Register R) { return TRI.regsOverlap(R, Reg); });
+  };
+  auto Record = [&](const MachineInstr &MI) {
+    for (const MachineOperand &MO : MI.operands()) {
+      if (!MO.isReg() || !MO.getReg())
+        continue;
+      (MO.isDef() ? Defs : Uses).push_back(MO.getReg());
+    }
+  };
+
+  Record(*Br);
+  for (MachineBasicBlock::const_iterator I = Br; I != MBB.begin();) {
+    const MachineInstr &MI = *--I;
+    if (MI.isDebugInstr())
+      continue;
+    if (MI.isInlineAsm() || MI.isLabel() || MI.isBranch() || MI.isCall() ||
+        MI.isReturn() || MI.mayRaiseFPException())
+      return false;
+
+    bool Hazard = MI.mayLoadOrStore() || MI.isImplicitDef() || MI.isKill() ||
+                  any_of(MI.operands(), [&](const MachineOperand &MO) {
+                    if (!MO.isReg() || !MO.getReg())
+                      return false;
+                    if (MO.isDef())
+                      return Overlaps(Defs, MO.getReg()) ||
+                             Overlaps(Uses, MO.getReg());
+                    return Overlaps(Defs, MO.getReg());
+                  });
+    if (!Hazard)
+      return true;
+    Record(MI);
+  }
+  return false;
+}
+
+unsigned
+M88kInstrInfo::getProfileLikelyProb(const MachineBasicBlock &MBB) const {
+  // A taken branch costs an extra cycle unless its delay slot is filled with
+  // a useful instruction. If the slot of the conditional branch ending this
+  // block likely stays empty, then bias the layout towards falling through on
+  // the hot path.
+  MachineBasicBlock::const_iterator Br = MBB.getFirstTerminator();
+  if (Br != MBB.end() && Br->getDesc().isConditionalBranch() &&
+      M88k::getOpcodeWithDelaySlot(Br->getOpcode()) != -1 &&
+      !canFillDelaySlot(MBB, Br, RI))
+    return UnfilledBranchLikelyProb;
+  return TargetInstrInfo::getProfileLikelyProb(MBB);
+}
+
 Register M88kInstrInfo::isLoadFromStackSlot(const MachineInstr &MI,
                                             int &FrameIndex) const {
   switch (MI.getOpcode()) {
@@ -640,6 +699,40 @@ bool M88kInstrInfo::expandPostRAPseudo(MachineInstr &MI) const {
         .addMemOperand(MMO);
     break;
   }
+  case M88k::MOVri32: {
+    const Register Reg = MI.getOperand(0).getReg();
+    const MachineOperand &MO = MI.getOperand(1);
+    const bool IsDead = MI.getOperand(0).isDead();
+    if (MO.isImm()) {
+      uint32_t Val = static_cast<uint32_t>(MO.getImm());
+      uint32_t Hi = Val >> 16;
+      uint32_t Lo = Val & 0xffff;
+      // Only emit the or.u if the upper half is not zero.
+      Register Src = M88k::R0;
+      if (Hi || !Lo) {
+        BuildMI(MBB, &MI, MI.getDebugLoc(), get(M88k::ORriu))
+            .addReg(Reg, RegState::Define | getDeadRegState(IsDead && !Lo))
+            .addReg(M88k::R0)
+            .addImm(Hi);
+        Src = Reg;
+      }
+      if (Lo)
+        BuildMI(MBB, &MI, MI.getDebugLoc(), get(M88k::ORri))
+            .addReg(Reg, RegState::Define | getDeadRegState(IsDead))
+            .addReg(Src, getKillRegState(Src != M88k::R0))
+            .addImm(Lo);
+      break;
+    }
+    BuildMI(MBB, &MI, MI.getDebugLoc(), get(M88k::ORriu))
+        .addReg(Reg, RegState::Define)
+        .addReg(M88k::R0)
+        .addDisp(MO, 0, M88kII::MO_ABS_HI);
+    BuildMI(MBB, &MI, MI.getDebugLoc(), get(M88k::ORri))
+        .addReg(Reg, RegState::Define | getDeadRegState(IsDead))
+        .addReg(Reg, RegState::Kill)
+        .addDisp(MO, 0, M88kII::MO_ABS_LO);
+    break;
+  }
   case M88k::RET: {
     MachineInstrBuilder MIB =
         BuildMI(MBB, &MI, MI.getDebugLoc(), get(M88k::JMP))
@@ -684,6 +777,8 @@ bool M88kInstrInfo::isReallyTriviallyReMaterializable(
   case M88k::MASKri:
   case M88k::MASKriu:
     return MI.getOperand(1).isReg() && MI.getOperand(1).getReg() == M88k::R0;
+  case M88k::MOVri32:
+    return true;
   }
   return false;
 }
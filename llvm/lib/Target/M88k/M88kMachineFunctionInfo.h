@@ -13,7 +13,9 @@
 #ifndef LLVM_LIB_TARGET_M88K_M88KMACHINEFUNCTIONINFO_H
 #define LLVM_LIB_TARGET_M88K_M88KMACHINEFUNCTIONINFO_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/CodeGen/MachineFunction.h"
+#include <utility>
 
 namespace llvm {
 
@@ -34,6 +36,11 @@ class M88kMachineFunctionInfo : public MachineFunctionInfo {
   /// FrameIndex for start of argument area.
   int StackIndex = 0;
 
+  /// Size of the entries and base symbol of compressed jump tables, indexed
+  /// by jump table index. An entry of a compressed jump table holds the
+  /// distance in words from the base symbol to the target block.
+  DenseMap<int, std::pair<unsigned, MCSymbol *>> JumpTableEntryInfo;
+
 public:
   M88kMachineFunctionInfo(const Function &F, const TargetSubtargetInfo *STI) {}
 
@@ -53,6 +60,22 @@ public:
 
   int getStackIndex() const { return StackIndex; }
   void setStackIndex(int Idx) { StackIndex = Idx; }
+
+  bool hasCompressedJumpTables() const { return !JumpTableEntryInfo.empty(); }
+
+  unsigned getJumpTableEntrySize(int Idx) const {
+    auto It = JumpTableEntryInfo.find(Idx);
+    return It != JumpTableEntryInfo.end() ? It->second.first : 4;
+  }
+
+  MCSymbol *getJumpTableEntryBase(int Idx) const {
+    auto It = JumpTableEntryInfo.find(Idx);
+    return It != JumpTableEntryInfo.end() ? It->second.second : nullptr;
+  }
+
+  void setJumpTableEntryInfo(int Idx, unsigned Size, MCSymbol *Base) {
+    JumpTableEntryInfo[Idx] = std::make_pair(Size, Base);
+  }
 };
 } // end namespace llvm
 
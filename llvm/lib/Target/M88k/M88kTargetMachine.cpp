@@ -10,8 +10,10 @@
 //===----------------------------------------------------------------------===//
 
 #include "M88kTargetMachine.h"
+#include "GISel/M88kRegBankSelect.h"
 #include "M88k.h"
 #include "M88kMachineFunctionInfo.h"
+#include "M88kTargetTransformInfo.h"
 #include "TargetInfo/M88kTargetInfo.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/CodeGen/GlobalISel/IRTranslator.h"
@@ -51,6 +53,11 @@ static cl::opt<bool>
     BranchRelaxation("m88k-enable-branch-relax", cl::Hidden, cl::init(true),
                      cl::desc("Relax out of range conditional branches"));
 
+static cl::opt<bool>
+    CompressJumpTables("m88k-enable-compress-jump-tables", cl::Hidden,
+                       cl::init(true),
+                       cl::desc("Use 8-bit or 16-bit jump table entries"));
+
 static cl::opt<cl::boolOrDefault>
     EnableDelaySlotFiller("m88k-enable-delay-slot-filler",
                           cl::desc("Fill delay slots."), cl::Hidden);
@@ -74,6 +81,8 @@ extern "C" LLVM_EXTERNAL_VISIBILITY void LLVMInitializeM88kTarget() {
   initializeM88kPreLegalizerCombinerPass(PR);
   initializeM88kPostLegalizerCombinerPass(PR);
   initializeM88kPostLegalizerLoweringPass(PR);
+  initializeM88kRegBankSelectPass(PR);
+  initializeM88kCompressJumpTablesPass(PR);
   initializeM88kDelaySlotFillerPass(PR);
   initializeM88kFFSPass(PR);
 }
@@ -164,6 +173,11 @@ M88kTargetMachine::getSubtargetImpl(const Function &F) const {
   return I.get();
 }
 
+TargetTransformInfo
+M88kTargetMachine::getTargetTransformInfo(const Function &F) const {
+  return TargetTransformInfo(M88kTTIImpl(this, F));
+}
+
 MachineFunctionInfo *M88kTargetMachine::createMachineFunctionInfo(
     BumpPtrAllocator &Allocator, const Function &F,
     const TargetSubtargetInfo *STI) const {
@@ -214,6 +228,10 @@ void M88kPassConfig::addPreEmitPass() {
   if (BranchRelaxation)
     addPass(&BranchRelaxationPassID);
 
+  // Shrink the jump tables now that the layout of the function is final.
+  if (getOptLevel() != CodeGenOptLevel::None && CompressJumpTables)
+    addPass(createM88kCompressJumpTables());
+
   // Enable the delay slot filler for optimizing builds or if explicitly
   // requested.
   // TODO: When targetting MC88110 it might be better to not enable it.
@@ -250,7 +268,12 @@ void M88kPassConfig::addPreRegBankSelect() {
 }
 
 bool M88kPassConfig::addRegBankSelect() {
-  addPass(new RegBankSelect());
+  // On the MC88110, floating point values can be kept in either register bank.
+  // The greedy mode weighs the alternative mappings against the cost of the
+  // copies between the banks.
+  addPass(new M88kRegBankSelect(getOptLevel() == CodeGenOptLevel::None
+                                    ? RegBankSelect::Mode::Fast
+                                    : RegBankSelect::Mode::Greedy));
   return false;
 }
 
@@ -0,0 +1,98 @@
+//===-- M88kTargetTransformInfo.cpp - M88k specific TTI -------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "M88kTargetTransformInfo.h"
+#include "llvm/ADT/APInt.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/Support/MathExtras.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "m88ktti"
+
+// Returns true if the value can be loaded into a register with a single
+// instruction. See the constant patterns in M88kInstrInfo.td.
+static bool isSingleInstrImm(uint32_t Val) {
+  return isUInt<16>(Val) || (Val & 0xffff) == 0 || isUInt<16>(-Val) ||
+         isShiftedMask_32(Val);
+}
+
+InstructionCost M88kTTIImpl::getIntImmCost(const APInt &Imm, Type *Ty,
+                                           TTI::TargetCostKind CostKind) {
+  assert(Ty->isIntegerTy());
+
+  // There is no cost model for constants with a bit size of 0 or larger than
+  // 32 bits. Return TCC_Free here, so that constant hoisting will ignore
+  // these constants.
+  unsigned BitSize = Ty->getPrimitiveSizeInBits();
+  if (BitSize == 0 || BitSize > 32)
+    return TTI::TCC_Free;
+
+  uint32_t Val = Imm.getZExtValue();
+  if (Val == 0)
+    return TTI::TCC_Free;
+  if (isSingleInstrImm(Val))
+    return TTI::TCC_Basic;
+
+  // Other values need an or.u/or pair.
+  return 2 * TTI::TCC_Basic;
+}
+
+InstructionCost M88kTTIImpl::getIntImmCostInst(unsigned Opcode, unsigned Idx,
+                                               const APInt &Imm, Type *Ty,
+                                               TTI::TargetCostKind CostKind,
+                                               Instruction *Inst) {
+  assert(Ty->isIntegerTy());
+
+  unsigned BitSize = Ty->getPrimitiveSizeInBits();
+  if (BitSize == 0 || BitSize > 32)
+    return TTI::TCC_Free;
+
+  // Only the second operand can be an immediate.
+  if (Idx != 1)
+    return getIntImmCost(Imm, Ty, CostKind);
+
+  uint32_t Val = Imm.getZExtValue();
+  switch (Opcode) {
+  default:
+    break;
+  case Instruction::Add:
+  case Instruction::Sub:
+    // addu and subu take an unsigned 16-bit immediate. Constant hoisting uses
+    // this to rebase constants which differ only in the lower half to a
+    // common base, which shares the or.u between them.
+    if (isUInt<16>(Val) || isUInt<16>(-Val))
+      return TTI::TCC_Free;
+    break;
+  case Instruction::And:
+  case Instruction::Or:
+  case Instruction::Xor:
+    // The logical instructions operate on either half of the register, so any
+    // constant is applied with at most two instructions without a temporary.
+    return TTI::TCC_Free;
+  case Instruction::ICmp:
+    if (isUInt<16>(Val))
+      return TTI::TCC_Free;
+    break;
+  case Instruction::Shl:
+  case Instruction::LShr:
+  case Instruction::AShr:
+    return TTI::TCC_Free;
+  }
+
+  return getIntImmCost(Imm, Ty, CostKind);
+}
+
+InstructionCost
+M88kTTIImpl::getIntImmCostIntrin(Intrinsic::ID IID, unsigned Idx,
+                                 const APInt &Imm, Type *Ty,
+                                 TTI::TargetCostKind CostKind) {
+  // Intrinsics are lowered to calls or ordinary instructions, so treat the
+  // immediate like a materialized constant.
+  return getIntImmCost(Imm, Ty, CostKind);
+}
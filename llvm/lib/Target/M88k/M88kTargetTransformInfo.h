@@ -0,0 +1,56 @@
+//===-- M88kTargetTransformInfo.h - M88k specific TTI -----------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a TargetTransformInfo::Concept conforming object specific
+// to the M88k target machine. It provides the cost of immediates, which drives
+// constant hoisting, and lets the target independent implementation handle
+// the rest.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_LIB_TARGET_M88K_M88KTARGETTRANSFORMINFO_H
+#define LLVM_LIB_TARGET_M88K_M88KTARGETTRANSFORMINFO_H
+
+#include "M88kSubtarget.h"
+#include "M88kTargetMachine.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/CodeGen/BasicTTIImpl.h"
+
+namespace llvm {
+
+class M88kTTIImpl : public BasicTTIImplBase<M88kTTIImpl> {
+  using BaseT = BasicTTIImplBase<M88kTTIImpl>;
+  using TTI = TargetTransformInfo;
+
+  friend BaseT;
+
+  const M88kSubtarget *ST;
+  const M88kTargetLowering *TLI;
+
+  const M88kSubtarget *getST() const { return ST; }
+  const M88kTargetLowering *getTLI() const { return TLI; }
+
+public:
+  explicit M88kTTIImpl(const M88kTargetMachine *TM, const Function &F)
+      : BaseT(TM, F.getParent()->getDataLayout()), ST(TM->getSubtargetImpl(F)),
+        TLI(ST->getTargetLowering()) {}
+
+  InstructionCost getIntImmCost(const APInt &Imm, Type *Ty,
+                                TTI::TargetCostKind CostKind);
+  InstructionCost getIntImmCostInst(unsigned Opcode, unsigned Idx,
+                                    const APInt &Imm, Type *Ty,
+                                    TTI::TargetCostKind CostKind,
+                                    Instruction *Inst = nullptr);
+  InstructionCost getIntImmCostIntrin(Intrinsic::ID IID, unsigned Idx,
+                                      const APInt &Imm, Type *Ty,
+                                      TTI::TargetCostKind CostKind);
+};
+
+} // end namespace llvm
+
+#endif
@@ -138,9 +138,13 @@ void M88kInstPrinter::printPCRelOperand(const MCInst *MI, uint64_t Address,
                                         int OpNum, const MCSubtargetInfo &STI,
                                         raw_ostream &O) {
   const MCOperand &MO = MI->getOperand(OpNum);
-  if (MO.isImm())
-    O << MO.getImm();
-  else
+  if (MO.isImm()) {
+    // The offset is counted in words.
+    if (PrintBranchImmAsAddress)
+      O << formatHex((Address + uint64_t(MO.getImm()) * 4) & 0xffffffff);
+    else
+      O << MO.getImm();
+  } else
     MO.getExpr()->print(O, &MAI);
 }
 
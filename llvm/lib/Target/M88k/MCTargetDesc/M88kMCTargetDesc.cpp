@@ -13,12 +13,14 @@
 #include "M88kTargetStreamer.h"
 #include "TargetInfo/M88kTargetInfo.h"
 #include "llvm/MC/MCDwarf.h"
+#include "llvm/MC/MCInstrAnalysis.h"
 #include "llvm/MC/MCInstrInfo.h"
 #include "llvm/MC/MCRegisterInfo.h"
 #include "llvm/MC/MCStreamer.h"
 #include "llvm/MC/MCSubtargetInfo.h"
 #include "llvm/MC/TargetRegistry.h"
 #include "llvm/Support/Compiler.h"
+#include <algorithm>
 
 using namespace llvm;
 
@@ -63,6 +65,37 @@ static MCInstPrinter *createM88kMCInstPrinter(const Triple &T,
   return new M88kInstPrinter(MAI, MII, MRI);
 }
 
+namespace {
+
+class M88kMCInstrAnalysis : public MCInstrAnalysis {
+public:
+  M88kMCInstrAnalysis(const MCInstrInfo *Info) : MCInstrAnalysis(Info) {}
+
+  bool evaluateBranch(const MCInst &Inst, uint64_t Addr, uint64_t Size,
+                      uint64_t &Target) const override {
+    // The branch target is the only PC-relative operand. It is the offset in
+    // words from the branch instruction.
+    const MCInstrDesc &Desc = Info->get(Inst.getOpcode());
+    for (unsigned I = 0,
+                  E = std::min(Inst.getNumOperands(), Desc.getNumOperands());
+         I != E; ++I) {
+      if (Desc.operands()[I].OperandType == MCOI::OPERAND_PCREL &&
+          Inst.getOperand(I).isImm()) {
+        Target = (Addr + uint64_t(Inst.getOperand(I).getImm()) * 4) &
+                 0xffffffff;
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+} // end anonymous namespace
+
+static MCInstrAnalysis *createM88kMCInstrAnalysis(const MCInstrInfo *Info) {
+  return new M88kMCInstrAnalysis(Info);
+}
+
 static MCTargetStreamer *createM88kAsmTargetStreamer(MCStreamer &S,
                                                      formatted_raw_ostream &OS,
                                                      MCInstPrinter *InstPrint,
@@ -102,6 +135,10 @@ extern "C" LLVM_EXTERNAL_VISIBILITY void LLVMInitializeM88kTargetMC() {
   TargetRegistry::RegisterMCRegInfo(getTheM88kTarget(),
                                     createM88kMCRegisterInfo);
 
+  // Register the MCInstrAnalysis.
+  TargetRegistry::RegisterMCInstrAnalysis(getTheM88kTarget(),
+                                          createM88kMCInstrAnalysis);
+
   // Register the MCSubtargetInfo.
   TargetRegistry::RegisterMCSubtargetInfo(getTheM88kTarget(),
                                           createM88kMCSubtargetInfo);
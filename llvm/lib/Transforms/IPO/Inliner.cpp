@@ -387,6 +387,12 @@ PreservedAnalyses InlinerPass::run(LazyCallGraph::SCC &InitialC,
       InlinedCallees.insert(&Callee);
       ++NumInlined;
 
+      // The inline cost summary of F is stale now, and the remaining calls in
+      // and to F are analyzed with it.
+      PreservedAnalyses CalleeInfoPA = PreservedAnalyses::all();
+      CalleeInfoPA.abandon<InlineCostCalleeAnalysis>();
+      FAM.invalidate(F, CalleeInfoPA);
+
       LLVM_DEBUG(dbgs() << "    Size after inlining: "
                         << F.getInstructionCount() << "\n");
 
@@ -39,6 +39,14 @@
 // overridable, we move the functionality into a new internal function and
 // leave two overridable thunks to it.
 //
+// With -mergefunc-parameterize, the functions that are still distinct are then
+// merged if they only differ in a few constant operands, such as the constants
+// and callees of template instantiations. The body of the first one becomes a
+// private function that takes these operands as extra parameters, and each of
+// the functions becomes a thunk passing its own constants to it. A group is
+// only merged if the thunks are smaller than the bodies they replace, according
+// to the code size costs of TargetTransformInfo.
+//
 //===----------------------------------------------------------------------===//
 //
 // Future work:
@@ -90,8 +98,11 @@
 
 #include "llvm/Transforms/IPO/MergeFunctions.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Sequence.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/OptimizationRemarkEmitter.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/IR/Argument.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Constant.h"
@@ -135,6 +146,9 @@ STATISTIC(NumFunctionsMerged, "Number of functions merged");
 STATISTIC(NumThunksWritten, "Number of thunks generated");
 STATISTIC(NumAliasesWritten, "Number of aliases generated");
 STATISTIC(NumDoubleWeak, "Number of new functions created");
+STATISTIC(NumParameterizedMerged,
+          "Number of functions merged into a parameterized function");
+STATISTIC(NumParametersAdded, "Number of parameters added to merge functions");
 
 static cl::opt<unsigned> NumFunctionsForVerificationCheck(
     "mergefunc-verify",
@@ -168,6 +182,21 @@ static cl::opt<bool>
                           cl::init(false),
                           cl::desc("Allow mergefunc to create aliases"));
 
+cl::opt<bool> MergeFunctionsParameterize(
+    "mergefunc-parameterize", cl::Hidden, cl::init(false),
+    cl::desc("Merge functions that only differ in some constant operands, "
+             "by passing the constants as parameters"));
+
+cl::opt<unsigned> MergeFunctionsMaxParams(
+    "mergefunc-max-params", cl::Hidden, cl::init(4),
+    cl::desc("Maximum number of parameters added to merge functions that "
+             "differ in constant operands"));
+
+cl::opt<unsigned> MergeFunctionsMaxGroups(
+    "mergefunc-max-groups", cl::Hidden, cl::init(16),
+    cl::desc("Maximum number of groups a function is compared with to merge "
+             "functions that differ in constant operands"));
+
 namespace {
 
 class FunctionNode {
@@ -188,6 +217,37 @@ public:
   }
 };
 
+/// Compares functions like FunctionComparator, but also accepts two functions
+/// that differ in constant operands which could be passed as arguments.
+class ParameterizingComparator : public FunctionComparator {
+public:
+  ParameterizingComparator(const Function *F1, const Function *F2,
+                           GlobalNumberState *GN)
+      : FunctionComparator(F1, F2, GN) {}
+
+  /// Return true if the functions are equal up to constant operands. The
+  /// operands of the first function that differ are appended to \p Diffs,
+  /// along with the constants of the second function there.
+  bool compareUpToConstants(
+      SmallVectorImpl<std::pair<const Use *, Constant *>> &Diffs);
+
+private:
+  bool cmpBasicBlocksUpToConstants(
+      const BasicBlock *BBL, const BasicBlock *BBR,
+      SmallVectorImpl<std::pair<const Use *, Constant *>> &Diffs);
+};
+
+/// Functions that are equal up to some constant operands, which become the
+/// parameters of the function they are merged into.
+struct ParameterizedGroup {
+  /// The functions, the first one is the one the others are compared with.
+  SmallVector<Function *, 4> Members;
+  /// The operands of the first function that differ between the members.
+  SmallVector<const Use *, 4> Operands;
+  /// The constants of each member at each of these operands.
+  SmallVector<SmallVector<Constant *, 4>, 4> Constants;
+};
+
 /// MergeFunctions finds functions which will generate identical machine code,
 /// by considering all pointer types to be equivalent. Once identified,
 /// MergeFunctions will fold them by replacing a call to one to a call to a
@@ -199,6 +259,11 @@ public:
 
   bool runOnModule(Module &M);
 
+  /// Merge the functions that only differ in constant operands.
+  bool
+  runOnModuleParameterized(Module &M,
+                           function_ref<TargetTransformInfo &(Function &)> GetTTI);
+
 private:
   // The function comparison operator is provided here so that FunctionNodes do
   // not need to become larger with another pointer.
@@ -288,6 +353,14 @@ private:
   /// Replace function F with function G in the function tree.
   void replaceFunctionInTree(const FunctionNode &FN, Function *G);
 
+  /// Add F to Group if it only differs from its members in constant operands,
+  /// and merging it would not need too many parameters.
+  bool addToGroup(ParameterizedGroup &Group, Function *F);
+
+  /// Merge the members of Group into a function taking the operands they
+  /// differ in as parameters, if that reduces the code size.
+  bool mergeGroup(const ParameterizedGroup &Group, TargetTransformInfo &TTI);
+
   /// The set of all distinct functions. Use the insert() and remove() methods
   /// to modify it. The map allows efficient lookup and deferring of Functions.
   FnTreeType FnTree;
@@ -304,7 +377,20 @@ private:
 PreservedAnalyses MergeFunctionsPass::run(Module &M,
                                           ModuleAnalysisManager &AM) {
   MergeFunctions MF;
-  if (!MF.runOnModule(M))
+  bool Changed = MF.runOnModule(M);
+  if (MergeFunctionsParameterize) {
+    FunctionAnalysisManager &FAM =
+        AM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+    // Functions may have been deleted and new ones allocated at the same
+    // addresses, which must not see the cached results of the old ones.
+    if (Changed)
+      FAM.clear();
+    auto GetTTI = [&](Function &F) -> TargetTransformInfo & {
+      return FAM.getResult<TargetIRAnalysis>(F);
+    };
+    Changed |= MF.runOnModuleParameterized(M, GetTTI);
+  }
+  if (!Changed)
     return PreservedAnalyses::all();
   return PreservedAnalyses::none();
 }
@@ -1028,3 +1114,337 @@ void MergeFunctions::removeUsers(Value *V) {
     if (auto *I = dyn_cast<Instruction>(U))
       remove(I->getFunction());
 }
+
+bool ParameterizingComparator::compareUpToConstants(
+    SmallVectorImpl<std::pair<const Use *, Constant *>> &Diffs) {
+  beginCompare();
+
+  if (compareSignature())
+    return false;
+
+  // Walk the blocks in the same order as FunctionComparator::compare().
+  SmallVector<const BasicBlock *, 8> FnLBBs, FnRBBs;
+  SmallPtrSet<const BasicBlock *, 32> VisitedBBs;
+
+  FnLBBs.push_back(&FnL->getEntryBlock());
+  FnRBBs.push_back(&FnR->getEntryBlock());
+
+  VisitedBBs.insert(FnLBBs[0]);
+  while (!FnLBBs.empty()) {
+    const BasicBlock *BBL = FnLBBs.pop_back_val();
+    const BasicBlock *BBR = FnRBBs.pop_back_val();
+
+    if (cmpValues(BBL, BBR) || !cmpBasicBlocksUpToConstants(BBL, BBR, Diffs))
+      return false;
+
+    const Instruction *TermL = BBL->getTerminator();
+    const Instruction *TermR = BBR->getTerminator();
+
+    assert(TermL->getNumSuccessors() == TermR->getNumSuccessors());
+    for (unsigned i = 0, e = TermL->getNumSuccessors(); i != e; ++i) {
+      if (!VisitedBBs.insert(TermL->getSuccessor(i)).second)
+        continue;
+
+      FnLBBs.push_back(TermL->getSuccessor(i));
+      FnRBBs.push_back(TermR->getSuccessor(i));
+    }
+  }
+  return true;
+}
+
+/// Whether operand \p OpIdx of \p I, and of the equal operation \p J, can be
+/// replaced by an argument.
+static bool isParameterizableOperand(const Instruction *I,
+                                     const Instruction *J, unsigned OpIdx) {
+  if (const auto *CB = dyn_cast<CallBase>(I)) {
+    // Intrinsics may take immediate arguments, and cannot be called
+    // indirectly.
+    if (isa<IntrinsicInst>(CB) || isa<IntrinsicInst>(J) || CB->isInlineAsm())
+      return false;
+    const Use *U = &CB->getOperandUse(OpIdx);
+    return CB->isArgOperand(U) || CB->isCallee(U);
+  }
+  return isa<BinaryOperator, CmpInst, CastInst, SelectInst, LoadInst,
+             StoreInst, ReturnInst, PHINode>(I);
+}
+
+bool ParameterizingComparator::cmpBasicBlocksUpToConstants(
+    const BasicBlock *BBL, const BasicBlock *BBR,
+    SmallVectorImpl<std::pair<const Use *, Constant *>> &Diffs) {
+  BasicBlock::const_iterator InstL = BBL->begin(), InstLE = BBL->end();
+  BasicBlock::const_iterator InstR = BBR->begin(), InstRE = BBR->end();
+
+  for (; InstL != InstLE && InstR != InstRE; ++InstL, ++InstR) {
+    // cmpOperations compares the pointers of GEPs, where it considers the
+    // references of the functions to themselves equal. That only holds if
+    // the functions are merged without parameters.
+    if (auto *GEP = dyn_cast<GetElementPtrInst>(&*InstL))
+      if (GEP->getPointerOperand() == FnL)
+        return false;
+
+    bool needToCmpOperands = true;
+    if (cmpOperations(&*InstL, &*InstR, needToCmpOperands))
+      return false;
+    if (!needToCmpOperands)
+      continue;
+    assert(InstL->getNumOperands() == InstR->getNumOperands());
+
+    for (unsigned i = 0, e = InstL->getNumOperands(); i != e; ++i) {
+      Value *OpL = InstL->getOperand(i);
+      Value *OpR = InstR->getOperand(i);
+      // References to the functions themselves are compared like any other
+      // global, so that each member keeps referring to itself.
+      if (isa<ConstantInt, ConstantFP, GlobalValue>(OpL) &&
+          isa<ConstantInt, ConstantFP, GlobalValue>(OpR)) {
+        if (OpL == OpR)
+          continue;
+        if (!isParameterizableOperand(&*InstL, &*InstR, i))
+          return false;
+        Diffs.emplace_back(&InstL->getOperandUse(i), cast<Constant>(OpR));
+        continue;
+      }
+      if (cmpValues(OpL, OpR))
+        return false;
+    }
+  }
+  return InstL == InstLE && InstR == InstRE;
+}
+
+/// Whether the body of \p F may be moved into a function with more parameters,
+/// leaving a thunk to it.
+static bool canParameterize(Function &F) {
+  if (F.isVarArg() || F.hasFnAttribute(Attribute::Naked) ||
+      F.getCallingConv() == CallingConv::SwiftTail || F.hasPrefixData() ||
+      F.hasPrologueData())
+    return false;
+  // Block addresses and musttail calls are bound to the signature of F.
+  return none_of(F, [](BasicBlock &BB) {
+    return BB.hasAddressTaken() || BB.getTerminatingMustTailCall();
+  });
+}
+
+/// Map the operands of a group of \p NumMembers functions to the parameters
+/// they are passed in. \p GetConstant returns the constant of a member at an
+/// operand; the operands that have the same constant in every member share a
+/// parameter. Returns the first operand of each parameter.
+template <typename ConstantFn>
+static SmallVector<unsigned, 4> getParams(unsigned NumMembers,
+                                          unsigned NumOperands,
+                                          ConstantFn GetConstant,
+                                          SmallVectorImpl<unsigned> &ParamOf) {
+  SmallVector<unsigned, 4> Params;
+  ParamOf.clear();
+  for (unsigned Op = 0; Op != NumOperands; ++Op) {
+    auto *It = find_if(Params, [&](unsigned Other) {
+      return all_of(seq(NumMembers), [&](unsigned Member) {
+        return GetConstant(Member, Op) == GetConstant(Member, Other);
+      });
+    });
+    ParamOf.push_back(It - Params.begin());
+    if (It == Params.end())
+      Params.push_back(Op);
+  }
+  return Params;
+}
+
+static SmallVector<unsigned, 4> getParams(const ParameterizedGroup &Group,
+                                          SmallVectorImpl<unsigned> &ParamOf) {
+  return getParams(
+      Group.Members.size(), Group.Operands.size(),
+      [&](unsigned Member, unsigned Op) { return Group.Constants[Member][Op]; },
+      ParamOf);
+}
+
+bool MergeFunctions::addToGroup(ParameterizedGroup &Group, Function *F) {
+  SmallVector<std::pair<const Use *, Constant *>, 8> Diffs;
+  ParameterizingComparator FCmp(Group.Members.front(), F, &GlobalNumbers);
+  if (!FCmp.compareUpToConstants(Diffs))
+    return false;
+
+  // The constants of F at the operands of the group, followed by the operands
+  // that only F differs in. The members have the constants of the first
+  // function at the latter.
+  unsigned NumMembers = Group.Members.size();
+  unsigned NumOperands = Group.Operands.size();
+  SmallVector<const Use *, 4> NewOperands;
+  SmallVector<Constant *, 4> NewConstants;
+  for (const Use *U : Group.Operands)
+    NewConstants.push_back(cast<Constant>(U->get()));
+  for (auto [U, C] : Diffs) {
+    auto *It = find(Group.Operands, U);
+    if (It != Group.Operands.end()) {
+      NewConstants[It - Group.Operands.begin()] = C;
+      continue;
+    }
+    NewOperands.push_back(U);
+    NewConstants.push_back(C);
+  }
+
+  SmallVector<unsigned, 4> ParamOf;
+  auto GetConstant = [&](unsigned Member, unsigned Op) -> Constant * {
+    if (Member == NumMembers)
+      return NewConstants[Op];
+    if (Op < NumOperands)
+      return Group.Constants[Member][Op];
+    return cast<Constant>(NewOperands[Op - NumOperands]->get());
+  };
+  if (getParams(NumMembers + 1, NewConstants.size(), GetConstant, ParamOf)
+          .size() > MergeFunctionsMaxParams)
+    return false;
+
+  Group.Members.push_back(F);
+  append_range(Group.Operands, NewOperands);
+  for (SmallVector<Constant *, 4> &Constants : Group.Constants)
+    for (const Use *U : NewOperands)
+      Constants.push_back(cast<Constant>(U->get()));
+  Group.Constants.push_back(std::move(NewConstants));
+  return true;
+}
+
+bool MergeFunctions::mergeGroup(const ParameterizedGroup &Group,
+                                TargetTransformInfo &TTI) {
+  using namespace ore;
+
+  Function *First = Group.Members.front();
+  SmallVector<unsigned, 4> ParamOf;
+  SmallVector<unsigned, 4> Params = getParams(Group, ParamOf);
+  FunctionType *FTy = First->getFunctionType();
+  SmallVector<Type *, 8> ParamTys(FTy->params());
+  for (unsigned Op : Params)
+    ParamTys.push_back(Group.Operands[Op]->get()->getType());
+
+  // One body replaces the bodies of all members, each of which becomes a call
+  // passing the constants of the member.
+  InstructionCost BodyCost = 0;
+  for (BasicBlock &BB : *First)
+    for (Instruction &I : BB.instructionsWithoutDebug())
+      BodyCost += TTI.getInstructionCost(&I, TargetTransformInfo::TCK_CodeSize);
+  InstructionCost ThunkCost =
+      TTI.getCallInstrCost(nullptr, FTy->getReturnType(), ParamTys,
+                           TargetTransformInfo::TCK_CodeSize) +
+      (Params.size() + 1) * TargetTransformInfo::TCC_Basic;
+  unsigned NumMembers = Group.Members.size();
+  InstructionCost Savings =
+      BodyCost * (NumMembers - 1) - ThunkCost * NumMembers;
+
+  OptimizationRemarkEmitter ORE(First);
+  if (!Savings.isValid() || Savings <= 0) {
+    ORE.emit([&] {
+      return OptimizationRemarkMissed(DEBUG_TYPE, "ParameterizedMerge", First)
+             << "not merging " << NV("NumFunctions", NumMembers)
+             << " functions that differ in " << NV("NumParams", Params.size())
+             << " constants, the thunks cost " << NV("ThunkCost", ThunkCost)
+             << " and the body " << NV("BodyCost", BodyCost);
+    });
+    return false;
+  }
+
+  // Move the body of the first function into the merged one.
+  Function *Merged =
+      Function::Create(FunctionType::get(FTy->getReturnType(), ParamTys, false),
+                       First->getLinkage(), First->getAddressSpace(),
+                       First->getName() + ".merged", First->getParent());
+  Merged->copyAttributesFrom(First);
+  Merged->setLinkage(GlobalValue::PrivateLinkage);
+  Merged->setUnnamedAddr(GlobalValue::UnnamedAddr::Global);
+  Merged->IsNewDbgInfoFormat = First->IsNewDbgInfoFormat;
+  Merged->splice(Merged->begin(), First);
+  for (unsigned i = 0, e = FTy->getNumParams(); i != e; ++i) {
+    Merged->getArg(i)->takeName(First->getArg(i));
+    First->getArg(i)->replaceAllUsesWith(Merged->getArg(i));
+  }
+  for (unsigned Op = 0, E = Group.Operands.size(); Op != E; ++Op)
+    const_cast<Use *>(Group.Operands[Op])
+        ->set(Merged->getArg(FTy->getNumParams() + ParamOf[Op]));
+  // The body keeps its subprogram, the thunk of the first function gets a copy
+  // of it without the variables of the body.
+  if (DISubprogram *SP = First->getSubprogram()) {
+    Merged->setSubprogram(SP);
+    TempDISubprogram ThunkSP = SP->clone();
+    ThunkSP->replaceRetainedNodes(DINodeArray());
+    First->setSubprogram(MDNode::replaceWithDistinct(std::move(ThunkSP)));
+  }
+
+  // Replace the body of every member by a tail call to the merged function.
+  for (unsigned Member = 0; Member != NumMembers; ++Member) {
+    Function *F = Group.Members[Member];
+    for (BasicBlock &BB : *F)
+      BB.dropAllReferences();
+    while (!F->empty())
+      F->begin()->eraseFromParent();
+
+    IRBuilder<> Builder(BasicBlock::Create(F->getContext(), "", F));
+    SmallVector<Value *, 16> Args(make_pointer_range(F->args()));
+    for (unsigned Op : Params)
+      Args.push_back(Group.Constants[Member][Op]);
+    CallInst *CI = Builder.CreateCall(Merged, Args);
+    CI->setTailCall();
+    CI->setCallingConv(Merged->getCallingConv());
+    CI->setAttributes(Merged->getAttributes());
+    ReturnInst *RI = F->getReturnType()->isVoidTy() ? Builder.CreateRetVoid()
+                                                    : Builder.CreateRet(CI);
+    if (DISubprogram *SP = F->getSubprogram()) {
+      DebugLoc DL = DILocation::get(SP->getContext(), SP->getScopeLine(), 0, SP);
+      CI->setDebugLoc(DL);
+      RI->setDebugLoc(DL);
+    }
+    LLVM_DEBUG(dbgs() << "mergeGroup: " << F->getName() << " -> "
+                      << Merged->getName() << '\n');
+  }
+
+  ORE.emit([&] {
+    return OptimizationRemark(DEBUG_TYPE, "ParameterizedMerge", First)
+           << "merged " << NV("NumFunctions", NumMembers) << " functions into "
+           << NV("Merged", Merged) << " with " << NV("NumParams", Params.size())
+           << " parameters, saving an estimated code size of "
+           << NV("CodeSizeSavings", Savings);
+  });
+  NumParameterizedMerged += NumMembers;
+  NumParametersAdded += Params.size();
+  return true;
+}
+
+bool MergeFunctions::runOnModuleParameterized(
+    Module &M, function_ref<TargetTransformInfo &(Function &)> GetTTI) {
+  bool Changed = false;
+
+  // The structural hash ignores operands, so functions that only differ in
+  // constants have the same one.
+  std::vector<std::pair<IRHash, Function *>> HashedFuncs;
+  for (Function &Func : M)
+    if (isEligibleForMerging(Func) && canParameterize(Func))
+      HashedFuncs.push_back({StructuralHash(Func), &Func});
+  llvm::stable_sort(HashedFuncs, less_first());
+
+  for (auto I = HashedFuncs.begin(), IE = HashedFuncs.end(); I != IE;) {
+    auto Next = std::find_if(I, IE, [&](const auto &P) {
+      return P.first != I->first;
+    });
+    if (std::next(I) == Next) {
+      I = Next;
+      continue;
+    }
+
+    // Each function is only compared with the groups created last, so that
+    // large buckets don't take quadratic time.
+    SmallVector<ParameterizedGroup, 4> Groups;
+    for (; I != Next; ++I) {
+      Function *F = I->second;
+      auto Tried = MutableArrayRef(Groups).take_back(MergeFunctionsMaxGroups);
+      auto *G = find_if(Tried, [&](ParameterizedGroup &Group) {
+        return addToGroup(Group, F);
+      });
+      if (G == Tried.end()) {
+        Groups.emplace_back();
+        Groups.back().Members.push_back(F);
+        Groups.back().Constants.emplace_back();
+      }
+    }
+    for (const ParameterizedGroup &G : Groups)
+      if (G.Members.size() > 1)
+        Changed |= mergeGroup(G, GetTTI(*G.Members.front()));
+  }
+
+  GlobalNumbers.clear();
+  return Changed;
+}
@@ -0,0 +1,926 @@
+//===- ParallelFunctionPassAdaptor.cpp - Threaded function passes ---------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements ParallelModuleToFunctionPassAdaptor. The module is
+// handed to the workers as bitcode, together with a named metadata node that
+// lists the distinct metadata nodes of the module. A worker writes back the
+// functions it optimized, the global values its passes added, and the index
+// in that list of each distinct node its output refers to. Everything else is
+// turned into declarations, which the merge finds in the original module by
+// name.
+//
+// With a cache, a worker instead moves each function into a module of its own
+// and optimizes that in a new context. The list of distinct nodes then goes
+// with each of these modules, and the indices the output refers to are those
+// in that list.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO/ParallelFunctionPassAdaptor.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/Attributes.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/DebugProgramInstruction.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/BLAKE3.h"
+#include "llvm/Support/CachePruning.h"
+#include "llvm/Support/Caching.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SmallVectorMemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/VCSRevision.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/IPO/FunctionImport.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "parallel-function"
+
+STATISTIC(NumCacheHits, "Number of functions found in the cache");
+STATISTIC(NumCacheMisses, "Number of functions optimized and then cached");
+
+static cl::opt<std::string> ParallelFunctionCacheDir(
+    "parallel-function-cache-dir", cl::Hidden,
+    cl::desc("Cache the functions optimized by parallel-function adaptors in "
+             "this directory"));
+
+extern bool WriteNewDbgInfoFormatToBitcode;
+
+/// The named metadata that carries the distinct nodes of the original module
+/// to the workers, and the indices of the ones they refer to back.
+static const char *const DistinctNodesName = "llvm.parallel.distinct";
+
+/// The name given to unnamed global values while the workers run, so that
+/// the merge can find them. Names starting with "llvm." are reserved for
+/// intrinsics.
+static const char *const UnnamedValueName = "__parallel_unnamed";
+
+ParallelFunctionPipeline::~ParallelFunctionPipeline() = default;
+
+void ParallelFunctionPipeline::clear() {
+  LAM.clear();
+  FAM.clear();
+  CGAM.clear();
+  MAM.clear();
+}
+
+namespace {
+
+/// A module written by a worker, and the indices in the list of distinct nodes
+/// of the original module of those in the list it refers to, if the two lists
+/// are not the same.
+struct PartitionOutput {
+  std::unique_ptr<MemoryBuffer> Bitcode;
+  SmallVector<unsigned, 0> NodeIndices;
+};
+
+/// The work of one thread: the function definitions it optimizes, given by
+/// their index among the definitions of the module, and its output.
+struct Partition {
+  ArrayRef<unsigned> Definitions;
+  /// The position of the first of Definitions among those of all partitions,
+  /// which numbers the cache lookups.
+  unsigned FirstTask = 0;
+  std::unique_ptr<ParallelFunctionPipeline> Pipeline;
+  SmallVector<PartitionOutput, 1> Outputs;
+};
+
+/// Collects the distinct metadata nodes a module refers to.
+class DistinctNodeCollector {
+  SmallPtrSet<MDNode *, 32> Visited;
+  SmallVector<MDNode *, 32> Worklist;
+  SmallVector<std::pair<unsigned, MDNode *>, 8> Attachments;
+
+  void addNode(Metadata *MD) {
+    auto *N = dyn_cast_or_null<MDNode>(MD);
+    if (N && Visited.insert(N).second)
+      Worklist.push_back(N);
+  }
+
+  void addAttachments(const GlobalObject &GO) {
+    Attachments.clear();
+    GO.getAllMetadata(Attachments);
+    for (const auto &[Kind, N] : Attachments)
+      addNode(N);
+  }
+
+  void addInstruction(const Instruction &I) {
+    Attachments.clear();
+    I.getAllMetadata(Attachments);
+    for (const auto &[Kind, N] : Attachments)
+      addNode(N);
+    for (const Use &Op : I.operands())
+      if (auto *MAV = dyn_cast<MetadataAsValue>(Op))
+        addNode(MAV->getMetadata());
+    for (const DbgRecord &DR : I.getDbgRecordRange()) {
+      addNode(DR.getDebugLoc().getAsMDNode());
+      if (const auto *DVR = dyn_cast<DbgVariableRecord>(&DR)) {
+        addNode(DVR->getRawVariable());
+        addNode(DVR->getRawExpression());
+        addNode(DVR->getRawAssignID());
+        addNode(DVR->getRawAddressExpression());
+      } else {
+        addNode(cast<DbgLabelRecord>(DR).getRawLabel());
+      }
+    }
+  }
+
+public:
+  std::vector<MDNode *> collect(Module &M) {
+    for (const GlobalObject &GO : M.global_objects())
+      addAttachments(GO);
+    for (const Function &F : M)
+      for (const BasicBlock &BB : F)
+        for (const Instruction &I : BB)
+          addInstruction(I);
+    for (NamedMDNode &NMD : M.named_metadata())
+      for (MDNode *N : NMD.operands())
+        addNode(N);
+
+    std::vector<MDNode *> Distinct;
+    while (!Worklist.empty()) {
+      MDNode *N = Worklist.pop_back_val();
+      if (N->isDistinct())
+        Distinct.push_back(N);
+      for (const MDOperand &Op : N->operands())
+        addNode(Op.get());
+    }
+    return Distinct;
+  }
+};
+
+/// Moves the output of the workers into the original module.
+class PartitionMerger {
+  Module &M;
+  ArrayRef<MDNode *> DistinctNodes;
+  DenseSet<const GlobalValue *> Originals;
+  /// The attributes of the global values before the passes ran, which tell
+  /// the attributes a worker added from those it merely copied.
+  DenseMap<const Function *, AttributeList> OriginalFunctionAttrs;
+  DenseMap<const GlobalVariable *, AttributeSet> OriginalVariableAttrs;
+
+  /// Merges the changes the passes made to \p Output, a copy of \p GV in
+  /// the output of a worker, into GV.
+  void mergeChanges(const GlobalValue &Output, GlobalValue &GV);
+
+public:
+  PartitionMerger(Module &M, ArrayRef<MDNode *> DistinctNodes)
+      : M(M), DistinctNodes(DistinctNodes) {
+    for (const GlobalValue &GV : M.global_values()) {
+      Originals.insert(&GV);
+      if (const auto *F = dyn_cast<Function>(&GV))
+        OriginalFunctionAttrs[F] = F->getAttributes();
+      else if (const auto *Var = dyn_cast<GlobalVariable>(&GV))
+        OriginalVariableAttrs[Var] = Var->getAttributes();
+    }
+  }
+
+  void merge(StringRef Bitcode, ArrayRef<unsigned> NodeIndices);
+};
+
+/// Creates the declarations that stand in for the global values of the
+/// original module in the module of a single function, and copies constants
+/// with their values.
+class FragmentMaterializer final : public ValueMaterializer {
+  Module &Dst;
+
+public:
+  /// The copied constants, whose values still have to be mapped.
+  SmallVector<std::pair<GlobalVariable *, Constant *>, 4> Initializers;
+
+  FragmentMaterializer(Module &Dst) : Dst(Dst) {}
+
+  Value *materialize(Value *V) override;
+};
+
+/// The on-disk cache of optimized functions.
+class FunctionCache {
+  FileCache Cache;
+  /// Hashes what the output depends on besides the module of the function.
+  BLAKE3 KeyHasher;
+  /// The modules found in the cache or added to it, by task.
+  std::vector<std::unique_ptr<MemoryBuffer>> Buffers;
+
+public:
+  FunctionCache(StringRef Dir, unsigned NumTasks,
+                ParallelFunctionPipeline &Pipeline, bool DiscardValueNames,
+                bool NeedsProfileSummary);
+
+  /// Returns the optimized function for the module in \p Input. If it is not
+  /// in the cache, it is computed by \p Optimize and added. Each task may only
+  /// be looked up by one thread.
+  std::unique_ptr<MemoryBuffer>
+  get(unsigned Task, StringRef Name, StringRef Input,
+      function_ref<void(SmallVectorImpl<char> &)> Optimize);
+};
+
+} // end anonymous namespace
+
+/// Writes \p M as bitcode, in the debug info format BitcodeWriterPass uses.
+/// The modules are only read back by this pass, so there is no need for the
+/// symbol table WriteBitcodeToFile would add.
+static void writeModule(Module &M, SmallVectorImpl<char> &Buffer,
+                        bool ShouldPreserveUseListOrder) {
+  ScopedDbgInfoFormatSetter FormatSetter(M, M.IsNewDbgInfoFormat &&
+                                                WriteNewDbgInfoFormatToBitcode);
+  if (M.IsNewDbgInfoFormat)
+    M.removeDebugIntrinsicDeclarations();
+  BitcodeWriter Writer(Buffer);
+  Writer.writeModule(M, ShouldPreserveUseListOrder);
+  Writer.writeStrtab();
+}
+
+/// Returns the functions that have to stay in the original module: those with
+/// blocks whose address is taken, and those that refer to such a block.
+static SmallPtrSet<const Function *, 8> findPinnedFunctions(Module &M) {
+  SmallPtrSet<const Function *, 8> Pinned;
+  SmallVector<const User *, 8> Worklist;
+  for (const Function &F : M) {
+    for (const BasicBlock &BB : F) {
+      if (!BB.hasAddressTaken())
+        continue;
+      Pinned.insert(&F);
+      if (BlockAddress *BA = BlockAddress::lookup(&BB))
+        Worklist.push_back(BA);
+    }
+  }
+  while (!Worklist.empty()) {
+    const User *U = Worklist.pop_back_val();
+    if (const auto *I = dyn_cast<Instruction>(U)) {
+      Pinned.insert(I->getFunction());
+      continue;
+    }
+    append_range(Worklist, U->users());
+  }
+  return Pinned;
+}
+
+/// Runs the pipeline of \p P over \p Functions, which belong to \p M.
+static void runPipeline(ParallelFunctionPipeline &P, Module &M,
+                        ArrayRef<Function *> Functions,
+                        bool NeedsProfileSummary) {
+  // Function passes only look at the profile summary if it is cached, so
+  // compute it if the caller had it.
+  if (NeedsProfileSummary)
+    P.MAM.getResult<ProfileSummaryAnalysis>(M);
+  PassInstrumentation PI = P.MAM.getResult<PassInstrumentationAnalysis>(M);
+
+  for (Function *F : Functions) {
+    if (Error Err = F->materialize())
+      report_fatal_error(std::move(Err));
+    if (!PI.runBeforePass<Function>(P.FPM, *F))
+      continue;
+    PreservedAnalyses PassPA = P.FPM.run(*F, P.FAM);
+    P.FAM.invalidate(*F, PreservedAnalyses::none());
+    PI.runAfterPass(P.FPM, *F, PassPA);
+  }
+  P.clear();
+}
+
+/// Drops the lists held by the compile units of \p M. The compile units are
+/// mapped back to the original ones, so these would only be written for
+/// nothing.
+static void clearCompileUnitLists(Module &M) {
+  for (DICompileUnit *CU : M.debug_compile_units()) {
+    CU->replaceEnumTypes(nullptr);
+    CU->replaceRetainedTypes(nullptr);
+    CU->replaceGlobalVariables(nullptr);
+    CU->replaceImportedEntities(nullptr);
+    CU->replaceMacros(nullptr);
+  }
+}
+
+/// Turns the global values \p Others of the optimized module \p M into
+/// declarations, and writes M to \p Output together with the index in
+/// \p NodeIndex of each distinct node it still refers to.
+static void
+writeOptimizedModule(Module &M, ArrayRef<GlobalValue *> Others,
+                     const DenseMap<const MDNode *, unsigned> &NodeIndex,
+                     SmallVectorImpl<char> &Output) {
+  // The merge finds the declarations left behind by name.
+  for (GlobalValue *GV : Others)
+    if (!convertToDeclaration(*GV))
+      GV->eraseFromParent();
+  clearCompileUnitLists(M);
+
+  std::vector<MDNode *> Referenced = DistinctNodeCollector().collect(M);
+  NamedMDNode *Nodes = M.getOrInsertNamedMetadata(DistinctNodesName);
+  Type *Int32Ty = Type::getInt32Ty(M.getContext());
+  for (MDNode *N : Referenced) {
+    auto It = NodeIndex.find(N);
+    if (It == NodeIndex.end())
+      continue;
+    Metadata *Ops[] = {
+        ConstantAsMetadata::get(ConstantInt::get(Int32Ty, It->second)), N};
+    Nodes->addOperand(MDTuple::get(M.getContext(), Ops));
+  }
+
+  writeModule(M, Output, /*ShouldPreserveUseListOrder=*/true);
+}
+
+/// Reads the list of distinct nodes the workers get from \p M, and removes it.
+static DenseMap<const MDNode *, unsigned> takeDistinctNodes(Module &M) {
+  DenseMap<const MDNode *, unsigned> NodeIndex;
+  if (NamedMDNode *Nodes = M.getNamedMetadata(DistinctNodesName)) {
+    for (auto [Index, N] : enumerate(Nodes->operands()))
+      NodeIndex[N] = Index;
+    M.eraseNamedMetadata(Nodes);
+  }
+  return NodeIndex;
+}
+
+/// Creates a declaration in \p Dst that can stand in for \p GV.
+static GlobalValue *declareGlobalValue(const GlobalValue &GV, Module &Dst,
+                                       const Twine &Name) {
+  GlobalValue::LinkageTypes Linkage = GV.hasExternalWeakLinkage()
+                                          ? GlobalValue::ExternalWeakLinkage
+                                          : GlobalValue::ExternalLinkage;
+  GlobalValue *New;
+  if (auto *FTy = dyn_cast<FunctionType>(GV.getValueType())) {
+    Function *NewF =
+        Function::Create(FTy, Linkage, GV.getAddressSpace(), Name, &Dst);
+    if (const auto *F = dyn_cast<Function>(&GV)) {
+      NewF->setAttributes(F->getAttributes());
+      NewF->setCallingConv(F->getCallingConv());
+    }
+    New = NewF;
+  } else {
+    auto *NewVar = new GlobalVariable(
+        Dst, GV.getValueType(), /*isConstant=*/false, Linkage,
+        /*Initializer=*/nullptr, Name, /*InsertBefore=*/nullptr,
+        GV.getThreadLocalMode(), GV.getAddressSpace());
+    if (const auto *Var = dyn_cast<GlobalVariable>(&GV)) {
+      NewVar->setConstant(Var->isConstant());
+      NewVar->setExternallyInitialized(Var->isExternallyInitialized());
+      NewVar->setAttributes(Var->getAttributes());
+    }
+    New = NewVar;
+  }
+  if (const auto *GO = dyn_cast<GlobalObject>(&GV))
+    cast<GlobalObject>(New)->setAlignment(GO->getAlign());
+  if (!GV.hasLocalLinkage())
+    New->setVisibility(GV.getVisibility());
+  New->setUnnamedAddr(GV.getUnnamedAddr());
+  New->setDSOLocal(GV.isDSOLocal());
+  return New;
+}
+
+Value *FragmentMaterializer::materialize(Value *V) {
+  auto *GV = dyn_cast<GlobalValue>(V);
+  if (!GV)
+    return nullptr;
+
+  // Passes may fold loads from constants.
+  auto *Var = dyn_cast<GlobalVariable>(GV);
+  if (!Var || !Var->isConstant() || !Var->hasDefinitiveInitializer())
+    return declareGlobalValue(*GV, Dst, GV->getName());
+  auto *NewVar = new GlobalVariable(
+      Dst, Var->getValueType(), /*isConstant=*/true, Var->getLinkage(),
+      /*Initializer=*/nullptr, Var->getName(), /*InsertBefore=*/nullptr,
+      Var->getThreadLocalMode(), Var->getAddressSpace());
+  NewVar->copyAttributesFrom(Var);
+  Initializers.emplace_back(NewVar, Var->getInitializer());
+  return NewVar;
+}
+
+/// Moves \p F into a new module that holds nothing else the passes may look
+/// at, see the file comment of ParallelFunctionPassAdaptor.h, and replaces it
+/// by a declaration. The new module shares its metadata with the old one.
+/// It lists its distinct nodes like the input of the workers does, and returns
+/// them in \p DistinctNodes.
+static std::unique_ptr<Module>
+extractFunction(Function &F, std::vector<MDNode *> &DistinctNodes) {
+  Module &M = *F.getParent();
+  auto Fragment = std::make_unique<Module>("", M.getContext());
+  Fragment->setDataLayout(M.getDataLayout());
+  Fragment->setTargetTriple(M.getTargetTriple());
+  Fragment->setNewDbgInfoFormatFlag(M.IsNewDbgInfoFormat);
+
+  // Functions extracted later refer to the declaration, which has to look like
+  // F did.
+  GlobalValue *Decl = declareGlobalValue(F, M, "");
+  F.replaceAllUsesWith(Decl);
+  Decl->takeName(&F);
+  F.removeFromParent();
+  Fragment->getFunctionList().push_back(&F);
+  F.setName(Decl->getName());
+  if (const Comdat *C = F.getComdat()) {
+    Comdat *NewC = Fragment->getOrInsertComdat(C->getName());
+    NewC->setSelectionKind(C->getSelectionKind());
+    F.setComdat(NewC);
+  }
+
+  ValueToValueMapTy VMap;
+  VMap[Decl] = &F;
+  FragmentMaterializer Materializer(*Fragment);
+  ValueMapper Mapper(VMap,
+                     RF_ReuseAndMutateDistinctMDs | RF_IgnoreMissingLocals,
+                     /*TypeMapper=*/nullptr, &Materializer);
+  Mapper.remapFunction(F);
+  if (NamedMDNode *Flags = M.getModuleFlagsMetadata()) {
+    NamedMDNode *NewFlags = Fragment->getOrInsertModuleFlagsMetadata();
+    for (MDNode *Flag : Flags->operands())
+      NewFlags->addOperand(Mapper.mapMDNode(*Flag));
+  }
+  while (!Materializer.Initializers.empty()) {
+    auto [Var, Init] = Materializer.Initializers.pop_back_val();
+    Var->setInitializer(Mapper.mapConstant(*Init));
+  }
+
+  // The verifier wants the compile units that are referred to listed.
+  DistinctNodes = DistinctNodeCollector().collect(*Fragment);
+  for (MDNode *N : DistinctNodes)
+    if (isa<DICompileUnit>(N))
+      Fragment->getOrInsertNamedMetadata("llvm.dbg.cu")->addOperand(N);
+  NamedMDNode *Nodes = Fragment->getOrInsertNamedMetadata(DistinctNodesName);
+  for (MDNode *N : DistinctNodes)
+    Nodes->addOperand(N);
+  return Fragment;
+}
+
+/// Loads the module in \p Input, which extractFunction created, into a new
+/// context, optimizes its function, and writes it to \p Output. Nothing but
+/// Input and the pipeline can change the output, which makes it safe to
+/// cache.
+static void optimizeFragment(StringRef Input, StringRef Name,
+                             bool DiscardValueNames, bool NeedsProfileSummary,
+                             ParallelFunctionPipeline &P,
+                             SmallVectorImpl<char> &Output) {
+  LLVMContext Ctx;
+  Ctx.setDiscardValueNames(DiscardValueNames);
+  Expected<std::unique_ptr<Module>> MOrErr =
+      parseBitcodeFile(MemoryBufferRef(Input, Name), Ctx);
+  if (!MOrErr)
+    report_fatal_error(MOrErr.takeError());
+  Module &M = **MOrErr;
+  DenseMap<const MDNode *, unsigned> NodeIndex = takeDistinctNodes(M);
+
+  SmallVector<Function *, 1> Functions;
+  SmallVector<GlobalValue *, 0> Others;
+  for (GlobalValue &GV : M.global_values()) {
+    if (auto *F = dyn_cast<Function>(&GV); F && !F->isDeclaration())
+      Functions.push_back(F);
+    else
+      Others.push_back(&GV);
+  }
+
+  runPipeline(P, M, Functions, NeedsProfileSummary);
+  writeOptimizedModule(M, Others, NodeIndex, Output);
+}
+
+FunctionCache::FunctionCache(StringRef Dir, unsigned NumTasks,
+                             ParallelFunctionPipeline &Pipeline,
+                             bool DiscardValueNames, bool NeedsProfileSummary)
+    : Buffers(NumTasks) {
+  Expected<FileCache> CacheOrErr = localCache(
+      "ParallelFunctionCache", "ParallelFunction", Dir,
+      [this](unsigned Task, const Twine &ModuleName,
+             std::unique_ptr<MemoryBuffer> MB) {
+        Buffers[Task] = std::move(MB);
+      });
+  if (!CacheOrErr)
+    report_fatal_error(CacheOrErr.takeError());
+  Cache = std::move(*CacheOrErr);
+
+  KeyHasher.update(LLVM_VERSION_STRING);
+#ifdef LLVM_REVISION
+  KeyHasher.update(LLVM_REVISION);
+#endif
+  auto AddString = [&](StringRef Str) {
+    KeyHasher.update(Str);
+    KeyHasher.update(ArrayRef<uint8_t>{0});
+  };
+  std::string PipelineText;
+  raw_string_ostream OS(PipelineText);
+  Pipeline.FPM.printPipeline(OS, [](StringRef ClassName) { return ClassName; });
+  AddString(PipelineText);
+  AddString(Pipeline.Configuration);
+  KeyHasher.update(ArrayRef<uint8_t>{DiscardValueNames, NeedsProfileSummary});
+}
+
+std::unique_ptr<MemoryBuffer>
+FunctionCache::get(unsigned Task, StringRef Name, StringRef Input,
+                   function_ref<void(SmallVectorImpl<char> &)> Optimize) {
+  BLAKE3 Hasher = KeyHasher;
+  Hasher.update(Input);
+  std::string Key = toHex(Hasher.final(), /*LowerCase=*/true);
+
+  Expected<AddStreamFn> AddStreamOrErr = Cache(Task, Key, Name);
+  if (!AddStreamOrErr)
+    report_fatal_error(AddStreamOrErr.takeError());
+  if (AddStreamFn &AddStream = *AddStreamOrErr) {
+    ++NumCacheMisses;
+    SmallString<0> Output;
+    Optimize(Output);
+    // The cache hands the entry to Buffers once the stream is destroyed.
+    Expected<std::unique_ptr<CachedFileStream>> StreamOrErr =
+        AddStream(Task, Name);
+    if (!StreamOrErr)
+      report_fatal_error(StreamOrErr.takeError());
+    *(*StreamOrErr)->OS << Output;
+  } else {
+    ++NumCacheHits;
+  }
+  return std::move(Buffers[Task]);
+}
+
+/// Loads the module in \p Input into a new context, optimizes the definitions
+/// of \p P, and writes them to P.Outputs. The whole module is materialized,
+/// since passes may look at the uses of global values. With a \p Cache, each
+/// function is moved into a module of its own first.
+static void optimizePartition(StringRef Input, StringRef Identifier,
+                              bool DiscardValueNames, bool NeedsProfileSummary,
+                              FunctionCache *Cache, Partition &P) {
+  LLVMContext Ctx;
+  Ctx.setDiscardValueNames(DiscardValueNames);
+  Expected<std::unique_ptr<Module>> MOrErr =
+      parseBitcodeFile(MemoryBufferRef(Input, Identifier), Ctx);
+  if (!MOrErr)
+    report_fatal_error(MOrErr.takeError());
+  Module &M = **MOrErr;
+  DenseMap<const MDNode *, unsigned> NodeIndex = takeDistinctNodes(M);
+
+  // Everything but the definitions of this partition is only needed while the
+  // passes run, so remember what the module looked like before.
+  SmallVector<Function *, 0> Functions;
+  SmallVector<GlobalValue *, 0> Others;
+  const unsigned *Next = P.Definitions.begin();
+  unsigned Index = 0;
+  for (Function &F : M) {
+    if (F.isDeclaration())
+      continue;
+    if (Next != P.Definitions.end() && *Next == Index) {
+      Functions.push_back(&F);
+      ++Next;
+    } else {
+      Others.push_back(&F);
+    }
+    ++Index;
+  }
+  for (GlobalVariable &GV : M.globals())
+    Others.push_back(&GV);
+  for (GlobalAlias &GA : M.aliases())
+    Others.push_back(&GA);
+  for (GlobalIFunc &GI : M.ifuncs())
+    Others.push_back(&GI);
+
+  if (!Cache) {
+    runPipeline(*P.Pipeline, M, Functions, NeedsProfileSummary);
+    SmallString<0> Output;
+    writeOptimizedModule(M, Others, NodeIndex, Output);
+    P.Outputs.push_back({std::make_unique<SmallVectorMemoryBuffer>(
+                             std::move(Output), Identifier,
+                             /*RequiresNullTerminator=*/false),
+                         {}});
+    return;
+  }
+
+  // The lists of the compile units would otherwise be part of the key of every
+  // function.
+  clearCompileUnitLists(M);
+  for (auto [Index, F] : enumerate(Functions)) {
+    std::string Name = F->getName().str();
+    std::vector<MDNode *> DistinctNodes;
+    std::unique_ptr<Module> Fragment = extractFunction(*F, DistinctNodes);
+    SmallString<0> Input;
+    writeModule(*Fragment, Input, /*ShouldPreserveUseListOrder=*/false);
+
+    PartitionOutput &Out = P.Outputs.emplace_back();
+    Out.Bitcode = Cache->get(
+        P.FirstTask + Index, Name, Input, [&](SmallVectorImpl<char> &Output) {
+          optimizeFragment(Input, Name, DiscardValueNames, NeedsProfileSummary,
+                           *P.Pipeline, Output);
+        });
+    // Nodes that are not in the original list are left unmapped.
+    for (MDNode *N : DistinctNodes) {
+      auto It = NodeIndex.find(N);
+      Out.NodeIndices.push_back(It == NodeIndex.end() ? ~0u : It->second);
+    }
+  }
+}
+
+/// Returns \p Current with the attributes of \p Output that differ from
+/// \p Original, what they were before the passes ran. Memory effects are
+/// intersected, since passes only refine them. Other attributes that were
+/// already changed by another worker keep the value it gave them.
+static AttributeSet mergeAttributeSets(LLVMContext &Ctx, AttributeSet Current,
+                                       AttributeSet Output,
+                                       AttributeSet Original) {
+  auto Find = [](AttributeSet AS, Attribute A) {
+    return A.isStringAttribute() ? AS.getAttribute(A.getKindAsString())
+                                 : AS.getAttribute(A.getKindAsEnum());
+  };
+  AttrBuilder B(Ctx, Current);
+  for (Attribute A : Output) {
+    Attribute Old = Find(Original, A);
+    if (A == Old)
+      continue;
+    if (A.hasAttribute(Attribute::Memory))
+      B.addMemoryAttr(Current.getMemoryEffects() & A.getMemoryEffects());
+    else if (Find(Current, A) == Old)
+      B.addAttribute(A);
+  }
+  return AttributeSet::get(Ctx, B);
+}
+
+/// Merges the attributes of a function \p F like mergeAttributeSets.
+static AttributeList mergeAttributes(const Function &F, AttributeList Current,
+                                     AttributeList Output,
+                                     AttributeList Original) {
+  LLVMContext &Ctx = F.getContext();
+  SmallVector<AttributeSet, 8> Params;
+  for (unsigned I = 0, E = F.arg_size(); I != E; ++I)
+    Params.push_back(mergeAttributeSets(Ctx, Current.getParamAttrs(I),
+                                        Output.getParamAttrs(I),
+                                        Original.getParamAttrs(I)));
+  return AttributeList::get(
+      Ctx,
+      mergeAttributeSets(Ctx, Current.getFnAttrs(), Output.getFnAttrs(),
+                         Original.getFnAttrs()),
+      mergeAttributeSets(Ctx, Current.getRetAttrs(), Output.getRetAttrs(),
+                         Original.getRetAttrs()),
+      Params);
+}
+
+/// Gives \p GV the alignment of \p Output if that is larger.
+static void raiseAlignment(const GlobalValue &Output, GlobalValue &GV) {
+  const auto *OutputGO = dyn_cast<GlobalObject>(&Output);
+  auto *GO = dyn_cast<GlobalObject>(&GV);
+  if (!OutputGO || !GO)
+    return;
+  MaybeAlign A = OutputGO->getAlign();
+  if (A && (!GO->getAlign() || *A > *GO->getAlign()))
+    GO->setAlignment(A);
+}
+
+void PartitionMerger::mergeChanges(const GlobalValue &Output,
+                                   GlobalValue &GV) {
+  // Passes may raise the alignment of a global, e.g. InstCombine does for the
+  // source of a memcpy, and add attributes to it, e.g. to the library
+  // functions they call. The bodies of the worker may rely on both.
+  raiseAlignment(Output, GV);
+  if (auto *F = dyn_cast<Function>(&GV)) {
+    if (const auto *OutputF = dyn_cast<Function>(&Output))
+      F->setAttributes(mergeAttributes(*F, F->getAttributes(),
+                                       OutputF->getAttributes(),
+                                       OriginalFunctionAttrs.lookup(F)));
+  } else if (auto *Var = dyn_cast<GlobalVariable>(&GV)) {
+    if (const auto *OutputVar = dyn_cast<GlobalVariable>(&Output))
+      Var->setAttributes(mergeAttributeSets(
+          M.getContext(), Var->getAttributes(), OutputVar->getAttributes(),
+          OriginalVariableAttrs.lookup(Var)));
+  }
+}
+
+void PartitionMerger::merge(StringRef Bitcode,
+                            ArrayRef<unsigned> NodeIndices) {
+  Expected<std::unique_ptr<Module>> MOrErr = getLazyBitcodeModule(
+      MemoryBufferRef(Bitcode, M.getModuleIdentifier()), M.getContext());
+  if (!MOrErr)
+    report_fatal_error(MOrErr.takeError());
+  std::unique_ptr<Module> Src = std::move(*MOrErr);
+
+  ValueToValueMapTy VMap;
+  ValueMapper Mapper(VMap,
+                     RF_ReuseAndMutateDistinctMDs | RF_IgnoreMissingLocals);
+
+  if (NamedMDNode *Nodes = Src->getNamedMetadata(DistinctNodesName)) {
+    for (MDNode *Op : Nodes->operands()) {
+      uint64_t Index =
+          mdconst::extract<ConstantInt>(Op->getOperand(0))->getZExtValue();
+      if (!NodeIndices.empty())
+        Index = NodeIndices[Index];
+      if (Index < DistinctNodes.size())
+        VMap.MD()[Op->getOperand(1)].reset(DistinctNodes[Index]);
+    }
+    Src->eraseNamedMetadata(Nodes);
+  }
+
+  // Global values that were in the module map to the original ones, and so do
+  // declarations the passes added if another partition added them first. The
+  // changes the passes made to them are merged, whatever the order of the
+  // partitions.
+  SmallVector<std::pair<Function *, Function *>, 0> Bodies;
+  SmallVector<GlobalValue *, 0> Added;
+  for (GlobalValue &GV : Src->global_values()) {
+    GlobalValue *Existing =
+        GV.hasName() ? M.getNamedValue(GV.getName()) : nullptr;
+    if (!Existing || (!Originals.contains(Existing) && !GV.isDeclaration())) {
+      Added.push_back(&GV);
+      continue;
+    }
+    VMap[&GV] = Existing;
+    if (auto *F = dyn_cast<Function>(&GV); F && !F->isDeclaration())
+      Bodies.emplace_back(F, cast<Function>(Existing));
+    else
+      mergeChanges(GV, *Existing);
+  }
+
+  for (GlobalValue *GV : Added) {
+    GV->removeFromParent();
+    if (auto *F = dyn_cast<Function>(GV))
+      M.getFunctionList().push_back(F);
+    else if (auto *Var = dyn_cast<GlobalVariable>(GV))
+      M.insertGlobalVariable(Var);
+    else if (auto *GA = dyn_cast<GlobalAlias>(GV))
+      M.insertAlias(GA);
+    else
+      M.insertIFunc(cast<GlobalIFunc>(GV));
+
+    // Comdats belong to the module.
+    if (auto *GO = dyn_cast<GlobalObject>(GV); GO && GO->hasComdat()) {
+      const Comdat *C = GO->getComdat();
+      Comdat *NewC = M.getOrInsertComdat(C->getName());
+      NewC->setSelectionKind(C->getSelectionKind());
+      GO->setComdat(NewC);
+    }
+  }
+
+  for (GlobalValue *GV : Added) {
+    if (auto *F = dyn_cast<Function>(GV)) {
+      if (Error Err = F->materialize())
+        report_fatal_error(std::move(Err));
+      F->setIsNewDbgInfoFormat(M.IsNewDbgInfoFormat);
+      Mapper.remapFunction(*F);
+    } else if (auto *Var = dyn_cast<GlobalVariable>(GV)) {
+      if (Var->hasInitializer())
+        Var->setInitializer(Mapper.mapConstant(*Var->getInitializer()));
+      Mapper.remapGlobalObjectMetadata(*Var);
+    } else if (auto *GA = dyn_cast<GlobalAlias>(GV)) {
+      GA->setAliasee(Mapper.mapConstant(*GA->getAliasee()));
+    } else {
+      auto *GI = cast<GlobalIFunc>(GV);
+      GI->setResolver(Mapper.mapConstant(*GI->getResolver()));
+    }
+  }
+
+  // Replace the bodies the same way IRMover links them in.
+  for (auto [From, To] : Bodies) {
+    if (Error Err = From->materialize())
+      report_fatal_error(std::move(Err));
+    From->setIsNewDbgInfoFormat(To->IsNewDbgInfoFormat);
+
+    // The attributes are those of the body, plus those other workers added.
+    To->dropAllReferences();
+    raiseAlignment(*From, *To);
+    To->setAttributes(mergeAttributes(*To, From->getAttributes(),
+                                      To->getAttributes(),
+                                      OriginalFunctionAttrs.lookup(To)));
+    To->setCallingConv(From->getCallingConv());
+    if (From->hasPrefixData())
+      To->setPrefixData(From->getPrefixData());
+    if (From->hasPrologueData())
+      To->setPrologueData(From->getPrologueData());
+    if (From->hasPersonalityFn())
+      To->setPersonalityFn(From->getPersonalityFn());
+    To->copyMetadata(From, 0);
+    To->stealArgumentListFrom(*From);
+    To->splice(To->end(), From);
+    Mapper.remapFunction(*To);
+  }
+}
+
+PreservedAnalyses
+ParallelModuleToFunctionPassAdaptor::run(Module &M, ModuleAnalysisManager &AM) {
+  SmallPtrSet<const Function *, 8> Pinned = findPinnedFunctions(M);
+  bool NeedsProfileSummary = AM.getCachedResult<ProfileSummaryAnalysis>(M);
+
+  // Unnamed global values get a name while the workers run.
+  SmallVector<GlobalValue *, 0> Unnamed;
+  for (GlobalValue &GV : M.global_values()) {
+    if (!GV.hasName()) {
+      GV.setName(UnnamedValueName);
+      Unnamed.push_back(&GV);
+    }
+  }
+
+  DistinctNodeCollector Collector;
+  std::vector<MDNode *> DistinctNodes = Collector.collect(M);
+  NamedMDNode *Nodes = M.getOrInsertNamedMetadata(DistinctNodesName);
+  for (MDNode *N : DistinctNodes)
+    Nodes->addOperand(N);
+  SmallString<0> Input;
+  writeModule(M, Input, /*ShouldPreserveUseListOrder=*/true);
+  M.eraseNamedMetadata(Nodes);
+
+  // Split the definitions that can be moved into contiguous ranges with about
+  // the same number of instructions.
+  SmallVector<unsigned, 0> Definitions;
+  SmallVector<unsigned, 0> Costs;
+  SmallVector<Function *, 0> PinnedFunctions;
+  uint64_t TotalCost = 0;
+  unsigned Index = 0;
+  for (Function &F : M) {
+    if (F.isDeclaration())
+      continue;
+    if (Pinned.contains(&F)) {
+      PinnedFunctions.push_back(&F);
+    } else {
+      Definitions.push_back(Index);
+      Costs.push_back(F.getInstructionCount() + 1);
+      TotalCost += Costs.back();
+    }
+    ++Index;
+  }
+
+  unsigned NumPartitions =
+      std::min<size_t>(heavyweight_hardware_concurrency(Threads)
+                           .compute_thread_count(),
+                       Definitions.size());
+  std::vector<Partition> Partitions(NumPartitions);
+  uint64_t Cost = 0;
+  for (unsigned I = 0, Begin = 0; I != NumPartitions; ++I) {
+    unsigned End = Definitions.size();
+    if (I + 1 != NumPartitions) {
+      // Leave at least one definition for each of the remaining partitions.
+      unsigned Limit = Definitions.size() - (NumPartitions - I - 1);
+      uint64_t Target = TotalCost * (I + 1) / NumPartitions;
+      End = Begin;
+      do
+        Cost += Costs[End++];
+      while (End != Limit && Cost < Target);
+    }
+    Partitions[I].Definitions =
+        ArrayRef(Definitions).slice(Begin, End - Begin);
+    Partitions[I].FirstTask = Begin;
+    Partitions[I].Pipeline = BuildPipeline();
+    Begin = End;
+  }
+
+  StringRef Dir = CacheDir.empty() ? StringRef(ParallelFunctionCacheDir)
+                                   : StringRef(CacheDir);
+  if (!Partitions.empty()) {
+    StringRef Identifier = M.getModuleIdentifier();
+    bool DiscardValueNames = M.getContext().shouldDiscardValueNames();
+    std::unique_ptr<FunctionCache> Cache;
+    if (!Dir.empty())
+      Cache = std::make_unique<FunctionCache>(
+          Dir, Definitions.size(), *Partitions.front().Pipeline,
+          DiscardValueNames, NeedsProfileSummary);
+
+    DefaultThreadPool Pool(heavyweight_hardware_concurrency(NumPartitions));
+    for (Partition &P : Partitions)
+      Pool.async([&Input, &P, Identifier, DiscardValueNames,
+                  NeedsProfileSummary, Cache = Cache.get()] {
+        optimizePartition(Input, Identifier, DiscardValueNames,
+                          NeedsProfileSummary, Cache, P);
+      });
+    Pool.wait();
+
+    // Merge in order, so that the global values the passes added are renamed
+    // the same way whatever the number of partitions.
+    PartitionMerger Merger(M, DistinctNodes);
+    for (Partition &P : Partitions)
+      for (PartitionOutput &Out : P.Outputs)
+        Merger.merge(Out.Bitcode->getBuffer(), Out.NodeIndices);
+
+    if (Cache)
+      pruneCache(Dir, CachePruningPolicy());
+  }
+
+  for (GlobalValue *GV : Unnamed)
+    GV->setName("");
+
+  if (!PinnedFunctions.empty()) {
+    std::unique_ptr<ParallelFunctionPipeline> P =
+        Partitions.empty() ? BuildPipeline()
+                           : std::move(Partitions.front().Pipeline);
+    runPipeline(*P, M, PinnedFunctions, NeedsProfileSummary);
+  }
+
+  // All function bodies have been replaced.
+  return PreservedAnalyses::none();
+}
+
+void ParallelModuleToFunctionPassAdaptor::printPipeline(
+    raw_ostream &OS, function_ref<StringRef(StringRef)> MapClassName2PassName) {
+  OS << "parallel-function";
+  if (Threads)
+    OS << '<' << Threads << '>';
+  OS << '(';
+  BuildPipeline()->FPM.printPipeline(OS, MapClassName2PassName);
+  OS << ')';
+}
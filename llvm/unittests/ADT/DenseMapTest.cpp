@@ -10,6 +10,7 @@
 #include "llvm/ADT/DenseMapInfo.h"
 #include "llvm/ADT/DenseMapInfoVariant.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/SwissDenseMap.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include <map>
@@ -109,6 +110,10 @@ typedef ::testing::Types<DenseMap<uint32_t, uint32_t>,
                          SmallDenseMap<uint32_t, uint32_t>,
                          SmallDenseMap<uint32_t *, uint32_t *>,
                          SmallDenseMap<CtorTester, CtorTester, 4,
+                                       CtorTesterMapInfo>,
+                         SwissDenseMap<uint32_t, uint32_t>,
+                         SwissDenseMap<uint32_t *, uint32_t *>,
+                         SwissDenseMap<CtorTester, CtorTester,
                                        CtorTesterMapInfo>
                          > DenseMapTestTypes;
 TYPED_TEST_SUITE(DenseMapTest, DenseMapTestTypes, );
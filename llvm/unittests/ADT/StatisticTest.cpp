@@ -9,6 +9,9 @@
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 using namespace llvm;
 
 using OptionalStatistic = std::optional<std::pair<StringRef, uint64_t>>;
@@ -169,4 +172,47 @@ TEST(StatisticTest, API) {
 #endif
 }
 
+#if LLVM_ENABLE_STATS && LLVM_ENABLE_THREADS
+TEST(StatisticTest, Threads) {
+  EnableStatistics();
+
+  Counter = 10;
+  std::vector<std::thread> Threads;
+  for (int I = 0; I < 4; ++I)
+    Threads.emplace_back([] {
+      for (int J = 0; J < 1000; ++J)
+        ++Counter;
+      Counter -= 500;
+    });
+  for (std::thread &T : Threads)
+    T.join();
+  EXPECT_EQ(Counter, 2010u);
+
+  // The counters of a thread are included before it exits.
+  std::mutex M;
+  std::condition_variable CV;
+  bool Counted = false, Done = false;
+  std::thread T([&] {
+    Counter += 5;
+    std::unique_lock<std::mutex> Lock(M);
+    Counted = true;
+    CV.notify_all();
+    CV.wait(Lock, [&] { return Done; });
+  });
+  {
+    std::unique_lock<std::mutex> Lock(M);
+    CV.wait(Lock, [&] { return Counted; });
+    EXPECT_EQ(Counter, 2015u);
+    Counter = 1;
+    EXPECT_EQ(Counter, 1u);
+    Done = true;
+    CV.notify_all();
+  }
+  T.join();
+  EXPECT_EQ(Counter, 1u);
+  Counter++;
+  EXPECT_EQ(Counter, 2u);
+}
+#endif
+
 } // end anonymous namespace
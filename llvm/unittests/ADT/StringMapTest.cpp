@@ -10,9 +10,12 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/Support/DataTypes.h"
+#include "llvm/Support/ReverseIteration.h"
 #include "gtest/gtest.h"
 #include <limits>
+#include <string>
 #include <tuple>
+#include <vector>
 using namespace llvm;
 
 namespace {
@@ -498,6 +501,111 @@ TEST_F(StringMapTest, PrecomputedHash) {
   ASSERT_EQ(I->second, Value);
 }
 
+// Returns \p Count keys whose hash, as used by the table, satisfies \p Pred.
+std::vector<std::string> findKeys(unsigned Count,
+                                  function_ref<bool(uint32_t)> Pred) {
+  std::vector<std::string> Keys;
+  for (unsigned I = 0; Keys.size() != Count; ++I) {
+    std::string Key = "key" + std::to_string(I);
+    uint32_t Hash = StringMap<int>::hash(Key);
+    if (shouldReverseIterate())
+      Hash = ~Hash;
+    if (Pred(Hash))
+      Keys.push_back(Key);
+  }
+  return Keys;
+}
+
+TEST_F(StringMapTest, ProbeWrapsAround) {
+  // The keys all start probing at the fourth last bucket, so the last two are
+  // stored at the start of the table and found through the control bytes
+  // mirrored after its end.
+  StringMap<int> Map(32);
+  ASSERT_EQ(64u, Map.getNumBuckets());
+  std::vector<std::string> Keys =
+      findKeys(6, [](uint32_t Hash) { return (Hash & 63) == 60; });
+  for (auto [I, Key] : enumerate(Keys))
+    Map[Key] = I;
+  std::vector<std::string> Order;
+  for (auto &Entry : Map)
+    Order.push_back(Entry.getKey().str());
+  EXPECT_EQ(Keys[4], Order[0]);
+  EXPECT_EQ(Keys[5], Order[1]);
+
+  // The keys starting at the first bucket skip the wrapped ones.
+  std::vector<std::string> OtherKeys =
+      findKeys(4, [](uint32_t Hash) { return (Hash & 63) == 0; });
+  for (const std::string &Key : OtherKeys)
+    Map[Key] = -1;
+  ASSERT_EQ(64u, Map.getNumBuckets());
+  for (auto [I, Key] : enumerate(Keys))
+    EXPECT_EQ(int(I), Map.lookup(Key));
+  for (const std::string &Key : OtherKeys)
+    EXPECT_EQ(-1, Map.lookup(Key));
+
+  // Erasing the wrapped keys leaves tombstones that don't end the probes.
+  Map.erase(Keys[4]);
+  Map.erase(Keys[5]);
+  EXPECT_FALSE(Map.contains(Keys[4]));
+  EXPECT_FALSE(Map.contains(Keys[5]));
+  for (const std::string &Key : OtherKeys)
+    EXPECT_EQ(-1, Map.lookup(Key));
+}
+
+TEST_F(StringMapTest, TombstoneReuse) {
+  // Three keys that start probing at the same bucket.
+  std::vector<std::string> Keys =
+      findKeys(3, [](uint32_t Hash) { return (Hash & 15) == 5; });
+  StringMap<int> Map;
+  Map[Keys[0]] = 0;
+  Map[Keys[1]] = 1;
+  Map.erase(Keys[0]);
+  ASSERT_EQ(16u, Map.getNumBuckets());
+
+  // The second key is found past the tombstone of the first, rather than
+  // inserted again.
+  EXPECT_FALSE(Map.insert({Keys[1], 2}).second);
+  EXPECT_EQ(1, Map.lookup(Keys[1]));
+  EXPECT_EQ(1u, Map.size());
+
+  // The third key takes the bucket of the first, before the second one.
+  Map[Keys[2]] = 2;
+  ASSERT_EQ(16u, Map.getNumBuckets());
+  auto I = Map.begin();
+  EXPECT_EQ(Keys[2], I->getKey());
+  EXPECT_EQ(Keys[1], (++I)->getKey());
+
+  // Erasing and inserting the same keys many times doesn't grow the table.
+  for (unsigned Round = 0; Round != 64; ++Round) {
+    Map.erase(Keys[Round % 3]);
+    Map[Keys[(Round + 1) % 3]] = Round;
+  }
+  EXPECT_EQ(16u, Map.getNumBuckets());
+  EXPECT_EQ(1u, Map.size());
+  EXPECT_EQ(63, Map.lookup(Keys[1]));
+}
+
+TEST_F(StringMapTest, SameTag) {
+  // Keys whose hashes have the same top seven bits have the same control
+  // byte, so each lookup has to compare the full hash of every match.
+  std::vector<std::string> Keys =
+      findKeys(300, [](uint32_t Hash) { return (Hash >> 25) == 42; });
+  StringMap<int> Map;
+  for (unsigned I = 0; I != 200; ++I)
+    Map[Keys[I]] = I;
+  EXPECT_EQ(200u, Map.size());
+  for (unsigned I = 0; I != 200; ++I)
+    EXPECT_EQ(int(I), Map.lookup(Keys[I]));
+  for (unsigned I = 200; I != 300; ++I)
+    EXPECT_FALSE(Map.contains(Keys[I]));
+
+  for (unsigned I = 0; I != 200; I += 2)
+    Map.erase(Keys[I]);
+  EXPECT_EQ(100u, Map.size());
+  for (unsigned I = 0; I != 200; ++I)
+    EXPECT_EQ(I % 2 != 0, Map.contains(Keys[I]));
+}
+
 struct Countable {
   int &InstanceCount;
   int Number;
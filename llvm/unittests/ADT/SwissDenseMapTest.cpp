@@ -0,0 +1,146 @@
+//===- llvm/unittest/ADT/SwissDenseMapTest.cpp - SwissDenseMap tests ------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// The interface shared with DenseMap is covered by the typed tests in
+// DenseMapTest.cpp. These tests cover the behaviour that differs.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/SwissDenseMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "gtest/gtest.h"
+#include <map>
+#include <random>
+
+using namespace llvm;
+
+namespace {
+
+// Keys equal to the empty and tombstone keys of DenseMapInfo are fine.
+TEST(SwissDenseMapTest, SentinelKeys) {
+  SwissDenseMap<unsigned, int> Map;
+  unsigned Empty = DenseMapInfo<unsigned>::getEmptyKey();
+  unsigned Tombstone = DenseMapInfo<unsigned>::getTombstoneKey();
+  Map[Empty] = 1;
+  Map[Tombstone] = 2;
+  EXPECT_EQ(2u, Map.size());
+  EXPECT_EQ(1, Map.lookup(Empty));
+  EXPECT_EQ(2, Map.lookup(Tombstone));
+  EXPECT_TRUE(Map.erase(Empty));
+  EXPECT_FALSE(Map.contains(Empty));
+  EXPECT_TRUE(Map.contains(Tombstone));
+}
+
+// Erasing and inserting different keys must not grow the map, no matter how
+// often it is repeated.
+TEST(SwissDenseMapTest, EraseChurnDoesNotGrow) {
+  SwissDenseMap<unsigned, unsigned> Map;
+  Map.reserve(100);
+  size_t MemorySize = Map.getMemorySize();
+
+  for (unsigned I = 0; I < 80; ++I)
+    Map[I] = I;
+  for (unsigned I = 80; I < 100000; ++I) {
+    EXPECT_TRUE(Map.erase(I - 80));
+    Map[I] = I;
+  }
+
+  EXPECT_EQ(80u, Map.size());
+  EXPECT_EQ(MemorySize, Map.getMemorySize());
+  for (unsigned I = 99920; I < 100000; ++I)
+    EXPECT_EQ(I, Map.lookup(I));
+}
+
+// Keys whose hash values collide in the low bits end up in the same group.
+TEST(SwissDenseMapTest, CollidingHashes) {
+  struct CollidingInfo {
+    static unsigned getHashValue(unsigned Val) { return Val & 1; }
+    static bool isEqual(unsigned LHS, unsigned RHS) { return LHS == RHS; }
+  };
+  SwissDenseMap<unsigned, unsigned, CollidingInfo> Map;
+  for (unsigned I = 0; I < 200; ++I)
+    EXPECT_TRUE(Map.try_emplace(I, I * 2).second);
+  for (unsigned I = 0; I < 200; I += 3)
+    EXPECT_TRUE(Map.erase(I));
+  for (unsigned I = 0; I < 200; ++I) {
+    if (I % 3 == 0)
+      EXPECT_FALSE(Map.contains(I));
+    else
+      EXPECT_EQ(I * 2, Map.lookup(I));
+  }
+}
+
+// Compare against std::map with a random mix of operations, including maps
+// smaller than a group.
+TEST(SwissDenseMapTest, RandomOperations) {
+  std::mt19937 Rng(0);
+  for (unsigned Range : {4u, 20u, 300u, 5000u}) {
+    SwissDenseMap<unsigned, unsigned> Map;
+    std::map<unsigned, unsigned> Expected;
+    for (unsigned I = 0; I < 50000; ++I) {
+      unsigned Key = Rng() % Range;
+      switch (Rng() % 4) {
+      case 0:
+      case 1:
+        EXPECT_EQ(Expected.try_emplace(Key, I).second,
+                  Map.try_emplace(Key, I).second);
+        break;
+      case 2:
+        EXPECT_EQ(Expected.erase(Key) != 0, Map.erase(Key));
+        break;
+      case 3:
+        if (Rng() % 1000 == 0) {
+          Map.clear();
+          Expected.clear();
+        }
+        break;
+      }
+    }
+
+    ASSERT_EQ(Expected.size(), Map.size());
+    for (const auto &[Key, Value] : Expected)
+      EXPECT_EQ(Value, Map.lookup(Key));
+    unsigned NumVisited = 0;
+    for (const auto &KV : Map) {
+      EXPECT_EQ(Expected[KV.first], KV.second);
+      ++NumVisited;
+    }
+    EXPECT_EQ(Expected.size(), NumVisited);
+  }
+}
+
+// find_as and insert_as use the hash and equality of the lookup key.
+TEST(SwissDenseMapTest, FindAsStringRef) {
+  SwissDenseMap<StringRef, int> Map;
+  std::string Key = "foo";
+  Map.insert_as(std::make_pair(StringRef("foo"), 1), StringRef(Key));
+  EXPECT_EQ(1u, Map.size());
+  EXPECT_NE(Map.end(), Map.find_as(StringRef(Key)));
+  EXPECT_EQ(Map.end(), Map.find_as(StringRef("bar")));
+}
+
+// Erasing through an iterator while walking the map visits every entry once.
+TEST(SwissDenseMapTest, EraseWhileIterating) {
+  SwissDenseMap<unsigned, unsigned> Map;
+  for (unsigned I = 0; I < 1000; ++I)
+    Map[I] = I;
+
+  unsigned NumVisited = 0;
+  for (auto It = Map.begin(), E = Map.end(); It != E;) {
+    auto Cur = It++;
+    ++NumVisited;
+    if (Cur->first % 2)
+      Map.erase(Cur);
+  }
+  EXPECT_EQ(1000u, NumVisited);
+  EXPECT_EQ(500u, Map.size());
+  for (auto &KV : Map)
+    EXPECT_EQ(0u, KV.first % 2);
+}
+
+} // end anonymous namespace
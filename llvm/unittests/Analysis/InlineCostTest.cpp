@@ -9,6 +9,7 @@
 #include "llvm/Analysis/InlineCost.h"
 #include "llvm/Analysis/AssumptionCache.h"
 #include "llvm/Analysis/InlineModelFeatureMaps.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/AsmParser/Parser.h"
 #include "llvm/IR/InstIterator.h"
@@ -150,4 +151,90 @@ declare void @prevent_sroa(ptr)
   }
 }
 
+// Tests that reusing the callee summary across call sites does not change the
+// computed costs.
+TEST(InlineCostTest, CalleeInfoReuse) {
+  const auto *const IR = R"IR(
+define i32 @callee(i32 %x, ptr %p) {
+entry:
+  %c = icmp sgt i32 %x, 0
+  call void @llvm.assume(i1 %c)
+  %i = ptrtoint ptr %p to i64
+  %t = trunc i64 %i to i32
+  %z = icmp eq i32 %x, 7
+  br i1 %z, label %then, label %exit
+then:
+  %l = load i32, ptr %p
+  %a = add i32 %l, %t
+  store i32 %a, ptr %p
+  br label %exit
+exit:
+  %r = phi i32 [ %a, %then ], [ %x, %entry ]
+  ret i32 %r
+}
+
+define i32 @caller(i32 %y, ptr %p) {
+  %a = call i32 @callee(i32 7, ptr %p)
+  %b = call i32 @callee(i32 %y, ptr %p)
+  %c = alloca i32
+  %d = call i32 @callee(i32 3, ptr %c)
+  %e = call i32 @caller(i32 %y, ptr %p)
+  %s = add i32 %a, %b
+  %t = add i32 %s, %d
+  %u = add i32 %t, %e
+  ret i32 %u
+}
+
+declare void @llvm.assume(i1)
+)IR";
+
+  LLVMContext C;
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(IR, Err, C);
+  ASSERT_TRUE(M);
+
+  FunctionAnalysisManager FAM;
+  FAM.registerPass([&] { return TargetIRAnalysis(); });
+  FAM.registerPass([&] { return TargetLibraryAnalysis(); });
+  FAM.registerPass([&] { return AssumptionAnalysis(); });
+  FAM.registerPass([&] { return InlineCostCalleeAnalysis(); });
+  FAM.registerPass([&] { return PassInstrumentationAnalysis(); });
+
+  auto GetAssumptionCache = [&](Function &F) -> AssumptionCache & {
+    return FAM.getResult<AssumptionAnalysis>(F);
+  };
+  auto GetTLI = [&](Function &F) -> const TargetLibraryInfo & {
+    return FAM.getResult<TargetLibraryAnalysis>(F);
+  };
+  auto GetCalleeInfo = [&](Function &F) -> InlineCostCalleeInfo & {
+    return FAM.getResult<InlineCostCalleeAnalysis>(F);
+  };
+
+  Function *Callee = M->getFunction("callee");
+  InlineParams Params = getInlineParams();
+  unsigned NumCalls = 0;
+  for (auto &I : instructions(M->getFunction("caller"))) {
+    auto *CB = dyn_cast<CallBase>(&I);
+    if (!CB || CB->getCalledFunction() != Callee)
+      continue;
+    ++NumCalls;
+    auto &TTI = FAM.getResult<TargetIRAnalysis>(*Callee);
+    InlineCost Fresh = getInlineCost(*CB, Params, TTI, GetAssumptionCache,
+                                     GetTLI);
+    // Ask twice, the second query reuses the summary of the first one.
+    for (unsigned Query = 0; Query != 2; ++Query) {
+      InlineCost Reused =
+          getInlineCost(*CB, Params, TTI, GetAssumptionCache, GetTLI, nullptr,
+                        nullptr, nullptr, GetCalleeInfo);
+      EXPECT_EQ(Fresh.isAlways(), Reused.isAlways());
+      EXPECT_EQ(Fresh.isNever(), Reused.isNever());
+      if (Fresh.isVariable() && Reused.isVariable()) {
+        EXPECT_EQ(Fresh.getCost(), Reused.getCost());
+        EXPECT_EQ(Fresh.getThreshold(), Reused.getThreshold());
+      }
+    }
+  }
+  EXPECT_EQ(NumCalls, 3u);
+}
+
 } // namespace
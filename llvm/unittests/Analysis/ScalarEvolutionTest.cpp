@@ -21,9 +21,13 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/SourceMgr.h"
 #include "gtest/gtest.h"
 
+extern llvm::cl::opt<unsigned> SCEVMaxCachedValues;
+extern llvm::cl::opt<unsigned> SCEVMaxCachedBackedgeTakenCounts;
+
 namespace llvm {
 
 // We use this fixture to ensure that we clean up ScalarEvolution before
@@ -1589,4 +1593,113 @@ TEST_F(ScalarEvolutionsTest, ApplyLoopGuards) {
   });
 }
 
+// A chain of loops, each of which runs until the value computed by the
+// previous one, so that the results of one loop depend on the others.
+static std::string makeLoopChain(unsigned NumLoops) {
+  std::string IR;
+  raw_string_ostream OS(IR);
+  OS << "define i64 @f(i64 %n) {\n"
+     << "loop_entry:\n"
+     << "  br label %loop0\n";
+  for (unsigned I = 0; I != NumLoops; ++I) {
+    std::string N = std::to_string(I);
+    std::string Bound = I ? "%b" + std::to_string(I - 1) : "%n";
+    std::string Pred = I ? "%loop" + std::to_string(I - 1) : "%loop_entry";
+    OS << "loop" << N << ":\n"
+       << "  %iv" << N << " = phi i64 [ 0, " << Pred << " ], [ %iv" << N
+       << ".next, %loop" << N << " ]\n"
+       << "  %a" << N << " = mul i64 %iv" << N << ", " << (I + 3) << "\n"
+       << "  %b" << N << " = add i64 %a" << N << ", %n\n"
+       << "  %iv" << N << ".next = add nuw i64 %iv" << N << ", 1\n"
+       << "  %c" << N << " = icmp ult i64 %iv" << N << ".next, " << Bound
+       << "\n"
+       << "  br i1 %c" << N << ", label %loop" << N << ", label %loop"
+       << (I + 1) << "\n";
+  }
+  OS << "loop" << NumLoops << ":\n"
+     << "  ret i64 %b" << (NumLoops - 1) << "\n"
+     << "}\n";
+  return IR;
+}
+
+TEST_F(ScalarEvolutionsTest, BoundedCaches) {
+  std::string IR = makeLoopChain(24);
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(IR, Err, Context);
+  ASSERT_TRUE(M && "Could not parse module?");
+  ASSERT_TRUE(!verifyModule(*M) && "Must have been well formed!");
+
+  // Query every loop and instruction twice, the second time after most of
+  // the results of the first were evicted.
+  auto Query = [&]() {
+    std::string Str;
+    raw_string_ostream OS(Str);
+    runWithSE(*M, "f", [&](Function &F, LoopInfo &LI, ScalarEvolution &SE) {
+      for (unsigned Round = 0; Round != 2; ++Round) {
+        for (Loop *L : LI.getLoopsInPreorder())
+          OS << *SE.getBackedgeTakenCount(L) << "\n"
+             << *SE.getSymbolicMaxBackedgeTakenCount(L) << "\n";
+        for (Instruction &I : instructions(F))
+          if (SE.isSCEVable(I.getType()))
+            OS << *SE.getSCEV(&I) << "\n";
+      }
+    });
+    return Str;
+  };
+
+  unsigned OldMaxValues = SCEVMaxCachedValues;
+  unsigned OldMaxCounts = SCEVMaxCachedBackedgeTakenCounts;
+  SCEVMaxCachedValues = 0;
+  SCEVMaxCachedBackedgeTakenCounts = 0;
+  std::string Unbounded = Query();
+  SCEVMaxCachedValues = 8;
+  SCEVMaxCachedBackedgeTakenCounts = 2;
+  std::string Bounded = Query();
+  SCEVMaxCachedValues = OldMaxValues;
+  SCEVMaxCachedBackedgeTakenCounts = OldMaxCounts;
+  EXPECT_EQ(Unbounded, Bounded);
+}
+
+TEST_F(ScalarEvolutionsTest, BoundedCachesNestedQueries) {
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M =
+      parseAssemblyString(makeLoopChain(24), Err, Context);
+  ASSERT_TRUE(M && "Could not parse module?");
+  ASSERT_TRUE(!verifyModule(*M) && "Must have been well formed!");
+
+  // Computing the values at scope and the ranges of the instructions creates
+  // many SCEVs and backedge-taken counts in nested queries. The caches must
+  // not be trimmed under those queries, or they lose their placeholders.
+  auto Query = [&]() {
+    std::string Str;
+    raw_string_ostream OS(Str);
+    runWithSE(*M, "f", [&](Function &F, LoopInfo &LI, ScalarEvolution &SE) {
+      for (unsigned Round = 0; Round != 2; ++Round) {
+        for (Instruction &I : instructions(F)) {
+          if (!SE.isSCEVable(I.getType()))
+            continue;
+          OS << *SE.getSCEVAtScope(&I, nullptr) << " "
+             << SE.getUnsignedRange(SE.getSCEV(&I)) << "\n";
+          if (Loop *L = LI.getLoopFor(I.getParent()))
+            OS << *SE.getSCEVAtScope(&I, L) << "\n";
+        }
+      }
+      SE.verify();
+    });
+    return Str;
+  };
+
+  unsigned OldMaxValues = SCEVMaxCachedValues;
+  unsigned OldMaxCounts = SCEVMaxCachedBackedgeTakenCounts;
+  SCEVMaxCachedValues = 0;
+  SCEVMaxCachedBackedgeTakenCounts = 0;
+  std::string Unbounded = Query();
+  SCEVMaxCachedValues = 2;
+  SCEVMaxCachedBackedgeTakenCounts = 1;
+  std::string Bounded = Query();
+  SCEVMaxCachedValues = OldMaxValues;
+  SCEVMaxCachedBackedgeTakenCounts = OldMaxCounts;
+  EXPECT_EQ(Unbounded, Bounded);
+}
+
 }  // end namespace llvm
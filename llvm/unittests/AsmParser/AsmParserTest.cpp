@@ -117,6 +117,48 @@ TEST(AsmParserTest, TypeAndConstantValueParsing) {
   EXPECT_EQ(Error.getMessage(), "expected end of string");
 }
 
+TEST(AsmParserTest, KeywordAndIntegerLexing) {
+  LLVMContext Ctx;
+  SMDiagnostic Error;
+  Module M("test", Ctx);
+
+  std::pair<StringRef, Type *> Types[] = {
+      {"half", Type::getHalfTy(Ctx)},
+      {"bfloat", Type::getBFloatTy(Ctx)},
+      {"x86_fp80", Type::getX86_FP80Ty(Ctx)},
+      {"ppc_fp128", Type::getPPC_FP128Ty(Ctx)},
+      {"label", Type::getLabelTy(Ctx)},
+      {"metadata", Type::getMetadataTy(Ctx)},
+      {"token", Type::getTokenTy(Ctx)},
+      {"ptr", PointerType::getUnqual(Ctx)},
+      {"i17", Type::getIntNTy(Ctx, 17)}};
+  for (auto [Name, Ty] : Types)
+    EXPECT_EQ(parseType(Name, Error, M), Ty) << Name;
+
+  // Integers of up to 18 digits are lexed without APInt's string parsing;
+  // both ways have to agree on the value.
+  std::pair<StringRef, APInt> Ints[] = {
+      {"i1 -0", APInt(1, 0)},
+      {"i8 -1", APInt(8, -1, /*isSigned=*/true)},
+      {"i8 255", APInt(8, 255)},
+      {"i64 -123456789012345678",
+       APInt(64, -123456789012345678, /*isSigned=*/true)},
+      {"i64 999999999999999999", APInt(64, 999999999999999999)},
+      {"i64 -9223372036854775808", APInt::getSignedMinValue(64)},
+      {"i64 18446744073709551615", APInt::getMaxValue(64)},
+      {"i128 -170141183460469231731687303715884105728",
+       APInt::getSignedMinValue(128)}};
+  for (auto [Asm, Val] : Ints) {
+    auto *CI = dyn_cast_or_null<ConstantInt>(parseConstantValue(Asm, Error, M));
+    ASSERT_TRUE(CI) << Asm;
+    EXPECT_EQ(CI->getValue(), Val) << Asm;
+  }
+
+  // Keywords are only matched in full.
+  EXPECT_FALSE(parseType("voids", Error, M));
+  EXPECT_FALSE(parseConstantValue("i32 addd (i32 1, i32 2)", Error, M));
+}
+
 TEST(AsmParserTest, TypeAndConstantValueWithSlotMappingParsing) {
   LLVMContext Ctx;
   SMDiagnostic Error;
@@ -21,6 +21,7 @@
 #include "llvm/Support/Error.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/Threading.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -257,6 +258,69 @@ TEST(BitReaderTest, MaterializeFunctionsForBlockAddrInFunctionAfter) {
   EXPECT_FALSE(verifyModule(*M, &dbgs()));
 }
 
+TEST(BitReaderTest, MaterializeFunctionsInParallel) {
+  // Enough functions for a few chunks, with function-level constants, value
+  // names and metadata attachments, and a blockaddress that pulls in a
+  // function that comes later.
+  std::string Assembly = "@g = global i32 0\n"
+                         "define ptr @before() {\n"
+                         "  ret ptr blockaddress(@func, %bb)\n"
+                         "}\n";
+  for (unsigned I = 0; I != 100; ++I)
+    Assembly += "define i64 @f" + std::to_string(I) +
+                "(i64 %x) {\n"
+                "entry:\n"
+                "  %a = add i64 %x, " +
+                std::to_string(I * 1000000007ULL) +
+                "\n"
+                "  %c = icmp eq i64 %a, 7\n"
+                "  br i1 %c, label %t, label %e, !prof !0\n"
+                "t:\n"
+                "  store i64 %a, ptr @g\n"
+                "  br label %e\n"
+                "e:\n"
+                "  %p = phi i64 [ %a, %t ], [ -1, %entry ]\n"
+                "  ret i64 %p\n"
+                "}\n";
+  Assembly += "define void @func() {\n"
+              "  unreachable\n"
+              "bb:\n"
+              "  unreachable\n"
+              "}\n"
+              "!0 = !{!\"branch_weights\", i32 1, i32 2}\n";
+
+  std::string Expected;
+  {
+    LLVMContext Context;
+    raw_string_ostream OS(Expected);
+    std::unique_ptr<Module> M = parseAssembly(Context, Assembly.c_str());
+    M->setModuleIdentifier("test");
+    M->print(OS, nullptr);
+  }
+
+  for (unsigned Threads : {1, 4}) {
+    SCOPED_TRACE(Threads);
+    SmallString<1024> Mem;
+    LLVMContext Context;
+    std::unique_ptr<Module> M =
+        getLazyModuleFromAssembly(Context, Mem, Assembly.c_str());
+    std::vector<Function *> Fns;
+    for (Function &F : *M)
+      Fns.push_back(&F);
+    ASSERT_FALSE(errorToBool(
+        M->materializeFunctions(Fns, hardware_concurrency(Threads))));
+    for (Function &F : *M)
+      EXPECT_FALSE(F.isMaterializable());
+    ASSERT_FALSE(errorToBool(M->materializeAll()));
+    EXPECT_FALSE(verifyModule(*M, &dbgs()));
+
+    std::string Actual;
+    raw_string_ostream OS(Actual);
+    M->print(OS, nullptr);
+    EXPECT_EQ(Expected, Actual);
+  }
+}
+
 // Helper function to convert type metadata to a string for testing
 static std::string mdToString(Metadata *MD) {
   std::string S;
@@ -161,6 +161,45 @@ TEST(BitstreamReaderTest, shortRead) {
   }
 }
 
+TEST(BitstreamReaderTest, ReadVBR64Array) {
+  // Values of all sizes, so that some of them straddle words.
+  SmallVector<uint64_t, 0> Values;
+  for (unsigned I = 0; I != 64; ++I) {
+    Values.push_back(I);
+    Values.push_back(uint64_t(1) << I);
+    Values.push_back((uint64_t(1) << I) - 1);
+  }
+  Values.push_back(~uint64_t(0));
+
+  for (unsigned NumBits : {2, 3, 6, 8, 17, 32}) {
+    SCOPED_TRACE(NumBits);
+    SmallVector<char, 0> Buffer;
+    {
+      BitstreamWriter Stream(Buffer);
+      Stream.Emit(1, 1);
+      for (uint64_t V : Values)
+        Stream.EmitVBR64(V, NumBits);
+      Stream.FlushToWord();
+    }
+
+    SimpleBitstreamCursor Cursor(
+        ArrayRef<uint8_t>((const uint8_t *)Buffer.data(), Buffer.size()));
+    ASSERT_TRUE((bool)Cursor.Read(1));
+    SmallVector<uint64_t, 0> Read;
+    ASSERT_FALSE(errorToBool(Cursor.ReadVBR64Array(NumBits, 10, Read)));
+    ASSERT_FALSE(errorToBool(
+        Cursor.ReadVBR64Array(NumBits, Values.size() - 10, Read)));
+    EXPECT_EQ(Values, Read);
+
+    // Reading past the end fails like ReadVBR64 does.
+    Cursor = SimpleBitstreamCursor(
+        ArrayRef<uint8_t>((const uint8_t *)Buffer.data(), Buffer.size()));
+    Read.clear();
+    EXPECT_TRUE(errorToBool(
+        Cursor.ReadVBR64Array(NumBits, Buffer.size() * 8, Read)));
+  }
+}
+
 static_assert(std::is_trivially_copyable_v<BitCodeAbbrevOp>,
               "trivially copyable");
 
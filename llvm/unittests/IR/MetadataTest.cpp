@@ -3112,6 +3112,31 @@ TEST_F(DILocalVariableTest, getArg256) {
                      ->getArg());
 }
 
+TEST_F(DILocalVariableTest, getAnnotations) {
+  DILocalScope *Scope = getSubprogram();
+  DIFile *File = getFile();
+  DIType *Type = getDerivedType();
+
+  // The annotations operand is only allocated when there are annotations.
+  auto *N = DILocalVariable::get(Context, Scope, "name", File, 1, Type, 0,
+                                 DINode::FlagZero, 0, nullptr);
+  EXPECT_EQ(4u, N->getNumOperands());
+  EXPECT_EQ(nullptr, N->getRawAnnotations());
+  EXPECT_EQ(Type, N->getType());
+
+  MDTuple *Annotations = MDTuple::get(Context, {getSubprogram()});
+  auto *A = DILocalVariable::get(Context, Scope, "name", File, 1, Type, 0,
+                                 DINode::FlagZero, 0, Annotations);
+  EXPECT_EQ(5u, A->getNumOperands());
+  EXPECT_EQ(Annotations, A->getAnnotations().get());
+  EXPECT_NE(N, A);
+
+  TempDILocalVariable Temp = N->clone();
+  EXPECT_EQ(N, MDNode::replaceWithUniqued(std::move(Temp)));
+  Temp = A->clone();
+  EXPECT_EQ(A, MDNode::replaceWithUniqued(std::move(Temp)));
+}
+
 typedef MetadataTest DIExpressionTest;
 
 TEST_F(DIExpressionTest, get) {
@@ -8,6 +8,7 @@
 
 #include "llvm/AsmParser/Parser.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/User.h"
@@ -107,4 +108,59 @@ TEST(UseTest, reverse) {
   ASSERT_EQ(8u, I);
 }
 
+TEST(UseTest, getUser) {
+  // Each Use finds its User by following the waymarks to the end of its
+  // array, so check arrays longer than the 20 fixed waymarks as well.
+  LLVMContext C;
+  Module M("m", C);
+  Type *I32 = Type::getInt32Ty(C);
+  SmallVector<Type *, 64> Params(64, I32);
+  Function *F = Function::Create(FunctionType::get(I32, Params, false),
+                                 GlobalValue::ExternalLinkage, "f", M);
+  BasicBlock *Entry = BasicBlock::Create(C, "entry", F);
+  BasicBlock *Exit = BasicBlock::Create(C, "exit", F);
+  IRBuilder<> B(Entry);
+
+  // Co-allocated operands, with and without a descriptor.
+  SmallVector<Value *, 64> Args;
+  for (Argument &A : F->args())
+    Args.push_back(&A);
+  FunctionCallee G =
+      M.getOrInsertFunction("g", FunctionType::get(I32, {}, true));
+  for (unsigned N : {0u, 1u, 2u, 17u, 18u, 19u, 20u, 21u, 64u}) {
+    CallInst *Calls[] = {
+        B.CreateCall(G, ArrayRef(Args).take_front(N)),
+        B.CreateCall(G, ArrayRef(Args).take_front(N),
+                     {OperandBundleDef("b", Args[1])})};
+    for (CallInst *Call : Calls)
+      for (const Use &U : Call->operands()) {
+        EXPECT_EQ(U.getUser(), Call);
+        EXPECT_EQ(&Call->getOperandUse(U.getOperandNo()), &U);
+      }
+  }
+  B.CreateBr(Exit);
+
+  // Hung-off operands, which are reallocated as the PHI grows.
+  B.SetInsertPoint(Exit);
+  PHINode *Phi = B.CreatePHI(I32, 1);
+  for (unsigned I = 0; I != 50; ++I) {
+    Phi->addIncoming(Args[I], Entry);
+    for (const Use &U : Phi->operands()) {
+      EXPECT_EQ(U.getUser(), Phi);
+      EXPECT_EQ(Phi->getIncomingBlock(U), Entry);
+    }
+    ASSERT_EQ(Phi->getNumIncomingValues(), I + 1);
+    EXPECT_EQ(Phi->getIncomingValue(I), Args[I]);
+  }
+
+  // Swapping operands moves the values but not the waymarks.
+  Phi->getOperandUse(0).swap(Phi->getOperandUse(49));
+  EXPECT_EQ(Phi->getIncomingValue(0), Args[49]);
+  EXPECT_EQ(Phi->getIncomingValue(49), Args[0]);
+  EXPECT_EQ(Phi->getOperandUse(0).getUser(), Phi);
+  EXPECT_EQ(Phi->getOperandUse(49).getOperandNo(), 49u);
+  for (const Use &U : Args[0]->uses())
+    EXPECT_TRUE(U.getUser() == Phi || isa<CallInst>(U.getUser()));
+}
+
 } // end anonymous namespace
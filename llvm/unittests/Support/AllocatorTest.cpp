@@ -9,6 +9,7 @@
 #include "llvm/Support/Allocator.h"
 #include "gtest/gtest.h"
 #include <cstdlib>
+#include <cstring>
 
 using namespace llvm;
 
@@ -258,4 +259,25 @@ TEST(AllocatorTest, TestBigAlignment) {
   EXPECT_GT(MockSlabAllocator::GetLastSlabSize(), 4096u);
 }
 
+// Slabs of a HugePageBumpPtrAllocator are huge page sized mappings, objects
+// larger than a slab get a mapping of their own.
+TEST(AllocatorTest, TestHugePageSlabs) {
+  HugePageBumpPtrAllocator Alloc;
+  for (int I = 0; I < 1000; ++I) {
+    char *P = static_cast<char *>(Alloc.Allocate(1000, 8));
+    memset(P, I, 1000);
+  }
+  EXPECT_EQ(1U, Alloc.GetNumSlabs());
+  EXPECT_EQ(HugePageSlabAllocator::HugePageSize, Alloc.getTotalMemory());
+
+  const size_t BigSize = 3 * HugePageSlabAllocator::HugePageSize;
+  char *Big = static_cast<char *>(Alloc.Allocate(BigSize, 16));
+  memset(Big, 1, BigSize);
+  EXPECT_EQ(2U, Alloc.GetNumSlabs());
+  EXPECT_TRUE(Alloc.identifyObject(Big + BigSize - 1).has_value());
+
+  Alloc.Reset();
+  EXPECT_EQ(1U, Alloc.GetNumSlabs());
+}
+
 }  // anonymous namespace
@@ -15,6 +15,8 @@
 #include "llvm/Support/HashBuilder.h"
 #include "gtest/gtest.h"
 
+#include <vector>
+
 using namespace llvm;
 
 namespace {
@@ -92,4 +94,32 @@ TEST(BLAKE3Test, SmallerHashSize) {
   EXPECT_EQ(hashStr1, toHex(hash4));
 }
 
+TEST(BLAKE3Test, Parallel) {
+  std::vector<uint8_t> Input(5 * 1024 * 1024 + 777);
+  for (size_t I = 0; I < Input.size(); ++I)
+    Input[I] = uint8_t(I * 2654435761u >> 24);
+  ArrayRef<uint8_t> Data(Input);
+
+  // The parallel path splits the largest subtrees of the input further, which
+  // must not change the result.
+  for (size_t Size : {size_t(0), BLAKE3::MinParallelSize - 1,
+                      BLAKE3::MinParallelSize, BLAKE3::MinParallelSize + 1,
+                      size_t(4 * 1024 * 1024), Input.size()}) {
+    EXPECT_EQ(toHex(BLAKE3::hash(Data.take_front(Size))),
+              toHex(BLAKE3::hashParallel(Data.take_front(Size))))
+        << Size;
+  }
+
+  // Start in the middle of a chunk, and of a larger subtree.
+  for (size_t Prefix : {size_t(100), size_t(3 * 1024), size_t(129 * 1024)}) {
+    BLAKE3 Sequential;
+    Sequential.update(Data.take_front(Prefix));
+    Sequential.update(Data.drop_front(Prefix));
+    BLAKE3 Parallel;
+    Parallel.update(Data.take_front(Prefix));
+    Parallel.updateParallel(Data.drop_front(Prefix));
+    EXPECT_EQ(toHex(Sequential.final()), toHex(Parallel.final())) << Prefix;
+  }
+}
+
 } // namespace
@@ -435,6 +435,40 @@ TEST_F(MemoryBufferTest, mmapVolatileNoNull) {
   EXPECT_TRUE(MB->getBuffer().starts_with("01234567"));
 }
 
+TEST_F(MemoryBufferTest, mmapAdvice) {
+  // Access pattern hints must not change the contents of a mapped buffer.
+  int FD;
+  SmallString<64> TestPath;
+  ASSERT_NO_ERROR(sys::fs::createTemporaryFile("MemoryBufferTest_mmapAdvice",
+                                               "temp", FD, TestPath));
+  FileRemover Cleanup(TestPath);
+  raw_fd_ostream OF(FD, true);
+  unsigned PageSize = sys::Process::getPageSizeEstimate();
+  unsigned FileWrites = (PageSize * 4) / 8;
+  for (unsigned i = 0; i < FileWrites; ++i)
+    OF << "01234567";
+  OF.close();
+
+  auto MBOrError = MemoryBuffer::getFile(TestPath, /*IsText=*/false,
+                                         /*RequiresNullTerminator=*/false);
+  ASSERT_NO_ERROR(MBOrError.getError())
+  OwningBuffer MB = std::move(*MBOrError);
+  EXPECT_EQ(MB->getBufferKind(), MemoryBuffer::MemoryBuffer_MMap);
+  for (auto Pattern : {MemoryBuffer::AccessPattern::WillNeed,
+                       MemoryBuffer::AccessPattern::Sequential,
+                       MemoryBuffer::AccessPattern::Random,
+                       MemoryBuffer::AccessPattern::Normal}) {
+    MB->adviseIfMmap(Pattern);
+    EXPECT_EQ(MB->getBufferSize(), std::size_t(FileWrites * 8));
+    EXPECT_TRUE(MB->getBuffer().ends_with("01234567"));
+  }
+
+  // Buffers that aren't mapped ignore the hint.
+  OwningBuffer Copy = MemoryBuffer::getMemBufferCopy(MB->getBuffer());
+  Copy->adviseIfMmap(MemoryBuffer::AccessPattern::WillNeed);
+  EXPECT_EQ(MB->getBuffer(), Copy->getBuffer());
+}
+
 // Test that SmallVector without a null terminator gets one.
 TEST(SmallVectorMemoryBufferTest, WithoutNullTerminatorRequiresNullTerminator) {
   SmallString<0> Data("some data");
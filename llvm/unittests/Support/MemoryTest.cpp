@@ -122,6 +122,26 @@ TEST_P(MappedMemoryTest, AllocAndReleaseHuge) {
   EXPECT_FALSE(Memory::releaseMappedMemory(M1));
 }
 
+TEST_P(MappedMemoryTest, AllocAndReleaseHugeAligned) {
+  CHECK_UNSUPPORTED();
+  const size_t HugePageSize = 2 * 1024 * 1024;
+  std::error_code EC;
+  MemoryBlock M1 = Memory::allocateMappedMemory(
+      HugePageSize + 1, nullptr, Flags | Memory::MF_HUGE_HINT, EC);
+  EXPECT_EQ(std::error_code(), EC);
+
+  EXPECT_NE((void *)nullptr, M1.base());
+  EXPECT_LE(HugePageSize + 1, M1.allocatedSize());
+#if defined(__linux__)
+  // Requests of at least a huge page are aligned so that they can be backed
+  // by transparent huge pages.
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(M1.base()) % HugePageSize);
+  EXPECT_EQ(0u, M1.allocatedSize() % HugePageSize);
+#endif
+
+  EXPECT_FALSE(Memory::releaseMappedMemory(M1));
+}
+
 TEST_P(MappedMemoryTest, MultipleAllocAndRelease) {
   CHECK_UNSUPPORTED();
   std::error_code EC;
@@ -103,6 +103,29 @@ TEST(Parallel, TaskGroupSequentialFor) {
   EXPECT_EQ(Count, 500ul);
 }
 
+TEST(Parallel, TaskGroupMixedSequential) {
+  // Sequential tasks keep their order and do not overlap, even if parallel
+  // tasks are spawned in between.
+  size_t Count = 0;
+  std::atomic<unsigned> Running{0};
+  std::atomic<size_t> ParallelCount{0};
+  {
+    parallel::TaskGroup tg;
+    for (size_t Idx = 0; Idx < 500; Idx++) {
+      tg.spawn(
+          [&, Idx]() {
+            EXPECT_EQ(Running++, 0u);
+            EXPECT_EQ(Count++, Idx);
+            --Running;
+          },
+          true);
+      tg.spawn([&]() { ++ParallelCount; });
+    }
+  }
+  EXPECT_EQ(Count, 500ul);
+  EXPECT_EQ(ParallelCount, 500ul);
+}
+
 #if LLVM_ENABLE_THREADS
 TEST(Parallel, NestedTaskGroup) {
   // This test checks:
@@ -453,6 +453,71 @@ TEST_F(SourceMgrTest, LocationPastEndOf257ByteBufferEndingInNewline) {
             Output);
 }
 
+TEST_F(SourceMgrTest, LineAndColumnInLongBuffer) {
+  // Lines of varying length, so that line endings fall at every position of
+  // the groups of bytes that are scanned together.
+  std::string Text;
+  std::vector<std::pair<unsigned, unsigned>> Expected;
+  unsigned Line = 1;
+  for (unsigned Len = 0; Text.size() < 70000; Len = (Len + 7) % 53) {
+    for (unsigned Col = 1; Col <= Len; ++Col) {
+      Text += Col % 11 ? 'x' : '\t';
+      Expected.emplace_back(Line, Col);
+    }
+    Text += '\n';
+    Expected.emplace_back(Line++, Len + 1);
+  }
+  setMainBuffer(Text, "file.in");
+
+  for (unsigned Offset = 0; Offset < Text.size(); Offset += 97)
+    EXPECT_EQ(Expected[Offset], SM.getLineAndColumn(getLoc(Offset)))
+        << "at offset " << Offset;
+  EXPECT_EQ(std::make_pair(Line, 1u),
+            SM.getLineAndColumn(getLoc(Text.size())));
+  EXPECT_EQ(getLoc(Text.size() - 1),
+            SM.FindLocForLineAndColumn(MainBufferID, Line - 1,
+                                       Expected.back().second));
+  EXPECT_EQ(SMLoc(), SM.FindLocForLineAndColumn(MainBufferID, Line + 1, 1));
+}
+
+TEST_F(SourceMgrTest, FindBufferContainingLoc) {
+  // Two buffers that are adjacent in memory. A pointer to the end of the first
+  // one belongs to it, even after a lookup in the second one.
+  StringRef Text = "aaaa\nbbbb\n";
+  unsigned First = SM.AddNewSourceBuffer(
+      MemoryBuffer::getMemBuffer(Text.take_front(5), "first", false), SMLoc());
+  unsigned Second = SM.AddNewSourceBuffer(
+      MemoryBuffer::getMemBuffer(Text.drop_front(5), "second", false),
+      SMLoc());
+  SMLoc Boundary = SMLoc::getFromPointer(Text.data() + 5);
+  EXPECT_EQ(Second,
+            SM.FindBufferContainingLoc(SMLoc::getFromPointer(Text.data() + 7)));
+  EXPECT_EQ(First, SM.FindBufferContainingLoc(Boundary));
+  EXPECT_EQ(Second,
+            SM.FindBufferContainingLoc(SMLoc::getFromPointer(Text.data() + 8)));
+  EXPECT_EQ(First, SM.FindBufferContainingLoc(Boundary));
+  EXPECT_EQ(0u, SM.FindBufferContainingLoc(
+                    SMLoc::getFromPointer(Text.data() + 11)));
+}
+
+TEST_F(SourceMgrTest, FindBufferContainingLocOverlapping) {
+  // A buffer that shares its memory with an earlier one. Locations in both
+  // belong to the earlier buffer, even after a lookup in the later one.
+  StringRef Text = "aaaa\nbbbb\n";
+  unsigned Part = SM.AddNewSourceBuffer(
+      MemoryBuffer::getMemBuffer(Text.drop_front(5), "part", false), SMLoc());
+  unsigned Whole = SM.AddNewSourceBuffer(
+      MemoryBuffer::getMemBuffer(Text, "whole", false), SMLoc());
+  EXPECT_EQ(Whole,
+            SM.FindBufferContainingLoc(SMLoc::getFromPointer(Text.data() + 2)));
+  EXPECT_EQ(Part,
+            SM.FindBufferContainingLoc(SMLoc::getFromPointer(Text.data() + 7)));
+  EXPECT_EQ(Whole,
+            SM.FindBufferContainingLoc(SMLoc::getFromPointer(Text.data() + 3)));
+  EXPECT_EQ(Part,
+            SM.FindBufferContainingLoc(SMLoc::getFromPointer(Text.data() + 8)));
+}
+
 TEST_F(SourceMgrTest, BasicRange) {
   setMainBuffer("aaa bbb\nccc ddd\n", "file.in");
   printMessage(getLoc(4), SourceMgr::DK_Error, "message", getRange(4, 3),
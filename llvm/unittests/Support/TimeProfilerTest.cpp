@@ -15,6 +15,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/TimeProfiler.h"
+#include "llvm/Testing/Support/Error.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -65,6 +66,74 @@ TEST(TimeProfiler, Async_Begin_End_Smoke) {
   ASSERT_TRUE(json.find(R"("detail":"detail")") != std::string::npos);
 }
 
+static size_t countEvents(StringRef JSON, StringRef Name) {
+  return JSON.count((R"("name":")" + Name + "\"").str());
+}
+
+TEST(TimeProfiler, Ring_Buffer) {
+  TimeTraceProfilerOptions Options;
+  Options.RingBufferSize = 4;
+  timeTraceProfilerInitialize(Options, "test");
+
+  { TimeTraceScope scope("first"); }
+  for (int I = 0; I < 10; ++I)
+    TimeTraceScope scope("event");
+
+  std::string json = teardownProfiler();
+  // Only the last four events are kept, but the total covers all of them.
+  EXPECT_EQ(countEvents(json, "first"), 0u);
+  EXPECT_EQ(countEvents(json, "event"), 4u);
+  EXPECT_NE(json.find(R"("name":"Total first")"), std::string::npos);
+  EXPECT_NE(json.find(R"("count":10)"), std::string::npos);
+  EXPECT_NE(json.find(R"("droppedEvents":7)"), std::string::npos);
+}
+
+TEST(TimeProfiler, Sampling) {
+  TimeTraceProfilerOptions Options;
+  Options.SamplingPeriod = 3;
+  timeTraceProfilerInitialize(Options, "test");
+
+  for (int I = 0; I < 10; ++I)
+    TimeTraceScope scope("event");
+
+  std::string json = teardownProfiler();
+  EXPECT_EQ(countEvents(json, "event"), 4u);
+  EXPECT_NE(json.find(R"("count":10)"), std::string::npos);
+  EXPECT_EQ(json.find("droppedEvents"), std::string::npos);
+}
+
+TEST(TimeProfiler, Binary) {
+  setupProfiler();
+
+  {
+    TimeTraceScope scope("outer", "detail");
+    { TimeTraceScope scope("inner"); }
+    auto *Profiler = timeTraceAsyncProfilerBegin("async", "");
+    timeTraceProfilerEnd(Profiler);
+  }
+
+  SmallVector<char, 1024> JSON;
+  raw_svector_ostream JSONOS(JSON);
+  timeTraceProfilerWrite(JSONOS);
+  SmallVector<char, 1024> Binary;
+  raw_svector_ostream BinaryOS(Binary);
+  timeTraceProfilerWriteBinary(BinaryOS);
+  timeTraceProfilerCleanup();
+
+  SmallVector<char, 1024> Converted;
+  raw_svector_ostream ConvertedOS(Converted);
+  ASSERT_THAT_ERROR(timeTraceProfilerConvertToJSON(BinaryOS.str(), ConvertedOS),
+                    Succeeded());
+  EXPECT_EQ(ConvertedOS.str(), JSONOS.str());
+  EXPECT_LT(Binary.size(), JSON.size());
+
+  EXPECT_THAT_ERROR(timeTraceProfilerConvertToJSON("{}", ConvertedOS),
+                    Failed());
+  EXPECT_THAT_ERROR(timeTraceProfilerConvertToJSON(
+                        BinaryOS.str().drop_back(), ConvertedOS),
+                    Failed());
+}
+
 TEST(TimeProfiler, Begin_End_Disabled) {
   // Nothing should be observable here. The test is really just making sure
   // we've not got a stray nullptr deref.
@@ -7,6 +7,8 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/Timer.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 
 #if _WIN32
@@ -61,4 +63,38 @@ TEST(Timer, CheckIfTriggered) {
   EXPECT_FALSE(T1.hasTriggered());
 }
 
+TEST(Timer, PerfCounters) {
+  auto &Opt = static_cast<cl::opt<bool> &>(
+      *cl::getRegisteredOptions()["track-perf-counters"]);
+  bool OldTrackPerfCounters = Opt;
+  Opt = true;
+
+  TimerGroup TG("perf", "Perf counters");
+  Timer T1("T1", "T1", TG);
+  volatile unsigned Sum = 0;
+  T1.startTimer();
+  for (unsigned I = 0; I != 100000; ++I)
+    Sum += I;
+  T1.stopTimer();
+  Opt = OldTrackPerfCounters;
+
+  TimeRecord TR = T1.getTotalTime();
+  if (!TR.getCycles()) {
+    T1.clear();
+    GTEST_SKIP() << "hardware performance counters are not available";
+  }
+  EXPECT_GT(TR.getInstructionsExecuted(), 100000u);
+
+  std::string Report;
+  raw_string_ostream OS(Report);
+  TG.print(OS);
+  EXPECT_NE(Report.find("---Cycles---"), std::string::npos);
+
+  std::string JSON;
+  raw_string_ostream JOS(JSON);
+  TG.printJSONValues(JOS, "");
+  EXPECT_NE(JSON.find("\"time.perf.T1.cycles\""), std::string::npos);
+  T1.clear();
+}
+
 } // end anon namespace
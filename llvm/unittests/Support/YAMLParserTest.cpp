@@ -7,6 +7,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/YAMLParser.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/MemoryBuffer.h"
@@ -216,6 +217,44 @@ TEST(YAMLParser, NullTerminatedBlockScalars) {
   EXPECT_EQ(Value.data()[Value.size()], '\0');
 }
 
+TEST(YAMLParser, ParsesStreamOfDocuments) {
+  // The documents of a stream share their memory, and %TAG directives only
+  // apply to the document they precede.
+  SourceMgr SM;
+  yaml::Stream Stream("%TAG ! tag:example.com,2000:\n"
+                      "--- !foo\n"
+                      "a: |\n  block\n"
+                      "--- !foo\n"
+                      "b: [1, 2]\n"
+                      "...\n"
+                      "--- !!str\n"
+                      "c\n",
+                      SM);
+  std::vector<std::string> Tags;
+  std::vector<std::string> Values;
+  SmallString<8> Storage;
+  for (yaml::Document &Doc : Stream) {
+    yaml::Node *Root = Doc.getRoot();
+    ASSERT_NE(Root, nullptr);
+    Tags.push_back(Root->getVerbatimTag());
+    if (auto *Map = dyn_cast<yaml::MappingNode>(Root)) {
+      for (yaml::KeyValueNode &KV : *Map) {
+        if (auto *Block = dyn_cast<yaml::BlockScalarNode>(KV.getValue()))
+          Values.push_back(Block->getValue().str());
+        else
+          Values.push_back(
+              cast<yaml::ScalarNode>(KV.getKey())->getValue(Storage).str());
+      }
+    } else {
+      Values.push_back(cast<yaml::ScalarNode>(Root)->getValue(Storage).str());
+    }
+  }
+  EXPECT_FALSE(Stream.failed());
+  EXPECT_EQ(Tags, std::vector<std::string>({"tag:example.com,2000:foo", "!foo",
+                                            "tag:yaml.org,2002:str"}));
+  EXPECT_EQ(Values, std::vector<std::string>({"block\n", "b", "c"}));
+}
+
 TEST(YAMLParser, HandlesEndOfFileGracefully) {
   ExpectParseError("In string starting with EOF", "[\"");
   ExpectParseError("In string hitting EOF", "[\"   ");
@@ -9,6 +9,8 @@
 #include "llvm/Support/xxhash.h"
 #include "gtest/gtest.h"
 
+#include <vector>
+
 using namespace llvm;
 
 TEST(xxhashTest, Basic) {
@@ -61,3 +63,67 @@ TEST(xxhashTest, xxh3) {
   F(2243, 0x0979f786a24edde7);
 #undef F
 }
+
+TEST(xxhashTest, xxh3_128bits) {
+  constexpr size_t size = 2243;
+  uint8_t a[size];
+  uint64_t x = 1;
+  for (size_t i = 0; i < size; ++i) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    a[i] = uint8_t(x);
+  }
+
+#define F(len, expected_low64, expected_high64)                                \
+  EXPECT_EQ((XXH128_hash_t{uint64_t(expected_low64),                           \
+                           uint64_t(expected_high64)}),                        \
+            xxh3_128bits(ArrayRef(a, size_t(len))))
+  F(0, 0x6001c324468d497f, 0x99aa06d3014798d8);
+  F(1, 0xd0d496e05c553485, 0x9b0498cbe3839bec);
+  F(2, 0x84d625edb7055eac, 0x39f31ddb50a50629);
+  F(3, 0x6ea2d59aca5c3778, 0xda144489d8121038);
+  F(4, 0x32155062b0846a5f, 0xbdb46f15727afe0b);
+  F(5, 0xe35cd2b821465457, 0x692936e1d54d37b3);
+  F(6, 0x9cfeb06724ae4d1e, 0x15d058ede626bb51);
+  F(7, 0xbd8dad0bc6752811, 0xa9a87eb9dfc14607);
+  F(8, 0xb32074cdf9d2383e, 0x7db9ec143bb8a407);
+  F(9, 0x3828db28cee43c33, 0x4e7373480678d263);
+  F(16, 0x98b6ea429419ec79, 0xab12683e09d8b18d);
+  F(17, 0x5d902693cf8543b0, 0xfe121e16f8823440);
+  F(32, 0x3cb5d37bb7617448, 0x78ce93179ef4a64e);
+  F(33, 0x069d582adaf2d22f, 0xc128585a3c201675);
+  F(64, 0x56eb82b152581d2b, 0xc71eab3d2a2d5857);
+  F(65, 0x5295b67f9bb9891b, 0xf8db69ec68d789cb);
+  F(96, 0x2777d92bdc00d119, 0xebe7afde5ee22db4);
+  F(97, 0x12d4faccd714e159, 0x4c782d3e6f870126);
+  F(128, 0x1e155a0bb4fc02a7, 0xd324f43755151b52);
+  F(129, 0x088b8c6fb17ddd22, 0x188c4a4e2302a3fa);
+  F(403, 0xcefeb3ffa532ad8c, 0x563f52f3179e382e);
+  F(512, 0xcdfa6b6268e3650f, 0x803ec34ea3edec1a);
+  F(513, 0x4bb5d42742f9765f, 0xe780a012a93c3145);
+  F(2048, 0x330ce110cbb79eae, 0xb46e2bc609cccc5f);
+  F(2049, 0x3ba6afa0249fef9a, 0xda0e5debded2ff7b);
+  F(2240, 0xd61d4d2a94e926a8, 0x7718efbee45c4a34);
+  F(2243, 0x0979f786a24edde7, 0xa3f3efdb91cbfa78);
+#undef F
+}
+
+TEST(xxhashTest, xxh3Long) {
+  // Inputs longer than 240 bytes go through the (possibly vectorized)
+  // accumulate loop, which is shared by both variants. For those the low half
+  // of the 128-bit hash is the 64-bit hash.
+  std::vector<uint8_t> a(1 << 20);
+  uint64_t x = 1;
+  for (uint8_t &c : a) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    c = uint8_t(x);
+  }
+  for (size_t len : {241, 1024, 1025, 65536, 100003, 1 << 20}) {
+    ArrayRef<uint8_t> data(a.data() + a.size() - len, len);
+    EXPECT_EQ(xxh3_64bits(data), xxh3_128bits(data).low64) << len;
+  }
+  EXPECT_EQ(uint64_t(0xdea4d262feb0e985), xxh3_64bits(a));
+}
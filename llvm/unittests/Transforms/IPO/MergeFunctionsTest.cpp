@@ -0,0 +1,316 @@
+//===- MergeFunctionsTest.cpp - Unit tests for MergeFunctions -------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO/MergeFunctions.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+extern cl::opt<bool> MergeFunctionsParameterize;
+extern cl::opt<unsigned> MergeFunctionsMaxParams;
+extern cl::opt<unsigned> MergeFunctionsMaxGroups;
+
+namespace {
+
+// @a, @b and @c only differ in a constant, a global they load from and a
+// callee, and call themselves. @d stores to a global where the others load.
+const char *ModuleString = R"(
+  @g1 = global i32 1
+  @g2 = global i32 2
+
+  declare i32 @f1(i32)
+  declare i32 @f2(i32)
+
+  define i32 @a(i32 %x, i32 %n) {
+  entry:
+    %c = icmp eq i32 %n, 0
+    br i1 %c, label %exit, label %loop
+  loop:
+    %l = load i32, ptr @g1
+    %m = mul i32 %x, 7
+    %s = add i32 %m, %l
+    %t = call i32 @f1(i32 %s)
+    %n1 = sub i32 %n, 1
+    %r = call i32 @a(i32 %t, i32 %n1)
+    br label %exit
+  exit:
+    %p = phi i32 [ %x, %entry ], [ %r, %loop ]
+    ret i32 %p
+  }
+
+  define i32 @b(i32 %x, i32 %n) {
+  entry:
+    %c = icmp eq i32 %n, 0
+    br i1 %c, label %exit, label %loop
+  loop:
+    %l = load i32, ptr @g2
+    %m = mul i32 %x, 11
+    %s = add i32 %m, %l
+    %t = call i32 @f2(i32 %s)
+    %n1 = sub i32 %n, 1
+    %r = call i32 @b(i32 %t, i32 %n1)
+    br label %exit
+  exit:
+    %p = phi i32 [ %x, %entry ], [ %r, %loop ]
+    ret i32 %p
+  }
+
+  define i32 @c(i32 %x, i32 %n) {
+  entry:
+    %c = icmp eq i32 %n, 0
+    br i1 %c, label %exit, label %loop
+  loop:
+    %l = load i32, ptr @g1
+    %m = mul i32 %x, 13
+    %s = add i32 %m, %l
+    %t = call i32 @f2(i32 %s)
+    %n1 = sub i32 %n, 1
+    %r = call i32 @c(i32 %t, i32 %n1)
+    br label %exit
+  exit:
+    %p = phi i32 [ %x, %entry ], [ %r, %loop ]
+    ret i32 %p
+  }
+
+  define i32 @d(i32 %x, i32 %n) {
+  entry:
+    %c = icmp eq i32 %n, 0
+    br i1 %c, label %exit, label %loop
+  loop:
+    store i32 %x, ptr @g1
+    %m = mul i32 %x, 7
+    %s = add i32 %m, %n
+    %t = call i32 @f1(i32 %s)
+    %n1 = sub i32 %n, 1
+    %r = call i32 @d(i32 %t, i32 %n1)
+    br label %exit
+  exit:
+    %p = phi i32 [ %x, %entry ], [ %r, %loop ]
+    ret i32 %p
+  }
+)";
+
+// @a, @b and @c only differ in a constant and have debug info. @a has a
+// variable.
+const char *DebugInfoModuleString = R"(
+  define i32 @a(i32 %x) !dbg !3 {
+    %m = mul i32 %x, 7, !dbg !4
+    %a = add i32 %m, 1, !dbg !4
+    %s = shl i32 %a, 2, !dbg !4
+    %o = or i32 %s, 5, !dbg !4
+    %y = xor i32 %o, %x, !dbg !4
+    %l = lshr i32 %y, 3, !dbg !4
+    %n = and i32 %l, 255, !dbg !4
+    %r = sub i32 %n, %m, !dbg !4
+    ret i32 %r, !dbg !4
+  }
+
+  define i32 @b(i32 %x) !dbg !6 {
+    %m = mul i32 %x, 11, !dbg !7
+    %a = add i32 %m, 1, !dbg !7
+    %s = shl i32 %a, 2, !dbg !7
+    %o = or i32 %s, 5, !dbg !7
+    %y = xor i32 %o, %x, !dbg !7
+    %l = lshr i32 %y, 3, !dbg !7
+    %n = and i32 %l, 255, !dbg !7
+    %r = sub i32 %n, %m, !dbg !7
+    ret i32 %r, !dbg !7
+  }
+
+  define i32 @c(i32 %x) !dbg !8 {
+    %m = mul i32 %x, 13, !dbg !9
+    %a = add i32 %m, 1, !dbg !9
+    %s = shl i32 %a, 2, !dbg !9
+    %o = or i32 %s, 5, !dbg !9
+    %y = xor i32 %o, %x, !dbg !9
+    %l = lshr i32 %y, 3, !dbg !9
+    %n = and i32 %l, 255, !dbg !9
+    %r = sub i32 %n, %m, !dbg !9
+    ret i32 %r, !dbg !9
+  }
+
+  !llvm.dbg.cu = !{!0}
+  !llvm.module.flags = !{!2}
+  !0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1)
+  !1 = !DIFile(filename: "test.c", directory: "")
+  !2 = !{i32 1, !"Debug Info Version", i32 3}
+  !3 = distinct !DISubprogram(name: "a", scope: !1, file: !1, line: 1, scopeLine: 1, unit: !0, spFlags: DISPFlagDefinition, retainedNodes: !{!5})
+  !4 = !DILocation(line: 2, scope: !3)
+  !5 = !DILocalVariable(name: "m", scope: !3, file: !1, line: 2)
+  !6 = distinct !DISubprogram(name: "b", scope: !1, file: !1, line: 11, scopeLine: 11, unit: !0, spFlags: DISPFlagDefinition)
+  !7 = !DILocation(line: 12, scope: !6)
+  !8 = distinct !DISubprogram(name: "c", scope: !1, file: !1, line: 21, scopeLine: 21, unit: !0, spFlags: DISPFlagDefinition)
+  !9 = !DILocation(line: 22, scope: !8)
+)";
+
+struct RemarkHandler : DiagnosticHandler {
+  SmallVector<std::string, 4> Remarks;
+
+  bool handleDiagnostics(const DiagnosticInfo &DI) override {
+    if (auto *Remark = dyn_cast<DiagnosticInfoOptimizationBase>(&DI))
+      Remarks.push_back(Remark->getMsg());
+    return true;
+  }
+  bool isMissedOptRemarkEnabled(StringRef) const override { return true; }
+  bool isPassedOptRemarkEnabled(StringRef) const override { return true; }
+  bool isAnyRemarkEnabled() const override { return true; }
+};
+
+std::unique_ptr<Module>
+runMergeFunctions(LLVMContext &Ctx, unsigned MaxParams,
+                  const char *IR = ModuleString) {
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(IR, Err, Ctx);
+  if (!M) {
+    Err.print("MergeFunctionsTest", errs());
+    return nullptr;
+  }
+
+  bool OldParameterize = MergeFunctionsParameterize;
+  unsigned OldMaxParams = MergeFunctionsMaxParams;
+  MergeFunctionsParameterize = true;
+  MergeFunctionsMaxParams = MaxParams;
+
+  FunctionAnalysisManager FAM;
+  ModuleAnalysisManager MAM;
+  FAM.registerPass([&] { return TargetIRAnalysis(); });
+  FAM.registerPass([&] { return ModuleAnalysisManagerFunctionProxy(MAM); });
+  FAM.registerPass([&] { return PassInstrumentationAnalysis(); });
+  MAM.registerPass([&] { return FunctionAnalysisManagerModuleProxy(FAM); });
+  MAM.registerPass([&] { return PassInstrumentationAnalysis(); });
+  ModulePassManager MPM;
+  MPM.addPass(MergeFunctionsPass());
+  MPM.run(*M, MAM);
+
+  MergeFunctionsParameterize = OldParameterize;
+  MergeFunctionsMaxParams = OldMaxParams;
+  return M;
+}
+
+// Returns the call of F if it is a thunk.
+CallInst *getThunkCall(Function &F) {
+  if (F.size() != 1 || F.front().size() != 2)
+    return nullptr;
+  return dyn_cast<CallInst>(&F.front().front());
+}
+
+TEST(MergeFunctionsTest, Parameterized) {
+  LLVMContext Ctx;
+  auto Handler = std::make_unique<RemarkHandler>();
+  RemarkHandler &Remarks = *Handler;
+  Ctx.setDiagnosticHandler(std::move(Handler));
+  std::unique_ptr<Module> M = runMergeFunctions(Ctx, 4);
+  ASSERT_TRUE(M);
+  EXPECT_FALSE(verifyModule(*M, &errs()));
+
+  // @a differs from @b in all four columns, and from @c in the constant, the
+  // callee and the reference to itself.
+  Function *Merged = M->getFunction("a.merged");
+  ASSERT_TRUE(Merged);
+  EXPECT_TRUE(Merged->hasPrivateLinkage());
+  EXPECT_EQ(Merged->arg_size(), 6u);
+  for (StringRef Name : {"a", "b", "c"}) {
+    SCOPED_TRACE(Name);
+    Function *F = M->getFunction(Name);
+    CallInst *CI = getThunkCall(*F);
+    ASSERT_TRUE(CI);
+    EXPECT_EQ(CI->getCalledFunction(), Merged);
+    EXPECT_EQ(CI->getArgOperand(0), F->getArg(0));
+    EXPECT_EQ(CI->getArgOperand(1), F->getArg(1));
+    // Each function still calls itself.
+    EXPECT_TRUE(is_contained(CI->args(), F));
+  }
+  EXPECT_FALSE(getThunkCall(*M->getFunction("d")));
+  ASSERT_EQ(Remarks.Remarks.size(), 1u);
+  EXPECT_TRUE(StringRef(Remarks.Remarks[0])
+                  .starts_with("merged 3 functions into a.merged with 4 "
+                               "parameters"));
+}
+
+TEST(MergeFunctionsTest, ParameterizedMaxParams) {
+  // @b needs four parameters, @a and @c only three.
+  LLVMContext Ctx;
+  std::unique_ptr<Module> M = runMergeFunctions(Ctx, 3);
+  ASSERT_TRUE(M);
+  EXPECT_FALSE(verifyModule(*M, &errs()));
+
+  Function *Merged = M->getFunction("a.merged");
+  ASSERT_TRUE(Merged);
+  EXPECT_EQ(Merged->arg_size(), 5u);
+  EXPECT_TRUE(getThunkCall(*M->getFunction("a")));
+  EXPECT_FALSE(getThunkCall(*M->getFunction("b")));
+  EXPECT_TRUE(getThunkCall(*M->getFunction("c")));
+
+  M = runMergeFunctions(Ctx, 0);
+  ASSERT_TRUE(M);
+  EXPECT_FALSE(M->getFunction("a.merged"));
+}
+
+TEST(MergeFunctionsTest, ParameterizedMaxGroups) {
+  // @b doesn't fit into the group of @a, so @c is only compared with the group
+  // of @b when one group is tried.
+  unsigned OldMaxGroups = MergeFunctionsMaxGroups;
+  MergeFunctionsMaxGroups = 1;
+  LLVMContext Ctx;
+  std::unique_ptr<Module> M = runMergeFunctions(Ctx, 3);
+  MergeFunctionsMaxGroups = OldMaxGroups;
+  ASSERT_TRUE(M);
+  EXPECT_FALSE(verifyModule(*M, &errs()));
+
+  EXPECT_FALSE(M->getFunction("a.merged"));
+  Function *Merged = M->getFunction("b.merged");
+  ASSERT_TRUE(Merged);
+  EXPECT_EQ(getThunkCall(*M->getFunction("b"))->getCalledFunction(), Merged);
+  EXPECT_EQ(getThunkCall(*M->getFunction("c"))->getCalledFunction(), Merged);
+  EXPECT_FALSE(getThunkCall(*M->getFunction("a")));
+}
+
+TEST(MergeFunctionsTest, ParameterizedDebugInfo) {
+  LLVMContext Ctx;
+  std::unique_ptr<Module> M =
+      runMergeFunctions(Ctx, 4, DebugInfoModuleString);
+  ASSERT_TRUE(M);
+  EXPECT_FALSE(verifyModule(*M, &errs()));
+
+  // The merged body keeps the subprogram of @a with its variable, and the
+  // thunk of @a gets one of its own.
+  Function *Merged = M->getFunction("a.merged");
+  ASSERT_TRUE(Merged);
+  DISubprogram *MergedSP = Merged->getSubprogram();
+  ASSERT_TRUE(MergedSP);
+  EXPECT_EQ(MergedSP->getName(), "a");
+  EXPECT_EQ(MergedSP->getRetainedNodes().size(), 1u);
+  for (StringRef Name : {"a", "b", "c"}) {
+    SCOPED_TRACE(Name);
+    Function *F = M->getFunction(Name);
+    CallInst *CI = getThunkCall(*F);
+    ASSERT_TRUE(CI);
+    DISubprogram *SP = F->getSubprogram();
+    ASSERT_TRUE(SP);
+    EXPECT_NE(SP, MergedSP);
+    EXPECT_TRUE(SP->isDistinct());
+    EXPECT_EQ(SP->getName(), Name);
+    EXPECT_TRUE(SP->getRetainedNodes().empty());
+    ASSERT_TRUE(CI->getDebugLoc());
+    EXPECT_EQ(CI->getDebugLoc()->getScope(), SP);
+  }
+}
+
+} // end anonymous namespace
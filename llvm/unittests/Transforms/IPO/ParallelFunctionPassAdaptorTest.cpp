@@ -0,0 +1,389 @@
+//===- ParallelFunctionPassAdaptorTest.cpp --------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO/ParallelFunctionPassAdaptor.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#include <map>
+
+using namespace llvm;
+
+namespace {
+
+// SimplifyCFG turns the switch in @lookup into a load from a new global, and
+// @indirect takes the address of one of its blocks, so it is not moved.
+const char *ModuleString = R"(
+  target datalayout = "n8:16:32:64"
+
+  @g = global i32 1
+  @0 = private constant i32 2
+
+  define i32 @lookup(i32 %x) !dbg !6 {
+  entry:
+    switch i32 %x, label %default [
+      i32 0, label %a
+      i32 1, label %b
+      i32 2, label %c
+      i32 3, label %d
+    ], !dbg !7
+  a:
+    br label %exit
+  b:
+    br label %exit
+  c:
+    br label %exit
+  d:
+    br label %exit
+  default:
+    br label %exit
+  exit:
+    %r = phi i32 [ 7, %a ], [ 11, %b ], [ 13, %c ], [ 17, %d ], [ 0, %default ]
+    ret i32 %r, !dbg !7
+  }
+
+  define i32 @fold(i32 %a) !dbg !8 {
+    %b = add i32 %a, 0, !dbg !9
+    %c = mul i32 %b, 1, !dbg !9
+    ret i32 %c, !dbg !9
+  }
+
+  define i32 @user() !dbg !10 {
+    %v = load i32, ptr @g, !dbg !11
+    %r = call i32 @fold(i32 %v), !dbg !11
+    %p = load i32, ptr @0, !dbg !11
+    %s = add i32 %r, %p, !dbg !11
+    ret i32 %s, !dbg !11
+  }
+
+  define ptr @indirect(i1 %c) {
+  entry:
+    br i1 %c, label %t, label %f
+  t:
+    br label %f
+  f:
+    %x = add i32 0, 0
+    ret ptr blockaddress(@indirect, %t)
+  }
+
+  !llvm.dbg.cu = !{!0}
+  !llvm.module.flags = !{!2, !3}
+
+  !0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1,
+                               producer: "test", isOptimized: true,
+                               runtimeVersion: 0, emissionKind: FullDebug)
+  !1 = !DIFile(filename: "test.c", directory: "/")
+  !2 = !{i32 2, !"Debug Info Version", i32 3}
+  !3 = !{i32 7, !"Dwarf Version", i32 5}
+  !4 = !{}
+  !5 = !DISubroutineType(types: !4)
+  !6 = distinct !DISubprogram(name: "lookup", scope: !1, file: !1, line: 1,
+                              type: !5, scopeLine: 1, unit: !0,
+                              spFlags: DISPFlagDefinition | DISPFlagOptimized)
+  !7 = !DILocation(line: 2, column: 3, scope: !6)
+  !8 = distinct !DISubprogram(name: "fold", scope: !1, file: !1, line: 5,
+                              type: !5, scopeLine: 5, unit: !0,
+                              spFlags: DISPFlagDefinition | DISPFlagOptimized)
+  !9 = !DILocation(line: 6, column: 3, scope: !8)
+  !10 = distinct !DISubprogram(name: "user", scope: !1, file: !1, line: 9,
+                               type: !5, scopeLine: 9, unit: !0,
+                               spFlags: DISPFlagDefinition | DISPFlagOptimized)
+  !11 = !DILocation(line: 10, column: 3, scope: !10)
+)";
+
+const char *FunctionPipeline = "instcombine,simplifycfg<switch-to-lookup>";
+
+// Each function changes a global that another function loads from or calls.
+const char *GlobalChangesString = R"(
+  @a = global i32 1
+  @b = global i32 2
+
+  declare void @ext()
+
+  define i32 @f() {
+    %v = load i32, ptr @a
+    call void @ext()
+    ret i32 %v
+  }
+
+  define i32 @g() {
+    %v = load i32, ptr @b
+    %r = call i32 @h()
+    ret i32 %r
+  }
+
+  define i32 @h() {
+    %r = call i32 @f()
+    ret i32 %r
+  }
+)";
+
+// Raises the alignment of the globals its function loads from, like
+// InstCombine does for the source of a memcpy, and marks the functions it
+// calls nounwind, like the passes that emit library calls add attributes.
+struct RaiseAlignmentPass : PassInfoMixin<RaiseAlignmentPass> {
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &) {
+    for (Instruction &I : instructions(F)) {
+      if (auto *LI = dyn_cast<LoadInst>(&I)) {
+        if (auto *GV = dyn_cast<GlobalVariable>(LI->getPointerOperand())) {
+          GV->setAlignment(Align(16));
+          LI->setAlignment(Align(16));
+        }
+      } else if (auto *CI = dyn_cast<CallInst>(&I)) {
+        if (Function *Callee = CI->getCalledFunction())
+          Callee->addFnAttr(Attribute::NoUnwind);
+      }
+    }
+    return PreservedAnalyses::none();
+  }
+};
+
+std::unique_ptr<Module> runPasses(LLVMContext &Ctx, ModulePassManager &MPM,
+                                  StringRef IR = ModuleString) {
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(IR, Err, Ctx);
+  if (!M) {
+    Err.print("ParallelFunctionPassAdaptorTest", errs());
+    return nullptr;
+  }
+
+  LoopAnalysisManager LAM;
+  FunctionAnalysisManager FAM;
+  CGSCCAnalysisManager CGAM;
+  ModuleAnalysisManager MAM;
+  PassBuilder PB;
+  PB.registerModuleAnalyses(MAM);
+  PB.registerCGSCCAnalyses(CGAM);
+  PB.registerFunctionAnalyses(FAM);
+  PB.registerLoopAnalyses(LAM);
+  PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+  MPM.run(*M, MAM);
+  return M;
+}
+
+std::unique_ptr<Module> runPipeline(LLVMContext &Ctx, StringRef Pipeline) {
+  PassBuilder PB;
+  ModulePassManager MPM;
+  if (Error E = PB.parsePassPipeline(MPM, Pipeline)) {
+    ADD_FAILURE() << toString(std::move(E));
+    return nullptr;
+  }
+  return runPasses(Ctx, MPM);
+}
+
+struct TestPipeline : ParallelFunctionPipeline {
+  PassBuilder PB;
+
+  TestPipeline(bool RaiseAlignment = false) {
+    PB.registerModuleAnalyses(MAM);
+    PB.registerCGSCCAnalyses(CGAM);
+    PB.registerFunctionAnalyses(FAM);
+    PB.registerLoopAnalyses(LAM);
+    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+    if (RaiseAlignment)
+      FPM.addPass(RaiseAlignmentPass());
+    else
+      cantFail(PB.parsePassPipeline(FPM, FunctionPipeline));
+  }
+};
+
+std::string printModule(const Module &M) {
+  std::string Str;
+  raw_string_ostream OS(Str);
+  M.print(OS, nullptr);
+  return Str;
+}
+
+std::unique_ptr<Module> runRaiseAlignment(LLVMContext &Ctx) {
+  ModulePassManager MPM;
+  MPM.addPass(createModuleToFunctionPassAdaptor(RaiseAlignmentPass()));
+  return runPasses(Ctx, MPM, GlobalChangesString);
+}
+
+void expectGlobalChanges(const Module &M) {
+  for (StringRef Name : {"a", "b"})
+    EXPECT_EQ(M.getGlobalVariable(Name)->getAlign(), MaybeAlign(16)) << Name;
+  for (StringRef Name : {"ext", "f", "h"})
+    EXPECT_TRUE(M.getFunction(Name)->doesNotThrow()) << Name;
+  EXPECT_FALSE(M.getFunction("g")->doesNotThrow());
+}
+
+// A cache hit reads the file of the entry, a miss replaces it, so the IDs of
+// the files tell which functions were optimized again.
+std::map<std::string, sys::fs::UniqueID> getCacheEntries(StringRef CacheDir) {
+  std::map<std::string, sys::fs::UniqueID> Entries;
+  std::error_code EC;
+  for (sys::fs::directory_iterator I(CacheDir, EC), E; I != E && !EC;
+       I.increment(EC)) {
+    if (!sys::path::filename(I->path()).starts_with("llvmcache-"))
+      continue;
+    sys::fs::UniqueID ID;
+    EXPECT_FALSE(sys::fs::getUniqueID(I->path(), ID));
+    Entries.emplace(I->path(), ID);
+  }
+  EXPECT_FALSE(EC);
+  return Entries;
+}
+
+TEST(ParallelFunctionPassAdaptorTest, MatchesSequentialPipeline) {
+  LLVMContext Ctx;
+  std::unique_ptr<Module> Sequential =
+      runPipeline(Ctx, (Twine("function(") + FunctionPipeline + ")").str());
+  ASSERT_TRUE(Sequential);
+  ASSERT_TRUE(Sequential->getGlobalVariable("switch.table.lookup", true));
+
+  for (unsigned Threads : {1, 2, 3}) {
+    SCOPED_TRACE(Threads);
+    LLVMContext Ctx;
+    std::unique_ptr<Module> M = runPipeline(
+        Ctx, (Twine("parallel-function<") + Twine(Threads) + ">(" +
+              FunctionPipeline + ")")
+                 .str());
+    ASSERT_TRUE(M);
+    EXPECT_FALSE(verifyModule(*M, &errs()));
+    EXPECT_EQ(printModule(*Sequential), printModule(*M));
+
+    // The subprograms still refer to the one compile unit of the module.
+    NamedMDNode *CUs = M->getNamedMetadata("llvm.dbg.cu");
+    ASSERT_EQ(CUs->getNumOperands(), 1u);
+    for (Function &F : *M)
+      if (DISubprogram *SP = F.getSubprogram())
+        EXPECT_EQ(SP->getUnit(), CUs->getOperand(0));
+  }
+}
+
+TEST(ParallelFunctionPassAdaptorTest, MergesGlobalChanges) {
+  LLVMContext Ctx;
+  std::unique_ptr<Module> Sequential = runRaiseAlignment(Ctx);
+  ASSERT_TRUE(Sequential);
+  expectGlobalChanges(*Sequential);
+
+  // The changes to a global are kept whichever partition made them, and
+  // whether or not it is also the one that optimizes the global.
+  for (unsigned Threads : {1, 2, 3}) {
+    SCOPED_TRACE(Threads);
+    LLVMContext Ctx;
+    ModulePassManager MPM;
+    MPM.addPass(ParallelModuleToFunctionPassAdaptor(
+        [] { return std::make_unique<TestPipeline>(/*RaiseAlignment=*/true); },
+        Threads));
+    std::unique_ptr<Module> M = runPasses(Ctx, MPM, GlobalChangesString);
+    ASSERT_TRUE(M);
+    EXPECT_FALSE(verifyModule(*M, &errs()));
+    EXPECT_EQ(printModule(*Sequential), printModule(*M));
+    expectGlobalChanges(*M);
+  }
+}
+
+TEST(ParallelFunctionPassAdaptorTest, CachesFunctions) {
+  SmallString<128> CacheDir;
+  ASSERT_FALSE(
+      sys::fs::createUniqueDirectory("parallel-function-cache", CacheDir));
+
+  auto RunCached = [&](LLVMContext &Ctx, StringRef IR) {
+    ModulePassManager MPM;
+    MPM.addPass(ParallelModuleToFunctionPassAdaptor(
+        [] { return std::make_unique<TestPipeline>(); }, 2,
+        std::string(CacheDir)));
+    return runPasses(Ctx, MPM, IR);
+  };
+
+  LLVMContext Ctx;
+  std::unique_ptr<Module> Sequential =
+      runPipeline(Ctx, (Twine("function(") + FunctionPipeline + ")").str());
+  ASSERT_TRUE(Sequential);
+
+  // @indirect is optimized in place, and not cached.
+  std::map<std::string, sys::fs::UniqueID> Entries;
+  for (unsigned Run = 0; Run != 2; ++Run) {
+    SCOPED_TRACE(Run);
+    LLVMContext Ctx;
+    std::unique_ptr<Module> M = RunCached(Ctx, ModuleString);
+    ASSERT_TRUE(M);
+    EXPECT_FALSE(verifyModule(*M, &errs()));
+    EXPECT_EQ(printModule(*Sequential), printModule(*M));
+    if (Run == 0)
+      Entries = getCacheEntries(CacheDir);
+    else
+      EXPECT_EQ(Entries, getCacheEntries(CacheDir));
+  }
+  EXPECT_EQ(Entries.size(), 3u);
+
+  // Only the function that changed is optimized again.
+  std::string Changed = ModuleString;
+  Changed.replace(Changed.find("[ 11, %b ]"), 10, "[ 12, %b ]");
+  LLVMContext ChangedCtx;
+  std::unique_ptr<Module> M = RunCached(ChangedCtx, Changed);
+  ASSERT_TRUE(M);
+  std::map<std::string, sys::fs::UniqueID> NewEntries =
+      getCacheEntries(CacheDir);
+  EXPECT_EQ(NewEntries.size(), 4u);
+  for (const auto &[Path, ID] : Entries)
+    EXPECT_TRUE(NewEntries.count(Path) && NewEntries.at(Path) == ID);
+
+  sys::fs::remove_directories(CacheDir);
+}
+
+TEST(ParallelFunctionPassAdaptorTest, CachesGlobalChanges) {
+  SmallString<128> CacheDir;
+  ASSERT_FALSE(
+      sys::fs::createUniqueDirectory("parallel-function-cache", CacheDir));
+
+  LLVMContext Ctx;
+  std::unique_ptr<Module> Sequential = runRaiseAlignment(Ctx);
+  ASSERT_TRUE(Sequential);
+
+  // The second run only replays the fragments of the first one, into a module
+  // in which the globals still have their original alignment and attributes.
+  std::map<std::string, sys::fs::UniqueID> Entries;
+  for (unsigned Run = 0; Run != 2; ++Run) {
+    SCOPED_TRACE(Run);
+    LLVMContext Ctx;
+    ModulePassManager MPM;
+    MPM.addPass(ParallelModuleToFunctionPassAdaptor(
+        [] { return std::make_unique<TestPipeline>(/*RaiseAlignment=*/true); },
+        2, std::string(CacheDir)));
+    std::unique_ptr<Module> M = runPasses(Ctx, MPM, GlobalChangesString);
+    ASSERT_TRUE(M);
+    EXPECT_FALSE(verifyModule(*M, &errs()));
+    EXPECT_EQ(printModule(*Sequential), printModule(*M));
+    expectGlobalChanges(*M);
+    if (Run == 0)
+      Entries = getCacheEntries(CacheDir);
+    else
+      EXPECT_EQ(Entries, getCacheEntries(CacheDir));
+  }
+  EXPECT_EQ(Entries.size(), 3u);
+
+  sys::fs::remove_directories(CacheDir);
+}
+
+TEST(ParallelFunctionPassAdaptorTest, ParsePipeline) {
+  PassBuilder PB;
+  ModulePassManager MPM;
+  EXPECT_FALSE(errorToBool(
+      PB.parsePassPipeline(MPM, "parallel-function(no-op-function)")));
+  EXPECT_FALSE(errorToBool(PB.parsePassPipeline(
+      MPM, "parallel-function<4>(function(no-op-function))")));
+  EXPECT_TRUE(errorToBool(
+      PB.parsePassPipeline(MPM, "parallel-function<x>(no-op-function)")));
+  EXPECT_TRUE(errorToBool(
+      PB.parsePassPipeline(MPM, "parallel-function(no-op-module)")));
+}
+
+} // end anonymous namespace